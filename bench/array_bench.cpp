@@ -0,0 +1,105 @@
+#include <benchmark/benchmark.h>
+#include <scaffold/array.h>
+#include <scaffold/memory.h>
+#include <scaffold/segmented_array.h>
+#include <scaffold/vector.h>
+
+#include <string.h>
+
+using namespace fo;
+
+// Grows an array one push_back at a time up to `state.range(0)` bytes of u64s.
+
+// Forwards to the default allocator, but reallocates the way Vector used to: allocate a new block, copy, and
+// free the old block.
+struct CopyingAllocator : public Allocator {
+    void *allocate(AddrUint size, AddrUint align = DEFAULT_ALIGN) override {
+        return memory_globals::default_allocator().allocate(size, align);
+    }
+
+    void *reallocate(void *old_allocation, AddrUint new_size, AddrUint align, AddrUint old_size) override {
+        void *p = allocate(new_size, align);
+        if (old_allocation) {
+            memcpy(p, old_allocation, old_size < new_size ? old_size : new_size);
+            deallocate(old_allocation);
+        }
+        return p;
+    }
+
+    void deallocate(void *p) override { memory_globals::default_allocator().deallocate(p); }
+
+    AddrUint allocated_size(void *p) override {
+        return memory_globals::default_allocator().allocated_size(p);
+    }
+
+    AddrUint total_allocated() override { return SIZE_NOT_TRACKED; }
+};
+
+template <bool copying> static void array_grow(benchmark::State &state) {
+    memory_globals::init();
+    {
+        CopyingAllocator copying_allocator;
+        Allocator &a = copying ? (Allocator &)copying_allocator : memory_globals::default_allocator();
+        const u32 n = u32(state.range(0) / sizeof(u64));
+
+        for (auto _ : state) {
+            Array<u64> arr(a);
+            for (u32 i = 0; i < n; ++i) {
+                push_back(arr, u64(i));
+            }
+            benchmark::DoNotOptimize(data(arr));
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+    memory_globals::shutdown();
+}
+
+template <bool copying> static void vector_grow(benchmark::State &state) {
+    memory_globals::init();
+    {
+        CopyingAllocator copying_allocator;
+        Allocator &a = copying ? (Allocator &)copying_allocator : memory_globals::default_allocator();
+        const u32 n = u32(state.range(0) / sizeof(u64));
+
+        for (auto _ : state) {
+            Vector<u64> v(a);
+            for (u32 i = 0; i < n; ++i) {
+                push_back(v, u64(i));
+            }
+            benchmark::DoNotOptimize(data(v));
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+    memory_globals::shutdown();
+}
+
+// Appends in chunks, never moving an item. Also reads every item back, which goes through the chunk table.
+static void segmented_grow(benchmark::State &state) {
+    memory_globals::init();
+    {
+        const u32 n = u32(state.range(0) / sizeof(u64));
+
+        for (auto _ : state) {
+            SegmentedArray<u64> arr;
+            for (u32 i = 0; i < n; ++i) {
+                push_back(arr, u64(i));
+            }
+            u64 sum = 0;
+            for (u32 i = 0; i < n; ++i) {
+                sum += arr[i];
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK_TEMPLATE(array_grow, true)->Arg(1 << 20)->Arg(1 << 30)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(array_grow, false)->Arg(1 << 20)->Arg(1 << 30)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(vector_grow, true)->Arg(1 << 20)->Arg(1 << 30)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(vector_grow, false)->Arg(1 << 20)->Arg(1 << 30)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(segmented_grow)->Arg(1 << 20)->Arg(1 << 30)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
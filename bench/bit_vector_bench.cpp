@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+#include <scaffold/bit_vector.h>
+#include <scaffold/dypackeduintarray.h>
+#include <scaffold/memory.h>
+
+#include <random>
+
+using namespace fo;
+
+// Queries on `state.range(0)` random bits, half of them set. Build with SCAFFOLD_NATIVE_ARCH to compare the
+// popcnt/BMI2/AVX2 paths against the portable ones.
+
+static void fill_random(BitVector &bv, u32 n) {
+    std::mt19937 rng(3);
+    resize(bv, n);
+    for (u32 i = 0; i < n; ++i) {
+        set(bv, i, rng() & 1);
+    }
+    build_rank_index(bv);
+}
+
+static void rank(benchmark::State &state) {
+    memory_globals::init();
+    {
+        const u32 n = u32(state.range(0));
+        BitVector bv;
+        fill_random(bv, n);
+
+        std::mt19937 rng(7);
+        u64 sum = 0;
+        for (auto _ : state) {
+            sum += rank1(bv, rng() % n);
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+    }
+    memory_globals::shutdown();
+}
+
+static void select(benchmark::State &state) {
+    memory_globals::init();
+    {
+        const u32 n = u32(state.range(0));
+        BitVector bv;
+        fill_random(bv, n);
+        const u32 ones = count(bv);
+
+        std::mt19937 rng(7);
+        u64 sum = 0;
+        for (auto _ : state) {
+            sum += select1(bv, rng() % ones);
+        }
+        benchmark::DoNotOptimize(sum);
+        state.SetItemsProcessed(state.iterations());
+    }
+    memory_globals::shutdown();
+}
+
+static void count_ones(benchmark::State &state) {
+    memory_globals::init();
+    {
+        const u32 n = u32(state.range(0));
+        BitVector bv;
+        fill_random(bv, n);
+        set(bv, 0, !get(bv, 0)); // Drop the index, so count has to count
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(count(bv));
+        }
+        state.SetBytesProcessed(state.iterations() * (n / 8));
+    }
+    memory_globals::shutdown();
+}
+
+// Finding a free slot in a mostly full bitmap, as an allocator does. First with a one-bit DyPackedUintArray
+// read a bit at a time, then with a word-at-a-time scan.
+
+static void find_clear_packed(benchmark::State &state) {
+    memory_globals::init();
+    {
+        const u32 n = u32(state.range(0));
+        DyPackedUintArray<u64> bits(1, n);
+        bits.set_range(0, n, 1);
+        bits.set(n - 1, 0);
+
+        for (auto _ : state) {
+            u32 i = 0;
+            while (bits.get(i) != 0) {
+                ++i;
+            }
+            benchmark::DoNotOptimize(i);
+        }
+        state.SetBytesProcessed(state.iterations() * (n / 8));
+    }
+    memory_globals::shutdown();
+}
+
+static void find_clear_bit_vector(benchmark::State &state) {
+    memory_globals::init();
+    {
+        const u32 n = u32(state.range(0));
+        BitVector bv;
+        resize(bv, n);
+        set_range(bv, 0, n, true);
+        set(bv, n - 1, false);
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(find_first_clear(bv));
+        }
+        state.SetBytesProcessed(state.iterations() * (n / 8));
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK(rank)->Arg(1 << 16)->Arg(1 << 28);
+BENCHMARK(select)->Arg(1 << 16)->Arg(1 << 28);
+BENCHMARK(count_ones)->Arg(1 << 16)->Arg(1 << 24);
+BENCHMARK(find_clear_packed)->Arg(1 << 16);
+BENCHMARK(find_clear_bit_vector)->Arg(1 << 16);
+
+BENCHMARK_MAIN();
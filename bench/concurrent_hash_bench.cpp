@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+#include <scaffold/concurrent_open_hash.h>
+#include <scaffold/memory.h>
+#include <scaffold/open_hash.h>
+
+#include <mutex>
+
+namespace fo {
+
+template <> struct GetNilAndDeleted<u64> {
+    static u64 get_nil() { return 8888; }
+
+    static u64 get_deleted() { return 9999; }
+};
+
+} // namespace fo
+
+using namespace fo;
+
+static uint32_t hash_u64(const u64 &k) { return uint32_t(k * 0x9E3779B97F4A7C15ull >> 32); }
+static bool equal_u64(const u64 &a, const u64 &b) { return a == b; }
+
+// Keys are in [10000, 10000 + max_entries) to stay clear of the nil and deleted keys.
+constexpr u64 key_base = 10000;
+
+using ConcurrentTable = ConcurrentOpenHash<u64, u64>;
+
+static ConcurrentTable *concurrent_table = nullptr;
+
+struct LockedOpenHash {
+    std::mutex mutex;
+    OpenHash<u64, u64> h;
+
+    LockedOpenHash(Allocator &a)
+        : h(a, 16, hash_u64, equal_u64) {}
+};
+
+static LockedOpenHash *locked_table = nullptr;
+
+// All threads look up keys from the table. Thread 0 additionally updates a value every `write_every` lookups
+// if `write_every` is non-zero, to model a rarely updated routing table.
+static void concurrent_open_hash_find(benchmark::State &bm_state) {
+    const u64 max_entries = bm_state.range(0);
+    const u64 write_every = bm_state.range(1);
+
+    if (bm_state.thread_index() == 0) {
+        memory_globals::init();
+        auto &alloc = memory_globals::default_allocator();
+        concurrent_table = make_new<ConcurrentTable>(alloc, alloc, uint32_t(max_entries), hash_u64, equal_u64);
+        for (u64 i = 0; i < max_entries; ++i) {
+            concurrent_open_hash::set(*concurrent_table, key_base + i, i);
+        }
+    }
+
+    u64 k = u64(bm_state.thread_index()) * 7919;
+    u64 n = 0;
+
+    for (auto _ : bm_state) {
+        u64 v;
+        bool found = concurrent_open_hash::get(*concurrent_table, key_base + k % max_entries, v);
+        benchmark::DoNotOptimize(found);
+        benchmark::DoNotOptimize(v);
+        k += 104729;
+
+        if (write_every != 0 && bm_state.thread_index() == 0 && ++n % write_every == 0) {
+            concurrent_open_hash::set(*concurrent_table, key_base + k % max_entries, n);
+        }
+    }
+
+    bm_state.SetItemsProcessed(bm_state.iterations());
+
+    if (bm_state.thread_index() == 0) {
+        make_delete(memory_globals::default_allocator(), concurrent_table);
+        memory_globals::shutdown();
+    }
+}
+
+// Same access pattern with an OpenHash guarded by a mutex, which is what we did before.
+static void locked_open_hash_find(benchmark::State &bm_state) {
+    const u64 max_entries = bm_state.range(0);
+    const u64 write_every = bm_state.range(1);
+
+    if (bm_state.thread_index() == 0) {
+        memory_globals::init();
+        locked_table = make_new<LockedOpenHash>(memory_globals::default_allocator(),
+                                                memory_globals::default_allocator());
+        for (u64 i = 0; i < max_entries; ++i) {
+            open_hash::set(locked_table->h, key_base + i, i);
+        }
+    }
+
+    u64 k = u64(bm_state.thread_index()) * 7919;
+    u64 n = 0;
+
+    for (auto _ : bm_state) {
+        {
+            std::lock_guard<std::mutex> lk(locked_table->mutex);
+            auto idx = open_hash::find(locked_table->h, key_base + k % max_entries);
+            benchmark::DoNotOptimize(idx);
+        }
+        k += 104729;
+
+        if (write_every != 0 && bm_state.thread_index() == 0 && ++n % write_every == 0) {
+            std::lock_guard<std::mutex> lk(locked_table->mutex);
+            open_hash::set(locked_table->h, key_base + k % max_entries, n);
+        }
+    }
+
+    bm_state.SetItemsProcessed(bm_state.iterations());
+
+    if (bm_state.thread_index() == 0) {
+        make_delete(memory_globals::default_allocator(), locked_table);
+        memory_globals::shutdown();
+    }
+}
+
+BENCHMARK(concurrent_open_hash_find)
+    ->Args({ 1 << 16, 0 })
+    ->Args({ 1 << 16, 1024 })
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+BENCHMARK(locked_open_hash_find)->Args({ 1 << 16, 0 })->Args({ 1 << 16, 1024 })->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
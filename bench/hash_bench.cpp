@@ -4,8 +4,10 @@
 #include <scaffold/debug.h>
 #include <scaffold/hash.h>
 #include <scaffold/memory.h>
+#include <scaffold/multi_hash.h>
 #include <scaffold/murmur_hash.h>
 #include <scaffold/open_hash.h>
+#include <scaffold/perfect_hash.h>
 #include <scaffold/pod_hash.h>
 #include <scaffold/pod_hash_usuals.h>
 
@@ -149,6 +151,445 @@ static void pod_hash_search(benchmark::State &bm_state) {
     memory_globals::shutdown();
 }
 
+// -- Batched lookups. A batch of random keys is looked up per iteration, either with a loop of single `find`
+// calls or with one `find_batch`. The larger table sizes are meant to exceed the last level cache. Each
+// iteration takes the next batch from a large pool of keys so that we don't keep hitting the slots that the
+// previous iteration brought into cache.
+
+constexpr uint32_t lookup_batch_size = 4096;
+constexpr uint32_t lookup_pool_size = lookup_batch_size * 1024;
+
+static void fill_random_keys(u64 *keys, uint32_t count, u64 max_key) {
+    u64 x = SCAFFOLD_SEED;
+    for (uint32_t i = 0; i < count; ++i) {
+        // xorshift64
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        keys[i] = x % max_key;
+    }
+}
+
+static u32 scatter_u64(const u64 &k) { return u32((k * 0x9E3779B97F4A7C15ull) >> 32); }
+
+template <bool batched> static void open_hash_find_many(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+
+        const uint64_t max_entries = bm_state.range(0);
+
+        OpenHash<u64, u64> h{ alloc, uint32_t(max_entries), scatter_u64,
+                              [](const u64 &i, const u64 &j) { return i == j; } };
+
+        // Keep clear of the nil and deleted keys
+        for (u64 i = 0; i < max_entries; ++i) {
+            open_hash::set(h, i + 10000, i);
+        }
+
+        Array<u64> keys(alloc, lookup_pool_size);
+        Array<u32> indices(alloc, lookup_batch_size);
+        fill_random_keys(data(keys), lookup_pool_size, max_entries);
+        for (u64 &k : keys) {
+            k += 10000;
+        }
+
+        u32 offset = 0;
+        for (auto _ : bm_state) {
+            const u64 *batch = data(keys) + offset;
+            offset = (offset + lookup_batch_size) % lookup_pool_size;
+
+            if (batched) {
+                open_hash::find_batch(h, batch, lookup_batch_size, data(indices));
+            } else {
+                for (u32 i = 0; i < lookup_batch_size; ++i) {
+                    indices[i] = open_hash::find(h, batch[i]);
+                }
+            }
+            benchmark::DoNotOptimize(data(indices));
+            benchmark::ClobberMemory();
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * lookup_batch_size);
+    }
+    memory_globals::shutdown();
+}
+
+template <bool batched> static void pod_hash_find_many(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+
+        using hash_type = PodHash<u64, u64, decltype(&scatter_u64)>;
+
+        hash_type h(alloc, alloc, scatter_u64, CallEqualOperator<u64>());
+
+        const uint64_t max_entries = bm_state.range(0);
+
+        reserve(h, uint32_t(max_entries));
+        for (u64 i = 0; i < max_entries; ++i) {
+            set(h, i, i);
+        }
+
+        Array<u64> keys(alloc, lookup_pool_size);
+        Array<u32> indices(alloc, lookup_batch_size);
+        fill_random_keys(data(keys), lookup_pool_size, max_entries);
+
+        u32 offset = 0;
+        for (auto _ : bm_state) {
+            const u64 *batch = data(keys) + offset;
+            offset = (offset + lookup_batch_size) % lookup_pool_size;
+
+            if (batched) {
+                find_batch(h, batch, lookup_batch_size, data(indices));
+            } else {
+                for (u32 i = 0; i < lookup_batch_size; ++i) {
+                    indices[i] = u32(get(h, batch[i]) - begin(h));
+                }
+            }
+            benchmark::DoNotOptimize(data(indices));
+            benchmark::ClobberMemory();
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * lookup_batch_size);
+    }
+    memory_globals::shutdown();
+}
+
+// -- Building a table from arrays of keys and values, either with one `set` per key or with `build_from`. The
+// second template argument is the number of threads given to `build_from`.
+
+static void fill_build_input(Array<u64> &keys, Array<u64> &values) {
+    fill_random_keys(data(keys), size(keys), std::numeric_limits<u64>::max() - 10000);
+    for (uint32_t i = 0; i < size(keys); ++i) {
+        keys[i] += 10000;
+        values[i] = i;
+    }
+}
+
+template <bool bulk, uint32_t num_threads> static void open_hash_build(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+        const uint32_t n = uint32_t(bm_state.range(0));
+
+        Array<u64> keys(alloc, n);
+        Array<u64> values(alloc, n);
+        fill_build_input(keys, values);
+
+        for (auto _ : bm_state) {
+            OpenHash<u64, u64> h{ alloc, 16, scatter_u64, [](const u64 &i, const u64 &j) { return i == j; } };
+            if (bulk) {
+                open_hash::build_from(h, data(keys), data(values), n, num_threads);
+            } else {
+                for (uint32_t i = 0; i < n; ++i) {
+                    open_hash::set(h, keys[i], values[i]);
+                }
+            }
+            benchmark::DoNotOptimize(h._buffer);
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * n);
+    }
+    memory_globals::shutdown();
+}
+
+template <bool bulk, uint32_t num_threads> static void pod_hash_build(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+        const uint32_t n = uint32_t(bm_state.range(0));
+
+        Array<u64> keys(alloc, n);
+        Array<u64> values(alloc, n);
+        fill_build_input(keys, values);
+
+        for (auto _ : bm_state) {
+            PodHash<u64, u64, decltype(&scatter_u64)> h(alloc, alloc, scatter_u64, CallEqualOperator<u64>());
+            if (bulk) {
+                build_from(h, data(keys), data(values), n, num_threads);
+            } else {
+                for (uint32_t i = 0; i < n; ++i) {
+                    set(h, keys[i], values[i]);
+                }
+            }
+            benchmark::DoNotOptimize(data(h._index));
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * n);
+    }
+    memory_globals::shutdown();
+}
+
+template <bool bulk, uint32_t num_threads> static void hash_build(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+        const uint32_t n = uint32_t(bm_state.range(0));
+
+        Array<u64> keys(alloc, n);
+        Array<u64> values(alloc, n);
+        fill_build_input(keys, values);
+
+        for (auto _ : bm_state) {
+            Hash<u64> h(alloc);
+            if (bulk) {
+                build_from(h, data(keys), data(values), n, num_threads);
+            } else {
+                for (uint32_t i = 0; i < n; ++i) {
+                    hash::set(h, keys[i], values[i]);
+                }
+            }
+            benchmark::DoNotOptimize(data(h._hash));
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * n);
+    }
+    memory_globals::shutdown();
+}
+
+#define BUILD_BENCHMARKS(fn)                                                                                     \
+    BENCHMARK_TEMPLATE(fn, false, 1)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);                 \
+    BENCHMARK_TEMPLATE(fn, true, 1)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);                  \
+    BENCHMARK_TEMPLATE(fn, true, 4)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond)->UseRealTime()
+
+BUILD_BENCHMARKS(open_hash_build);
+BUILD_BENCHMARKS(pod_hash_build);
+BUILD_BENCHMARKS(hash_build);
+
+// -- Reading all values of a key from a multi-map. Values are inserted round robin over the keys, which is the
+// worst case for `Hash<T>` since each key's chain ends up spread over the whole entry array.
+
+constexpr uint32_t values_per_key = 16;
+
+static void hash_multi_get(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+        const uint32_t num_keys = uint32_t(bm_state.range(0));
+
+        Hash<u64> h(alloc);
+        for (uint32_t i = 0; i < values_per_key; ++i) {
+            for (u64 key = 0; key < num_keys; ++key) {
+                multi_hash_insert(h, key * 7919, key + i);
+            }
+        }
+
+        Array<u64> keys(alloc, lookup_pool_size);
+        fill_random_keys(data(keys), lookup_pool_size, num_keys);
+
+        u32 k = 0;
+        for (auto _ : bm_state) {
+            u64 sum = 0;
+            auto e = multi_hash_find_first(h, keys[k] * 7919);
+            while (e) {
+                sum += e->value;
+                e = find_next(h, e);
+            }
+            benchmark::DoNotOptimize(sum);
+            k = (k + 1) % lookup_pool_size;
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * values_per_key);
+    }
+    memory_globals::shutdown();
+}
+
+static void multi_hash_get(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+        const uint32_t num_keys = uint32_t(bm_state.range(0));
+
+        MultiHash<u64> h(alloc);
+        for (uint32_t i = 0; i < values_per_key; ++i) {
+            for (u64 key = 0; key < num_keys; ++key) {
+                multi_hash::insert(h, key * 7919, key + i);
+            }
+        }
+
+        Array<u64> keys(alloc, lookup_pool_size);
+        fill_random_keys(data(keys), lookup_pool_size, num_keys);
+
+        u32 k = 0;
+        for (auto _ : bm_state) {
+            u64 sum = 0;
+            for (u64 v : multi_hash::get(h, keys[k] * 7919)) {
+                sum += v;
+            }
+            benchmark::DoNotOptimize(sum);
+            k = (k + 1) % lookup_pool_size;
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * values_per_key);
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK(hash_multi_get)->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+BENCHMARK(multi_hash_get)->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+
+// Lookups of present keys in a table that never changes after it's built. Keys are spread out like string ids.
+
+constexpr u64 static_key_spread = u64(0x9E3779B97F4A7C15);
+
+static void pod_hash_static_get(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+        const uint32_t num_keys = uint32_t(bm_state.range(0));
+
+        PodHash<u64, u64> h(alloc, alloc, ConvertToInt<u64>(), CallEqualOperator<u64>());
+        for (u64 key = 0; key < num_keys; ++key) {
+            set(h, key * static_key_spread, key);
+        }
+
+        Array<u64> keys(alloc, lookup_pool_size);
+        fill_random_keys(data(keys), lookup_pool_size, num_keys);
+
+        u32 k = 0;
+        for (auto _ : bm_state) {
+            benchmark::DoNotOptimize(get(h, keys[k] * static_key_spread)->value);
+            k = (k + 1) % lookup_pool_size;
+        }
+    }
+    memory_globals::shutdown();
+}
+
+static void perfect_hash_get(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+        const uint32_t num_keys = uint32_t(bm_state.range(0));
+
+        Array<u64> build_keys(alloc, num_keys);
+        Array<u64> build_values(alloc, num_keys);
+        for (u64 key = 0; key < num_keys; ++key) {
+            build_keys[key] = key * static_key_spread;
+            build_values[key] = key;
+        }
+
+        PerfectHash<u64, u64> h(alloc);
+        perfect_hash::build(h, build_keys, build_values);
+
+        Array<u64> keys(alloc, lookup_pool_size);
+        fill_random_keys(data(keys), lookup_pool_size, num_keys);
+
+        u32 k = 0;
+        for (auto _ : bm_state) {
+            benchmark::DoNotOptimize(perfect_hash::get(h, keys[k] * static_key_spread, u64(0)));
+            k = (k + 1) % lookup_pool_size;
+        }
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK(pod_hash_static_get)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(perfect_hash_get)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+
+// -- Rehashing a string keyed table. Alternates between two index sizes each iteration.
+
+static void pod_hash_string_rehash(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+
+        const uint32_t max_entries = uint32_t(bm_state.range(0));
+
+        // Keys look like identifiers, around 20 characters each
+        constexpr uint32_t key_capacity = 32;
+        Array<char> key_storage(alloc, max_entries * key_capacity);
+        for (uint32_t i = 0; i < max_entries; ++i) {
+            snprintf(&key_storage[i * key_capacity], key_capacity, "some_identifier_%u", i);
+        }
+
+        using hash_type = PodHash<char *, u32, decltype(&usual_hash<char *>), decltype(&usual_equal<char *>)>;
+        hash_type h(alloc, alloc, usual_hash<char *>, usual_equal<char *>);
+
+        for (uint32_t i = 0; i < max_entries; ++i) {
+            set(h, &key_storage[i * key_capacity], i);
+        }
+
+        uint32_t n = 0;
+        for (auto _ : bm_state) {
+            reserve(h, max_entries * (++n % 2 == 0 ? 2 : 4));
+            benchmark::ClobberMemory();
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * max_entries);
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK(pod_hash_string_rehash)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->Unit(benchmark::kMicrosecond);
+
+// -- Slot layouts. Same random lookups as above, but each hit also reads its value, which is where keeping the
+// value next to its key should save a cache miss.
+
+template <typename TLayout> static void open_hash_layout_get(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+
+        const uint64_t max_entries = bm_state.range(0);
+
+        OpenHash<u64, u64, GetNilAndDeleted<u64>, TLayout> h{
+            alloc, uint32_t(max_entries), scatter_u64, [](const u64 &i, const u64 &j) { return i == j; }
+        };
+
+        for (u64 i = 0; i < max_entries; ++i) {
+            open_hash::set(h, i + 10000, i);
+        }
+
+        Array<u64> keys(alloc, lookup_pool_size);
+        fill_random_keys(data(keys), lookup_pool_size, max_entries);
+        for (u64 &k : keys) {
+            k += 10000;
+        }
+
+        u32 offset = 0;
+        for (auto _ : bm_state) {
+            const u64 *batch = data(keys) + offset;
+            offset = (offset + lookup_batch_size) % lookup_pool_size;
+
+            u64 sum = 0;
+            for (u32 i = 0; i < lookup_batch_size; ++i) {
+                sum += open_hash::value(h, open_hash::find(h, batch[i]));
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * lookup_batch_size);
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK_TEMPLATE(open_hash_layout_get, open_hash::SeparateArrays)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(open_hash_layout_get, open_hash::InterleavedSlots)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(open_hash_find_many, false)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(open_hash_find_many, true)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(pod_hash_find_many, false)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(pod_hash_find_many, true)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+
 constexpr uint32_t max_entries = 4096;
 
 BENCHMARK(pod_hash_search)->RangeMultiplier(2)->Range(16, max_entries);
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include <scaffold/array.h>
+#include <scaffold/jobs.h>
+#include <scaffold/memory.h>
+#include <scaffold/parallel_algorithms.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace fo;
+
+// Sorts `state.range(0)` random u64 keys. Filling the array again each iteration is excluded from the timing.
+
+enum SortKind { STD_SORT, MERGE_SORT, RADIX_SORT };
+
+template <SortKind kind> static void sort_u64(benchmark::State &state) {
+    memory_globals::init();
+    jobs::init();
+    {
+        const u32 n = u32(state.range(0));
+        Array<u64> source;
+        resize(source, n);
+        std::mt19937_64 rng(n);
+        for (u32 i = 0; i < n; ++i) {
+            source[i] = rng();
+        }
+        Array<u64> a;
+        resize(a, n);
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            std::copy(begin(source), end(source), begin(a));
+            state.ResumeTiming();
+
+            if (kind == STD_SORT) {
+                std::sort(begin(a), end(a));
+            } else if (kind == MERGE_SORT) {
+                parallel::sort(a);
+            } else {
+                parallel::radix_sort(a);
+            }
+            benchmark::DoNotOptimize(data(a));
+        }
+        state.SetItemsProcessed(state.iterations() * n);
+        state.counters["threads"] = jobs::num_threads();
+    }
+    jobs::shutdown();
+    memory_globals::shutdown();
+}
+
+static void reduce_u64(benchmark::State &state) {
+    memory_globals::init();
+    jobs::init();
+    {
+        const u32 n = u32(state.range(0));
+        Array<u64> a;
+        resize(a, n);
+        for (u32 i = 0; i < n; ++i) {
+            a[i] = i;
+        }
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(parallel::reduce(a, u64(0), [](u64 x, u64 y) { return x + y; }));
+        }
+        state.SetItemsProcessed(state.iterations() * n);
+    }
+    jobs::shutdown();
+    memory_globals::shutdown();
+}
+
+BENCHMARK_TEMPLATE(sort_u64, STD_SORT)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(sort_u64, MERGE_SORT)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(sort_u64, RADIX_SORT)->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(reduce_u64)->Arg(1 << 20)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+#include <scaffold/concurrent_queue.h>
+#include <scaffold/magic_ring_queue.h>
+#include <scaffold/memory.h>
+#include <scaffold/queue.h>
+
+#include <mutex>
+#include <thread>
+
+using namespace fo;
+
+// Threads with an even index produce, threads with an odd index consume. Every thread moves `batch` items per
+// iteration and all threads run the same number of iterations, so producers and consumers stay balanced.
+
+constexpr u32 queue_capacity = 1024;
+
+struct LockedQueue {
+    std::mutex mutex;
+    Queue<u64> q;
+
+    LockedQueue(Allocator &a)
+        : q(a) {
+        reserve(q, queue_capacity);
+    }
+};
+
+// The mutex-wrapped `Queue` the pipeline uses now. Bounded to the same capacity as the others.
+static u32 push(LockedQueue &q, const u64 *items, u32 n) {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (n > queue_capacity - size(q.q)) {
+        n = queue_capacity - size(q.q);
+    }
+    push(q.q, items, n);
+    return n;
+}
+
+static u32 consume(LockedQueue &q, u64 *items, u32 n) {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (n > size(q.q)) {
+        n = size(q.q);
+    }
+    for (u32 i = 0; i < n; ++i) {
+        items[i] = q.q[i];
+    }
+    consume(q.q, n);
+    return n;
+}
+
+template <typename Q> static Q *new_queue(Allocator &a) { return make_new<Q>(a, a, queue_capacity); }
+
+template <> LockedQueue *new_queue<LockedQueue>(Allocator &a) { return make_new<LockedQueue>(a, a); }
+
+template <typename Q> static Q *shared_queue = nullptr;
+
+template <typename Q> static void queue_throughput(benchmark::State &bm_state) {
+    const u32 batch = u32(bm_state.range(0));
+
+    if (bm_state.thread_index() == 0) {
+        memory_globals::init();
+        shared_queue<Q> = new_queue<Q>(memory_globals::default_allocator());
+    }
+
+    u64 items[64] = {};
+    u64 sum = 0;
+    const bool producer = bm_state.thread_index() % 2 == 0;
+
+    for (auto _ : bm_state) {
+        u32 done = 0;
+        while (done < batch) {
+            const u32 n = producer ? push(*shared_queue<Q>, items + done, batch - done)
+                                   : consume(*shared_queue<Q>, items + done, batch - done);
+            if (n == 0) {
+                std::this_thread::yield();
+            }
+            done += n;
+        }
+        sum += items[0];
+    }
+    benchmark::DoNotOptimize(sum);
+
+    bm_state.SetItemsProcessed(bm_state.iterations() * batch);
+
+    if (bm_state.thread_index() == 0) {
+        make_delete(memory_globals::default_allocator(), shared_queue<Q>);
+        memory_globals::shutdown();
+    }
+}
+
+// A single-threaded stream of pushes of `batch` items, each read back in bulk through `get_extent`. The ring
+// is not a multiple of the batch size, so extents keep wrapping around.
+template <typename Q> static Q make_stream_queue() { return Q(memory_globals::default_allocator()); }
+
+template <> MagicRingQueue<u64> make_stream_queue<MagicRingQueue<u64>>() { return MagicRingQueue<u64>(); }
+
+template <typename Q> static void queue_bulk_consume(benchmark::State &bm_state) {
+    const u32 batch = u32(bm_state.range(0));
+
+    memory_globals::init();
+    {
+        Q q = make_stream_queue<Q>();
+        reserve(q, 1000);
+        while (space(q) % batch == 0) {
+            push_back(q, u64(0));
+        }
+
+        u64 items[256];
+        for (u32 i = 0; i < batch; ++i) {
+            items[i] = i;
+        }
+
+        u64 sum = 0;
+        for (auto _ : bm_state) {
+            push(q, items, batch);
+            auto e = get_extent(q, size(q) - batch, batch);
+            for (u32 i = 0; i < e.first_chunk_size; ++i) {
+                sum += e.first_chunk[i];
+            }
+            for (u32 i = 0; i < e.second_chunk_size; ++i) {
+                sum += e.second_chunk[i];
+            }
+            consume(q, batch);
+        }
+        benchmark::DoNotOptimize(sum);
+        bm_state.SetItemsProcessed(bm_state.iterations() * batch);
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK_TEMPLATE(queue_bulk_consume, Queue<u64>)->Arg(7)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(queue_bulk_consume, MagicRingQueue<u64>)->Arg(7)->Arg(64)->Arg(256);
+
+BENCHMARK_TEMPLATE(queue_throughput, LockedQueue)->Arg(1)->Arg(32)->Threads(2)->Threads(4)->UseRealTime();
+BENCHMARK_TEMPLATE(queue_throughput, SpscQueue<u64>)->Arg(1)->Arg(32)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(queue_throughput, MpmcQueue<u64>)->Arg(1)->Arg(32)->Threads(2)->Threads(4)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -1,5 +1,9 @@
 #include <benchmark/benchmark.h>
+#include <scaffold/btree_map.h>
+#include <scaffold/ordered_map.h>
+#include <scaffold/persistent_map.h>
 #include <scaffold/rbt.h>
+#include <scaffold/rbt_set_ops.h>
 #include <vector>
 
 using namespace fo;
@@ -58,9 +62,299 @@ static void find_in_rbt(benchmark::State &bm_state) {
     memory_globals::shutdown();
 }
 
+// Lookups of random keys, so the descent isn't served from the same few cache lines every time
+static void find_random_in_rbt(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        auto &alloc = memory_globals::default_allocator();
+
+        rbt::RBTree<u64, u64> tree(alloc);
+
+        const u64 max_entries = bm_state.range(0);
+
+        for (u64 i = 0; i < max_entries; ++i) {
+            rbt::set(tree, i, i);
+        }
+
+        std::vector<u64> keys_to_find(4096);
+        for (auto &k : keys_to_find) {
+            k = u64(rand()) % max_entries;
+        }
+
+        size_t i = 0;
+        for (auto _ : bm_state) {
+            auto res = rbt::get(tree, keys_to_find[i]);
+            benchmark::DoNotOptimize(res);
+            i = (i + 1) % keys_to_find.size();
+        }
+    }
+    memory_globals::shutdown();
+}
+
+static void ordered_map_size(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        OrderedMap<u64, u64> m(memory_globals::default_allocator());
+
+        const u64 max_entries = bm_state.range(0);
+
+        for (u64 i = 0; i < max_entries; ++i) {
+            set(m, i, i);
+        }
+
+        for (auto _ : bm_state) {
+            benchmark::DoNotOptimize(size(m));
+        }
+    }
+    memory_globals::shutdown();
+}
+
+// The same lookups, inserts and in-order scans on `OrderedMap`, `BTreeMap` and `PersistentMap`
+
+template <typename Map> static void map_find_random(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        Map m(memory_globals::default_allocator());
+
+        const u64 max_entries = bm_state.range(0);
+
+        for (u64 i = 0; i < max_entries; ++i) {
+            set(m, i * 7919 % max_entries, i);
+        }
+
+        std::vector<u64> keys_to_find(1 << 16);
+        for (auto &k : keys_to_find) {
+            k = u64(rand()) % max_entries;
+        }
+
+        size_t i = 0;
+        for (auto _ : bm_state) {
+            auto it = get(m, keys_to_find[i]);
+            benchmark::DoNotOptimize(it->v);
+            i = (i + 1) % keys_to_find.size();
+        }
+    }
+    memory_globals::shutdown();
+}
+
+template <typename Map> static void map_insert_random(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        const u64 max_entries = bm_state.range(0);
+
+        for (auto _ : bm_state) {
+            Map m(memory_globals::default_allocator());
+            for (u64 i = 0; i < max_entries; ++i) {
+                set(m, u64(i * 0x9E3779B97F4A7C15ull) >> 20, i);
+            }
+            benchmark::DoNotOptimize(size(m));
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * max_entries);
+    }
+    memory_globals::shutdown();
+}
+
+// Building a tree from keys that are already sorted, either with `build_from_sorted` or one `set` at a time.
+template <bool bulk> static void rbt_build_sorted(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        const u64 max_entries = bm_state.range(0);
+
+        std::vector<u64> keys(max_entries);
+        for (u64 i = 0; i < max_entries; ++i) {
+            keys[i] = i * 3;
+        }
+
+        rbt::RBTree<u64, u64> tree(memory_globals::default_allocator());
+
+        for (auto _ : bm_state) {
+            if (bulk) {
+                rbt::build_from_sorted(tree, keys.data(), keys.data(), u32(max_entries));
+            } else {
+                rbt::clear(tree);
+                for (u64 k : keys) {
+                    rbt::set(tree, k, k);
+                }
+            }
+            benchmark::DoNotOptimize(tree._root);
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * max_entries);
+    }
+    memory_globals::shutdown();
+}
+
+// Merging `range(0)` keys into a tree of 1M keys, with `set_union` or one `set_default` per key. The two key
+// sets don't overlap, so the merged keys are taken out again (untimed) with `set_difference`.
+template <bool join> static void rbt_union_into_large(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        const u64 num_small = bm_state.range(0);
+
+        rbt::RBTree<u64, u64> large(memory_globals::default_allocator());
+        rbt::RBTree<u64, u64> small(memory_globals::default_allocator());
+
+        for (u64 i = 0; i < (1u << 20); ++i) {
+            rbt::set(large, (u64(i * 0x9E3779B97F4A7C15ull) >> 20) & ~u64(1), i);
+        }
+        for (u64 i = 0; i < num_small; ++i) {
+            rbt::set(small, (u64(i * 0xC2B2AE3D27D4EB4Full) >> 20) | 1, i);
+        }
+
+        for (auto _ : bm_state) {
+            if (join) {
+                rbt::set_union(large, small);
+            } else {
+                for (auto &node : small) {
+                    rbt::set_default(large, node.k, node.v);
+                }
+            }
+            benchmark::DoNotOptimize(large._root);
+
+            bm_state.PauseTiming();
+            rbt::set_difference(large, small);
+            bm_state.ResumeTiming();
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * num_small);
+    }
+    memory_globals::shutdown();
+}
+
+// Only the teardown is timed. With pooled nodes this is one deallocation per chunk.
+static void rbt_clear(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        const u64 max_entries = bm_state.range(0);
+
+        rbt::RBTree<u64, u64> tree(memory_globals::default_allocator());
+
+        for (auto _ : bm_state) {
+            bm_state.PauseTiming();
+            for (u64 i = 0; i < max_entries; ++i) {
+                rbt::set(tree, u64(i * 0x9E3779B97F4A7C15ull) >> 20, i);
+            }
+            bm_state.ResumeTiming();
+
+            rbt::clear(tree);
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * max_entries);
+    }
+    memory_globals::shutdown();
+}
+
+// A writer taking a snapshot for readers after every change. For `OrderedMap` that's a copy of the whole
+// tree.
+template <typename Map> static void map_snapshot_per_set(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        Map m(memory_globals::default_allocator());
+
+        const u64 max_entries = bm_state.range(0);
+
+        for (u64 i = 0; i < max_entries; ++i) {
+            set(m, u64(i * 0x9E3779B97F4A7C15ull) >> 20, i);
+        }
+
+        u64 i = 0;
+        for (auto _ : bm_state) {
+            set(m, u64(i * 0x9E3779B97F4A7C15ull) >> 20, i + 1);
+            Map snapshot(m);
+            benchmark::DoNotOptimize(size(snapshot));
+            i = (i + 1) % max_entries;
+        }
+    }
+    memory_globals::shutdown();
+}
+
+template <typename Map> static void map_scan(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        Map m(memory_globals::default_allocator());
+
+        const u64 max_entries = bm_state.range(0);
+
+        for (u64 i = 0; i < max_entries; ++i) {
+            set(m, u64(i * 0x9E3779B97F4A7C15ull) >> 20, i);
+        }
+
+        for (auto _ : bm_state) {
+            u64 sum = 0;
+            for (auto &entry : m) {
+                sum += entry.v;
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+
+        bm_state.SetItemsProcessed(bm_state.iterations() * max_entries);
+    }
+    memory_globals::shutdown();
+}
+
+// Summing the values of 64 consecutive keys, by filtering a full iteration as we used to, or with
+// `rbt::range`
+template <bool use_range> static void rbt_range_query(benchmark::State &bm_state) {
+    memory_globals::init();
+    {
+        rbt::RBTree<u64, u64> tree(memory_globals::default_allocator());
+
+        const u64 max_entries = bm_state.range(0);
+
+        for (u64 i = 0; i < max_entries; ++i) {
+            rbt::set(tree, i, i);
+        }
+
+        u64 lo = 0;
+        for (auto _ : bm_state) {
+            u64 sum = 0;
+            if (use_range) {
+                for (auto &node : rbt::range(tree, lo, lo + 64)) {
+                    sum += node.v;
+                }
+            } else {
+                for (auto &node : tree) {
+                    if (node.k >= lo && node.k < lo + 64) {
+                        sum += node.v;
+                    }
+                }
+            }
+            benchmark::DoNotOptimize(sum);
+            lo = (lo + 7919) % max_entries;
+        }
+    }
+    memory_globals::shutdown();
+}
+
+BENCHMARK_TEMPLATE(rbt_range_query, false)->RangeMultiplier(32)->Range(1 << 10, 1 << 15);
+BENCHMARK_TEMPLATE(rbt_range_query, true)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+#define MAP_BENCHMARKS(fn)                                                                                  \
+    BENCHMARK_TEMPLATE(fn, OrderedMap<u64, u64>)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);             \
+    BENCHMARK_TEMPLATE(fn, BTreeMap<u64, u64>)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);               \
+    BENCHMARK_TEMPLATE(fn, PersistentMap<u64, u64>)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)
+
+MAP_BENCHMARKS(map_find_random);
+MAP_BENCHMARKS(map_insert_random);
+MAP_BENCHMARKS(map_scan);
+
+// Copying the whole OrderedMap per set is too slow for the larger sizes
+BENCHMARK_TEMPLATE(map_snapshot_per_set, OrderedMap<u64, u64>)->RangeMultiplier(32)->Range(1 << 10, 1 << 15);
+BENCHMARK_TEMPLATE(map_snapshot_per_set, PersistentMap<u64, u64>)
+  ->RangeMultiplier(32)
+  ->Range(1 << 10, 1 << 20);
+
 constexpr uint32_t max_entries = 4096;
 
 // BENCHMARK(insert_in_sorted_order)->RangeMultiplier(2)->Range(2, max_entries);
 BENCHMARK(find_in_rbt)->RangeMultiplier(2)->Range(2, max_entries);
+BENCHMARK(find_random_in_rbt)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(ordered_map_size)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(rbt_clear)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(rbt_build_sorted, false)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(rbt_build_sorted, true)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(rbt_union_into_large, false)->RangeMultiplier(16)->Range(1 << 4, 1 << 20);
+BENCHMARK_TEMPLATE(rbt_union_into_large, true)->RangeMultiplier(16)->Range(1 << 4, 1 << 20);
 
 BENCHMARK_MAIN();
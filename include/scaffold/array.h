@@ -43,7 +43,7 @@ template <typename T> void set_capacity(Array<T> &a, uint32_t new_capacity);
 /// Makes sure that the array has at least the specified capacity. (If not,
 /// the array is grown.)
 template <typename T> void reserve(Array<T> &a, uint32_t new_capacity);
-/// Grows the array using a geometric progression formula, so that the
+/// Grows the array by SCAFFOLD_GROWTH_FACTOR_PERCENT, so that the
 /// ammortized cost of push_back() is O(1). If a min_capacity is specified,
 /// the array will grow to at least that capacity.
 template <typename T> void grow(Array<T> &a, uint32_t min_capacity = 0);
@@ -93,6 +93,7 @@ template <typename T> inline void free(Array<T> &a) {
     a._allocator->deallocate(a._data);
     a._data = nullptr;
     a._size = 0;
+    a._capacity = 0;
 }
 template <typename T> inline void trim(Array<T> &a) { set_capacity(a, a._size); }
 
@@ -155,7 +156,7 @@ template <typename T> void set_capacity(Array<T> &a, uint32_t new_capacity) {
 }
 
 template <typename T> void grow(Array<T> &a, uint32_t min_capacity) {
-    uint32_t new_capacity = a._capacity ? a._capacity * 2 : 2;
+    uint32_t new_capacity = a._capacity ? internal::grown_capacity(a._capacity) : 2;
     if (new_capacity < min_capacity) {
         new_capacity = min_capacity;
         new_capacity = clip_to_pow2(new_capacity);
@@ -241,7 +242,10 @@ Array<T>::Array(const Array<T> &other)
     , _data(0) {
     const uint32_t n = other._size;
     set_capacity(*this, n);
-    memcpy(_data, other._data, sizeof(T) * n);
+    // An empty array's data can be null, which memcpy must not get even for zero bytes
+    if (n != 0) {
+        memcpy(_data, other._data, sizeof(T) * n);
+    }
     _size = n;
 }
 
@@ -259,7 +263,9 @@ Array<T>::Array(Array<T> &&other)
 template <typename T> Array<T> &Array<T>::operator=(const Array<T> &other) {
     const uint32_t n = other._size;
     resize(*this, n);
-    memcpy(_data, other._data, sizeof(T) * n);
+    if (n != 0) {
+        memcpy(_data, other._data, sizeof(T) * n);
+    }
     return *this;
 }
 
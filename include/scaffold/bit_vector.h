@@ -0,0 +1,164 @@
+/// A vector of bits with rank and select. `rank1(bv, i)` counts the ones before position i and
+/// `select1(bv, k)` finds the position of the k-th one, the two operations succinct indexes are built from.
+/// Also does bulk AND/OR/XOR and scans for the first set or clear bit, for bitmap allocators and sets.
+///
+/// Bit i is bit `i % 64` of word `i / 64`, the same layout as a `DyPackedUintArray<u64>` with one bit per
+/// integer, and bits past the end of the last word are kept zero.
+///
+/// Rank and select use an index built by `build_rank_index`. It takes two words per 512-bit block: the ones
+/// before the block, and the ones before each of the words in the block packed 9 bits apiece, so a rank is
+/// two loads and a popcount. Select starts from a sample taken every `SELECT_SAMPLE` ones and binary
+/// searches the blocks in between. The index adds about 25% to the size of the bits. Changing any bit
+/// invalidates it.
+///
+/// Popcount compiles to the `popcnt` instruction where the target has it, so build with
+/// `SCAFFOLD_NATIVE_ARCH` (or `-mpopcnt`) for fast ranks. `count` also has an AVX2 loop.
+#pragma once
+
+#include <scaffold/array.h>
+#include <scaffold/debug.h>
+#include <scaffold/memory.h>
+
+#include <assert.h>
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace fo {
+
+struct BitVector {
+    static constexpr u32 NOT_FOUND = ~u32(0);
+    static constexpr u32 BLOCK_WORDS = 8;
+    static constexpr u32 SELECT_SAMPLE = 512;
+
+    Array<u64> _words;
+    Array<u64> _blocks;         // Ones before each block, then the packed ones before each word in it
+    Array<u32> _select_samples; // Block holding the one of rank `i * SELECT_SAMPLE`
+    u32 _num_bits;
+    u32 _num_ones; // Valid while `_indexed`
+    bool _indexed; // True if the index matches the bits
+
+    BitVector(Allocator &allocator = memory_globals::default_allocator());
+};
+
+/// Number of bits.
+inline u32 size(const BitVector &bv);
+
+/// Changes the number of bits. New bits are zero. Invalidates the index.
+SCAFFOLD_API void resize(BitVector &bv, u32 num_bits);
+
+/// Returns bit i.
+inline bool get(const BitVector &bv, u32 i);
+
+/// Sets bit i to the given value. Invalidates the index.
+inline void set(BitVector &bv, u32 i, bool value = true);
+
+/// Sets the bits in [begin, end) to the given value, a word at a time. Invalidates the index.
+SCAFFOLD_API void set_range(BitVector &bv, u32 begin, u32 end, bool value);
+
+/// Number of ones.
+SCAFFOLD_API u32 count(const BitVector &bv);
+
+/// Builds the index used by `rank1`, `rank0` and `select1`. Call again after changing bits.
+SCAFFOLD_API void build_rank_index(BitVector &bv);
+
+/// Number of ones in [0, i). i may be `size(bv)`. Needs the index.
+inline u32 rank1(const BitVector &bv, u32 i);
+
+/// Number of zeros in [0, i). Needs the index.
+inline u32 rank0(const BitVector &bv, u32 i);
+
+/// Position of the one with rank k, i.e. the (k+1)-th one. Returns NOT_FOUND if there are no more than k
+/// ones. Needs the index.
+SCAFFOLD_API u32 select1(const BitVector &bv, u32 k);
+
+/// Position of the first one/zero at or after `from`, or NOT_FOUND.
+SCAFFOLD_API u32 find_first_set(const BitVector &bv, u32 from = 0);
+SCAFFOLD_API u32 find_first_clear(const BitVector &bv, u32 from = 0);
+
+/// dst = dst & src, dst | src, dst ^ src. Both must have the same size. Invalidates the index of `dst`.
+SCAFFOLD_API void bitwise_and(BitVector &dst, const BitVector &src);
+SCAFFOLD_API void bitwise_or(BitVector &dst, const BitVector &src);
+SCAFFOLD_API void bitwise_xor(BitVector &dst, const BitVector &src);
+
+namespace bit_vector_internal {
+
+/// Number of set bits in `w`.
+inline u32 popcount(u64 w);
+
+/// Index of the lowest set bit of `w`, which must not be zero.
+inline u32 trailing_zeros(u64 w);
+
+} // namespace bit_vector_internal
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace bit_vector_internal {
+
+inline u32 popcount(u64 w) {
+#if defined(__POPCNT__) || defined(__aarch64__)
+    return u32(__builtin_popcountll(w));
+#elif defined(_MSC_VER) && defined(_M_X64) && defined(__AVX__)
+    return u32(__popcnt64(w));
+#else
+    // Without the instruction gcc calls a table-driven libgcc routine, which is slower than this
+    w = w - ((w >> 1) & 0x5555555555555555ull);
+    w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return u32((w * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+inline u32 trailing_zeros(u64 w) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, w);
+    return u32(index);
+#else
+    return u32(__builtin_ctzll(w));
+#endif
+}
+
+} // namespace bit_vector_internal
+
+inline u32 size(const BitVector &bv) { return bv._num_bits; }
+
+inline bool get(const BitVector &bv, u32 i) {
+    assert(i < bv._num_bits);
+    return (bv._words[i >> 6] >> (i & 63)) & 1;
+}
+
+inline void set(BitVector &bv, u32 i, bool value) {
+    assert(i < bv._num_bits);
+    const u64 bit = u64(1) << (i & 63);
+    u64 &word = bv._words[i >> 6];
+    word = value ? word | bit : word & ~bit;
+    bv._indexed = false;
+}
+
+inline u32 rank1(const BitVector &bv, u32 i) {
+    assert(bv._indexed && "rank1 - Index is stale, call build_rank_index");
+    assert(i <= bv._num_bits);
+
+    const u32 w = i >> 6;
+    const u64 *block = &bv._blocks[(w / BitVector::BLOCK_WORDS) * 2];
+
+    // Ones before word j of the block are at bits [9 * (j - 1), 9 * j) of the second word. For j = 0 the
+    // shift wraps to 63, and bit 63 is always zero.
+    const u64 t = u64(w % BitVector::BLOCK_WORDS) - 1;
+    u32 ones = u32(block[0] + ((block[1] >> ((t + (t >> 60 & 8)) * 9)) & 0x1ff));
+
+    if (i & 63) {
+        ones += bit_vector_internal::popcount(bv._words[w] << (64 - (i & 63)));
+    }
+    return ones;
+}
+
+inline u32 rank0(const BitVector &bv, u32 i) { return i - rank1(bv, i); }
+
+} // namespace fo
@@ -0,0 +1,821 @@
+// Contains a B+tree based ordered map.
+//
+// Compared to the red-black tree behind `OrderedMap`, a node holds many keys (a node is 8 cache lines), so a
+// lookup visits O(log_B n) nodes instead of O(log_2 n), and searches the keys of each one in a contiguous
+// array. Entries are only stored in the leaves, which are linked to each other, so in-order iteration and
+// range scans are a walk along the leaves. The free functions `get`, `set`, `set_default`, `remove` and
+// `size` match the ones of `OrderedMap`, so code can switch between the two by changing the map's type.
+//
+// Unlike with `OrderedMap`, entries move around when the tree changes. Any `set`, `set_default` or `remove`
+// invalidates all iterators.
+
+#pragma once
+
+#include <scaffold/memory.h>
+#include <scaffold/types.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace fo {
+
+/// A key-value pair stored in the map. Has the same members as `rbt::RBNode`.
+template <typename Key, typename Value> struct BTreeEntry {
+    Key k;
+    Value v;
+
+    const Key &first() const { return k; }
+    const Value &second() const { return v; }
+    Value &second() { return v; }
+};
+
+namespace btree_internal {
+
+// Size of a node we aim for
+constexpr u32 NODE_BYTES = 512;
+
+// Max number of levels. Every node but the root is at least half full, so this is plenty for u32 sizes.
+constexpr u32 MAX_DEPTH = 32;
+
+struct NodeHeader {
+    u32 _num_keys;
+    u32 _is_leaf;
+};
+
+template <typename Key, typename Value> struct Capacity {
+    static constexpr u32 inner_fit =
+        u32((NODE_BYTES - sizeof(NodeHeader) - sizeof(void *)) / (sizeof(Key) + sizeof(void *)));
+    static constexpr u32 leaf_fit =
+        u32((NODE_BYTES - sizeof(NodeHeader) - 2 * sizeof(void *)) / sizeof(BTreeEntry<Key, Value>));
+
+    // Max number of keys in an inner node and in a leaf, and the least number a node other than the root can
+    // have.
+    static constexpr u32 inner = inner_fit < 4 ? 4 : inner_fit;
+    static constexpr u32 leaf = leaf_fit < 4 ? 4 : leaf_fit;
+    static constexpr u32 inner_min = inner / 2;
+    static constexpr u32 leaf_min = leaf / 2;
+};
+
+template <typename Key, typename Value> struct alignas(64) Leaf : NodeHeader {
+    Leaf *_prev;
+    Leaf *_next;
+    BTreeEntry<Key, Value> _entries[Capacity<Key, Value>::leaf];
+};
+
+// Key `i` is the separator between child `i` and child `i + 1`. Keys in child `i` are less than it, keys in
+// child `i + 1` are not.
+template <typename Key, typename Value> struct alignas(64) Inner : NodeHeader {
+    Key _keys[Capacity<Key, Value>::inner];
+    NodeHeader *_children[Capacity<Key, Value>::inner + 1];
+};
+
+} // namespace btree_internal
+
+/// Bidirectional iterator over the entries in key order.
+template <typename Key, typename Value, bool is_const> struct BTreeIterator {
+    using LeafType = typename std::conditional<is_const,
+                                               const btree_internal::Leaf<Key, Value>,
+                                               btree_internal::Leaf<Key, Value>>::type;
+    using EntryType =
+        typename std::conditional<is_const, const BTreeEntry<Key, Value>, BTreeEntry<Key, Value>>::type;
+
+    LeafType *_leaf;      // nullptr denotes end
+    u32 _i;               // Entry in the leaf
+    LeafType *_last_leaf; // For going back from end
+
+    BTreeIterator(LeafType *leaf, u32 i, LeafType *last_leaf);
+
+    // A non-const iterator can be used as a const one
+    template <bool other_const, typename = typename std::enable_if<is_const && !other_const>::type>
+    BTreeIterator(const BTreeIterator<Key, Value, other_const> &o)
+        : BTreeIterator(o._leaf, o._i, o._last_leaf) {}
+
+    BTreeIterator &operator++();
+    BTreeIterator operator++(int);
+
+    BTreeIterator &operator--();
+    BTreeIterator operator--(int);
+
+    EntryType *operator->() const { return &_leaf->_entries[_i]; }
+    EntryType &operator*() const { return _leaf->_entries[_i]; }
+
+    template <bool other_const> bool operator==(const BTreeIterator<Key, Value, other_const> &o) const {
+        return o._leaf == _leaf && o._i == _i;
+    }
+
+    template <bool other_const> bool operator!=(const BTreeIterator<Key, Value, other_const> &o) const {
+        return !(*this == o);
+    }
+};
+
+/// Represents a B+tree based map. `Less` is the key comparison, same as for `OrderedMap`.
+template <typename Key, typename Value, typename Less = std::less<Key>> struct BTreeMap {
+    static_assert(std::is_default_constructible<Key>::value && std::is_default_constructible<Value>::value,
+                  "Nodes are arrays of keys and values");
+
+    using Leaf = btree_internal::Leaf<Key, Value>;
+    using Inner = btree_internal::Inner<Key, Value>;
+    using Capacity = btree_internal::Capacity<Key, Value>;
+
+    using iterator = BTreeIterator<Key, Value, false>;
+    using const_iterator = BTreeIterator<Key, Value, true>;
+
+    // This being nullptr denotes moved-from map
+    Allocator *_allocator;
+
+    btree_internal::NodeHeader *_root; // nullptr if the map is empty
+    Leaf *_first_leaf;
+    Leaf *_last_leaf;
+    u32 _size;
+
+    Less _less;
+
+    /// Constructs an empty map where nodes will be allocated using given `allocator`.
+    BTreeMap(Allocator &allocator = memory_globals::default_allocator(), Less less = Less{});
+    ~BTreeMap();
+
+    /// Copy ctor. If you don't provide an allocator, the new map will use the allocator used by `o`.
+    BTreeMap(const BTreeMap &o, Allocator *allocator = nullptr);
+
+    /// Copy assignment.
+    BTreeMap &operator=(const BTreeMap &o);
+
+    /// Move constructor. The moved-from map must not be operated on any further (except calling its
+    /// destructor).
+    BTreeMap(BTreeMap &&o);
+
+    /// Move assignment.
+    BTreeMap &operator=(BTreeMap &&o);
+
+    inline Value &operator[](const Key &k);
+};
+
+/// Returns the number of entries.
+template <typename Key, typename Value, typename Less> u32 size(const BTreeMap<Key, Value, Less> &m);
+
+/// Returns an iterator to the entry with the given key, or `end(m)`.
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> get(const BTreeMap<Key, Value, Less> &m, const Key &k);
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> get(BTreeMap<Key, Value, Less> &m, const Key &k);
+
+/// Associates the value with the key, replacing the current one if present. Returns an iterator to the entry.
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> set(BTreeMap<Key, Value, Less> &m, Key k, Value v);
+
+/// Associates the value with the key if the key is not present. Returns an iterator to the entry.
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> set_default(BTreeMap<Key, Value, Less> &m, Key k, Value default_value);
+
+/// Removes the entry with the given key. Returns true if there was one.
+template <typename Key, typename Value, typename Less>
+bool remove(BTreeMap<Key, Value, Less> &m, const Key &k);
+
+/// Removes all entries.
+template <typename Key, typename Value, typename Less> void clear(BTreeMap<Key, Value, Less> &m);
+
+/// Returns an iterator to the first entry whose key is not less than `k`, or `end(m)`.
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> lower_bound(const BTreeMap<Key, Value, Less> &m, const Key &k);
+
+/// Returns an iterator to the first entry whose key is greater than `k`, or `end(m)`.
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> upper_bound(const BTreeMap<Key, Value, Less> &m, const Key &k);
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> begin(const BTreeMap<Key, Value, Less> &m);
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> end(const BTreeMap<Key, Value, Less> &m);
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> begin(BTreeMap<Key, Value, Less> &m);
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> end(BTreeMap<Key, Value, Less> &m);
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+template <typename Key, typename Value, bool is_const>
+BTreeIterator<Key, Value, is_const>::BTreeIterator(LeafType *leaf, u32 i, LeafType *last_leaf)
+    : _leaf(leaf)
+    , _i(i)
+    , _last_leaf(last_leaf) {
+    // Past the last entry of a leaf is the same position as the start of the next one
+    if (_leaf && _i == _leaf->_num_keys) {
+        _leaf = _leaf->_next;
+        _i = 0;
+    }
+}
+
+template <typename Key, typename Value, bool is_const>
+BTreeIterator<Key, Value, is_const> &BTreeIterator<Key, Value, is_const>::operator++() {
+    if (++_i == _leaf->_num_keys) {
+        _leaf = _leaf->_next;
+        _i = 0;
+    }
+    return *this;
+}
+
+template <typename Key, typename Value, bool is_const>
+BTreeIterator<Key, Value, is_const> BTreeIterator<Key, Value, is_const>::operator++(int) {
+    BTreeIterator saved(*this);
+    ++*this;
+    return saved;
+}
+
+template <typename Key, typename Value, bool is_const>
+BTreeIterator<Key, Value, is_const> &BTreeIterator<Key, Value, is_const>::operator--() {
+    if (_leaf == nullptr) {
+        _leaf = _last_leaf;
+        _i = _leaf->_num_keys - 1;
+    } else if (_i == 0) {
+        _leaf = _leaf->_prev;
+        _i = _leaf->_num_keys - 1;
+    } else {
+        --_i;
+    }
+    return *this;
+}
+
+template <typename Key, typename Value, bool is_const>
+BTreeIterator<Key, Value, is_const> BTreeIterator<Key, Value, is_const>::operator--(int) {
+    BTreeIterator saved(*this);
+    --*this;
+    return saved;
+}
+
+namespace btree_internal {
+
+template <typename Key, typename Value, typename Less>
+Leaf<Key, Value> *new_leaf(BTreeMap<Key, Value, Less> &m) {
+    auto leaf = make_new<Leaf<Key, Value>>(*m._allocator);
+    leaf->_num_keys = 0;
+    leaf->_is_leaf = 1;
+    leaf->_prev = nullptr;
+    leaf->_next = nullptr;
+    return leaf;
+}
+
+template <typename Key, typename Value, typename Less>
+Inner<Key, Value> *new_inner(BTreeMap<Key, Value, Less> &m) {
+    auto inner = make_new<Inner<Key, Value>>(*m._allocator);
+    inner->_num_keys = 0;
+    inner->_is_leaf = 0;
+    return inner;
+}
+
+template <typename Key, typename Value> void delete_node(Allocator &a, NodeHeader *node) {
+    if (node->_is_leaf) {
+        make_delete(a, static_cast<Leaf<Key, Value> *>(node));
+        return;
+    }
+    auto inner = static_cast<Inner<Key, Value> *>(node);
+    for (u32 i = 0; i <= inner->_num_keys; ++i) {
+        delete_node<Key, Value>(a, inner->_children[i]);
+    }
+    make_delete(a, inner);
+}
+
+// Copies the subtree, appending the copied leaves to the list ending at `last_leaf`.
+template <typename Key, typename Value, typename Less>
+NodeHeader *clone_node(BTreeMap<Key, Value, Less> &m, const NodeHeader *node, Leaf<Key, Value> *&last_leaf) {
+    if (node->_is_leaf) {
+        auto from = static_cast<const Leaf<Key, Value> *>(node);
+        auto leaf = new_leaf(m);
+        leaf->_num_keys = from->_num_keys;
+        std::copy(from->_entries, from->_entries + from->_num_keys, leaf->_entries);
+        leaf->_prev = last_leaf;
+        if (last_leaf) {
+            last_leaf->_next = leaf;
+        } else {
+            m._first_leaf = leaf;
+        }
+        last_leaf = leaf;
+        return leaf;
+    }
+
+    auto from = static_cast<const Inner<Key, Value> *>(node);
+    auto inner = new_inner(m);
+    inner->_num_keys = from->_num_keys;
+    std::copy(from->_keys, from->_keys + from->_num_keys, inner->_keys);
+    for (u32 i = 0; i <= from->_num_keys; ++i) {
+        inner->_children[i] = clone_node(m, from->_children[i], last_leaf);
+    }
+    return inner;
+}
+
+template <typename Key, typename Value, typename Less>
+void copy_from(BTreeMap<Key, Value, Less> &m, const BTreeMap<Key, Value, Less> &other) {
+    m._size = other._size;
+    if (other._root) {
+        Leaf<Key, Value> *last_leaf = nullptr;
+        m._root = clone_node(m, other._root, last_leaf);
+        m._last_leaf = last_leaf;
+    }
+}
+
+// The path from the root to a leaf. `nodes[d]` is the inner node at depth `d`, and we went down to its child
+// `child_i[d]`.
+template <typename Key, typename Value> struct Path {
+    Inner<Key, Value> *nodes[MAX_DEPTH];
+    u32 child_i[MAX_DEPTH];
+    u32 depth = 0;
+};
+
+template <typename Key, typename Value, typename Less>
+Leaf<Key, Value> *
+find_leaf(const BTreeMap<Key, Value, Less> &m, const Key &k, Path<Key, Value> *path = nullptr) {
+    NodeHeader *node = m._root;
+    while (!node->_is_leaf) {
+        auto inner = static_cast<Inner<Key, Value> *>(node);
+        const Key *keys = inner->_keys;
+        const u32 i = u32(std::upper_bound(keys, keys + inner->_num_keys, k, m._less) - keys);
+        if (path) {
+            path->nodes[path->depth] = inner;
+            path->child_i[path->depth] = i;
+            ++path->depth;
+        }
+        node = inner->_children[i];
+    }
+    return static_cast<Leaf<Key, Value> *>(node);
+}
+
+template <typename Key, typename Value, typename Less>
+u32 leaf_lower_bound(const BTreeMap<Key, Value, Less> &m, const Leaf<Key, Value> *leaf, const Key &k) {
+    auto less = [&m](const BTreeEntry<Key, Value> &e, const Key &k) { return m._less(e.k, k); };
+    return u32(std::lower_bound(leaf->_entries, leaf->_entries + leaf->_num_keys, k, less) - leaf->_entries);
+}
+
+template <typename Key, typename Value, typename Less>
+u32 leaf_upper_bound(const BTreeMap<Key, Value, Less> &m, const Leaf<Key, Value> *leaf, const Key &k) {
+    auto less = [&m](const Key &k, const BTreeEntry<Key, Value> &e) { return m._less(k, e.k); };
+    return u32(std::upper_bound(leaf->_entries, leaf->_entries + leaf->_num_keys, k, less) - leaf->_entries);
+}
+
+// Inserts key `k` at `i` and `child` right after it
+template <typename Key, typename Value>
+void inner_insert(Inner<Key, Value> *inner, u32 i, Key k, NodeHeader *child) {
+    const u32 n = inner->_num_keys;
+    std::move_backward(inner->_keys + i, inner->_keys + n, inner->_keys + n + 1);
+    std::move_backward(inner->_children + i + 1, inner->_children + n + 1, inner->_children + n + 2);
+    inner->_keys[i] = std::move(k);
+    inner->_children[i + 1] = child;
+    ++inner->_num_keys;
+}
+
+// Removes key `i` and the child right after it
+template <typename Key, typename Value> void inner_erase(Inner<Key, Value> *inner, u32 i) {
+    const u32 n = inner->_num_keys;
+    std::move(inner->_keys + i + 1, inner->_keys + n, inner->_keys + i);
+    std::move(inner->_children + i + 2, inner->_children + n + 1, inner->_children + i + 1);
+    inner->_keys[n - 1] = Key{};
+    --inner->_num_keys;
+}
+
+// Adds `right` to the tree, right after `left`, separated by `sep`. Splits the parents as needed.
+template <typename Key, typename Value, typename Less>
+void insert_into_parent(BTreeMap<Key, Value, Less> &m,
+                        Path<Key, Value> &path,
+                        NodeHeader *left,
+                        Key sep,
+                        NodeHeader *right) {
+    constexpr u32 cap = Capacity<Key, Value>::inner;
+
+    while (path.depth != 0) {
+        --path.depth;
+        auto parent = path.nodes[path.depth];
+        const u32 i = path.child_i[path.depth];
+
+        if (parent->_num_keys < cap) {
+            inner_insert(parent, i, std::move(sep), right);
+            return;
+        }
+
+        // Split the parent. The middle key moves up.
+        const u32 mid = cap / 2;
+        auto sibling = new_inner(m);
+        Key up = std::move(parent->_keys[mid]);
+        std::move(parent->_keys + mid + 1, parent->_keys + cap, sibling->_keys);
+        std::copy(parent->_children + mid + 1, parent->_children + cap + 1, sibling->_children);
+        sibling->_num_keys = cap - mid - 1;
+        parent->_num_keys = mid;
+
+        if (i <= mid) {
+            inner_insert(parent, i, std::move(sep), right);
+        } else {
+            inner_insert(sibling, i - mid - 1, std::move(sep), right);
+        }
+
+        left = parent;
+        sep = std::move(up);
+        right = sibling;
+    }
+
+    // Split the root
+    auto root = new_inner(m);
+    root->_num_keys = 1;
+    root->_keys[0] = std::move(sep);
+    root->_children[0] = left;
+    root->_children[1] = right;
+    m._root = root;
+}
+
+// Inserts the entry if the key isn't present. Otherwise replaces it if `overwrite` is true.
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> insert(BTreeMap<Key, Value, Less> &m, Key &&k, Value &&v, bool overwrite) {
+    constexpr u32 cap = Capacity<Key, Value>::leaf;
+
+    if (!m._root) {
+        auto leaf = new_leaf(m);
+        m._root = leaf;
+        m._first_leaf = leaf;
+        m._last_leaf = leaf;
+    }
+
+    Path<Key, Value> path;
+    auto leaf = find_leaf(m, k, &path);
+    u32 pos = leaf_lower_bound(m, leaf, k);
+
+    if (pos < leaf->_num_keys && !m._less(k, leaf->_entries[pos].k)) {
+        if (overwrite) {
+            leaf->_entries[pos].k = std::move(k);
+            leaf->_entries[pos].v = std::move(v);
+        }
+        return BTreeIterator<Key, Value, false>(leaf, pos, m._last_leaf);
+    }
+
+    ++m._size;
+
+    Leaf<Key, Value> *right = nullptr;
+    auto left = leaf;
+
+    if (leaf->_num_keys == cap) {
+        // Split the leaf in two halves and insert into the one the key belongs to
+        const u32 mid = cap / 2;
+        right = new_leaf(m);
+        std::move(leaf->_entries + mid, leaf->_entries + cap, right->_entries);
+        right->_num_keys = cap - mid;
+        leaf->_num_keys = mid;
+
+        right->_prev = leaf;
+        right->_next = leaf->_next;
+        if (leaf->_next) {
+            leaf->_next->_prev = right;
+        } else {
+            m._last_leaf = right;
+        }
+        leaf->_next = right;
+
+        if (pos > mid) {
+            leaf = right;
+            pos -= mid;
+        }
+    }
+
+    const u32 n = leaf->_num_keys;
+    std::move_backward(leaf->_entries + pos, leaf->_entries + n, leaf->_entries + n + 1);
+    leaf->_entries[pos].k = std::move(k);
+    leaf->_entries[pos].v = std::move(v);
+    ++leaf->_num_keys;
+
+    if (right) {
+        insert_into_parent(m, path, left, Key(right->_entries[0].k), right);
+    }
+
+    return BTreeIterator<Key, Value, false>(leaf, pos, m._last_leaf);
+}
+
+// Fixes up the leaf after it went under the minimum number of entries, by taking an entry from a sibling or
+// merging with one.
+template <typename Key, typename Value, typename Less>
+void rebalance_leaf(BTreeMap<Key, Value, Less> &m, Path<Key, Value> &path, Leaf<Key, Value> *leaf) {
+    constexpr u32 leaf_min = Capacity<Key, Value>::leaf_min;
+
+    auto parent = path.nodes[path.depth - 1];
+    const u32 i = path.child_i[path.depth - 1];
+
+    auto left = i > 0 ? static_cast<Leaf<Key, Value> *>(parent->_children[i - 1]) : nullptr;
+    auto right = i < parent->_num_keys ? static_cast<Leaf<Key, Value> *>(parent->_children[i + 1]) : nullptr;
+
+    if (left && left->_num_keys > leaf_min) {
+        const u32 n = leaf->_num_keys;
+        std::move_backward(leaf->_entries, leaf->_entries + n, leaf->_entries + n + 1);
+        leaf->_entries[0] = std::move(left->_entries[left->_num_keys - 1]);
+        left->_entries[left->_num_keys - 1] = BTreeEntry<Key, Value>{};
+        --left->_num_keys;
+        ++leaf->_num_keys;
+        parent->_keys[i - 1] = leaf->_entries[0].k;
+        return;
+    }
+
+    if (right && right->_num_keys > leaf_min) {
+        leaf->_entries[leaf->_num_keys] = std::move(right->_entries[0]);
+        std::move(right->_entries + 1, right->_entries + right->_num_keys, right->_entries);
+        right->_entries[right->_num_keys - 1] = BTreeEntry<Key, Value>{};
+        --right->_num_keys;
+        ++leaf->_num_keys;
+        parent->_keys[i] = right->_entries[0].k;
+        return;
+    }
+
+    // Merge the right one of the two into the left one
+    u32 sep_i = i;
+    if (left) {
+        right = leaf;
+        sep_i = i - 1;
+    } else {
+        left = leaf;
+    }
+
+    std::move(right->_entries, right->_entries + right->_num_keys, left->_entries + left->_num_keys);
+    left->_num_keys += right->_num_keys;
+    left->_next = right->_next;
+    if (right->_next) {
+        right->_next->_prev = left;
+    } else {
+        m._last_leaf = left;
+    }
+    make_delete(*m._allocator, right);
+
+    inner_erase(parent, sep_i);
+}
+
+// Fixes up the inner nodes on the path, from the deepest one up, after a child of the deepest one was merged
+// away.
+template <typename Key, typename Value, typename Less>
+void rebalance_inner(BTreeMap<Key, Value, Less> &m, Path<Key, Value> &path) {
+    constexpr u32 inner_min = Capacity<Key, Value>::inner_min;
+
+    for (u32 d = path.depth - 1;; --d) {
+        auto node = path.nodes[d];
+
+        if (d == 0) {
+            // The root only goes away when it's down to one child
+            if (node->_num_keys == 0) {
+                m._root = node->_children[0];
+                make_delete(*m._allocator, node);
+            }
+            return;
+        }
+
+        if (node->_num_keys >= inner_min) {
+            return;
+        }
+
+        auto parent = path.nodes[d - 1];
+        const u32 i = path.child_i[d - 1];
+
+        auto left = i > 0 ? static_cast<Inner<Key, Value> *>(parent->_children[i - 1]) : nullptr;
+        auto right =
+            i < parent->_num_keys ? static_cast<Inner<Key, Value> *>(parent->_children[i + 1]) : nullptr;
+
+        if (left && left->_num_keys > inner_min) {
+            const u32 n = node->_num_keys;
+            std::move_backward(node->_keys, node->_keys + n, node->_keys + n + 1);
+            std::move_backward(node->_children, node->_children + n + 1, node->_children + n + 2);
+            node->_keys[0] = std::move(parent->_keys[i - 1]);
+            node->_children[0] = left->_children[left->_num_keys];
+            parent->_keys[i - 1] = std::move(left->_keys[left->_num_keys - 1]);
+            --left->_num_keys;
+            ++node->_num_keys;
+            return;
+        }
+
+        if (right && right->_num_keys > inner_min) {
+            const u32 n = node->_num_keys;
+            node->_keys[n] = std::move(parent->_keys[i]);
+            node->_children[n + 1] = right->_children[0];
+            parent->_keys[i] = std::move(right->_keys[0]);
+            std::move(right->_keys + 1, right->_keys + right->_num_keys, right->_keys);
+            std::move(right->_children + 1, right->_children + right->_num_keys + 1, right->_children);
+            --right->_num_keys;
+            ++node->_num_keys;
+            return;
+        }
+
+        // Merge the right one of the two into the left one, with the separator between them
+        u32 sep_i = i;
+        if (left) {
+            right = node;
+            sep_i = i - 1;
+        } else {
+            left = node;
+        }
+
+        const u32 ln = left->_num_keys;
+        left->_keys[ln] = std::move(parent->_keys[sep_i]);
+        std::move(right->_keys, right->_keys + right->_num_keys, left->_keys + ln + 1);
+        std::copy(right->_children, right->_children + right->_num_keys + 1, left->_children + ln + 1);
+        left->_num_keys = ln + 1 + right->_num_keys;
+        make_delete(*m._allocator, right);
+
+        inner_erase(parent, sep_i);
+    }
+}
+
+} // namespace btree_internal
+
+template <typename Key, typename Value, typename Less>
+BTreeMap<Key, Value, Less>::BTreeMap(Allocator &allocator, Less less)
+    : _allocator(&allocator)
+    , _root(nullptr)
+    , _first_leaf(nullptr)
+    , _last_leaf(nullptr)
+    , _size(0)
+    , _less(std::move(less)) {}
+
+template <typename Key, typename Value, typename Less> BTreeMap<Key, Value, Less>::~BTreeMap() {
+    if (_allocator) {
+        clear(*this);
+        _allocator = nullptr;
+    }
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeMap<Key, Value, Less>::BTreeMap(const BTreeMap &o, Allocator *allocator)
+    : BTreeMap(allocator ? *allocator : *o._allocator, o._less) {
+    btree_internal::copy_from(*this, o);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeMap<Key, Value, Less> &BTreeMap<Key, Value, Less>::operator=(const BTreeMap &o) {
+    if (this == &o) {
+        return *this;
+    }
+
+    assert(_allocator != nullptr && "Cannot copy into moved-from map");
+
+    clear(*this);
+    _less = o._less;
+    btree_internal::copy_from(*this, o);
+    return *this;
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeMap<Key, Value, Less>::BTreeMap(BTreeMap &&o)
+    : _allocator(o._allocator)
+    , _root(o._root)
+    , _first_leaf(o._first_leaf)
+    , _last_leaf(o._last_leaf)
+    , _size(o._size)
+    , _less(std::move(o._less)) {
+    o._allocator = nullptr;
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeMap<Key, Value, Less> &BTreeMap<Key, Value, Less>::operator=(BTreeMap &&o) {
+    if (this == &o) {
+        return *this;
+    }
+
+    if (_allocator) {
+        clear(*this);
+    }
+
+    _allocator = o._allocator;
+    _root = o._root;
+    _first_leaf = o._first_leaf;
+    _last_leaf = o._last_leaf;
+    _size = o._size;
+    _less = std::move(o._less);
+
+    o._allocator = nullptr;
+    return *this;
+}
+
+template <typename Key, typename Value, typename Less>
+Value &BTreeMap<Key, Value, Less>::operator[](const Key &k) {
+    return set_default(*this, k, Value())->v;
+}
+
+template <typename Key, typename Value, typename Less> u32 size(const BTreeMap<Key, Value, Less> &m) {
+    return m._size;
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> get(const BTreeMap<Key, Value, Less> &m, const Key &k) {
+    if (!m._root) {
+        return end(m);
+    }
+
+    auto leaf = btree_internal::find_leaf(m, k);
+    const u32 pos = btree_internal::leaf_lower_bound(m, leaf, k);
+    if (pos < leaf->_num_keys && !m._less(k, leaf->_entries[pos].k)) {
+        return BTreeIterator<Key, Value, true>(leaf, pos, m._last_leaf);
+    }
+    return end(m);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> get(BTreeMap<Key, Value, Less> &m, const Key &k) {
+    const auto it = get(static_cast<const BTreeMap<Key, Value, Less> &>(m), k);
+    return BTreeIterator<Key, Value, false>(
+        const_cast<btree_internal::Leaf<Key, Value> *>(it._leaf), it._i, m._last_leaf);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> set(BTreeMap<Key, Value, Less> &m, Key k, Value v) {
+    return btree_internal::insert(m, std::move(k), std::move(v), true);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> set_default(BTreeMap<Key, Value, Less> &m, Key k, Value default_value) {
+    return btree_internal::insert(m, std::move(k), std::move(default_value), false);
+}
+
+template <typename Key, typename Value, typename Less>
+bool remove(BTreeMap<Key, Value, Less> &m, const Key &k) {
+    using namespace btree_internal;
+
+    if (!m._root) {
+        return false;
+    }
+
+    Path<Key, Value> path;
+    auto leaf = find_leaf(m, k, &path);
+    const u32 pos = leaf_lower_bound(m, leaf, k);
+    if (pos == leaf->_num_keys || m._less(k, leaf->_entries[pos].k)) {
+        return false;
+    }
+
+    std::move(leaf->_entries + pos + 1, leaf->_entries + leaf->_num_keys, leaf->_entries + pos);
+    --leaf->_num_keys;
+    leaf->_entries[leaf->_num_keys] = BTreeEntry<Key, Value>{};
+    --m._size;
+
+    if (path.depth == 0) {
+        if (leaf->_num_keys == 0) {
+            clear(m);
+        }
+        return true;
+    }
+
+    if (leaf->_num_keys < Capacity<Key, Value>::leaf_min) {
+        const u32 parent_keys = path.nodes[path.depth - 1]->_num_keys;
+        rebalance_leaf(m, path, leaf);
+        if (path.nodes[path.depth - 1]->_num_keys != parent_keys) {
+            rebalance_inner(m, path);
+        }
+    }
+
+    return true;
+}
+
+template <typename Key, typename Value, typename Less> void clear(BTreeMap<Key, Value, Less> &m) {
+    if (m._root) {
+        btree_internal::delete_node<Key, Value>(*m._allocator, m._root);
+    }
+    m._root = nullptr;
+    m._first_leaf = nullptr;
+    m._last_leaf = nullptr;
+    m._size = 0;
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> lower_bound(const BTreeMap<Key, Value, Less> &m, const Key &k) {
+    if (!m._root) {
+        return end(m);
+    }
+    auto leaf = btree_internal::find_leaf(m, k);
+    return BTreeIterator<Key, Value, true>(leaf, btree_internal::leaf_lower_bound(m, leaf, k), m._last_leaf);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> upper_bound(const BTreeMap<Key, Value, Less> &m, const Key &k) {
+    if (!m._root) {
+        return end(m);
+    }
+    auto leaf = btree_internal::find_leaf(m, k);
+    return BTreeIterator<Key, Value, true>(leaf, btree_internal::leaf_upper_bound(m, leaf, k), m._last_leaf);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> begin(const BTreeMap<Key, Value, Less> &m) {
+    return BTreeIterator<Key, Value, true>(m._first_leaf, 0, m._last_leaf);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, true> end(const BTreeMap<Key, Value, Less> &m) {
+    return BTreeIterator<Key, Value, true>(nullptr, 0, m._last_leaf);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> begin(BTreeMap<Key, Value, Less> &m) {
+    return BTreeIterator<Key, Value, false>(m._first_leaf, 0, m._last_leaf);
+}
+
+template <typename Key, typename Value, typename Less>
+BTreeIterator<Key, Value, false> end(BTreeMap<Key, Value, Less> &m) {
+    return BTreeIterator<Key, Value, false>(nullptr, 0, m._last_leaf);
+}
+
+} // namespace fo
@@ -8,6 +8,14 @@
 
 #define SCAFFOLD_IGNORE_DEF_CTOR static constexpr bool _scaffold_ignore_def_ctor = true
 
+/// How much `Array`, `SmallArray` and `Vector` grow when a push runs out of capacity, in percent of the old
+/// capacity. Set with the SCAFFOLD_GROWTH_FACTOR_PERCENT cmake option.
+#ifndef SCAFFOLD_GROWTH_FACTOR_PERCENT
+#    define SCAFFOLD_GROWTH_FACTOR_PERCENT 200
+#endif
+
+static_assert(SCAFFOLD_GROWTH_FACTOR_PERCENT > 100, "Growth factor must be more than 100 percent");
+
 /// All collection types assume that they are used to store POD objects. I.e.
 /// they:
 ///
@@ -29,6 +37,12 @@ template <typename T> struct DefaultCtorTrivial<T, decltype(T::_scaffold_ignore_
     static constexpr bool value = true;
 };
 
+// Capacity after growing by the growth factor. Always more than the given capacity.
+inline u32 grown_capacity(u32 capacity) {
+    const u64 grown = u64(capacity) * SCAFFOLD_GROWTH_FACTOR_PERCENT / 100;
+    return grown > capacity ? u32(grown) : capacity + 1;
+}
+
 } // namespace internal
 
 /// Dynamically resizable array of POD objects.
@@ -0,0 +1,421 @@
+/// Implements a read-mostly concurrent variant of the quadratic probing hash table in `open_hash.h`. Lookups
+/// never take a lock and never wait for a writer. Writers are serialized with a mutex.
+#pragma once
+
+#include <scaffold/const_log.h>
+#include <scaffold/debug.h>
+#include <scaffold/memory.h>
+#include <scaffold/open_hash.h>
+
+#include <assert.h>
+#include <atomic>
+#include <mutex>
+#include <string.h>
+#include <type_traits>
+
+namespace fo {
+
+/// Same probing scheme and nil/deleted key convention as `OpenHash`, but every slot holds two copies of its
+/// key and value plus a sequence counter, so that readers can run concurrently with a writer.
+///
+/// - `get` and `has` are lock-free. They load the current slot table once and probe at most `_num_slots`
+///   slots. A writer fills the copy of a slot that readers aren't using, then flips the counter to make it
+///   current, so a reader reads the last completed copy and never waits on a write in progress, even one
+///   whose writer was preempted in the middle. A reader retries a slot only if, while it was copying the
+///   slot, writers completed one write to it and started another. That takes the writers making progress,
+///   so it's lock-free rather than wait-free.
+///
+/// - `set` and `remove` are serialized by `_write_mutex`. When the table needs to grow, the writer builds a
+///   new slot table and publishes it with a single atomic store (RCU-style). The old table is frozen and
+///   kept on a retired list, since readers that loaded it earlier may still be probing it. Retired tables
+///   are freed when the hash is destroyed, or when `reclaim_retired` is called at a point where no reader
+///   can be active. Tables double when they grow, and a table is only replaced by one of the same size (to
+///   clear out deleted slots) while nothing is retired, so the retired tables together never take more
+///   memory than the current one. Until `reclaim_retired` is called, deleted slots are reused by inserts but
+///   not cleared out, so call it now and then if keys are removed a lot.
+///
+/// Keys are stored in `std::atomic<K>`, so K must be lock-free as an atomic (integers, pointers, small
+/// handles). Values are copied out to the reader, never returned by reference.
+template <typename K, typename V, typename TGetNilAndDeleted = GetNilAndDeleted<K>> struct ConcurrentOpenHash {
+    static_assert(std::is_trivially_copyable<K>::value, "Must");
+    static_assert(std::is_trivially_copyable<V>::value, "Must");
+    static_assert(std::is_default_constructible<V>::value, "Must");
+    static_assert(std::atomic<K>::is_always_lock_free, "Key type must be lock-free as a std::atomic");
+
+    using KeyType = K;
+    using ValueType = V;
+    using TGetNilAndDeletedType = TGetNilAndDeleted;
+
+    using HashFn = typename OpenHash<K, V, TGetNilAndDeleted>::HashFn;
+    using EqualFn = typename OpenHash<K, V, TGetNilAndDeleted>::EqualFn;
+
+    struct SlotCopy {
+        std::atomic<K> key;
+        V value;
+    };
+
+    // After n completed writes, `copies[n & 1]` is current. The counter is 2n between writes and 2n + 1
+    // while the n+1-th write fills `copies[(n + 1) & 1]`, so `copies[(seq >> 1) & 1]` is always complete.
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        SlotCopy copies[2];
+    };
+
+    // A slot table. The slots array is allocated right after the header in the same block.
+    struct Table {
+        uint32_t num_slots;
+        std::atomic<uint32_t> num_valid; // Atomic only so that `size` can be read by non-writers
+        uint32_t num_deleted;
+        Table *next_retired;
+        Slot *slots;
+    };
+
+    std::atomic<Table *> _table; // Current slot table. Only ever replaced by a writer.
+    Table *_retired;             // Singly linked list of tables replaced by a grow
+    HashFn _hash_fn;             // Hash function
+    EqualFn _equal_fn;           // Equal comparison
+    Allocator *_allocator;       // Table allocator
+    std::mutex _write_mutex;     // Serializes writers
+
+    /// Creates a hash table able to hold `initial_size` number of elements without rehashing.
+    ConcurrentOpenHash(Allocator &allocator, uint32_t initial_size, HashFn hash_fn, EqualFn equal_fn);
+
+    /// Creates a concurrent table containing the same entries as the given `OpenHash`.
+    template <typename TLayout>
+    ConcurrentOpenHash(Allocator &allocator, const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h);
+
+    ConcurrentOpenHash(const ConcurrentOpenHash &) = delete;
+    ConcurrentOpenHash &operator=(const ConcurrentOpenHash &) = delete;
+
+    ~ConcurrentOpenHash();
+};
+
+namespace concurrent_open_hash {
+
+/// Copies the value associated with `key` into `out` and returns true. Returns false if the key is not
+/// present. Safe to call concurrently with any other operation.
+template <typename K, typename V, typename TGetNilAndDeleted>
+bool get(const ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key, V &out);
+
+/// Returns true if the key is present. Safe to call concurrently with any other operation.
+template <typename K, typename V, typename TGetNilAndDeleted>
+bool has(const ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+
+/// Associates the given value with the given key. Blocks other writers. May grow the table.
+template <typename K, typename V, typename TGetNilAndDeleted>
+void set(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key, const V &value);
+
+/// Removes the key if it exists. Blocks other writers.
+template <typename K, typename V, typename TGetNilAndDeleted>
+void remove(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+
+/// Number of keys currently in the table. Only a snapshot if writers are active.
+template <typename K, typename V, typename TGetNilAndDeleted>
+uint32_t size(const ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h);
+
+/// Frees the tables retired by previous grows. The caller must guarantee that no reader is running, e.g.
+/// call this between two frames or after joining the reader threads.
+template <typename K, typename V, typename TGetNilAndDeleted>
+void reclaim_retired(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h);
+
+} // namespace concurrent_open_hash
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+namespace concurrent_open_hash {
+namespace internal {
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+using TableSig = typename ConcurrentOpenHash<K, V, TGetNilAndDeleted>::Table;
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+TableSig<K, V, TGetNilAndDeleted> *new_table(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, uint32_t num_slots) {
+    using Table = TableSig<K, V, TGetNilAndDeleted>;
+    using Slot = typename ConcurrentOpenHash<K, V, TGetNilAndDeleted>::Slot;
+
+    num_slots = clip_to_pow2(num_slots < 2 ? 2u : num_slots);
+
+    constexpr AddrUint slots_offset = (sizeof(Table) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+    constexpr AddrUint align = alignof(Slot) > alignof(Table) ? alignof(Slot) : alignof(Table);
+
+    auto mem = (uint8_t *)h._allocator->allocate(slots_offset + sizeof(Slot) * num_slots, align);
+
+    Table *t = new (mem) Table;
+    t->num_slots = num_slots;
+    t->num_valid.store(0, std::memory_order_relaxed);
+    t->num_deleted = 0;
+    t->next_retired = nullptr;
+    t->slots = reinterpret_cast<Slot *>(mem + slots_offset);
+
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        Slot *s = new (&t->slots[i]) Slot;
+        s->seq.store(0, std::memory_order_relaxed);
+        s->copies[0].key.store(TGetNilAndDeleted::get_nil(), std::memory_order_relaxed);
+        s->copies[1].key.store(TGetNilAndDeleted::get_nil(), std::memory_order_relaxed);
+    }
+    return t;
+}
+
+// The copy of the slot that is complete. Callers not holding the write mutex must validate what they read
+// from it with `copy_still_valid`.
+template <typename Slot> auto &current_copy(Slot &slot, uint32_t seq) { return slot.copies[(seq >> 1) & 1]; }
+
+// True if the copy current at `seq` hasn't started being overwritten, which happens at seq (seq | 1) + 2
+template <typename Slot> bool copy_still_valid(const Slot &slot, uint32_t seq) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) - (seq & ~1u) <= 2;
+}
+
+// Writes key and value into the spare copy of a slot of a table that may be visible to readers, then makes
+// it current. Caller holds the write mutex, so the counter is even.
+template <typename Slot, typename K, typename V> void write_slot(Slot &slot, const K &key, const V &value) {
+    const uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    auto &spare = slot.copies[((seq >> 1) + 1) & 1];
+    memcpy(&spare.value, &value, sizeof(V));
+    spare.key.store(key, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+// Marks a slot as deleted. Caller holds the write mutex.
+template <typename Slot, typename K> void delete_slot(Slot &slot, const K &deleted_key) {
+    const uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.copies[((seq >> 1) + 1) & 1].key.store(deleted_key, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+// Key of the current copy of a slot. Caller holds the write mutex.
+template <typename Slot> auto locked_key(const Slot &slot) {
+    return current_copy(slot, slot.seq.load(std::memory_order_relaxed)).key.load(std::memory_order_relaxed);
+}
+
+// Returns the index of the slot containing `key` in table `t`, or open_hash::NOT_FOUND. Caller holds the
+// write mutex, so no slot can change underneath.
+template <typename K, typename V, typename TGetNilAndDeleted>
+uint32_t find_locked(const ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h,
+                     const TableSig<K, V, TGetNilAndDeleted> *t,
+                     const K &key) {
+    const uint32_t mask = t->num_slots - 1;
+    uint32_t idx = h._hash_fn(key);
+
+    for (uint32_t i = 0; i < t->num_slots; ++i) {
+        idx = (idx + i) & mask;
+        const K k = locked_key(t->slots[idx]);
+        if (h._equal_fn(k, key)) {
+            return idx;
+        }
+        if (h._equal_fn(k, TGetNilAndDeleted::get_nil())) {
+            return open_hash::NOT_FOUND;
+        }
+    }
+    return open_hash::NOT_FOUND;
+}
+
+// Inserts a key known to be absent. Takes the first nil or deleted slot on the probe sequence.
+template <typename K, typename V, typename TGetNilAndDeleted>
+void insert_absent(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h,
+                   TableSig<K, V, TGetNilAndDeleted> *t,
+                   const K &key,
+                   const V &value) {
+    const uint32_t mask = t->num_slots - 1;
+    uint32_t idx = h._hash_fn(key);
+
+    for (uint32_t i = 0; i < t->num_slots; ++i) {
+        idx = (idx + i) & mask;
+        const K k = locked_key(t->slots[idx]);
+
+        const bool is_nil = h._equal_fn(k, TGetNilAndDeleted::get_nil());
+        if (is_nil || h._equal_fn(k, TGetNilAndDeleted::get_deleted())) {
+            write_slot(t->slots[idx], key, value);
+            ++t->num_valid;
+            if (!is_nil) {
+                --t->num_deleted;
+            }
+            return;
+        }
+    }
+
+    log_assert(0, "Impossible");
+}
+
+// Grows (or just cleans out deleted slots of) the current table if it is at least half full, and publishes
+// the replacement. Cleaning out without growing would retire a table as large as the current one, so it's
+// skipped while other tables are retired. Deleted slots are still reused by `insert_absent`, and probes end
+// after `num_slots` slots even without a nil one. Caller holds the write mutex.
+template <typename K, typename V, typename TGetNilAndDeleted>
+void rehash_if_needed(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h) {
+    static constexpr float max_load_factor = 0.5;
+
+    auto old_t = h._table.load(std::memory_order_relaxed);
+
+    const float real_load_factor = (old_t->num_valid + old_t->num_deleted + 1) / float(old_t->num_slots);
+    const float valid_load_factor = (old_t->num_valid + 1) / float(old_t->num_slots);
+
+    if (real_load_factor < max_load_factor) {
+        return;
+    }
+
+    const bool grow = valid_load_factor >= max_load_factor;
+    if (!grow && h._retired != nullptr) {
+        return;
+    }
+    const uint32_t new_size = grow ? old_t->num_slots * 2 : old_t->num_slots;
+
+    auto new_t = new_table(h, new_size);
+
+    for (uint32_t i = 0; i < old_t->num_slots; ++i) {
+        const auto &copy = current_copy(old_t->slots[i], old_t->slots[i].seq.load(std::memory_order_relaxed));
+        const K k = copy.key.load(std::memory_order_relaxed);
+        if (!h._equal_fn(k, TGetNilAndDeleted::get_nil()) &&
+            !h._equal_fn(k, TGetNilAndDeleted::get_deleted())) {
+            insert_absent(h, new_t, k, copy.value);
+        }
+    }
+
+    h._table.store(new_t, std::memory_order_release);
+
+    old_t->next_retired = h._retired;
+    h._retired = old_t;
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+void free_table_list(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, TableSig<K, V, TGetNilAndDeleted> *t) {
+    while (t) {
+        auto next = t->next_retired;
+        h._allocator->deallocate(t);
+        t = next;
+    }
+}
+
+} // namespace internal
+} // namespace concurrent_open_hash
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+ConcurrentOpenHash<K, V, TGetNilAndDeleted>::ConcurrentOpenHash(Allocator &allocator,
+                                                                uint32_t initial_size,
+                                                                HashFn hash_fn,
+                                                                EqualFn equal_fn)
+    : _retired(nullptr)
+    , _hash_fn(std::move(hash_fn))
+    , _equal_fn(std::move(equal_fn))
+    , _allocator(&allocator) {
+    // More than twice the slots, since `set` rehashes once an insert would reach a load factor of 0.5
+    auto t = concurrent_open_hash::internal::new_table(*this, initial_size * 2 + 1);
+    _table.store(t, std::memory_order_release);
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+template <typename TLayout>
+ConcurrentOpenHash<K, V, TGetNilAndDeleted>::ConcurrentOpenHash(Allocator &allocator,
+                                                                const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h)
+    : ConcurrentOpenHash(allocator, h._num_valid, h._hash_fn, h._equal_fn) {
+    auto t = _table.load(std::memory_order_relaxed);
+    for (auto it = begin(h); it != end(h); ++it) {
+        concurrent_open_hash::internal::insert_absent(*this, t, (*it).key, (*it).value);
+    }
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+ConcurrentOpenHash<K, V, TGetNilAndDeleted>::~ConcurrentOpenHash() {
+    concurrent_open_hash::internal::free_table_list(*this, _table.load(std::memory_order_acquire));
+    concurrent_open_hash::internal::free_table_list(*this, _retired);
+    _retired = nullptr;
+}
+
+namespace concurrent_open_hash {
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+bool get(const ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key, V &out) {
+    const auto t = h._table.load(std::memory_order_acquire);
+    const uint32_t mask = t->num_slots - 1;
+    uint32_t idx = h._hash_fn(key);
+
+    for (uint32_t i = 0; i < t->num_slots; ++i) {
+        idx = (idx + i) & mask;
+        const auto &slot = t->slots[idx];
+
+        // Read the complete copy even while a writer fills the other one. Retry only if the copy we read
+        // was overwritten meanwhile.
+        while (true) {
+            const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+            const auto &copy = internal::current_copy(slot, seq);
+
+            const K k = copy.key.load(std::memory_order_relaxed);
+            V v;
+            memcpy(&v, &copy.value, sizeof(V));
+
+            if (!internal::copy_still_valid(slot, seq)) {
+                continue;
+            }
+
+            if (h._equal_fn(k, TGetNilAndDeleted::get_nil())) {
+                return false;
+            }
+
+            if (!h._equal_fn(k, key)) {
+                break;
+            }
+
+            out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+bool has(const ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
+    V v;
+    return get(h, key, v);
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+void set(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key, const V &value) {
+    std::lock_guard<std::mutex> lk(h._write_mutex);
+
+    auto t = h._table.load(std::memory_order_relaxed);
+    const uint32_t idx = internal::find_locked(h, t, key);
+
+    if (idx != open_hash::NOT_FOUND) {
+        internal::write_slot(t->slots[idx], key, value);
+        return;
+    }
+
+    internal::rehash_if_needed(h);
+    internal::insert_absent(h, h._table.load(std::memory_order_relaxed), key, value);
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+void remove(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
+    std::lock_guard<std::mutex> lk(h._write_mutex);
+
+    auto t = h._table.load(std::memory_order_relaxed);
+    const uint32_t idx = internal::find_locked(h, t, key);
+
+    if (idx != open_hash::NOT_FOUND) {
+        internal::delete_slot(t->slots[idx], TGetNilAndDeleted::get_deleted());
+        --t->num_valid;
+        ++t->num_deleted;
+    }
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+uint32_t size(const ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h) {
+    return h._table.load(std::memory_order_acquire)->num_valid.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted>
+void reclaim_retired(ConcurrentOpenHash<K, V, TGetNilAndDeleted> &h) {
+    std::lock_guard<std::mutex> lk(h._write_mutex);
+    internal::free_table_list(h, h._retired);
+    h._retired = nullptr;
+}
+
+} // namespace concurrent_open_hash
+} // namespace fo
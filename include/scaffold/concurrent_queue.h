@@ -0,0 +1,307 @@
+/// Fixed-capacity ring queues for handing items between threads, the concurrent counterparts of `Queue` in
+/// `queue.h`.
+///
+/// - `SpscQueue` has exactly one producer thread and one consumer thread. Each side owns one index and only
+///   reads the other one when its cached copy says the queue is full (or empty).
+///
+/// - `MpmcQueue` allows any number of producers and consumers. It is Dmitry Vyukov's bounded queue: every
+///   cell has a sequence number telling which lap of the ring it's ready for, so claiming a cell is a single
+///   compare-and-swap on the head or tail, and producers and consumers never wait on each other's locks.
+///
+/// The capacity is rounded up to a power of two, so indices wrap with a mask. The head and tail live on their
+/// own cache lines, otherwise every push would invalidate the consumer's line and vice versa. Items are
+/// copied with memcpy, like in `Queue`, so they must be trivially copyable.
+#pragma once
+
+#include <scaffold/const_log.h>
+#include <scaffold/memory.h>
+#include <scaffold/types.h>
+
+#include <assert.h>
+#include <atomic>
+#include <new>
+#include <string.h>
+#include <type_traits>
+
+namespace fo {
+
+namespace concurrent_queue_internal {
+
+constexpr u32 CACHE_LINE_SIZE = 64;
+
+} // namespace concurrent_queue_internal
+
+/// Single producer, single consumer queue.
+template <typename T> struct SpscQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "Must");
+
+    Allocator *_allocator;
+    T *_items;
+    u32 _mask; // Capacity - 1
+
+    // Index of the next item to consume. The indices are never wrapped, only masked when used.
+    alignas(concurrent_queue_internal::CACHE_LINE_SIZE) std::atomic<u32> _head;
+    u32 _cached_tail; // Consumer's last seen `_tail`
+
+    // Index one past the last pushed item.
+    alignas(concurrent_queue_internal::CACHE_LINE_SIZE) std::atomic<u32> _tail;
+    u32 _cached_head; // Producer's last seen `_head`
+
+    /// Creates a queue holding at least `capacity` items. `capacity` must be at most 2^31.
+    SpscQueue(Allocator &allocator, u32 capacity);
+    ~SpscQueue();
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+};
+
+/// Multiple producer, multiple consumer queue.
+template <typename T> struct MpmcQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "Must");
+
+    struct Cell {
+        // Equals the index of the push that may fill the cell, or that index + 1 once it is filled and the
+        // pop with that index may take it.
+        std::atomic<u32> seq;
+        T item;
+    };
+
+    Allocator *_allocator;
+    Cell *_cells;
+    u32 _mask; // Capacity - 1
+
+    alignas(concurrent_queue_internal::CACHE_LINE_SIZE) std::atomic<u32> _head; // Index of the next pop
+    alignas(concurrent_queue_internal::CACHE_LINE_SIZE) std::atomic<u32> _tail; // Index of the next push
+
+    /// Creates a queue holding at least `capacity` items. `capacity` must be at most 2^31.
+    MpmcQueue(Allocator &allocator, u32 capacity);
+    ~MpmcQueue();
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+};
+
+/// Returns the number of items the queue can hold.
+template <typename T> u32 capacity(const SpscQueue<T> &q);
+template <typename T> u32 capacity(const MpmcQueue<T> &q);
+
+/// Returns the number of items in the queue. Only a snapshot while other threads push or pop.
+template <typename T> u32 size(const SpscQueue<T> &q);
+template <typename T> u32 size(const MpmcQueue<T> &q);
+
+/// Pushes the item to the end of the queue. Returns false, pushing nothing, if the queue is full.
+template <typename T> bool push_back(SpscQueue<T> &q, const T &item);
+template <typename T> bool push_back(MpmcQueue<T> &q, const T &item);
+
+/// Pops the first item into `item`. Returns false if the queue is empty.
+template <typename T> bool pop_front(SpscQueue<T> &q, T &item);
+template <typename T> bool pop_front(MpmcQueue<T> &q, T &item);
+
+/// Pushes as many of the n items as fit to the back of the queue, in order. Returns the number pushed. For
+/// `MpmcQueue` the pushed items are contiguous in the queue, other producers' items don't interleave.
+template <typename T> u32 push(SpscQueue<T> &q, const T *items, u32 n);
+template <typename T> u32 push(MpmcQueue<T> &q, const T *items, u32 n);
+
+/// Consumes up to n items from the front of the queue, copying them to `items`. Returns the number consumed.
+template <typename T> u32 consume(SpscQueue<T> &q, T *items, u32 n);
+template <typename T> u32 consume(MpmcQueue<T> &q, T *items, u32 n);
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace concurrent_queue_internal {
+
+inline u32 ring_capacity(u32 capacity) {
+    assert(capacity <= (1u << 31));
+    return clip_to_pow2(capacity < 2 ? 2u : capacity);
+}
+
+// Copies n items to the ring starting at masked index `start`, wrapping around the end.
+template <typename T> void copy_to_ring(T *ring, u32 mask, u32 start, const T *items, u32 n) {
+    const u32 first = (mask + 1 - start) < n ? (mask + 1 - start) : n;
+    memcpy(ring + start, items, first * sizeof(T));
+    memcpy(ring, items + first, (n - first) * sizeof(T));
+}
+
+template <typename T> void copy_from_ring(const T *ring, u32 mask, u32 start, T *items, u32 n) {
+    const u32 first = (mask + 1 - start) < n ? (mask + 1 - start) : n;
+    memcpy(items, ring + start, first * sizeof(T));
+    memcpy(items + first, ring, (n - first) * sizeof(T));
+}
+
+} // namespace concurrent_queue_internal
+
+template <typename T>
+SpscQueue<T>::SpscQueue(Allocator &allocator, u32 capacity)
+    : _allocator(&allocator)
+    , _items(nullptr)
+    , _mask(concurrent_queue_internal::ring_capacity(capacity) - 1)
+    , _head(0)
+    , _cached_tail(0)
+    , _tail(0)
+    , _cached_head(0) {
+    _items = (T *)_allocator->allocate(sizeof(T) * (_mask + 1), alignof(T));
+}
+
+template <typename T> SpscQueue<T>::~SpscQueue() { _allocator->deallocate(_items); }
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(Allocator &allocator, u32 capacity)
+    : _allocator(&allocator)
+    , _cells(nullptr)
+    , _mask(concurrent_queue_internal::ring_capacity(capacity) - 1)
+    , _head(0)
+    , _tail(0) {
+    _cells = (Cell *)_allocator->allocate(sizeof(Cell) * (_mask + 1), alignof(Cell));
+    for (u32 i = 0; i <= _mask; ++i) {
+        Cell *c = new (&_cells[i]) Cell;
+        c->seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T> MpmcQueue<T>::~MpmcQueue() { _allocator->deallocate(_cells); }
+
+template <typename T> u32 capacity(const SpscQueue<T> &q) { return q._mask + 1; }
+
+template <typename T> u32 capacity(const MpmcQueue<T> &q) { return q._mask + 1; }
+
+template <typename T> u32 size(const SpscQueue<T> &q) {
+    const u32 head = q._head.load(std::memory_order_acquire);
+    return q._tail.load(std::memory_order_acquire) - head;
+}
+
+template <typename T> u32 size(const MpmcQueue<T> &q) {
+    // Pops can overtake the loaded tail, clamp instead of wrapping
+    const u32 tail = q._tail.load(std::memory_order_acquire);
+    const u32 head = q._head.load(std::memory_order_acquire);
+    const i32 n = i32(tail - head);
+    return n < 0 ? 0 : n > i32(capacity(q)) ? capacity(q) : u32(n);
+}
+
+template <typename T> inline bool push_back(SpscQueue<T> &q, const T &item) { return push(q, &item, 1) == 1; }
+
+template <typename T> inline bool push_back(MpmcQueue<T> &q, const T &item) { return push(q, &item, 1) == 1; }
+
+template <typename T> inline bool pop_front(SpscQueue<T> &q, T &item) { return consume(q, &item, 1) == 1; }
+
+template <typename T> inline bool pop_front(MpmcQueue<T> &q, T &item) { return consume(q, &item, 1) == 1; }
+
+template <typename T> u32 push(SpscQueue<T> &q, const T *items, u32 n) {
+    const u32 tail = q._tail.load(std::memory_order_relaxed);
+
+    if (capacity(q) - (tail - q._cached_head) < n) {
+        q._cached_head = q._head.load(std::memory_order_acquire);
+    }
+    const u32 space = capacity(q) - (tail - q._cached_head);
+    if (n > space) {
+        n = space;
+    }
+
+    concurrent_queue_internal::copy_to_ring(q._items, q._mask, tail & q._mask, items, n);
+    q._tail.store(tail + n, std::memory_order_release);
+    return n;
+}
+
+template <typename T> u32 consume(SpscQueue<T> &q, T *items, u32 n) {
+    const u32 head = q._head.load(std::memory_order_relaxed);
+
+    if (q._cached_tail - head < n) {
+        q._cached_tail = q._tail.load(std::memory_order_acquire);
+    }
+    const u32 available = q._cached_tail - head;
+    if (n > available) {
+        n = available;
+    }
+
+    concurrent_queue_internal::copy_from_ring(q._items, q._mask, head & q._mask, items, n);
+    q._head.store(head + n, std::memory_order_release);
+    return n;
+}
+
+template <typename T> u32 push(MpmcQueue<T> &q, const T *items, u32 n) {
+    if (n == 0) {
+        return 0;
+    }
+
+    u32 tail = q._tail.load(std::memory_order_relaxed);
+    u32 claimed;
+
+    while (true) {
+        // Count the free cells from `tail` on. A cell holding the sequence number of our index has been
+        // consumed on the previous lap, and can't be taken by another producer unless `_tail` moves first.
+        claimed = 0;
+        while (claimed < n) {
+            const auto &c = q._cells[(tail + claimed) & q._mask];
+            if (c.seq.load(std::memory_order_acquire) != tail + claimed) {
+                break;
+            }
+            ++claimed;
+        }
+
+        if (claimed == 0) {
+            const u32 seq = q._cells[tail & q._mask].seq.load(std::memory_order_acquire);
+            if (i32(seq - tail) < 0) {
+                return 0; // Full
+            }
+            tail = q._tail.load(std::memory_order_relaxed); // Another producer got there first
+            continue;
+        }
+
+        if (q._tail.compare_exchange_weak(tail, tail + claimed, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    for (u32 i = 0; i < claimed; ++i) {
+        auto &c = q._cells[(tail + i) & q._mask];
+        memcpy(&c.item, &items[i], sizeof(T));
+        c.seq.store(tail + i + 1, std::memory_order_release);
+    }
+    return claimed;
+}
+
+template <typename T> u32 consume(MpmcQueue<T> &q, T *items, u32 n) {
+    if (n == 0) {
+        return 0;
+    }
+
+    u32 head = q._head.load(std::memory_order_relaxed);
+    u32 claimed;
+
+    while (true) {
+        claimed = 0;
+        while (claimed < n) {
+            const auto &c = q._cells[(head + claimed) & q._mask];
+            if (c.seq.load(std::memory_order_acquire) != head + claimed + 1) {
+                break;
+            }
+            ++claimed;
+        }
+
+        if (claimed == 0) {
+            const u32 seq = q._cells[head & q._mask].seq.load(std::memory_order_acquire);
+            if (i32(seq - (head + 1)) < 0) {
+                return 0; // Empty
+            }
+            head = q._head.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (q._head.compare_exchange_weak(head, head + claimed, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    for (u32 i = 0; i < claimed; ++i) {
+        auto &c = q._cells[(head + i) & q._mask];
+        memcpy(&items[i], &c.item, sizeof(T));
+        // Free the cell for the push one lap later
+        c.seq.store(head + i + capacity(q), std::memory_order_release);
+    }
+    return claimed;
+}
+
+} // namespace fo
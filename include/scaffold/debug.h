@@ -39,6 +39,16 @@
 #    endif
 #endif
 
+// Hint to bring the cache line containing `addr` into cache ahead of an access
+#ifndef SCAFFOLD_PREFETCH
+#    if defined(_MSC_VER)
+#        include <xmmintrin.h>
+#        define SCAFFOLD_PREFETCH(addr) _mm_prefetch((const char *)(addr), _MM_HINT_T0)
+#    else
+#        define SCAFFOLD_PREFETCH(addr) __builtin_prefetch((const void *)(addr))
+#    endif
+#endif
+
 #if defined(SCAFFOLD_API_EXPORT)
 #    if defined(_MSC_VER)
 #        define SCAFFOLD_API __declspec(dllexport)
@@ -2,6 +2,7 @@
 
 #include <scaffold/array.h>
 #include <scaffold/collection_types.h>
+#include <scaffold/radix_partition.h>
 
 namespace fo {
 
@@ -56,9 +57,21 @@ template <typename T> void remove(Hash<T> &h, const typename Hash<T>::Entry *e);
 /// Removes all entries with the specified key.
 template <typename T> void remove_all(Hash<T> &h, uint64_t key);
 
+/// Replaces the contents of the hash with the given `n` key-value pairs. The lookup table is sized once and
+/// the entries are counting-sorted by bucket, so each chain is a contiguous run of entries. The sort first
+/// groups the entries by region of the lookup table, then by bucket within each region, so the scratch
+/// memory stays proportional to `n` whatever the thread count. Both steps and filling in the entries are
+/// split across `num_threads` threads. A key given more than once gets an entry for each value, as with
+/// `multi_hash_insert`.
+template <typename T>
+void build_from(Hash<T> &h, const uint64_t *keys, const T *values, uint32_t n, uint32_t num_threads = 1);
+
 namespace hash_internal {
 const uint32_t END_OF_LIST = 0xffffffffu;
 
+// Buckets per region in `build_from`. The region's slice of the lookup table is used as its bucket counters.
+constexpr uint32_t BUILD_REGION_BUCKETS = 1u << 14;
+
 struct FindResult {
     uint32_t hash_i;
     uint32_t data_prev;
@@ -280,6 +293,83 @@ template <typename T> void remove_all(Hash<T> &h, uint64_t key) {
     while (hash::has(h, key))
         hash::remove(h, key);
 }
+
+template <typename T>
+void build_from(Hash<T> &h, const uint64_t *keys, const T *values, uint32_t n, uint32_t num_threads) {
+    using namespace hash_internal;
+
+    // Same size `grow` would pick
+    const uint32_t hash_size = n * 2 + 10;
+    resize(h._hash, hash_size);
+    resize(h._data, n);
+
+    Allocator &allocator = *h._hash._allocator;
+    Array<uint32_t> buckets(allocator, n);
+    Array<uint32_t> by_region(allocator, n);
+    Array<uint32_t> order(allocator, n);
+
+    parallel_chunks(n, num_threads, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            buckets[i] = uint32_t(keys[i] % hash_size);
+        }
+    });
+
+    const uint32_t num_regions = (hash_size + BUILD_REGION_BUCKETS - 1) / BUILD_REGION_BUCKETS;
+    Array<uint32_t> region_starts(allocator, num_regions + 1);
+    radix_partition(n,
+                    num_regions,
+                    [&](uint32_t i) { return buckets[i] / BUILD_REGION_BUCKETS; },
+                    data(by_region),
+                    data(region_starts),
+                    num_threads);
+
+    // Regions are independent, so each is sorted by bucket and filled in by one thread
+    auto build_region = [&](uint32_t r) {
+        const uint32_t first_bucket = r * BUILD_REGION_BUCKETS;
+        const uint32_t last_bucket = std::min(hash_size, first_bucket + BUILD_REGION_BUCKETS);
+        const uint32_t region_begin = region_starts[r];
+        const uint32_t region_end = region_starts[r + 1];
+        uint32_t *cursors = &h._hash[first_bucket];
+
+        std::fill(cursors, cursors + (last_bucket - first_bucket), 0u);
+        for (uint32_t j = region_begin; j < region_end; ++j) {
+            ++cursors[buckets[by_region[j]] - first_bucket];
+        }
+        uint32_t offset = region_begin;
+        for (uint32_t b = 0; b < last_bucket - first_bucket; ++b) {
+            const uint32_t count = cursors[b];
+            cursors[b] = offset;
+            offset += count;
+        }
+        // Afterwards each cursor is at the end of its bucket, the start of the next one
+        for (uint32_t j = region_begin; j < region_end; ++j) {
+            const uint32_t i = by_region[j];
+            order[cursors[buckets[i] - first_bucket]++] = i;
+        }
+
+        for (uint32_t bucket = last_bucket; bucket-- > first_bucket;) {
+            const uint32_t first = bucket == first_bucket ? region_begin : h._hash[bucket - 1];
+            const uint32_t last = h._hash[bucket];
+            h._hash[bucket] = first == last ? END_OF_LIST : first;
+            for (uint32_t j = first; j < last; ++j) {
+                auto &e = h._data[j];
+                e.key = keys[order[j]];
+                e.value = values[order[j]];
+                e.next = j + 1 < last ? j + 1 : END_OF_LIST;
+            }
+        }
+    };
+
+    parallel_chunks(
+        num_regions,
+        num_threads,
+        [&](uint32_t begin, uint32_t end) {
+            for (uint32_t r = begin; r < end; ++r) {
+                build_region(r);
+            }
+        },
+        1);
+}
 } // namespace fo
 
 namespace fo {
@@ -0,0 +1,160 @@
+/// A job system. Worker threads each own a `WorkStealingDeque` of jobs. A thread pushes the jobs it creates
+/// to its own deque and works through them newest first, and idle workers steal the oldest jobs of the
+/// others.
+///
+/// Jobs form fork-join trees. Each job counts itself plus its unfinished children, and a job is finished when
+/// the count reaches zero. Waiting on a job runs other jobs meanwhile, so nested forks don't block workers.
+///
+/// Every thread has a scratch allocator whose allocations made while running a job are all freed when the job
+/// returns. Use it directly, or as the backing allocator of a `TempAllocator`.
+///
+/// Jobs are allocated from a fixed ring per creating thread and are recycled without being freed. Allocation
+/// skips the slots of unfinished jobs, so only a thread's live jobs count against `max_jobs_per_thread`, not
+/// how many it has created since the oldest one it still waits on.
+#pragma once
+
+#include <scaffold/debug.h>
+#include <scaffold/memory.h>
+#include <scaffold/types.h>
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace fo {
+
+namespace jobs {
+
+constexpr u32 JOB_SIZE = 128;
+
+struct alignas(64) Job {
+    void (*_run)(Job *job); // Calls, then destroys, the callable stored in `_data`
+    Job *_parent;
+    std::atomic<u32> _unfinished; // This job plus its unfinished children. Zero when finished.
+
+    static constexpr u32 DATA_SIZE = JOB_SIZE - sizeof(void *) * 2 - sizeof(u64);
+    alignas(8) u8 _data[DATA_SIZE];
+};
+
+static_assert(sizeof(Job) == JOB_SIZE, "");
+
+struct InitConfig {
+    // Number of worker threads besides the thread calling `init`. ~0u means one less than the number of
+    // hardware threads.
+    u32 num_workers = ~0u;
+
+    // Most jobs created by one thread that can be unfinished at once. Must be a power of two.
+    u32 max_jobs_per_thread = 4096;
+
+    // Size of each thread's scratch buffer. Scratch allocations that don't fit go to the default allocator.
+    u32 scratch_size = 256 * 1024;
+};
+
+/// Starts the worker threads. The calling thread becomes thread 0. Call after `memory_globals::init`.
+SCAFFOLD_API void init(const InitConfig &config = InitConfig());
+
+/// Stops and joins the worker threads. All jobs must have finished.
+SCAFFOLD_API void shutdown();
+
+/// Number of threads running jobs, the workers plus the thread that called `init`.
+SCAFFOLD_API u32 num_threads();
+
+/// Index of the calling thread, in [0, num_threads()).
+SCAFFOLD_API u32 thread_index();
+
+/// Returns true if the calling thread can create, run and wait on jobs: the thread that called `init`, or a
+/// worker.
+SCAFFOLD_API bool is_job_thread();
+
+/// Creates a job that calls `fn()`. The callable must fit in `Job::DATA_SIZE` bytes. If `parent` is not null,
+/// the parent doesn't finish until this job has. The job doesn't start until passed to `run`.
+template <typename Fn> Job *create(Fn fn, Job *parent = nullptr);
+
+/// Creates a job that does nothing by itself, to be the parent of other jobs.
+SCAFFOLD_API Job *create_group(Job *parent = nullptr);
+
+/// Queues the job to be run by this or any other thread.
+SCAFFOLD_API void run(Job *job);
+
+/// Returns true if the job and all its children have finished.
+SCAFFOLD_API bool is_finished(const Job *job);
+
+/// Runs other jobs until the given job has finished.
+SCAFFOLD_API void wait(const Job *job);
+
+/// Returns the calling thread's scratch allocator. Allocations made while running a job are freed when the
+/// job returns. Allocations made outside of jobs live until `shutdown`. Not thread-safe, use only on the
+/// calling thread.
+SCAFFOLD_API Allocator &scratch_allocator();
+
+/// Calls `fn(begin, end)` on subranges of [0, n) of at most `grain` items, in parallel, and returns when all
+/// are done. The range is split in halves recursively, so idle threads steal large pieces first.
+template <typename Fn> void parallel_for(u32 n, u32 grain, Fn fn);
+
+} // namespace jobs
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace jobs {
+
+namespace internal {
+
+/// Takes the next free job from the calling thread's ring. Sets up everything but `_run` and `_data`.
+SCAFFOLD_API Job *allocate_job(Job *parent);
+
+template <typename Fn> void run_callable(Job *job) {
+    Fn *fn = reinterpret_cast<Fn *>(job->_data);
+    (*fn)();
+    fn->~Fn();
+}
+
+template <typename Fn> struct ParallelFor {
+    Fn *fn;
+    Job *root;
+    u32 begin;
+    u32 end;
+    u32 grain;
+
+    void operator()() {
+        // Keep the lower half, hand out the upper halves
+        while (end - begin > grain) {
+            const u32 mid = begin + (end - begin) / 2;
+            run(create(ParallelFor{ fn, root, mid, end, grain }, root));
+            end = mid;
+        }
+        (*fn)(begin, end);
+    }
+};
+
+} // namespace internal
+
+template <typename Fn> Job *create(Fn fn, Job *parent) {
+    static_assert(sizeof(Fn) <= Job::DATA_SIZE, "Callable too large for a job, capture by reference");
+    static_assert(alignof(Fn) <= 8, "");
+
+    Job *job = internal::allocate_job(parent);
+    new (job->_data) Fn(std::move(fn));
+    job->_run = internal::run_callable<Fn>;
+    return job;
+}
+
+template <typename Fn> void parallel_for(u32 n, u32 grain, Fn fn) {
+    if (n == 0) {
+        return;
+    }
+    grain = grain == 0 ? 1 : grain;
+
+    Job *root = create_group();
+    run(create(internal::ParallelFor<Fn>{ &fn, root, 0, n, grain }, root));
+    run(root);
+    wait(root);
+}
+
+} // namespace jobs
+
+} // namespace fo
@@ -0,0 +1,234 @@
+/// A double-ended queue like `Queue`, stored in a "magic" ring buffer. The pages of the ring are mapped
+/// twice, back to back, in virtual memory, so the items that wrap around the end of the ring can be read and
+/// written as one contiguous block. `begin_front`/`end_front` always span all the items and `get_extent`
+/// always returns a single chunk, which is what bulk consumers want.
+///
+/// The ring is allocated straight from the OS with mmap, not from an `Allocator`, and its size is a whole
+/// number of pages. Items are copied with memcpy, like in `Queue`.
+#pragma once
+
+#include <scaffold/debug.h>
+#include <scaffold/queue.h>
+#include <scaffold/types.h>
+
+#include <string.h>
+#include <type_traits>
+
+namespace fo {
+
+/// Virtual memory mapped twice in a row. `_base[i]` and `_base[i + _size]` are the same byte.
+struct MirroredMemory {
+    u8 *_base = nullptr;
+    u64 _size = 0;
+};
+
+/// Returns the size of a virtual memory page.
+SCAFFOLD_API u64 page_size();
+
+/// Maps `size` bytes twice in a row. `size` must be a multiple of `page_size()`.
+SCAFFOLD_API MirroredMemory map_mirrored(u64 size);
+
+/// Unmaps memory mapped by `map_mirrored`. Does nothing for a default constructed `MirroredMemory`.
+SCAFFOLD_API void unmap_mirrored(MirroredMemory &m);
+
+template <typename T> struct MagicRingQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "Must");
+
+    MagicRingQueue();
+    ~MagicRingQueue();
+
+    MagicRingQueue(const MagicRingQueue &other) = delete;
+    MagicRingQueue &operator=(const MagicRingQueue &other) = delete;
+
+    MagicRingQueue(MagicRingQueue &&other);
+    MagicRingQueue &operator=(MagicRingQueue &&other);
+
+    T &operator[](uint32_t i);
+    const T &operator[](uint32_t i) const;
+
+    MirroredMemory _memory;
+    uint32_t _capacity; // Number of items in one copy of the ring
+    uint32_t _size;
+    uint32_t _offset;
+};
+
+/// Returns the number of items in the queue.
+template <typename T> uint32_t size(const MagicRingQueue<T> &q);
+/// Returns the number of items we can push before the queue needs to grow.
+template <typename T> uint32_t space(const MagicRingQueue<T> &q);
+/// Makes sure the queue has room for at least the specified number of items. Rounded up to whole pages.
+template <typename T> void reserve(MagicRingQueue<T> &q, uint32_t size);
+
+/// Pushes the item to the end of the queue.
+template <typename T> void push_back(MagicRingQueue<T> &q, const T &item);
+/// Pops the last item from the queue. The queue cannot be empty.
+template <typename T> void pop_back(MagicRingQueue<T> &q);
+/// Pushes the item to the front of the queue.
+template <typename T> void push_front(MagicRingQueue<T> &q, const T &item);
+/// Pops the first item from the queue. The queue cannot be empty.
+template <typename T> void pop_front(MagicRingQueue<T> &q);
+
+/// Consumes n items from the front of the queue.
+template <typename T> void consume(MagicRingQueue<T> &q, uint32_t n);
+/// Pushes n items to the back of the queue. A single memcpy, even when the items wrap around.
+template <typename T> void push(MagicRingQueue<T> &q, const T *items, uint32_t n);
+
+/// Returns the begin and end of the items in the queue, which are always contiguous.
+template <typename T> T *begin_front(MagicRingQueue<T> &q);
+template <typename T> const T *begin_front(const MagicRingQueue<T> &q);
+template <typename T> T *end_front(MagicRingQueue<T> &q);
+template <typename T> const T *end_front(const MagicRingQueue<T> &q);
+
+/// Same as for `Queue`, but the second chunk is always empty.
+template <typename T> ChunkExtent<T> get_extent(MagicRingQueue<T> &q, uint32_t start, uint32_t size);
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace magic_ring_internal {
+
+template <typename T> T *items(const MagicRingQueue<T> &q) { return reinterpret_cast<T *>(q._memory._base); }
+
+// Maps a ring of at least `min_capacity` items, keeping the contents.
+template <typename T> void remap(MagicRingQueue<T> &q, uint32_t min_capacity) {
+    // The ring must hold a whole number of items, so that the mirror starts at an item boundary
+    u64 unit = page_size();
+    while (unit % sizeof(T) != 0) {
+        unit += page_size();
+    }
+    const u64 bytes = (u64(min_capacity) * sizeof(T) + unit - 1) / unit * unit;
+
+    MirroredMemory memory = map_mirrored(bytes);
+    if (q._size != 0) {
+        memcpy(memory._base, begin_front(q), q._size * sizeof(T));
+    }
+    unmap_mirrored(q._memory);
+
+    q._memory = memory;
+    q._capacity = uint32_t(bytes / sizeof(T));
+    q._offset = 0;
+}
+
+template <typename T> void grow(MagicRingQueue<T> &q, uint32_t min_capacity = 0) {
+    uint32_t new_capacity = q._capacity * 2;
+    if (new_capacity < min_capacity)
+        new_capacity = min_capacity;
+    remap(q, new_capacity);
+}
+
+} // namespace magic_ring_internal
+
+template <typename T> inline uint32_t size(const MagicRingQueue<T> &q) { return q._size; }
+
+template <typename T> inline uint32_t space(const MagicRingQueue<T> &q) { return q._capacity - q._size; }
+
+template <typename T> void reserve(MagicRingQueue<T> &q, uint32_t size) {
+    if (size > q._capacity)
+        magic_ring_internal::remap(q, size);
+}
+
+template <typename T> inline void push_back(MagicRingQueue<T> &q, const T &item) {
+    if (!space(q))
+        magic_ring_internal::grow(q, 1);
+    q[q._size++] = item;
+}
+
+template <typename T> inline void pop_back(MagicRingQueue<T> &q) { --q._size; }
+
+template <typename T> inline void push_front(MagicRingQueue<T> &q, const T &item) {
+    if (!space(q))
+        magic_ring_internal::grow(q, 1);
+    q._offset = queue_internal::wrap(q._offset - 1 + q._capacity, q._capacity);
+    ++q._size;
+    q[0] = item;
+}
+
+template <typename T> inline void pop_front(MagicRingQueue<T> &q) {
+    q._offset = queue_internal::wrap(q._offset + 1, q._capacity);
+    --q._size;
+}
+
+template <typename T> inline void consume(MagicRingQueue<T> &q, uint32_t n) {
+    q._offset = queue_internal::wrap(q._offset + n, q._capacity);
+    q._size -= n;
+}
+
+template <typename T> void push(MagicRingQueue<T> &q, const T *items, uint32_t n) {
+    if (space(q) < n)
+        magic_ring_internal::grow(q, size(q) + n);
+    memcpy(end_front(q), items, n * sizeof(T));
+    q._size += n;
+}
+
+template <typename T> inline T *begin_front(MagicRingQueue<T> &q) {
+    return magic_ring_internal::items(q) + q._offset;
+}
+
+template <typename T> inline const T *begin_front(const MagicRingQueue<T> &q) {
+    return magic_ring_internal::items(q) + q._offset;
+}
+
+template <typename T> inline T *end_front(MagicRingQueue<T> &q) { return begin_front(q) + q._size; }
+
+template <typename T> inline const T *end_front(const MagicRingQueue<T> &q) {
+    return begin_front(q) + q._size;
+}
+
+template <typename T> ChunkExtent<T> get_extent(MagicRingQueue<T> &q, uint32_t start, uint32_t count) {
+    ChunkExtent<T> e;
+    e.first_chunk = begin_front(q) + start;
+    e.first_chunk_size = count;
+    e.second_chunk = nullptr;
+    e.second_chunk_size = 0;
+    return e;
+}
+
+template <typename T>
+MagicRingQueue<T>::MagicRingQueue()
+    : _memory()
+    , _capacity(0)
+    , _size(0)
+    , _offset(0) {}
+
+template <typename T> MagicRingQueue<T>::~MagicRingQueue() { unmap_mirrored(_memory); }
+
+template <typename T>
+MagicRingQueue<T>::MagicRingQueue(MagicRingQueue<T> &&other)
+    : _memory(other._memory)
+    , _capacity(other._capacity)
+    , _size(other._size)
+    , _offset(other._offset) {
+    other._memory = MirroredMemory{};
+    other._capacity = 0;
+    other._size = 0;
+    other._offset = 0;
+}
+
+template <typename T> MagicRingQueue<T> &MagicRingQueue<T>::operator=(MagicRingQueue<T> &&other) {
+    if (this != &other) {
+        unmap_mirrored(_memory);
+        _memory = other._memory;
+        _capacity = other._capacity;
+        _size = other._size;
+        _offset = other._offset;
+        other._memory = MirroredMemory{};
+        other._capacity = 0;
+        other._size = 0;
+        other._offset = 0;
+    }
+    return *this;
+}
+
+// No wrapping needed, indices past the end of the ring land in the mirror
+template <typename T> inline T &MagicRingQueue<T>::operator[](uint32_t i) {
+    return magic_ring_internal::items(*this)[_offset + i];
+}
+
+template <typename T> inline const T &MagicRingQueue<T>::operator[](uint32_t i) const {
+    return magic_ring_internal::items(*this)[_offset + i];
+}
+
+} // namespace fo
@@ -0,0 +1,241 @@
+// A multi-map from uint64_t keys to POD values, where all the values of a key are kept next to each other in a
+// single pool. Compared to the multi_hash_* functions on `Hash<T>`, which chain each value through `next`
+// indices, reading all values of a key is a sequential scan over one contiguous run.
+#pragma once
+
+#include <scaffold/array.h>
+#include <scaffold/collection_types.h>
+#include <scaffold/pod_hash.h>
+
+namespace fo {
+
+template <typename T> struct MultiHash {
+    static_assert(std::is_trivially_copy_assignable<T>::value, "Must");
+
+    /// Where the values of a key are in the pool. The run has room for `capacity` values, the first `count`
+    /// of which are in use.
+    struct Run {
+        uint32_t offset;
+        uint32_t count;
+        uint32_t capacity;
+    };
+
+    PodHash<uint64_t, Run> _runs; // Maps a key to its run
+    Array<T> _pool;               // Values of all keys
+    uint32_t _num_values;         // Number of values in use
+    uint32_t _num_dead;           // Number of pool slots not belonging to any run, reclaimed by compaction
+
+    MultiHash(Allocator &a);
+    MultiHash(MultiHash &&other) = default;
+};
+
+/// A contiguous range of values belonging to one key. Empty if the key is not present. Invalidated by any
+/// modification of the table.
+template <typename T> struct MultiHashValues {
+    const T *_first;
+    const T *_last;
+};
+
+template <typename T> const T *begin(const MultiHashValues<T> &v) { return v._first; }
+template <typename T> const T *end(const MultiHashValues<T> &v) { return v._last; }
+template <typename T> uint32_t size(const MultiHashValues<T> &v) { return uint32_t(v._last - v._first); }
+
+namespace multi_hash {
+
+/// Returns true if at least one value is associated with the key.
+template <typename T> bool has(const MultiHash<T> &h, uint64_t key);
+
+/// Returns the number of values associated with the key.
+template <typename T> uint32_t count(const MultiHash<T> &h, uint64_t key);
+
+/// Returns the values associated with the key, in no particular order.
+template <typename T> MultiHashValues<T> get(const MultiHash<T> &h, uint64_t key);
+
+/// Appends all values associated with the key to `items`. Use a TempAllocator for the array to avoid
+/// allocating memory.
+template <typename T> void get(const MultiHash<T> &h, uint64_t key, Array<T> &items);
+
+/// Adds the value as an additional value for the key.
+template <typename T> void insert(MultiHash<T> &h, uint64_t key, const T &value);
+
+/// Removes the value at position `i` of the key's values, as seen by `get`. The last value of the key is moved
+/// into its place.
+template <typename T> void remove(MultiHash<T> &h, uint64_t key, uint32_t i);
+
+/// Removes all values associated with the key.
+template <typename T> void remove_all(MultiHash<T> &h, uint64_t key);
+
+/// Returns the number of distinct keys.
+template <typename T> uint32_t num_keys(const MultiHash<T> &h);
+
+/// Returns the number of values over all keys.
+template <typename T> uint32_t num_values(const MultiHash<T> &h);
+
+/// Reserves space for `num_keys` keys and `num_values` values.
+template <typename T> void reserve(MultiHash<T> &h, uint32_t num_keys, uint32_t num_values);
+
+/// Moves all runs next to each other, trimming their unused capacity. Happens automatically on insert when
+/// more than half of the pool is unused.
+template <typename T> void compact(MultiHash<T> &h);
+
+} // namespace multi_hash
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+template <typename T>
+MultiHash<T>::MultiHash(Allocator &a)
+    : _runs(a, a, ConvertToInt<uint64_t>(), CallEqualOperator<uint64_t>())
+    , _pool(a)
+    , _num_values(0)
+    , _num_dead(0) {}
+
+namespace multi_hash {
+
+namespace internal {
+
+// Capacity of a newly created run
+constexpr uint32_t MIN_RUN_CAPACITY = 2;
+
+template <typename T> typename MultiHash<T>::Run *find_run(const MultiHash<T> &h, uint64_t key) {
+    const auto it = fo::get(h._runs, key);
+    if (it == end(h._runs)) {
+        return nullptr;
+    }
+    return &it->value;
+}
+
+// Gives the run a new block of `new_capacity` slots at the end of the pool
+template <typename T> void move_run_to_end(MultiHash<T> &h, typename MultiHash<T>::Run &run, uint32_t new_capacity) {
+    const uint32_t new_offset = size(h._pool);
+    resize(h._pool, new_offset + new_capacity);
+    memcpy(data(h._pool) + new_offset, data(h._pool) + run.offset, run.count * sizeof(T));
+    h._num_dead += run.capacity;
+    run.offset = new_offset;
+    run.capacity = new_capacity;
+}
+
+template <typename T> bool needs_compaction(const MultiHash<T> &h) {
+    return h._num_dead > 64 && h._num_dead > size(h._pool) / 2;
+}
+
+} // namespace internal
+
+template <typename T> bool has(const MultiHash<T> &h, uint64_t key) {
+    return internal::find_run(h, key) != nullptr;
+}
+
+template <typename T> uint32_t count(const MultiHash<T> &h, uint64_t key) {
+    const auto run = internal::find_run(h, key);
+    return run ? run->count : 0;
+}
+
+template <typename T> MultiHashValues<T> get(const MultiHash<T> &h, uint64_t key) {
+    const auto run = internal::find_run(h, key);
+    if (!run) {
+        return MultiHashValues<T>{ nullptr, nullptr };
+    }
+    const T *first = data(h._pool) + run->offset;
+    return MultiHashValues<T>{ first, first + run->count };
+}
+
+template <typename T> void get(const MultiHash<T> &h, uint64_t key, Array<T> &items) {
+    const auto values = get(h, key);
+    if (size(values) == 0) {
+        return;
+    }
+    const uint32_t old_size = size(items);
+    resize(items, old_size + size(values));
+    memcpy(data(items) + old_size, begin(values), size(values) * sizeof(T));
+}
+
+template <typename T> void insert(MultiHash<T> &h, uint64_t key, const T &value) {
+    auto run = internal::find_run(h, key);
+
+    if (!run) {
+        typename MultiHash<T>::Run new_run;
+        new_run.offset = size(h._pool);
+        new_run.count = 0;
+        new_run.capacity = internal::MIN_RUN_CAPACITY;
+        resize(h._pool, new_run.offset + new_run.capacity);
+        run = &set_then_ref(h._runs, key, new_run);
+    } else if (run->count == run->capacity) {
+        if (run->offset + run->capacity == size(h._pool)) {
+            // Last run in the pool, can grow in place
+            resize(h._pool, size(h._pool) + run->capacity);
+            run->capacity *= 2;
+        } else {
+            internal::move_run_to_end(h, *run, run->capacity * 2);
+        }
+    }
+
+    h._pool[run->offset + run->count] = value;
+    ++run->count;
+    ++h._num_values;
+
+    if (internal::needs_compaction(h)) {
+        compact(h);
+    }
+}
+
+template <typename T> void remove(MultiHash<T> &h, uint64_t key, uint32_t i) {
+    auto run = internal::find_run(h, key);
+    log_assert(run && i < run->count, "Invalid value index %u", i);
+
+    --run->count;
+    h._pool[run->offset + i] = h._pool[run->offset + run->count];
+    --h._num_values;
+
+    if (run->count == 0) {
+        remove_all(h, key);
+    }
+}
+
+template <typename T> void remove_all(MultiHash<T> &h, uint64_t key) {
+    auto run = internal::find_run(h, key);
+    if (!run) {
+        return;
+    }
+
+    h._num_values -= run->count;
+    if (run->offset + run->capacity == size(h._pool)) {
+        resize(h._pool, run->offset);
+    } else {
+        h._num_dead += run->capacity;
+    }
+    fo::remove(h._runs, key);
+}
+
+template <typename T> uint32_t num_keys(const MultiHash<T> &h) { return size(h._runs._entries); }
+
+template <typename T> uint32_t num_values(const MultiHash<T> &h) { return h._num_values; }
+
+template <typename T> void reserve(MultiHash<T> &h, uint32_t num_keys, uint32_t num_values) {
+    fo::reserve(h._runs, num_keys);
+    reserve(h._pool, num_values);
+}
+
+template <typename T> void compact(MultiHash<T> &h) {
+    Array<T> new_pool(*h._pool._allocator);
+    reserve(new_pool, h._num_values + internal::MIN_RUN_CAPACITY);
+
+    // Runs are visited in the order of the table's entries, which is as good as any
+    for (auto &e : h._runs._entries) {
+        auto &run = e.value;
+        const uint32_t new_offset = size(new_pool);
+        resize(new_pool, new_offset + run.count);
+        memcpy(data(new_pool) + new_offset, data(h._pool) + run.offset, run.count * sizeof(T));
+        run.offset = new_offset;
+        run.capacity = run.count;
+    }
+
+    std::swap(h._pool, new_pool);
+    h._num_dead = 0;
+}
+
+} // namespace multi_hash
+
+} // namespace fo
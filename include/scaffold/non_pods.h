@@ -53,17 +53,16 @@ template <typename T> struct Vector {
     const T *cend() const { return _data + _size; }
 };
 
-template <typename Key, typename Value> struct OrderedMap {
-    using Rbt = fo::rbt::RBTree<Key, Value>;
+template <typename Key, typename Value, typename Less = std::less<Key>> struct OrderedMap {
+    using Rbt = fo::rbt::RBTree<Key, Value, Less>;
 
     Rbt _rbt;
 
-    using iterator = fo::rbt::Iterator<Key, Value, false>;
-    using const_iterator = fo::rbt::Iterator<Key, Value, true>;
+    using iterator = fo::rbt::Iterator<Key, Value, false, Less>;
+    using const_iterator = fo::rbt::Iterator<Key, Value, true, Less>;
 
-    OrderedMap(fo::Allocator &allocator = fo::memory_globals::default_allocator(),
-               typename Rbt::is_less_fn less_fn = std::less<Key>{})
-        : _rbt(allocator, less_fn) {}
+    OrderedMap(fo::Allocator &allocator = fo::memory_globals::default_allocator(), Less less_fn = Less{})
+        : _rbt(allocator, std::move(less_fn)) {}
 
     ~OrderedMap() {}
 
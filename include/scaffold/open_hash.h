@@ -6,8 +6,10 @@
 #include <scaffold/const_log.h>
 #include <scaffold/debug.h>
 #include <scaffold/memory.h>
+#include <scaffold/radix_partition.h>
 
 #include <assert.h>
+#include <stddef.h>
 #include <functional>
 #include <type_traits>
 
@@ -28,11 +30,69 @@ template <typename K> struct GetNilAndDeleted {
     static K get_deleted();
 };
 
+namespace open_hash {
+
+/// Slot layout policies for OpenHash. Each one provides a `Slots<K, V>` template that decides where the key
+/// and the value of slot `i` live in the table's buffer. Key `i` is at `_keys_offset + i * key_stride` and
+/// value `i` is at `_values_offset + i * value_stride`.
+
+/// All keys in one array followed (or preceded) by all values in another. Probing only touches the keys
+/// array, so this is the better choice for large values and for tables where most lookups are misses. A hit
+/// costs a cache miss in each array though.
+struct SeparateArrays {
+    template <typename K, typename V> struct Slots {
+        static constexpr uint32_t key_stride = sizeof(K);
+        static constexpr uint32_t value_stride = sizeof(V);
+        static constexpr uint32_t buffer_align = alignof(K) > alignof(V) ? alignof(K) : alignof(V);
+
+        static uint32_t buffer_size(uint32_t num_slots) { return sizeof(K) * num_slots + sizeof(V) * num_slots; }
+
+        // The one with the stricter alignment is kept first in the buffer.
+        static void set_offsets(uint32_t num_slots, uint32_t &keys_offset, uint32_t &values_offset) {
+            if (buffer_align == alignof(K)) {
+                keys_offset = 0;
+                values_offset = sizeof(K) * num_slots;
+            } else {
+                values_offset = 0;
+                keys_offset = sizeof(V) * num_slots;
+            }
+        }
+    };
+};
+
+/// Each value is stored right after its key, so that a hit usually costs a single cache miss. Use for small
+/// values (up to 16 bytes or so). Larger values spread the keys out and make probing touch more lines.
+struct InterleavedSlots {
+    template <typename K, typename V> struct Slots {
+        struct Slot {
+            K key;
+            V value;
+        };
+
+        static constexpr uint32_t key_stride = sizeof(Slot);
+        static constexpr uint32_t value_stride = sizeof(Slot);
+        static constexpr uint32_t buffer_align = alignof(Slot);
+
+        static uint32_t buffer_size(uint32_t num_slots) { return sizeof(Slot) * num_slots; }
+
+        static void set_offsets(uint32_t, uint32_t &keys_offset, uint32_t &values_offset) {
+            keys_offset = offsetof(Slot, key);
+            values_offset = offsetof(Slot, value);
+        }
+    };
+};
+
+} // namespace open_hash
+
 } // namespace fo
 
 namespace fo {
 
-template <typename K, typename V, typename TGetNilAndDeleted = GetNilAndDeleted<K>> struct OpenHash {
+template <typename K,
+          typename V,
+          typename TGetNilAndDeleted = GetNilAndDeleted<K>,
+          typename TLayout = open_hash::SeparateArrays>
+struct OpenHash {
     static_assert(std::is_trivially_destructible<K>::value, "Must");
     static_assert(std::is_trivially_destructible<V>::value, "Must");
     static_assert(std::is_default_constructible<K>::value, "Must");
@@ -44,6 +104,7 @@ template <typename K, typename V, typename TGetNilAndDeleted = GetNilAndDeleted<
     using KeyType = K;
     using ValueType = V;
     using TGetNilAndDeletedType = TGetNilAndDeleted;
+    using Slots = typename TLayout::template Slots<K, V>;
 
     /// Type of hash function
     using HashFn = std::function<uint32_t(const K &)>;
@@ -54,9 +115,9 @@ template <typename K, typename V, typename TGetNilAndDeleted = GetNilAndDeleted<
     uint32_t _num_slots;     // Number of slots (valid, deleted, nil)
     HashFn _hash_fn;         // Hash function
     EqualFn _equal_fn;       // Equal comparison
-    uint8_t *_buffer;        // Pointer to the buffer where we keep the keys and value arrays
-    uint32_t _keys_offset;   // Offset of keys array
-    uint32_t _values_offset; // Offset of values array
+    uint8_t *_buffer;        // Pointer to the buffer where we keep the keys and values
+    uint32_t _keys_offset;   // Offset of the first key
+    uint32_t _values_offset; // Offset of the first value
     Allocator *_allocator;   // Buffer allocator
 
     /// Creates a hash table able to hold `initial_size` number of elements
@@ -76,43 +137,67 @@ template <typename K, typename V, typename TGetNilAndDeleted = GetNilAndDeleted<
 
 namespace fo {
 namespace open_hash {
+
+namespace internal {
+
+// Views the keys or values of a table as an array, whatever the slot layout.
+template <typename T, uint32_t stride> struct StridedArray {
+    uint8_t *_p;
+
+    T &operator[](uint32_t i) const { return *reinterpret_cast<T *>(_p + uint64_t(i) * stride); }
+};
+
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+StridedArray<K, OpenHash<K, V, TGetNilAndDeleted, TLayout>::Slots::key_stride>
+keys_array(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h) {
+    return { h._buffer + h._keys_offset };
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+StridedArray<V, OpenHash<K, V, TGetNilAndDeleted, TLayout>::Slots::value_stride>
+values_array(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h) {
+    return { h._buffer + h._values_offset };
+}
+
+} // namespace internal
+
 /// Denotes that key is not found
 constexpr uint32_t NOT_FOUND = 0xffffffffu;
 
 /// Returns NOT_FOUND if given `key` is not associated with any value. Otherwise returns an integer i such
 /// that calling `value` will return a reference to the value.
-template <typename K, typename V, typename TGetNilAndDeleted>
-uint32_t find(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t find(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key);
 
 /// Returns the value at the given index
-template <typename K, typename V, typename TGetNilAndDeleted>
-V &value(OpenHash<K, V, TGetNilAndDeleted> &h, uint32_t index);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+V &value(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, uint32_t index);
 
 /// Returns the value at the given index (const reference)
-template <typename K, typename V, typename TGetNilAndDeleted>
-const V &value(const OpenHash<K, V, TGetNilAndDeleted> &h, uint32_t index);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+const V &value(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, uint32_t index);
 
 /// Returns reference to value associated with the given key. If given key doesn't exist, inserts it and
 /// default constructs a value first.
-template <typename K, typename V, typename TGetNilAndDeleted>
-const V &value_default(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+const V &value_default(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key);
 
 /// Same as above. Returns non-const reference
-template <typename K, typename V, typename TGetNilAndDeleted>
-V &value_default(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+V &value_default(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key);
 
 /// Returns the value associated with the given key. Key must exist.
-template <typename K, typename V, typename TGetNilAndDeleted>
-const V &must_value(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+const V &must_value(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key);
 
 /// Returns the value associated with the given key (const reference). Key must exist.
-template <typename K, typename V, typename TGetNilAndDeleted>
-const V &must_value(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+const V &must_value(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key);
 
 #if __has_include(<optional>)
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-std::optional<V *> maybe_value(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+std::optional<V *> maybe_value(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
     const auto index = find(h, key);
     if (index == NOT_FOUND) {
         return std::nullopt;
@@ -125,26 +210,44 @@ std::optional<V *> maybe_value(OpenHash<K, V, TGetNilAndDeleted> &h, const K &ke
 
 /// Associates the given value with the given key. May trigger a rehash if key doesn't exist already. Returns
 /// the position of the value.
-template <typename K, typename V, typename TGetNilAndDeleted>
-void set(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key, const V &value);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void set(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key, const V &value);
 
 /// Inserts the given key but does not take any value to associate with the key. Returns the index into the
 /// values array. (You must create some value there yourself!)
-template <typename K, typename V, typename TGetNilAndDeleted>
-uint32_t insert_key(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t insert_key(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key);
 
 /// Removes the key if it exists
-template <typename K, typename V, typename TGetNilAndDeleted>
-void remove(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void remove(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key);
+
+/// Looks up `n` keys at once and writes, for each key, the index `find` would return into `out_indices`.
+/// Keys are hashed and their first probe slots prefetched a group at a time before any of the group is
+/// resolved, so the cache misses of a group overlap instead of being paid one after another. Pays off on
+/// tables that don't fit in cache.
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void find_batch(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K *keys, uint32_t n, uint32_t *out_indices);
+
+/// Replaces the contents of the table with the given `n` key-value pairs. The table is sized once for `n`
+/// keys, then the keys are hashed (on `num_threads` threads) and inserted grouped by the region of the table
+/// they land in, so that the inserts don't miss the cache on large tables. A key given more than once takes
+/// its last value, as with `set`.
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void build_from(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h,
+                const K *keys,
+                const V *values,
+                uint32_t n,
+                uint32_t num_threads = 1);
 
 /// Flaky iterator support. A little too convoluted for my likes.
-template <typename K, typename V, typename TGetNilAndDeleted, bool is_const> struct Iterator {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout, bool is_const> struct Iterator {
     using KeyType = K;
     using ValueType = typename std::conditional<is_const, V, const V>::type;
     using TGetNilAndDeletedType = TGetNilAndDeleted;
     using OpenHashType = typename std::conditional<is_const,
-                                                   const OpenHash<K, V, TGetNilAndDeleted>,
-                                                   OpenHash<K, V, TGetNilAndDeleted>>::type;
+                                                   const OpenHash<K, V, TGetNilAndDeleted, TLayout>,
+                                                   OpenHash<K, V, TGetNilAndDeleted, TLayout>>::type;
 
     OpenHashType *_h;
     uint32_t _slot; // Either points to `end` or a valid slot. Never points to a deleted or nil slot.
@@ -158,7 +261,6 @@ template <typename K, typename V, typename TGetNilAndDeleted, bool is_const> str
         _slot = std::min(_h->_num_slots, _slot);
 
         auto keys = _keys_array();
-        auto values = _values_array();
 
         // Must start with a valid slot if it exists
         while (_slot != _h->_num_slots) {
@@ -175,15 +277,18 @@ template <typename K, typename V, typename TGetNilAndDeleted, bool is_const> str
         : _h(other._h)
         , _slot(other._slot) {}
 
-    KeyType *_keys_array() const { return reinterpret_cast<KeyType *>(_h->_buffer + _h->_keys_offset); }
+    using Slots = typename OpenHash<K, V, TGetNilAndDeleted, TLayout>::Slots;
+
+    internal::StridedArray<KeyType, Slots::key_stride> _keys_array() const {
+        return { _h->_buffer + _h->_keys_offset };
+    }
 
-    ValueType *_values_array() const {
-        return reinterpret_cast<ValueType *>(_h->_buffer + _h->_values_offset);
+    internal::StridedArray<ValueType, Slots::value_stride> _values_array() const {
+        return { _h->_buffer + _h->_values_offset };
     }
 
     Iterator &operator++() {
         auto keys = _keys_array();
-        auto values = _values_array();
 
         while (true) {
             ++_slot;
@@ -228,49 +333,49 @@ template <typename K, typename V, typename TGetNilAndDeleted, bool is_const> str
 
 // Iterator returns
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-open_hash::Iterator<K, V, TGetNilAndDeleted, true> begin(const OpenHash<K, V, TGetNilAndDeleted> &h) {
-    return open_hash::Iterator<K, V, TGetNilAndDeleted, true>(h, 0);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, true> begin(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h) {
+    return open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, true>(h, 0);
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-open_hash::Iterator<K, V, TGetNilAndDeleted, true> end(const OpenHash<K, V, TGetNilAndDeleted> &h) {
-    return open_hash::Iterator<K, V, TGetNilAndDeleted, true>(h, h._num_slots);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, true> end(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h) {
+    return open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, true>(h, h._num_slots);
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-open_hash::Iterator<K, V, TGetNilAndDeleted, false> begin(OpenHash<K, V, TGetNilAndDeleted> &h) {
-    return open_hash::Iterator<K, V, TGetNilAndDeleted, false>(h, 0);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, false> begin(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h) {
+    return open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, false>(h, 0);
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-open_hash::Iterator<K, V, TGetNilAndDeleted, false> end(OpenHash<K, V, TGetNilAndDeleted> &h) {
-    return open_hash::Iterator<K, V, TGetNilAndDeleted, false>(h, h._num_slots);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, false> end(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h) {
+    return open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, false>(h, h._num_slots);
 }
 
 // Comparisons. Not doing all of them. Will add if I ever need others.
 
-template <typename K, typename V, typename TGetNilAndDeleted, bool is_const>
-bool operator<(const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_0,
-               const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_1) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout, bool is_const>
+bool operator<(const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_0,
+               const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_1) {
     return it_0._slot < it_1._slot;
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted, bool is_const>
-bool operator==(const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_0,
-                const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_1) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout, bool is_const>
+bool operator==(const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_0,
+                const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_1) {
     return it_0._slot == it_1._slot;
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted, bool is_const>
-bool operator!=(const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_0,
-                const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_1) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout, bool is_const>
+bool operator!=(const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_0,
+                const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_1) {
     return it_0._slot != it_1._slot;
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted, bool is_const>
-bool operator>(const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_0,
-               const open_hash::Iterator<K, V, TGetNilAndDeleted, is_const> &it_1) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout, bool is_const>
+bool operator>(const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_0,
+               const open_hash::Iterator<K, V, TGetNilAndDeleted, TLayout, is_const> &it_1) {
     return it_1 < it_0;
 }
 
@@ -283,26 +388,34 @@ namespace open_hash {
 namespace internal {
 
 // Calculates key and value array offsets
-template <typename K, typename V, typename TGetNilAndDeleted>
-uint32_t allocate_buffer(OpenHash<K, V, TGetNilAndDeleted> *q, uint32_t num_slots);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t allocate_buffer(OpenHash<K, V, TGetNilAndDeleted, TLayout> *q, uint32_t num_slots);
 
 // Destroys a hash table
-template <typename K, typename V, typename TGetNilAndDeleted>
-void destroy(OpenHash<K, V, TGetNilAndDeleted> *q, bool moved_from);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void destroy(OpenHash<K, V, TGetNilAndDeleted, TLayout> *q, bool moved_from);
 
 // Rehashes
-template <typename K, typename V, typename TGetNilAndDeleted>
-void rehash_if_needed(OpenHash<K, V, TGetNilAndDeleted> &h);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void rehash_if_needed(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h);
+
+// Probes for `key` starting from hash value `idx`
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t probe(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key, uint32_t idx);
+
+// Number of keys find_batch hashes and prefetches before resolving them. Enough to keep the line fill
+// buffers busy, few enough that the prefetched lines are still in L1 when we get to them.
+constexpr uint32_t BATCH_GROUP_SIZE = 16;
 } // namespace internal
 } // namespace open_hash
 } // namespace fo
 
 namespace fo {
-template <typename K, typename V, typename TGetNilAndDeleted>
-OpenHash<K, V, TGetNilAndDeleted>::OpenHash(Allocator &allocator,
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+OpenHash<K, V, TGetNilAndDeleted, TLayout>::OpenHash(Allocator &allocator,
                                             uint32_t initial_size,
-                                            typename OpenHash<K, V, TGetNilAndDeleted>::HashFn hash_fn,
-                                            typename OpenHash<K, V, TGetNilAndDeleted>::EqualFn equal_fn)
+                                            typename OpenHash<K, V, TGetNilAndDeleted, TLayout>::HashFn hash_fn,
+                                            typename OpenHash<K, V, TGetNilAndDeleted, TLayout>::EqualFn equal_fn)
     : _num_valid(0)
     , _num_deleted(0)
     , _num_slots(0)
@@ -313,14 +426,14 @@ OpenHash<K, V, TGetNilAndDeleted>::OpenHash(Allocator &allocator,
     _num_slots = clip_to_pow2(initial_size);
     open_hash::internal::allocate_buffer(this, _num_slots);
 
-    K *keys = (K *)(_buffer + _keys_offset);
+    auto keys = open_hash::internal::keys_array(*this);
 
     for (uint32_t i = 0; i < _num_slots; ++i) {
         keys[i] = TGetNilAndDeleted::get_nil();
     }
 }
-template <typename K, typename V, typename TGetNilAndDeleted>
-OpenHash<K, V, TGetNilAndDeleted>::OpenHash(const OpenHash &other)
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+OpenHash<K, V, TGetNilAndDeleted, TLayout>::OpenHash(const OpenHash &other)
     : _num_valid(other._num_valid)
     , _num_deleted(other._num_deleted)
     , _num_slots(other._num_slots)
@@ -330,8 +443,8 @@ OpenHash<K, V, TGetNilAndDeleted>::OpenHash(const OpenHash &other)
     uint32_t buffer_size = open_hash::internal::allocate_buffer(this, _num_slots);
     memcpy(_buffer, other._buffer, buffer_size);
 }
-template <typename K, typename V, typename TGetNilAndDeleted>
-OpenHash<K, V, TGetNilAndDeleted>::OpenHash(OpenHash<K, V, TGetNilAndDeleted> &&other)
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+OpenHash<K, V, TGetNilAndDeleted, TLayout>::OpenHash(OpenHash<K, V, TGetNilAndDeleted, TLayout> &&other)
     : _num_valid(other._num_valid)
     , _num_deleted(other._num_deleted)
     , _num_slots(other._num_slots)
@@ -344,8 +457,8 @@ OpenHash<K, V, TGetNilAndDeleted>::OpenHash(OpenHash<K, V, TGetNilAndDeleted> &&
     open_hash::internal::destroy(&other, true);
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-OpenHash<K, V, TGetNilAndDeleted> &OpenHash<K, V, TGetNilAndDeleted>::operator=(OpenHash &&other) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+OpenHash<K, V, TGetNilAndDeleted, TLayout> &OpenHash<K, V, TGetNilAndDeleted, TLayout>::operator=(OpenHash &&other) {
     if (this != &other) {
         if (_allocator != nullptr) {
             _allocator->deallocate(_buffer);
@@ -364,8 +477,8 @@ OpenHash<K, V, TGetNilAndDeleted> &OpenHash<K, V, TGetNilAndDeleted>::operator=(
     return *this;
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-OpenHash<K, V, TGetNilAndDeleted> &OpenHash<K, V, TGetNilAndDeleted>::operator=(const OpenHash &other) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+OpenHash<K, V, TGetNilAndDeleted, TLayout> &OpenHash<K, V, TGetNilAndDeleted, TLayout>::operator=(const OpenHash &other) {
     if (this != &other) {
         if (_allocator != nullptr) {
             _allocator->deallocate(_buffer);
@@ -382,7 +495,7 @@ OpenHash<K, V, TGetNilAndDeleted> &OpenHash<K, V, TGetNilAndDeleted>::operator=(
     return *this;
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted> OpenHash<K, V, TGetNilAndDeleted>::~OpenHash() {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout> OpenHash<K, V, TGetNilAndDeleted, TLayout>::~OpenHash() {
     open_hash::internal::destroy(this, false);
 }
 
@@ -392,24 +505,18 @@ namespace fo {
 namespace open_hash {
 namespace internal {
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-uint32_t allocate_buffer(OpenHash<K, V, TGetNilAndDeleted> *q, uint32_t num_slots) {
-    // Using the one with the stricter alignment. Larger one is kept first in the buffer.
-    constexpr uint16_t buffer_align = alignof(K) > alignof(V) ? alignof(K) : alignof(V);
-    if (buffer_align == alignof(K)) {
-        q->_keys_offset = 0;
-        q->_values_offset = sizeof(K) * num_slots;
-    } else {
-        q->_values_offset = 0;
-        q->_keys_offset = sizeof(V) * num_slots;
-    }
-    uint32_t buffer_size = sizeof(K) * num_slots + sizeof(V) * num_slots;
-    q->_buffer = (uint8_t *)q->_allocator->allocate(buffer_size, buffer_align);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t allocate_buffer(OpenHash<K, V, TGetNilAndDeleted, TLayout> *q, uint32_t num_slots) {
+    using Slots = typename OpenHash<K, V, TGetNilAndDeleted, TLayout>::Slots;
+
+    Slots::set_offsets(num_slots, q->_keys_offset, q->_values_offset);
+    uint32_t buffer_size = Slots::buffer_size(num_slots);
+    q->_buffer = (uint8_t *)q->_allocator->allocate(buffer_size, Slots::buffer_align);
     return buffer_size;
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-void destroy(OpenHash<K, V, TGetNilAndDeleted> *q, bool moved_from) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void destroy(OpenHash<K, V, TGetNilAndDeleted, TLayout> *q, bool moved_from) {
     // allocator non null denotes valid object
     if (q->_allocator) {
         // Only deallocate if this was not moved from
@@ -426,8 +533,8 @@ void destroy(OpenHash<K, V, TGetNilAndDeleted> *q, bool moved_from) {
     }
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-void rehash_if_needed(OpenHash<K, V, TGetNilAndDeleted> &h) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void rehash_if_needed(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h) {
     static constexpr float max_load_factor = 0.5;
     // const uint32_t array_size = size(h._keys);
 
@@ -441,10 +548,10 @@ void rehash_if_needed(OpenHash<K, V, TGetNilAndDeleted> &h) {
     // Check and see if we do not actually need to double the size, since only valid entries will be entered
     uint32_t new_size = valid_load_factor >= max_load_factor ? h._num_slots * 2 : h._num_slots;
 
-    OpenHash<K, V, TGetNilAndDeleted> new_h{ *h._allocator, new_size, h._hash_fn, h._equal_fn };
+    OpenHash<K, V, TGetNilAndDeleted, TLayout> new_h{ *h._allocator, new_size, h._hash_fn, h._equal_fn };
 
-    K *keys = (K *)(h._buffer + h._keys_offset);
-    V *values = (V *)(h._buffer + h._values_offset);
+    auto keys = internal::keys_array(h);
+    auto values = internal::values_array(h);
 
     for (uint32_t i = 0; i < h._num_slots; ++i) {
         const K &key = keys[i];
@@ -463,12 +570,14 @@ void rehash_if_needed(OpenHash<K, V, TGetNilAndDeleted> &h) {
 namespace fo {
 namespace open_hash {
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-uint32_t find(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
-    uint32_t idx = h._hash_fn(key);
+namespace internal {
+
+// Number of slots in each of the regions that `build_from` groups its inserts by
+constexpr uint32_t BUILD_REGION_SIZE = 1u << 14;
 
-    K *keys = (K *)(h._buffer + h._keys_offset);
-    // V *values = (V *)(h._buffer + h._values_offset);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t probe(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key, uint32_t idx) {
+    auto keys = internal::keys_array(h);
 
     for (uint32_t i = 0; i < h._num_slots; ++i) {
         idx = (idx + i) % h._num_slots;
@@ -482,65 +591,146 @@ uint32_t find(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
     return NOT_FOUND;
 }
 
+} // namespace internal
+
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t find(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
+    return internal::probe(h, key, h._hash_fn(key));
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void find_batch(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K *keys, uint32_t n, uint32_t *out_indices) {
+    auto slot_keys = internal::keys_array(h);
+    auto slot_values = internal::values_array(h);
+
+    for (uint32_t start = 0; start < n; start += internal::BATCH_GROUP_SIZE) {
+        const uint32_t end = std::min(n, start + internal::BATCH_GROUP_SIZE);
+
+        // Hash the whole group first. `out_indices` doubles as storage for the hashes.
+        for (uint32_t i = start; i < end; ++i) {
+            const uint32_t hash = h._hash_fn(keys[i]);
+            const uint32_t slot = hash % h._num_slots;
+            SCAFFOLD_PREFETCH(&slot_keys[slot]);
+            SCAFFOLD_PREFETCH(&slot_values[slot]);
+            out_indices[i] = hash;
+        }
+
+        for (uint32_t i = start; i < end; ++i) {
+            out_indices[i] = internal::probe(h, keys[i], out_indices[i]);
+        }
+    }
+}
+
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void build_from(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h,
+                const K *keys,
+                const V *values,
+                uint32_t n,
+                uint32_t num_threads) {
+    assert(h._allocator != nullptr);
+
+    // Stay below the load factor of 0.5 at which `set` would rehash
+    const uint32_t num_slots = clip_to_pow2(2 * n + 2);
+    h._allocator->deallocate(h._buffer);
+    h._num_slots = num_slots;
+    h._num_valid = 0;
+    h._num_deleted = 0;
+    internal::allocate_buffer(&h, num_slots);
+
+    auto slot_keys = internal::keys_array(h);
+    auto slot_values = internal::values_array(h);
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        slot_keys[i] = TGetNilAndDeleted::get_nil();
+    }
+
+    Allocator &allocator = *h._allocator;
+    Array<uint32_t> hashes(allocator, n);
+    Array<uint32_t> order(allocator, n);
+
+    parallel_chunks(n, num_threads, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            hashes[i] = h._hash_fn(keys[i]);
+        }
+    });
+
+    const uint32_t region_size = std::min(num_slots, internal::BUILD_REGION_SIZE);
+    radix_partition(n,
+                    num_slots / region_size,
+                    [&](uint32_t i) { return (hashes[i] % num_slots) / region_size; },
+                    data(order),
+                    nullptr,
+                    num_threads);
+
+    for (uint32_t i : order) {
+        uint32_t idx = hashes[i];
+        for (uint32_t j = 0; j < num_slots; ++j) {
+            idx = (idx + j) % num_slots;
+            if (h._equal_fn(slot_keys[idx], TGetNilAndDeleted::get_nil())) {
+                slot_keys[idx] = keys[i];
+                slot_values[idx] = values[i];
+                ++h._num_valid;
+                break;
+            }
+            if (h._equal_fn(slot_keys[idx], keys[i])) {
+                slot_values[idx] = values[i];
+                break;
+            }
+        }
+    }
+}
+
 /// Returns the value at the given index
-template <typename K, typename V, typename TGetNilAndDeleted>
-V &value(OpenHash<K, V, TGetNilAndDeleted> &h, uint32_t index) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+V &value(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, uint32_t index) {
     assert(index != NOT_FOUND);
-    V *values = (V *)(h._buffer + h._values_offset);
-    return values[index];
+    return internal::values_array(h)[index];
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-V &value(const OpenHash<K, V, TGetNilAndDeleted> &h, uint32_t index) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+V &value(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, uint32_t index) {
     assert(index != NOT_FOUND);
-    const V *values = (const V *)(h._buffer + h._values_offset);
-    return values[index];
+    return internal::values_array(h)[index];
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-V &value_default(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+V &value_default(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
     uint32_t index = find(h, key);
 
-    V *values;
-
     if (index == NOT_FOUND) {
         index = insert_key(h, key);
-        values = (V *)(h._buffer + h._values_offset);
-        new (&values[index]) V; // Default ctor
-    } else {
-        values = (V *)(h._buffer + h._values_offset);
+        new (&internal::values_array(h)[index]) V; // Default ctor
     }
 
-    return values[index];
+    return internal::values_array(h)[index];
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-const V &value_default(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
-    return value_default(const_cast<OpenHash<K, V, TGetNilAndDeleted> &>(h), key);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+const V &value_default(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
+    return value_default(const_cast<OpenHash<K, V, TGetNilAndDeleted, TLayout> &>(h), key);
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-V &must_value(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+V &must_value(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
     uint32_t i = find(h, key);
     assert(i != NOT_FOUND);
     return value(h, i);
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-const V &must_value(const OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+const V &must_value(const OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
     uint32_t i = find(h, key);
     assert(i != NOT_FOUND);
     return value(h, i);
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-void set(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key, const V &value) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void set(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key, const V &value) {
     internal::rehash_if_needed(h);
 
     uint64_t idx = h._hash_fn(key);
 
-    K *keys = (K *)(h._buffer + h._keys_offset);
-    V *values = (V *)(h._buffer + h._values_offset);
+    auto keys = internal::keys_array(h);
+    auto values = internal::values_array(h);
 
     for (uint32_t i = 0; i < h._num_slots; ++i) {
         idx = (idx + i) % h._num_slots;
@@ -555,16 +745,15 @@ void set(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key, const V &value) {
     log_assert(0, "Impossible");
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-uint32_t insert_key(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+uint32_t insert_key(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
     // Implementation is essentially the same as `set`. Just returning the
     // index where we inserted.
     internal::rehash_if_needed(h);
 
     uint64_t idx = h._hash_fn(key);
 
-    K *keys = (K *)(h._buffer + h._keys_offset);
-    // V *values = (V *)(h._buffer + h._values_offset);
+    auto keys = internal::keys_array(h);
 
     for (uint32_t i = 0; i < h._num_slots; ++i) {
         idx = (idx + i) % h._num_slots;
@@ -579,9 +768,9 @@ uint32_t insert_key(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
     return NOT_FOUND;
 }
 
-template <typename K, typename V, typename TGetNilAndDeleted>
-void remove(OpenHash<K, V, TGetNilAndDeleted> &h, const K &key) {
-    K *keys = (K *)(h._buffer + h._keys_offset);
+template <typename K, typename V, typename TGetNilAndDeleted, typename TLayout>
+void remove(OpenHash<K, V, TGetNilAndDeleted, TLayout> &h, const K &key) {
+    auto keys = internal::keys_array(h);
 
     uint32_t idx = find(h, key);
     if (idx != NOT_FOUND) {
@@ -4,42 +4,53 @@
 
 namespace fo {
 
-template <typename Key, typename Value> auto size(const OrderedMap<Key, Value> &m) {
-    return rbt::count_nodes(m._rbt);
+template <typename Key, typename Value, typename Less> auto size(const OrderedMap<Key, Value, Less> &m) {
+    return rbt::size(m._rbt);
 }
 
 // returns iterator
-template <typename Key, typename Value> auto get(const OrderedMap<Key, Value> &m, const Key &k) {
+template <typename Key, typename Value, typename Less>
+auto get(const OrderedMap<Key, Value, Less> &m, const Key &k) {
     return rbt::get(m._rbt, k).i;
 }
 
 // returns iterator
-template <typename Key, typename Value> auto get(OrderedMap<Key, Value> &m, const Key &k) {
+template <typename Key, typename Value, typename Less>
+auto get(OrderedMap<Key, Value, Less> &m, const Key &k) {
     return rbt::get(m._rbt, k).i;
 }
 
 // returns iterator
-template <typename Key, typename Value> auto set(OrderedMap<Key, Value> &m, Key k, Value v) {
+template <typename Key, typename Value, typename Less>
+auto set(OrderedMap<Key, Value, Less> &m, Key k, Value v) {
     return rbt::set(m._rbt, std::move(k), std::move(v)).i;
 }
 
 // returns bool, indicating if removal did take place
-template <typename Key, typename Value> bool remove(OrderedMap<Key, Value> &m, Key k) {
+template <typename Key, typename Value, typename Less> bool remove(OrderedMap<Key, Value, Less> &m, Key k) {
     return rbt::remove(m._rbt, std::move(k)).key_was_present;
 }
 
 // returns iterator
-template <typename Key, typename Value>
-auto set_default(OrderedMap<Key, Value> &m, Key k, Value default_value) {
+template <typename Key, typename Value, typename Less>
+auto set_default(OrderedMap<Key, Value, Less> &m, Key k, Value default_value) {
     return rbt::set_default(m._rbt, k, std::move(default_value)).i;
 }
 
-template <typename Key, typename Value> Value &OrderedMap<Key, Value>::operator[](const Key &k) {
+// Replaces the contents with `n` key-value pairs, keys in strictly increasing order. O(n).
+template <typename Key, typename Value, typename Less>
+void build_from_sorted(OrderedMap<Key, Value, Less> &m, const Key *keys, const Value *values, u32 n) {
+    rbt::build_from_sorted(m._rbt, keys, values, n);
+}
+
+template <typename Key, typename Value, typename Less>
+Value &OrderedMap<Key, Value, Less>::operator[](const Key &k) {
     static_assert(std::is_default_constructible<Value>::value, "");
     return set_default(*this, k, Value())->v;
 }
 
-template <typename Key, typename Value> const Value &OrderedMap<Key, Value>::operator[](const Key &k) const {
+template <typename Key, typename Value, typename Less>
+const Value &OrderedMap<Key, Value, Less>::operator[](const Key &k) const {
     static_assert(std::is_default_constructible<Value>::value, "");
     return set_default(*this, k, Value())->v;
 }
@@ -47,20 +58,24 @@ template <typename Key, typename Value> const Value &OrderedMap<Key, Value>::ope
 #if 0
 
 // Ctor
-template <typename Key, typename Value>
-OrderedMap<Key, Value>::OrderedMap(fo::Allocator &allocator)
+template <typename Key, typename Value, typename Less>
+OrderedMap<Key, Value, Less>::OrderedMap(fo::Allocator &allocator)
     : _rbt(allocator) {}
 
 // Dtor
-template <typename Key, typename Value> OrderedMap<Key, Value>::~OrderedMap() {}
+template <typename Key, typename Value, typename Less> OrderedMap<Key, Value, Less>::~OrderedMap() {}
 
 #endif
 
 // # Begin and end iterators
 
-template <typename Key, typename Value> auto begin(OrderedMap<Key, Value> &m) { return m.begin(); }
-template <typename Key, typename Value> auto end(OrderedMap<Key, Value> &m) { return m.end(); }
-template <typename Key, typename Value> auto begin(const OrderedMap<Key, Value> &m) { return m.begin(); }
-template <typename Key, typename Value> auto end(const OrderedMap<Key, Value> &m) { return m.end(); }
+template <typename Key, typename Value, typename Less>
+auto begin(OrderedMap<Key, Value, Less> &m) { return m.begin(); }
+template <typename Key, typename Value, typename Less>
+auto end(OrderedMap<Key, Value, Less> &m) { return m.end(); }
+template <typename Key, typename Value, typename Less>
+auto begin(const OrderedMap<Key, Value, Less> &m) { return m.begin(); }
+template <typename Key, typename Value, typename Less>
+auto end(const OrderedMap<Key, Value, Less> &m) { return m.end(); }
 
 } // namespace fo
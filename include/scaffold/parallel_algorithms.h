@@ -0,0 +1,405 @@
+/// Parallel for_each, transform, reduce, scan and sort working directly on the items of an `Array` or a
+/// `Vector` (or any pointer and count), so the data doesn't have to be copied into a `std::vector` first.
+///
+/// The work runs on the `jobs` threads. Called from a thread that isn't one of them, or with a single job
+/// thread, everything runs serially on the calling thread.
+///
+/// Work is split in chunks of about `CHUNK_BYTES` of items. A chunk fits in a core's L2 cache alongside its
+/// output, so the passes of scan and sort that read a chunk a second time find it still cached. Temporary
+/// buffers come from the given allocator.
+#pragma once
+
+#include <scaffold/array.h>
+#include <scaffold/jobs.h>
+#include <scaffold/memory.h>
+#include <scaffold/vector.h>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace fo {
+
+namespace parallel {
+
+constexpr u32 CHUNK_BYTES = 64 * 1024;
+
+/// Calls `fn(item)` on each item.
+template <typename T, typename Fn> void for_each(T *items, u32 n, Fn fn);
+
+/// Writes `fn(in[i])` to `out[i]` for each i. `out` can be the same as `in`.
+template <typename T, typename U, typename Fn> void transform(const T *in, u32 n, U *out, Fn fn);
+
+/// Combines `init` and the items with `op`, which must be associative. Items are combined in order, so `op`
+/// need not be commutative. The partial result of each chunk goes in a buffer from `temp`.
+template <typename T, typename Op>
+T reduce(const T *items, u32 n, T init, Op op, Allocator &temp = memory_globals::default_allocator());
+
+/// Writes to `out[i]` the combination of `in[0] .. in[i]` with the associative `op`. `out` can be `in`.
+template <typename T, typename Op>
+void inclusive_scan(const T *in, u32 n, T *out, Op op, Allocator &temp = memory_globals::default_allocator());
+
+/// Writes to `out[i]` the combination of `init` and `in[0] .. in[i - 1]`. `out` can be `in`.
+template <typename T, typename Op>
+void exclusive_scan(
+  const T *in, u32 n, T *out, T init, Op op, Allocator &temp = memory_globals::default_allocator());
+
+/// Sorts the items with a merge sort. Stable. T must be trivially copyable. Needs a temporary buffer as large
+/// as the items.
+template <typename T, typename Less = std::less<T>>
+void sort(T *items, u32 n, Less less = Less{}, Allocator &temp = memory_globals::default_allocator());
+
+/// Sorts integers with an LSD radix sort, 8 bits per pass. Stable. Passes where all the items have the same
+/// byte are skipped. Needs a temporary buffer as large as the items.
+template <typename T> void radix_sort(T *items, u32 n, Allocator &temp = memory_globals::default_allocator());
+
+/// Sorts trivially copyable items by the unsigned integer `key_of(item)` with an LSD radix sort. Stable.
+template <typename T, typename KeyFn>
+void radix_sort_by_key(T *items, u32 n, KeyFn key_of, Allocator &temp = memory_globals::default_allocator());
+
+/// Same as above, on all the items of an `Array` or a `Vector`.
+template <typename T, typename Fn> void for_each(Array<T> &a, Fn fn) { for_each(data(a), size(a), fn); }
+template <typename T, typename Fn> void for_each(Vector<T> &v, Fn fn) { for_each(data(v), size(v), fn); }
+
+template <typename T, typename Op> T reduce(const Array<T> &a, T init, Op op) {
+    return reduce(data(a), size(a), init, op, *a._allocator);
+}
+template <typename T, typename Op> T reduce(const Vector<T> &v, T init, Op op) {
+    return reduce(data(v), size(v), init, op, *v._allocator);
+}
+
+template <typename T, typename Less = std::less<T>> void sort(Array<T> &a, Less less = Less{}) {
+    sort(data(a), size(a), less, *a._allocator);
+}
+template <typename T, typename Less = std::less<T>> void sort(Vector<T> &v, Less less = Less{}) {
+    sort(data(v), size(v), less, *v._allocator);
+}
+
+template <typename T> void radix_sort(Array<T> &a) { radix_sort(data(a), size(a), *a._allocator); }
+template <typename T> void radix_sort(Vector<T> &v) { radix_sort(data(v), size(v), *v._allocator); }
+
+} // namespace parallel
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace parallel {
+
+namespace internal {
+
+template <typename T> constexpr u32 chunk_items() {
+    return sizeof(T) >= CHUNK_BYTES ? 1u : u32(CHUNK_BYTES / sizeof(T));
+}
+
+inline bool can_fork() { return jobs::is_job_thread() && jobs::num_threads() > 1; }
+
+// Calls `fn(chunk)` for each chunk index in [0, num_chunks), in parallel if possible.
+template <typename Fn> void for_chunks(u32 num_chunks, Fn fn) {
+    if (num_chunks > 1 && can_fork()) {
+        jobs::parallel_for(num_chunks, 1, [&fn](u32 begin, u32 end) {
+            for (u32 c = begin; c < end; ++c) {
+                fn(c);
+            }
+        });
+    } else {
+        for (u32 c = 0; c < num_chunks; ++c) {
+            fn(c);
+        }
+    }
+}
+
+inline u32 num_chunks(u32 n, u32 chunk_size) { return (n + chunk_size - 1) / chunk_size; }
+
+// Typed buffer from the temp allocator, freed when it goes out of scope.
+template <typename T> struct TempBuffer {
+    Allocator &allocator;
+    T *items;
+
+    TempBuffer(Allocator &a, u32 n)
+        : allocator(a)
+        , items((T *)a.allocate(sizeof(T) * (n == 0 ? 1 : n), alignof(T))) {}
+
+    ~TempBuffer() { allocator.deallocate(items); }
+
+    TempBuffer(const TempBuffer &) = delete;
+    TempBuffer &operator=(const TempBuffer &) = delete;
+};
+
+// Returns how many of the first k items of the stable merge of `a` and `b` come from `a`.
+template <typename T, typename Less>
+u32 merge_path(const T *a, u32 na, const T *b, u32 nb, u32 k, Less &less) {
+    u32 lo = k > nb ? k - nb : 0;
+    u32 hi = k < na ? k : na;
+    while (lo < hi) {
+        const u32 mid = lo + (hi - lo) / 2;
+        // a[mid] is in the first k if it doesn't come after b[k - mid - 1]
+        if (less(b[k - mid - 1], a[mid])) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+template <typename T> struct UnsignedOf {
+    using type = typename std::make_unsigned<T>::type;
+};
+
+// Maps an integer to an unsigned one with the same order
+template <typename T> typename UnsignedOf<T>::type radix_key(T x) {
+    using U = typename UnsignedOf<T>::type;
+    if (std::is_signed<T>::value) {
+        return U(x) ^ (U(1) << (sizeof(T) * 8 - 1));
+    }
+    return U(x);
+}
+
+} // namespace internal
+
+template <typename T, typename Fn> void for_each(T *items, u32 n, Fn fn) {
+    const u32 chunk = internal::chunk_items<T>();
+    internal::for_chunks(internal::num_chunks(n, chunk), [&](u32 c) {
+        const u32 end = std::min(n, (c + 1) * chunk);
+        for (u32 i = c * chunk; i < end; ++i) {
+            fn(items[i]);
+        }
+    });
+}
+
+template <typename T, typename U, typename Fn> void transform(const T *in, u32 n, U *out, Fn fn) {
+    const u32 chunk = internal::chunk_items<T>();
+    internal::for_chunks(internal::num_chunks(n, chunk), [&](u32 c) {
+        const u32 end = std::min(n, (c + 1) * chunk);
+        for (u32 i = c * chunk; i < end; ++i) {
+            out[i] = fn(in[i]);
+        }
+    });
+}
+
+template <typename T, typename Op> T reduce(const T *items, u32 n, T init, Op op, Allocator &temp) {
+    const u32 chunk = internal::chunk_items<T>();
+    const u32 num_chunks = internal::num_chunks(n, chunk);
+    if (num_chunks <= 1 || !internal::can_fork()) {
+        for (u32 i = 0; i < n; ++i) {
+            init = op(init, items[i]);
+        }
+        return init;
+    }
+
+    // Per chunk partials, combined in order afterwards
+    internal::TempBuffer<T> partials(temp, num_chunks);
+    internal::for_chunks(num_chunks, [&](u32 c) {
+        const u32 end = std::min(n, (c + 1) * chunk);
+        T acc = items[c * chunk];
+        for (u32 i = c * chunk + 1; i < end; ++i) {
+            acc = op(acc, items[i]);
+        }
+        new (&partials.items[c]) T(acc);
+    });
+    for (u32 c = 0; c < num_chunks; ++c) {
+        init = op(init, partials.items[c]);
+        partials.items[c].~T();
+    }
+    return init;
+}
+
+namespace internal {
+
+// Scans [begin, end) starting from `*carry`, or from the first item if `carry` is null. Reads each item
+// before writing its output, so `out` can be `in`.
+template <typename T, typename Op>
+void scan_range(const T *in, u32 begin, u32 end, T *out, const T *carry, bool inclusive, Op &op) {
+    u32 i = begin;
+    T acc = carry ? *carry : in[i++];
+    if (!carry) {
+        out[begin] = acc;
+    }
+    for (; i < end; ++i) {
+        const T x = in[i];
+        if (inclusive) {
+            acc = op(acc, x);
+            out[i] = acc;
+        } else {
+            out[i] = acc;
+            acc = op(acc, x);
+        }
+    }
+}
+
+// Reduce, then scan. The first pass sums each chunk without writing anything, the carries into each chunk
+// are scanned serially, and the second pass scans each chunk from its carry while the chunk is still cached.
+template <typename T, typename Op>
+void scan(const T *in, u32 n, T *out, const T *init, bool inclusive, Op &op, Allocator &temp) {
+    if (n == 0) {
+        return;
+    }
+    const u32 chunk = chunk_items<T>();
+    const u32 num_chunks = internal::num_chunks(n, chunk);
+
+    if (num_chunks <= 1 || !can_fork()) {
+        scan_range(in, 0, n, out, init, inclusive, op);
+        return;
+    }
+
+    // carries[c] goes into chunk c + 1
+    TempBuffer<T> carries(temp, num_chunks - 1);
+    for_chunks(num_chunks - 1, [&](u32 c) {
+        const u32 end = (c + 1) * chunk;
+        T acc = in[c * chunk];
+        for (u32 i = c * chunk + 1; i < end; ++i) {
+            acc = op(acc, in[i]);
+        }
+        new (&carries.items[c]) T(acc);
+    });
+    if (init) {
+        carries.items[0] = op(*init, carries.items[0]);
+    }
+    for (u32 c = 1; c < num_chunks - 1; ++c) {
+        carries.items[c] = op(carries.items[c - 1], carries.items[c]);
+    }
+
+    for_chunks(num_chunks, [&](u32 c) {
+        const T *carry = c == 0 ? init : &carries.items[c - 1];
+        scan_range(in, c * chunk, std::min(n, (c + 1) * chunk), out, carry, inclusive, op);
+    });
+
+    for (u32 c = 0; c < num_chunks - 1; ++c) {
+        carries.items[c].~T();
+    }
+}
+
+} // namespace internal
+
+template <typename T, typename Op> void inclusive_scan(const T *in, u32 n, T *out, Op op, Allocator &temp) {
+    internal::scan(in, n, out, (const T *)nullptr, true, op, temp);
+}
+
+template <typename T, typename Op>
+void exclusive_scan(const T *in, u32 n, T *out, T init, Op op, Allocator &temp) {
+    internal::scan(in, n, out, &init, false, op, temp);
+}
+
+template <typename T, typename Less> void sort(T *items, u32 n, Less less, Allocator &temp) {
+    static_assert(std::is_trivially_copyable<T>::value, "Must");
+
+    const u32 chunk = internal::chunk_items<T>();
+    const u32 num_chunks = internal::num_chunks(n, chunk);
+    if (num_chunks <= 1 || !internal::can_fork()) {
+        std::stable_sort(items, items + n, less);
+        return;
+    }
+
+    internal::for_chunks(num_chunks, [&](u32 c) {
+        std::stable_sort(items + c * chunk, items + std::min(n, (c + 1) * chunk), less);
+    });
+
+    // Merge runs of doubling width between the two buffers. Every output chunk finds where its inputs start
+    // and end in the two runs it comes from, so each round is split evenly however long the runs are.
+    internal::TempBuffer<T> buffer(temp, n);
+    T *src = items;
+    T *dst = buffer.items;
+
+    for (u32 width = chunk; width < n; width *= 2) {
+        internal::for_chunks(num_chunks, [&](u32 c) {
+            const u32 out_begin = c * chunk;
+            const u32 out_end = std::min(n, out_begin + chunk);
+
+            const u32 pair_begin = out_begin / (2 * width) * (2 * width);
+            const T *a = src + pair_begin;
+            const u32 na = std::min(width, n - pair_begin);
+            const T *b = a + na;
+            const u32 nb = std::min(width, n - pair_begin - na);
+
+            const u32 k_begin = out_begin - pair_begin;
+            const u32 k_end = out_end - pair_begin;
+            const u32 a_begin = internal::merge_path(a, na, b, nb, k_begin, less);
+            const u32 a_end = internal::merge_path(a, na, b, nb, k_end, less);
+
+            std::merge(a + a_begin,
+                       a + a_end,
+                       b + (k_begin - a_begin),
+                       b + (k_end - a_end),
+                       dst + out_begin,
+                       less);
+        });
+        std::swap(src, dst);
+    }
+
+    if (src != items) {
+        transform(src, n, items, [](const T &x) { return x; });
+    }
+}
+
+template <typename T, typename KeyFn> void radix_sort_by_key(T *items, u32 n, KeyFn key_of, Allocator &temp) {
+    static_assert(std::is_trivially_copyable<T>::value, "Must");
+    using Key = decltype(key_of(items[0]));
+    static_assert(std::is_unsigned<Key>::value, "Key must be an unsigned integer");
+
+    constexpr u32 RADIX = 256;
+    const u32 chunk = internal::chunk_items<T>();
+    const u32 num_chunks = internal::num_chunks(n, chunk);
+    if (n < 2) {
+        return;
+    }
+
+    internal::TempBuffer<T> buffer(temp, n);
+    // offsets[c * RADIX + d] counts the items of chunk c with digit d, then becomes where chunk c writes them
+    internal::TempBuffer<u32> offsets(temp, num_chunks * RADIX);
+
+    T *src = items;
+    T *dst = buffer.items;
+
+    for (u32 shift = 0; shift < sizeof(Key) * 8; shift += 8) {
+        internal::for_chunks(num_chunks, [&](u32 c) {
+            u32 *counts = offsets.items + c * RADIX;
+            std::fill(counts, counts + RADIX, 0u);
+            const u32 end = std::min(n, (c + 1) * chunk);
+            for (u32 i = c * chunk; i < end; ++i) {
+                ++counts[(key_of(src[i]) >> shift) & (RADIX - 1)];
+            }
+        });
+
+        // Items are already grouped by this digit when a single digit covers all of them
+        bool skip = false;
+        u32 offset = 0;
+        for (u32 d = 0; d < RADIX; ++d) {
+            const u32 digit_begin = offset;
+            for (u32 c = 0; c < num_chunks; ++c) {
+                const u32 count = offsets.items[c * RADIX + d];
+                offsets.items[c * RADIX + d] = offset;
+                offset += count;
+            }
+            if (offset - digit_begin == n) {
+                skip = true;
+            }
+        }
+        if (skip) {
+            continue;
+        }
+
+        internal::for_chunks(num_chunks, [&](u32 c) {
+            u32 *chunk_offsets = offsets.items + c * RADIX;
+            const u32 end = std::min(n, (c + 1) * chunk);
+            for (u32 i = c * chunk; i < end; ++i) {
+                dst[chunk_offsets[(key_of(src[i]) >> shift) & (RADIX - 1)]++] = src[i];
+            }
+        });
+        std::swap(src, dst);
+    }
+
+    if (src != items) {
+        transform(src, n, items, [](const T &x) { return x; });
+    }
+}
+
+template <typename T> void radix_sort(T *items, u32 n, Allocator &temp) {
+    static_assert(std::is_integral<T>::value, "Use radix_sort_by_key for other types");
+    radix_sort_by_key(items, n, [](const T &x) { return internal::radix_key(x); }, temp);
+}
+
+} // namespace parallel
+
+} // namespace fo
@@ -0,0 +1,450 @@
+// Perfect hash tables for key sets that don't change once built. Each key gets a slot of its own, so a lookup
+// is a single probe: hash the key, read one small per-bucket "pilot", read the one slot the key can be in.
+//
+// Construction follows the hash-and-displace scheme of CHD/PTHash. Keys are split into buckets of about
+// `KEYS_PER_BUCKET` keys, and buckets are placed largest first. For each bucket we search for the first 16-bit
+// pilot value that sends all of its keys to free slots. The pilots are the only metadata, about 2.7 bits per
+// key. There are about 12% more slots than keys, which keeps the search short for the buckets placed last, when
+// the table is nearly full.
+//
+// `PerfectHash` is built at run time from arrays of keys and values. `ConstexprPerfectHash` is built at compile
+// time from a small literal list of key-value pairs.
+#pragma once
+
+#include <scaffold/array.h>
+#include <scaffold/debug.h>
+#include <scaffold/memory.h>
+#include <scaffold/pod_hash.h> // ConvertToInt, CallEqualOperator
+#include <scaffold/radix_partition.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+namespace fo {
+
+template <typename K,
+          typename V,
+          typename HashFnType = ConvertToInt<K>,
+          typename EqualFnType = CallEqualOperator<K>>
+struct PerfectHash {
+    static_assert(std::is_trivially_copy_assignable<K>::value, "Must");
+    static_assert(std::is_trivially_copy_assignable<V>::value, "Must");
+
+    Array<uint16_t> _pilots; // Pilot of each bucket
+    Array<K> _keys;          // Key in each slot. Unused slots hold a key that doesn't hash to them.
+    Array<V> _values;        // Value in each slot
+    uint64_t _seed;          // Seed the build succeeded with
+    uint32_t _num_keys;      // Number of keys
+    HashFnType _hashfn;
+    EqualFnType _equalfn;
+
+    /// Creates an empty table. Use `perfect_hash::build` to fill it.
+    PerfectHash(Allocator &allocator,
+                HashFnType hash_func = HashFnType(),
+                EqualFnType equal_func = EqualFnType());
+};
+
+namespace perfect_hash {
+
+/// Denotes that key is not found
+constexpr uint32_t NOT_FOUND = 0xffffffffu;
+
+/// Average number of keys in a bucket
+constexpr uint32_t KEYS_PER_BUCKET = 6;
+
+/// Builds the table from the given keys and their values, replacing any previous contents. Keys must be
+/// distinct. Returns false if no perfect hash could be found, which in practice only happens if there are
+/// duplicate keys (or keys whose 64-bit hashes are equal).
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+bool build(PerfectHash<K, V, HashFnType, EqualFnType> &h, const Array<K> &keys, const Array<V> &values);
+
+/// Returns the slot holding the given key, or NOT_FOUND if the key is not in the table.
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+uint32_t find(const PerfectHash<K, V, HashFnType, EqualFnType> &h, const K &key);
+
+/// Returns true if the key is in the table.
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+bool has(const PerfectHash<K, V, HashFnType, EqualFnType> &h, const K &key);
+
+/// Returns the value in the given slot.
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+const V &value(const PerfectHash<K, V, HashFnType, EqualFnType> &h, uint32_t slot);
+
+/// Returns the value associated with the key, or `deffault` if the key is not in the table.
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+const V &get(const PerfectHash<K, V, HashFnType, EqualFnType> &h, const K &key, const V &deffault);
+
+/// Returns the number of keys.
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+uint32_t size(const PerfectHash<K, V, HashFnType, EqualFnType> &h);
+
+} // namespace perfect_hash
+
+/// Hash and equality used by `ConstexprPerfectHash`. Defined for integers (and enums) and C strings.
+template <typename K, typename Whatever = void> struct ConstexprHashTraits;
+
+template <typename K>
+struct ConstexprHashTraits<K, typename std::enable_if<std::is_integral<K>::value || std::is_enum<K>::value>::type> {
+    static constexpr uint64_t hash(const K &k) { return uint64_t(k); }
+    static constexpr bool equal(const K &a, const K &b) { return a == b; }
+};
+
+template <> struct ConstexprHashTraits<const char *> {
+    // FNV-1a
+    static constexpr uint64_t hash(const char *s) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (; *s != '\0'; ++s) {
+            h = (h ^ uint8_t(*s)) * 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    static constexpr bool equal(const char *a, const char *b) {
+        while (*a != '\0' && *a == *b) {
+            ++a;
+            ++b;
+        }
+        return *a == *b;
+    }
+};
+
+/// A perfect hash table built at compile time, from `make_perfect_hash`. Meant for small sets of keys written
+/// in the source, like opcode or config name tables. Lookups can be evaluated at compile time too.
+template <typename K, typename V, size_t N, typename Traits = ConstexprHashTraits<K>> struct ConstexprPerfectHash {
+    static_assert(N > 0, "Need at least one key");
+
+    using KeyType = K;
+
+    static constexpr uint32_t num_slots = uint32_t(N + N / 8 + 1);
+    static constexpr uint32_t num_buckets = uint32_t(N / 4 + 1);
+
+    uint64_t _seed = 0;
+    uint16_t _pilots[num_buckets] = {};
+    K _keys[num_slots] = {};
+    V _values[num_slots] = {};
+};
+
+/// Builds a `ConstexprPerfectHash` from a list of distinct key-value pairs. Call like
+/// `constexpr auto opcodes = make_perfect_hash<const char *, int>({ { "add", 0 }, { "sub", 1 } });`.
+/// Duplicate keys make the build fail to compile.
+template <typename K, typename V, size_t N, typename Traits = ConstexprHashTraits<K>>
+constexpr ConstexprPerfectHash<K, V, N, Traits> make_perfect_hash(const std::pair<K, V> (&items)[N]);
+
+namespace perfect_hash {
+
+/// Returns a pointer to the value associated with the key, or nullptr if the key is not in the table.
+template <typename K, typename V, size_t N, typename Traits>
+constexpr const V *find(const ConstexprPerfectHash<K, V, N, Traits> &h,
+                        const typename ConstexprPerfectHash<K, V, N, Traits>::KeyType &key);
+
+} // namespace perfect_hash
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace perfect_hash_internal {
+
+constexpr uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+// Number of seeds to try before giving up
+constexpr uint64_t MAX_SEEDS = 16;
+
+constexpr uint32_t MAX_PILOT = 0xffff;
+
+constexpr uint64_t key_hash(uint64_t user_hash, uint64_t seed) { return mix64(user_hash ^ (seed * 0x9E3779B97F4A7C15ull)); }
+
+// Maps the high half of the hash to [0, num_buckets) with a multiply instead of a division
+constexpr uint32_t bucket_of(uint64_t key_hash, uint32_t num_buckets) {
+    return uint32_t(((key_hash >> 32) * num_buckets) >> 32);
+}
+
+constexpr uint32_t slot_of(uint64_t key_hash, uint16_t pilot, uint64_t seed, uint32_t num_slots) {
+    return uint32_t((uint64_t(uint32_t(key_hash ^ mix64(seed + pilot))) * num_slots) >> 32);
+}
+
+template <typename K, typename HashFnType> struct UserHash {
+    static uint64_t hash(const HashFnType &f, const K &k) { return uint64_t(std::invoke(f, k)); }
+};
+
+template <typename K> struct UserHash<K, ConvertToInt<K>> {
+    static uint64_t hash(const ConvertToInt<K> &, const K &k) { return uint64_t(k); }
+};
+
+template <typename K, typename EqualFnType> struct UserEqual {
+    static bool equal(const EqualFnType &f, const K &a, const K &b) { return f(a, b); }
+};
+
+template <typename K> struct UserEqual<K, CallEqualOperator<K>> {
+    static bool equal(const CallEqualOperator<K> &, const K &a, const K &b) { return a == b; }
+};
+
+// Called from constexpr code when the build fails. Not being constexpr, it turns the failure into a compile
+// error.
+inline void constexpr_build_failed() { log_assert(false, "make_perfect_hash - are there duplicate keys?"); }
+
+} // namespace perfect_hash_internal
+
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+PerfectHash<K, V, HashFnType, EqualFnType>::PerfectHash(Allocator &allocator,
+                                                        HashFnType hash_func,
+                                                        EqualFnType equal_func)
+    : _pilots(allocator)
+    , _keys(allocator)
+    , _values(allocator)
+    , _seed(0)
+    , _num_keys(0)
+    , _hashfn(std::move(hash_func))
+    , _equalfn(std::move(equal_func)) {}
+
+namespace perfect_hash {
+
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+bool build(PerfectHash<K, V, HashFnType, EqualFnType> &h, const Array<K> &keys, const Array<V> &values) {
+    using namespace perfect_hash_internal;
+
+    log_assert(size(keys) == size(values), "Need one value per key");
+
+    const uint32_t n = size(keys);
+    h._num_keys = n;
+    clear(h._pilots);
+    clear(h._keys);
+    clear(h._values);
+
+    if (n == 0) {
+        return true;
+    }
+
+    const uint32_t num_slots = n + n / 8 + 1;
+    const uint32_t num_buckets = n / KEYS_PER_BUCKET + 1;
+
+    Allocator &allocator = *h._keys._allocator;
+    Array<uint64_t> hashes(allocator, n);
+    Array<uint32_t> keys_by_bucket(allocator, n);
+    Array<uint32_t> bucket_starts(allocator, num_buckets + 1);
+    Array<uint32_t> buckets_by_size(allocator, num_buckets);
+    Array<uint64_t> taken(allocator, (num_slots + 63) / 64);
+    Array<uint32_t> bucket_slots(allocator);
+
+    resize(h._pilots, num_buckets);
+
+    for (uint64_t seed = 0; seed < MAX_SEEDS; ++seed) {
+        for (uint32_t i = 0; i < n; ++i) {
+            hashes[i] = key_hash(UserHash<K, HashFnType>::hash(h._hashfn, keys[i]), seed);
+        }
+
+        radix_partition(n,
+                        num_buckets,
+                        [&](uint32_t i) { return bucket_of(hashes[i], num_buckets); },
+                        data(keys_by_bucket),
+                        data(bucket_starts));
+
+        uint32_t max_bucket_size = 0;
+        for (uint32_t b = 0; b < num_buckets; ++b) {
+            max_bucket_size = std::max(max_bucket_size, bucket_starts[b + 1] - bucket_starts[b]);
+        }
+        resize(bucket_slots, max_bucket_size);
+
+        // Largest buckets first, while there's still plenty of room
+        radix_partition(num_buckets,
+                        max_bucket_size + 1,
+                        [&](uint32_t b) { return max_bucket_size - (bucket_starts[b + 1] - bucket_starts[b]); },
+                        data(buckets_by_size));
+
+        std::fill(begin(taken), end(taken), 0);
+        std::fill(begin(h._pilots), end(h._pilots), uint16_t(0));
+
+        bool failed = false;
+
+        for (uint32_t b : buckets_by_size) {
+            const uint32_t first = bucket_starts[b];
+            const uint32_t count = bucket_starts[b + 1] - first;
+            if (count == 0) {
+                break;
+            }
+
+            bool placed = false;
+            for (uint32_t pilot = 0; pilot <= MAX_PILOT && !placed; ++pilot) {
+                placed = true;
+                for (uint32_t j = 0; j < count; ++j) {
+                    const uint32_t slot = slot_of(hashes[keys_by_bucket[first + j]], pilot, seed, num_slots);
+                    if (taken[slot / 64] & (uint64_t(1) << (slot % 64))) {
+                        // Undo the ones we took for this pilot
+                        for (uint32_t k = 0; k < j; ++k) {
+                            taken[bucket_slots[k] / 64] &= ~(uint64_t(1) << (bucket_slots[k] % 64));
+                        }
+                        placed = false;
+                        break;
+                    }
+                    taken[slot / 64] |= uint64_t(1) << (slot % 64);
+                    bucket_slots[j] = slot;
+                }
+                if (placed) {
+                    h._pilots[b] = uint16_t(pilot);
+                }
+            }
+
+            if (!placed) {
+                failed = true;
+                break;
+            }
+        }
+
+        if (failed) {
+            continue;
+        }
+
+        // Unused slots get the first key, which can't be found there since it has a slot of its own
+        resize(h._keys, num_slots);
+        resize(h._values, num_slots);
+        std::fill(begin(h._keys), end(h._keys), keys[0]);
+        std::fill(begin(h._values), end(h._values), V{});
+
+        for (uint32_t i = 0; i < n; ++i) {
+            const uint32_t slot = slot_of(hashes[i], h._pilots[bucket_of(hashes[i], num_buckets)], seed, num_slots);
+            h._keys[slot] = keys[i];
+            h._values[slot] = values[i];
+        }
+
+        h._seed = seed;
+        return true;
+    }
+
+    log_warn("PerfectHash - failed to build, are there duplicate keys?");
+    h._num_keys = 0;
+    clear(h._pilots);
+    return false;
+}
+
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+uint32_t find(const PerfectHash<K, V, HashFnType, EqualFnType> &h, const K &key) {
+    using namespace perfect_hash_internal;
+
+    if (h._num_keys == 0) {
+        return NOT_FOUND;
+    }
+
+    const uint64_t hash = key_hash(UserHash<K, HashFnType>::hash(h._hashfn, key), h._seed);
+    const uint16_t pilot = h._pilots[bucket_of(hash, size(h._pilots))];
+    const uint32_t slot = slot_of(hash, pilot, h._seed, size(h._keys));
+    return UserEqual<K, EqualFnType>::equal(h._equalfn, h._keys[slot], key) ? slot : NOT_FOUND;
+}
+
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+bool has(const PerfectHash<K, V, HashFnType, EqualFnType> &h, const K &key) {
+    return find(h, key) != NOT_FOUND;
+}
+
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+const V &value(const PerfectHash<K, V, HashFnType, EqualFnType> &h, uint32_t slot) {
+    assert(slot != NOT_FOUND);
+    return h._values[slot];
+}
+
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+const V &get(const PerfectHash<K, V, HashFnType, EqualFnType> &h, const K &key, const V &deffault) {
+    const uint32_t slot = find(h, key);
+    return slot == NOT_FOUND ? deffault : h._values[slot];
+}
+
+template <typename K, typename V, typename HashFnType, typename EqualFnType>
+uint32_t size(const PerfectHash<K, V, HashFnType, EqualFnType> &h) {
+    return h._num_keys;
+}
+
+template <typename K, typename V, size_t N, typename Traits>
+constexpr const V *find(const ConstexprPerfectHash<K, V, N, Traits> &h,
+                        const typename ConstexprPerfectHash<K, V, N, Traits>::KeyType &key) {
+    using namespace perfect_hash_internal;
+    using Table = ConstexprPerfectHash<K, V, N, Traits>;
+
+    const uint64_t hash = key_hash(Traits::hash(key), h._seed);
+    const uint16_t pilot = h._pilots[bucket_of(hash, Table::num_buckets)];
+    const uint32_t slot = slot_of(hash, pilot, h._seed, Table::num_slots);
+    return Traits::equal(h._keys[slot], key) ? &h._values[slot] : nullptr;
+}
+
+} // namespace perfect_hash
+
+template <typename K, typename V, size_t N, typename Traits>
+constexpr ConstexprPerfectHash<K, V, N, Traits> make_perfect_hash(const std::pair<K, V> (&items)[N]) {
+    using namespace perfect_hash_internal;
+    using Table = ConstexprPerfectHash<K, V, N, Traits>;
+
+    Table h{};
+
+    for (uint64_t seed = 0; seed < MAX_SEEDS; ++seed) {
+        uint64_t hashes[N] = {};
+        uint32_t bucket_sizes[Table::num_buckets] = {};
+        bool taken[Table::num_slots] = {};
+
+        for (size_t i = 0; i < N; ++i) {
+            hashes[i] = key_hash(Traits::hash(items[i].first), seed);
+            ++bucket_sizes[bucket_of(hashes[i], Table::num_buckets)];
+        }
+
+        bool failed = false;
+
+        // Place the buckets from largest to smallest. The tables are small, so we just scan for the next one.
+        for (uint32_t bucket_size = N; bucket_size > 0 && !failed; --bucket_size) {
+            for (uint32_t b = 0; b < Table::num_buckets && !failed; ++b) {
+                if (bucket_sizes[b] != bucket_size) {
+                    continue;
+                }
+
+                bool placed = false;
+                for (uint32_t pilot = 0; pilot <= MAX_PILOT && !placed; ++pilot) {
+                    bool tried[Table::num_slots] = {};
+                    placed = true;
+                    for (size_t i = 0; i < N && placed; ++i) {
+                        if (bucket_of(hashes[i], Table::num_buckets) != b) {
+                            continue;
+                        }
+                        const uint32_t slot = slot_of(hashes[i], uint16_t(pilot), seed, Table::num_slots);
+                        placed = !taken[slot] && !tried[slot];
+                        tried[slot] = true;
+                    }
+                    if (placed) {
+                        h._pilots[b] = uint16_t(pilot);
+                        for (uint32_t s = 0; s < Table::num_slots; ++s) {
+                            taken[s] = taken[s] || tried[s];
+                        }
+                    }
+                }
+                failed = !placed;
+            }
+        }
+
+        if (failed) {
+            continue;
+        }
+
+        h._seed = seed;
+        for (uint32_t s = 0; s < Table::num_slots; ++s) {
+            h._keys[s] = items[0].first;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            const uint32_t slot =
+                slot_of(hashes[i], h._pilots[bucket_of(hashes[i], Table::num_buckets)], seed, Table::num_slots);
+            h._keys[slot] = items[i].first;
+            h._values[slot] = items[i].second;
+        }
+        return h;
+    }
+
+    constexpr_build_failed();
+    return h;
+}
+
+} // namespace fo
@@ -0,0 +1,509 @@
+// Contains a persistent red-black tree based ordered map.
+//
+// Nodes are never modified once in a map. Copying a `PersistentMap` is O(1), the copy shares all its nodes
+// with the original. `set` and `remove` build a new version of the map that shares all but O(log n) nodes
+// with the old one, which any other copies keep seeing. So taking a snapshot for a reader is just copying the
+// map.
+//
+// Nodes are reference counted, with atomic counts. A copy of the map can be handed to another thread, read
+// there without any locking, and destroyed there. Whichever thread drops the last reference to a node frees
+// it, so the allocator must be thread-safe if copies are destroyed on different threads. A single
+// `PersistentMap` object must still not be modified and read at the same time.
+//
+// The updates copy the path down to the key and join the copies back with the untouched subtrees, using the
+// same join as `rbt_set_ops.h`. Nodes made during the update are modified in place rather than copied again.
+
+#pragma once
+
+#include <scaffold/memory.h>
+#include <scaffold/types.h>
+
+#include <assert.h>
+#include <atomic>
+#include <functional>
+#include <utility>
+
+namespace fo {
+
+/// A node of the tree. Has the same members `k` and `v` as `rbt::RBNode`.
+template <typename Key, typename Value> struct PersistentNode {
+    const PersistentNode *_childs[2];
+    mutable std::atomic<u32> _refs;
+    u32 _count; // Size of the subtree rooted here
+    u32 _red;
+
+    Key k;
+    Value v;
+
+    template <typename K, typename V>
+    PersistentNode(const PersistentNode *l, const PersistentNode *r, bool red, K &&k, V &&v)
+        : _childs{ l, r }
+        , _refs(1)
+        , _count((l ? l->_count : 0) + (r ? r->_count : 0) + 1)
+        , _red(red)
+        , k(std::forward<K>(k))
+        , v(std::forward<V>(v)) {}
+
+    const Key &first() const { return k; }
+    const Value &second() const { return v; }
+};
+
+namespace persistent_internal {
+
+// Max height of a tree with a u32 size. The black height is at most 32 and the root can be red.
+constexpr u32 MAX_DEPTH = 2 * 32 + 2;
+
+} // namespace persistent_internal
+
+/// Forward iterator over the nodes in key order. Keeps the path to the current node, so it's not tied to a
+/// particular `PersistentMap` object, but the version it iterates over must be kept alive by some copy.
+template <typename Key, typename Value> struct PersistentIterator {
+    using Node = PersistentNode<Key, Value>;
+
+    // Nodes whose left subtree we are in, innermost last. The last one is the current node. Empty denotes
+    // end.
+    const Node *_stack[persistent_internal::MAX_DEPTH];
+    u32 _depth = 0;
+
+    // Pushes `n` and its chain of left children
+    void _push_left_spine(const Node *n);
+
+    PersistentIterator &operator++();
+    PersistentIterator operator++(int);
+
+    const Node *operator->() const { return _stack[_depth - 1]; }
+    const Node &operator*() const { return *_stack[_depth - 1]; }
+
+    bool operator==(const PersistentIterator &o) const {
+        return _depth == o._depth && (_depth == 0 || _stack[_depth - 1] == o._stack[_depth - 1]);
+    }
+
+    bool operator!=(const PersistentIterator &o) const { return !(*this == o); }
+};
+
+/// Represents a persistent red-black tree based map. `Less` is the key comparison, same as for `OrderedMap`.
+template <typename Key, typename Value, typename Less = std::less<Key>> struct PersistentMap {
+    using Node = PersistentNode<Key, Value>;
+
+    using iterator = PersistentIterator<Key, Value>;
+    using const_iterator = PersistentIterator<Key, Value>;
+
+    // This being nullptr denotes moved-from map
+    Allocator *_allocator;
+
+    const Node *_root; // nullptr if the map is empty
+    u32 _black_height;
+
+    Less _less;
+
+    /// Constructs an empty map where nodes will be allocated using given `allocator`.
+    PersistentMap(Allocator &allocator = memory_globals::default_allocator(), Less less = Less{});
+    ~PersistentMap();
+
+    /// O(1). The copy shares the nodes of `o`, and is not affected by any later changes to `o`.
+    PersistentMap(const PersistentMap &o);
+    PersistentMap &operator=(const PersistentMap &o);
+
+    /// The moved-from map must not be operated on any further (except calling its destructor).
+    PersistentMap(PersistentMap &&o);
+    PersistentMap &operator=(PersistentMap &&o);
+};
+
+/// Returns the number of entries.
+template <typename Key, typename Value, typename Less> u32 size(const PersistentMap<Key, Value, Less> &m);
+
+/// Returns an iterator to the entry with the given key, or `end(m)`.
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> get(const PersistentMap<Key, Value, Less> &m, const Key &k);
+
+/// Associates the value with the key, replacing the current one if present. Allocates O(log n) nodes, other
+/// copies of the map don't see the change.
+template <typename Key, typename Value, typename Less>
+void set(PersistentMap<Key, Value, Less> &m, Key k, Value v);
+
+/// Removes the entry with the given key. Returns true if there was one. Allocates O(log n) nodes.
+template <typename Key, typename Value, typename Less>
+bool remove(PersistentMap<Key, Value, Less> &m, const Key &k);
+
+/// Removes all entries. Nodes still used by other copies of the map are left alone.
+template <typename Key, typename Value, typename Less> void clear(PersistentMap<Key, Value, Less> &m);
+
+/// Returns an iterator to the first entry whose key is not less than `k`, or `end(m)`.
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> lower_bound(const PersistentMap<Key, Value, Less> &m, const Key &k);
+
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> begin(const PersistentMap<Key, Value, Less> &m);
+
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> end(const PersistentMap<Key, Value, Less> &m);
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace persistent_internal {
+
+template <typename Key, typename Value> struct Subtree {
+    const PersistentNode<Key, Value> *root;
+    u32 black_height; // Black nodes on a path down to a leaf. The root can be red.
+};
+
+template <typename Key, typename Value> bool is_red(const PersistentNode<Key, Value> *n) {
+    return n && n->_red;
+}
+
+template <typename Key, typename Value>
+const PersistentNode<Key, Value> *retain(const PersistentNode<Key, Value> *n) {
+    if (n) {
+        n->_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return n;
+}
+
+template <typename Key, typename Value> void release(Allocator &a, const PersistentNode<Key, Value> *n) {
+    if (n && n->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        release(a, n->_childs[0]);
+        release(a, n->_childs[1]);
+        make_delete(a, const_cast<PersistentNode<Key, Value> *>(n));
+    }
+}
+
+// In all of the functions below, the nodes passed in and returned are owned references, unless noted
+// otherwise.
+//
+// A node we own that has a reference count of 1 is not part of any version of the map. It was made during
+// the current update, so it can still be modified instead of copied. This way each update allocates about
+// one node per level of the tree instead of one per join.
+
+template <typename Key, typename Value> u32 count_of(const PersistentNode<Key, Value> *n) {
+    return n ? n->_count : 0;
+}
+
+// Returns a node with the key and value of `n`, and the given children and color.
+template <typename Key, typename Value>
+const PersistentNode<Key, Value> *with_children(Allocator &a,
+                                                const PersistentNode<Key, Value> *n,
+                                                const PersistentNode<Key, Value> *l,
+                                                const PersistentNode<Key, Value> *r,
+                                                bool red) {
+    using Node = PersistentNode<Key, Value>;
+
+    if (n->_refs.load(std::memory_order_acquire) == 1) {
+        Node *m = const_cast<Node *>(n);
+        release(a, m->_childs[0]);
+        release(a, m->_childs[1]);
+        m->_childs[0] = l;
+        m->_childs[1] = r;
+        m->_red = red;
+        m->_count = count_of(l) + count_of(r) + 1;
+        return m;
+    }
+
+    const Node *copy = make_new<Node>(a, l, r, red, n->k, n->v);
+    release(a, n);
+    return copy;
+}
+
+// Joins the taller tree `t` with `mid` and the shorter tree `s`. Goes down along the `dir` side of `t` until
+// reaching a black node with the same black height as `s`, copying the nodes on the way. `dir` is 1 if `t`
+// holds the smaller keys.
+template <typename Key, typename Value>
+const PersistentNode<Key, Value> *join_down(Allocator &a,
+                                            u32 dir,
+                                            const PersistentNode<Key, Value> *t,
+                                            u32 t_bh,
+                                            const PersistentNode<Key, Value> *mid,
+                                            const PersistentNode<Key, Value> *s,
+                                            u32 s_bh) {
+    using Node = PersistentNode<Key, Value>;
+
+    if (!is_red(t) && t_bh == s_bh) {
+        return dir == 1 ? with_children(a, mid, t, s, true) : with_children(a, mid, s, t, true);
+    }
+
+    const u32 child_bh = t_bh - (is_red(t) ? 0 : 1);
+    const Node *child = join_down(a, dir, retain(t->_childs[dir]), child_bh, mid, s, s_bh);
+    const Node *other = retain(t->_childs[1 - dir]);
+
+    if (!is_red(t) && is_red(child) && is_red(child->_childs[dir])) {
+        // Rotate `child` up, with its `dir` child turned black
+        const Node *gc = retain(child->_childs[dir]);
+        const Node *inner = retain(child->_childs[1 - dir]);
+        const Node *black_gc = with_children(a, gc, retain(gc->_childs[0]), retain(gc->_childs[1]), false);
+        if (dir == 1) {
+            return with_children(a, child, with_children(a, t, other, inner, false), black_gc, true);
+        }
+        return with_children(a, child, black_gc, with_children(a, t, inner, other, false), true);
+    }
+
+    const bool red = t->_red;
+    return dir == 1 ? with_children(a, t, other, child, red) : with_children(a, t, child, other, red);
+}
+
+// Returns the tree with the keys of `l`, then the key of `mid`, then the keys of `r`.
+template <typename Key, typename Value>
+Subtree<Key, Value>
+join(Allocator &a, Subtree<Key, Value> l, const PersistentNode<Key, Value> *mid, Subtree<Key, Value> r) {
+    using Node = PersistentNode<Key, Value>;
+
+    if (l.black_height != r.black_height) {
+        const bool left_taller = l.black_height > r.black_height;
+        const Subtree<Key, Value> tall = left_taller ? l : r;
+        const Subtree<Key, Value> low = left_taller ? r : l;
+        const u32 dir = left_taller ? 1 : 0;
+
+        const Node *t = join_down(a, dir, tall.root, tall.black_height, mid, low.root, low.black_height);
+        if (is_red(t) && is_red(t->_childs[dir])) {
+            t = with_children(a, t, retain(t->_childs[0]), retain(t->_childs[1]), false);
+            return Subtree<Key, Value>{ t, tall.black_height + 1 };
+        }
+        return Subtree<Key, Value>{ t, tall.black_height };
+    }
+
+    if (!is_red(l.root) && !is_red(r.root)) {
+        return Subtree<Key, Value>{ with_children(a, mid, l.root, r.root, true), l.black_height };
+    }
+    return Subtree<Key, Value>{ with_children(a, mid, l.root, r.root, false), l.black_height + 1 };
+}
+
+// Takes the last node out of `t`, leaving the others in `rest`.
+template <typename Key, typename Value>
+const PersistentNode<Key, Value> *split_last(Allocator &a, Subtree<Key, Value> t, Subtree<Key, Value> &rest) {
+    const u32 child_bh = t.black_height - (is_red(t.root) ? 0 : 1);
+
+    if (!t.root->_childs[1]) {
+        rest = Subtree<Key, Value>{ retain(t.root->_childs[0]), child_bh };
+        return t.root;
+    }
+
+    const auto last = split_last(a, Subtree<Key, Value>{ retain(t.root->_childs[1]), child_bh }, rest);
+    rest = join(a, Subtree<Key, Value>{ retain(t.root->_childs[0]), child_bh }, t.root, rest);
+    return last;
+}
+
+// Join without a middle key.
+template <typename Key, typename Value>
+Subtree<Key, Value> join2(Allocator &a, Subtree<Key, Value> l, Subtree<Key, Value> r) {
+    if (!l.root) {
+        return r;
+    }
+    Subtree<Key, Value> rest;
+    const PersistentNode<Key, Value> *last = split_last(a, l, rest);
+    return join(a, rest, last, r);
+}
+
+// Returns `t`, which is not owned, with `k` associated with `v`. Copies the nodes on the path down to `k`,
+// joining the copies back with the untouched subtrees on the way up.
+template <typename Key, typename Value, typename Less>
+Subtree<Key, Value> insert(
+  Allocator &a, const Less &less, const PersistentNode<Key, Value> *t, u32 t_bh, Key &k, Value &v) {
+    using Node = PersistentNode<Key, Value>;
+
+    if (!t) {
+        const Node *n = make_new<Node>(a, nullptr, nullptr, true, std::move(k), std::move(v));
+        return Subtree<Key, Value>{ n, 0 };
+    }
+
+    const u32 child_bh = t_bh - (is_red(t) ? 0 : 1);
+
+    if (less(k, t->k)) {
+        const Subtree<Key, Value> l = insert(a, less, t->_childs[0], child_bh, k, v);
+        return join(a, l, retain(t), Subtree<Key, Value>{ retain(t->_childs[1]), child_bh });
+    }
+    if (less(t->k, k)) {
+        const Subtree<Key, Value> r = insert(a, less, t->_childs[1], child_bh, k, v);
+        return join(a, Subtree<Key, Value>{ retain(t->_childs[0]), child_bh }, retain(t), r);
+    }
+    const Node *n = make_new<Node>(
+      a, retain(t->_childs[0]), retain(t->_childs[1]), t->_red, std::move(k), std::move(v));
+    return Subtree<Key, Value>{ n, t_bh };
+}
+
+// Returns `t`, which is not owned, without `k`. The key must be present.
+template <typename Key, typename Value, typename Less>
+Subtree<Key, Value>
+remove(Allocator &a, const Less &less, const PersistentNode<Key, Value> *t, u32 t_bh, const Key &k) {
+    assert(t);
+
+    const u32 child_bh = t_bh - (is_red(t) ? 0 : 1);
+
+    if (less(k, t->k)) {
+        const Subtree<Key, Value> l = remove(a, less, t->_childs[0], child_bh, k);
+        return join(a, l, retain(t), Subtree<Key, Value>{ retain(t->_childs[1]), child_bh });
+    }
+    if (less(t->k, k)) {
+        const Subtree<Key, Value> r = remove(a, less, t->_childs[1], child_bh, k);
+        return join(a, Subtree<Key, Value>{ retain(t->_childs[0]), child_bh }, retain(t), r);
+    }
+    return join2(a,
+                 Subtree<Key, Value>{ retain(t->_childs[0]), child_bh },
+                 Subtree<Key, Value>{ retain(t->_childs[1]), child_bh });
+}
+
+// Makes `t` the current version of `m`.
+template <typename Key, typename Value, typename Less>
+void replace_root(PersistentMap<Key, Value, Less> &m, Subtree<Key, Value> t) {
+    release(*m._allocator, m._root);
+    m._root = t.root;
+    m._black_height = t.black_height;
+}
+
+} // namespace persistent_internal
+
+template <typename Key, typename Value>
+void PersistentIterator<Key, Value>::_push_left_spine(const Node *n) {
+    for (; n; n = n->_childs[0]) {
+        assert(_depth < persistent_internal::MAX_DEPTH);
+        _stack[_depth++] = n;
+    }
+}
+
+template <typename Key, typename Value>
+PersistentIterator<Key, Value> &PersistentIterator<Key, Value>::operator++() {
+    const Node *n = _stack[--_depth];
+    _push_left_spine(n->_childs[1]);
+    return *this;
+}
+
+template <typename Key, typename Value>
+PersistentIterator<Key, Value> PersistentIterator<Key, Value>::operator++(int) {
+    PersistentIterator saved(*this);
+    ++*this;
+    return saved;
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentMap<Key, Value, Less>::PersistentMap(Allocator &allocator, Less less)
+    : _allocator(&allocator)
+    , _root(nullptr)
+    , _black_height(0)
+    , _less(std::move(less)) {}
+
+template <typename Key, typename Value, typename Less> PersistentMap<Key, Value, Less>::~PersistentMap() {
+    if (_allocator) {
+        persistent_internal::release(*_allocator, _root);
+        _allocator = nullptr;
+    }
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentMap<Key, Value, Less>::PersistentMap(const PersistentMap &o)
+    : _allocator(o._allocator)
+    , _root(persistent_internal::retain(o._root))
+    , _black_height(o._black_height)
+    , _less(o._less) {}
+
+template <typename Key, typename Value, typename Less>
+PersistentMap<Key, Value, Less> &PersistentMap<Key, Value, Less>::operator=(const PersistentMap &o) {
+    if (this != &o) {
+        // Retain first, `o` could be sharing our root
+        const Node *root = persistent_internal::retain(o._root);
+        if (_allocator) {
+            persistent_internal::release(*_allocator, _root);
+        }
+        _allocator = o._allocator;
+        _root = root;
+        _black_height = o._black_height;
+        _less = o._less;
+    }
+    return *this;
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentMap<Key, Value, Less>::PersistentMap(PersistentMap &&o)
+    : _allocator(o._allocator)
+    , _root(o._root)
+    , _black_height(o._black_height)
+    , _less(std::move(o._less)) {
+    o._allocator = nullptr;
+    o._root = nullptr;
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentMap<Key, Value, Less> &PersistentMap<Key, Value, Less>::operator=(PersistentMap &&o) {
+    if (this != &o) {
+        if (_allocator) {
+            persistent_internal::release(*_allocator, _root);
+        }
+        _allocator = o._allocator;
+        _root = o._root;
+        _black_height = o._black_height;
+        _less = std::move(o._less);
+        o._allocator = nullptr;
+        o._root = nullptr;
+    }
+    return *this;
+}
+
+template <typename Key, typename Value, typename Less> u32 size(const PersistentMap<Key, Value, Less> &m) {
+    return m._root ? m._root->_count : 0;
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> get(const PersistentMap<Key, Value, Less> &m, const Key &k) {
+    PersistentIterator<Key, Value> it;
+    for (auto n = m._root; n;) {
+        if (m._less(k, n->k)) {
+            it._stack[it._depth++] = n;
+            n = n->_childs[0];
+        } else if (m._less(n->k, k)) {
+            n = n->_childs[1];
+        } else {
+            it._stack[it._depth++] = n;
+            return it;
+        }
+    }
+    return end(m);
+}
+
+template <typename Key, typename Value, typename Less>
+void set(PersistentMap<Key, Value, Less> &m, Key k, Value v) {
+    persistent_internal::replace_root(
+      m, persistent_internal::insert(*m._allocator, m._less, m._root, m._black_height, k, v));
+}
+
+template <typename Key, typename Value, typename Less>
+bool remove(PersistentMap<Key, Value, Less> &m, const Key &k) {
+    if (get(m, k) == end(m)) {
+        return false;
+    }
+    persistent_internal::replace_root(
+      m, persistent_internal::remove(*m._allocator, m._less, m._root, m._black_height, k));
+    return true;
+}
+
+template <typename Key, typename Value, typename Less> void clear(PersistentMap<Key, Value, Less> &m) {
+    persistent_internal::replace_root(m, persistent_internal::Subtree<Key, Value>{ nullptr, 0 });
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> lower_bound(const PersistentMap<Key, Value, Less> &m, const Key &k) {
+    // Every node we go left from is greater or equal to `k`, and the last one is the first such node
+    PersistentIterator<Key, Value> it;
+    for (auto n = m._root; n;) {
+        if (m._less(n->k, k)) {
+            n = n->_childs[1];
+        } else {
+            it._stack[it._depth++] = n;
+            n = n->_childs[0];
+        }
+    }
+    return it;
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> begin(const PersistentMap<Key, Value, Less> &m) {
+    PersistentIterator<Key, Value> it;
+    it._push_left_spine(m._root);
+    return it;
+}
+
+template <typename Key, typename Value, typename Less>
+PersistentIterator<Key, Value> end(const PersistentMap<Key, Value, Less> &) {
+    return PersistentIterator<Key, Value>();
+}
+
+} // namespace fo
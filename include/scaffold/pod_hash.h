@@ -3,8 +3,10 @@
 #pragma once
 
 #include <scaffold/array.h>
+#include <scaffold/const_log.h>
 #include <scaffold/debug.h>
 #include <scaffold/memory.h>
+#include <scaffold/radix_partition.h>
 #include <scaffold/vector.h>
 
 #include <algorithm> // std::swap
@@ -46,13 +48,20 @@ namespace pod_hash_internal {
 template <typename K, typename V> struct Entry {
     K key;
     mutable V value;
-    uint32_t next;
+    uint32_t hash; // Hash of the key, so that we never need to call the hash function again for this entry
 
     const K &first() const { return key; }
     const V &second() const { return value; }
     V &second() { return value; }
 };
 
+// A slot of the open-addressed index. Points to an entry and keeps the hash of the entry's key so that a
+// probe can skip entries with a different hash without reading them.
+struct IndexSlot {
+    uint32_t entry_i;
+    uint32_t hash;
+};
+
 } // namespace pod_hash_internal
 
 /// 'PodHash' is similar hash table like the one in collection_types.h, but can use any 'trivially-
@@ -70,15 +79,15 @@ struct PodHash {
     using iterator = typename Vector<Entry>::const_iterator;
     using const_iterator = typename Vector<Entry>::const_iterator;
 
-    Array<uint32_t> _hashes; // Array mapping a hash to an entry index
-    Vector<Entry> _entries;  // Array of entries
-    HashFnType _hashfn;      // The hash function to use
-    EqualFnType _equalfn;    // The equal function to use
+    Array<pod_hash_internal::IndexSlot> _index; // Linear probed index into the entries. Size is a power of 2.
+    Vector<Entry> _entries;                     // Array of entries, kept dense
+    HashFnType _hashfn;                         // The hash function to use
+    EqualFnType _equalfn;                       // The equal function to use
     float _load_factor = 0.7f;
 
     /// Constructor
     PodHash(Allocator &hash_alloc, Allocator &entry_alloc, HashFnType hash_func, EqualFnType equal_func)
-        : _hashes(hash_alloc)
+        : _index(hash_alloc)
         , _entries(entry_alloc)
         , _hashfn(std::move(hash_func))
         , _equalfn(std::move(equal_func)) {
@@ -151,6 +160,19 @@ template <TypeList> bool has(const PodHashSig &h, const K &key);
 /// Otherwise returns an iterator pointing to the end.
 template <TypeList> typename PodHashSig::iterator get(const PodHashSig &h, const K &key);
 
+/// Looks up `n` keys at once. For each key, writes the index of its entry in `_entries` into `out_indices`,
+/// or `pod_hash_internal::END_OF_LIST` if the key is not present (`begin(h) + index` is what `get` would
+/// return). The index slots of a group of keys are prefetched, then the candidate entries, and only then are
+/// the keys compared, so that the cache misses of the group overlap.
+template <TypeList> void find_batch(const PodHashSig &h, const K *keys, uint32_t n, uint32_t *out_indices);
+
+/// Replaces the contents of the table with the given `n` key-value pairs. The index is sized once for `n`
+/// keys, then the keys are hashed (on `num_threads` threads) and inserted grouped by the region of the index
+/// they land in, so that the inserts don't miss the cache on large tables. A key given more than once takes
+/// its last value, as with `set`.
+template <TypeList>
+void build_from(PodHashSig &h, const K *keys, const V *values, uint32_t n, uint32_t num_threads = 1);
+
 /// Sets the given key's associated value to the given default value if no
 /// entry is present with the given key. Returns reference to the value
 /// associated with the key. (Can trigger a rehash if `key` doesn't already
@@ -164,9 +186,9 @@ template <TypeList> const K &get_key(const PodHashSig &h, K const &key, K const
 /// Removes the entry with the given key
 template <TypeList> void remove(PodHashSig &h, const K &key);
 
-/// Set the load factor
+/// Set the load factor. Must be in (0, 1), lookups of missing keys stop at an empty index slot.
 template <TypeList> void set_load_factor(PodHashSig &h, float new_load_factor) {
-    assert(new_load_factor > 0);
+    assert(new_load_factor > 0 && new_load_factor < 1.0f);
     h._load_factor = new_load_factor;
 }
 
@@ -177,29 +199,45 @@ namespace pod_hash_internal {
 
 const uint32_t END_OF_LIST = 0xffffffffu;
 
+// Number of keys find_batch works on at a time
+constexpr uint32_t BATCH_GROUP_SIZE = 16;
+
+// Number of index slots in each of the regions that `build_from` groups its inserts by
+constexpr uint32_t BUILD_REGION_SIZE = 1u << 13;
+
+// `index_i` is the index slot holding the entry if the key was found, otherwise the empty slot where the key
+// would be inserted (or END_OF_LIST if the index is not allocated yet).
 struct FindResult {
-    uint32_t hash_i;
+    uint32_t index_i;
     uint32_t entry_i;
-    uint32_t entry_prev;
+    uint32_t hash;
 };
 
-template <TypeList> struct KeyHashSlot {
-    static REALLY_INLINE uint32_t hash_slot(const PodHashSig &h, const K &k) {
-        return std::invoke(h._hashfn, k) % size(h._hashes);
-        // return h._hashfn(k) % size(h._hashes);
+template <TypeList> struct KeyHasher {
+    static REALLY_INLINE uint32_t hash(const PodHashSig &h, const K &k) {
+        return uint32_t(std::invoke(h._hashfn, k));
     }
 };
 
-template <typename K, typename V, typename EqualFnType>
-struct KeyHashSlot<K, V, ConvertToInt<K>, EqualFnType> {
-    static REALLY_INLINE uint32_t hash_slot(const PodHash<K, V, ConvertToInt<K>, EqualFnType> &h,
-                                            const K &k) {
-        return u32(k) % size(h._hashes);
+template <typename K, typename V, typename EqualFnType> struct KeyHasher<K, V, ConvertToInt<K>, EqualFnType> {
+    static REALLY_INLINE uint32_t hash(const PodHash<K, V, ConvertToInt<K>, EqualFnType> &h, const K &k) {
+        (void)h;
+        return u32(k);
     }
 };
 
-template <TypeList> uint32_t hash_slot(const PodHashSig &h, const K &k) {
-    return KeyHashSlot<K, V, HashFnType, EqualFnType>::hash_slot(h, k);
+template <TypeList> REALLY_INLINE uint32_t hash_key(const PodHashSig &h, const K &k) {
+    return KeyHasher<K, V, HashFnType, EqualFnType>::hash(h, k);
+}
+
+// The first slot to probe for a given hash. The hash is scrambled first because the index size is a power of
+// 2 and the low bits of a user hash (or of a key when using ConvertToInt) are often all alike.
+template <TypeList> REALLY_INLINE uint32_t home_slot(const PodHashSig &h, uint32_t hash) {
+    return uint32_t((hash * 0x9E3779B97F4A7C15ull) >> 32) & (size(h._index) - 1);
+}
+
+template <TypeList> REALLY_INLINE uint32_t next_slot(const PodHashSig &h, uint32_t index_i) {
+    return (index_i + 1) & (size(h._index) - 1);
 }
 
 // Forward declaration
@@ -208,9 +246,6 @@ template <TypeList> void rehash(PodHashSig &h, uint32_t new_size);
 // Forward declaration
 template <TypeList> void grow(PodHashSig &h);
 
-// Forward declaration
-template <TypeList> void insert(PodHashSig &h, const K &key, const V &value);
-
 template <TypeList> struct KeyEqualCaller {
     static bool key_equal(const PodHashSig &h, const K &k1, const K &k2) { return h._equalfn(k1, k2); }
 };
@@ -228,33 +263,37 @@ template <TypeList> REALLY_INLINE bool key_equal(const PodHashSig &h, const K &k
     return KeyEqualCaller<K, V, HashFnType, EqualFnType>::key_equal(h, key1, key2);
 };
 
-template <TypeList> FindResult find(const PodHashSig &h, const K &key) {
-    FindResult fr = { END_OF_LIST, END_OF_LIST, END_OF_LIST };
-
-    if (size(h._hashes) == 0) {
-        return fr;
+/// Probes the index starting at `index_i` for the given key.
+template <TypeList> FindResult probe(const PodHashSig &h, const K &key, uint32_t hash, uint32_t index_i) {
+    while (true) {
+        const IndexSlot &slot = h._index[index_i];
+        if (slot.entry_i == END_OF_LIST) {
+            return FindResult{ index_i, END_OF_LIST, hash };
+        }
+        if (slot.hash == hash && key_equal(h, h._entries[slot.entry_i].key, key)) {
+            return FindResult{ index_i, slot.entry_i, hash };
+        }
+        index_i = next_slot(h, index_i);
     }
+}
 
-    fr.hash_i = hash_slot(h, key);
-    fr.entry_i = h._hashes[fr.hash_i];
-    while (fr.entry_i != END_OF_LIST) {
-        if (key_equal(h, h._entries[fr.entry_i].key, key)) {
-            return fr;
-        }
-        fr.entry_prev = fr.entry_i;
-        fr.entry_i = h._entries[fr.entry_prev].next;
+template <TypeList> FindResult find(const PodHashSig &h, const K &key) {
+    if (size(h._index) == 0) {
+        return FindResult{ END_OF_LIST, END_OF_LIST, 0 };
     }
-    return fr;
+
+    const uint32_t hash = hash_key(h, key);
+    return probe(h, key, hash, home_slot(h, hash));
 }
 
 template <typename K, typename V, typename HashFnType, typename EqualFnType, bool value_init>
 struct PushEntry;
 
 template <TypeList> struct PushEntry<K, V, HashFnType, EqualFnType, true> {
-    static uint32_t push_entry(PodHashSig &h, const K &key) {
+    static uint32_t push_entry(PodHashSig &h, const K &key, uint32_t hash) {
         typename PodHashSig::Entry e{};
         e.key = key;
-        e.next = END_OF_LIST;
+        e.hash = hash;
         uint32_t ei = size(h._entries);
         push_back(h._entries, e);
         return ei;
@@ -262,76 +301,52 @@ template <TypeList> struct PushEntry<K, V, HashFnType, EqualFnType, true> {
 };
 
 template <TypeList> struct PushEntry<K, V, HashFnType, EqualFnType, false> {
-    static uint32_t push_entry(PodHashSig &h, const K &key) {
+    static uint32_t push_entry(PodHashSig &h, const K &key, uint32_t hash) {
         typename PodHashSig::Entry e;
         e.key = key;
-        e.next = END_OF_LIST;
+        e.hash = hash;
         uint32_t ei = size(h._entries);
         push_back(h._entries, e);
         return ei;
     }
 };
 
-/// Searches for the given key and if not found adds a new entry for the key.
-/// Returns the entry index.
+/// Searches for the given key and if not found adds a new entry for the key. The index must have room for one
+/// more entry. Returns the entry index.
 template <TypeList> uint32_t find_or_make(PodHashSig &h, const K &key, bool value_initialize) {
     FindResult fr = find(h, key);
     if (fr.entry_i != END_OF_LIST) {
         return fr.entry_i;
     }
 
-    fr.hash_i = hash_slot(h, key);
-
     if (value_initialize) {
-        fr.entry_i = PushEntry<K, V, HashFnType, EqualFnType, true>::push_entry(h, key);
+        fr.entry_i = PushEntry<K, V, HashFnType, EqualFnType, true>::push_entry(h, key, fr.hash);
     } else {
-        fr.entry_i = PushEntry<K, V, HashFnType, EqualFnType, false>::push_entry(h, key);
+        fr.entry_i = PushEntry<K, V, HashFnType, EqualFnType, false>::push_entry(h, key, fr.hash);
     }
 
-    if (fr.entry_prev == END_OF_LIST) {
-        h._hashes[fr.hash_i] = fr.entry_i;
-    } else {
-        h._entries[fr.entry_prev].next = fr.entry_i;
-    }
+    h._index[fr.index_i] = IndexSlot{ fr.entry_i, fr.hash };
     return fr.entry_i;
 }
 
-/// Makes a new entry and appends it to the appropriate chain
-template <TypeList> uint32_t make(PodHashSig &h, const K &key) {
-    const FindResult fr = find(h, key);
-    const uint32_t ei = PushEntry<K, V, HashFnType, EqualFnType, false>::push_entry(h, key);
-
-    if (fr.entry_prev == END_OF_LIST) {
-        h._hashes[fr.hash_i] = ei;
-    } else {
-        h._entries[fr.entry_prev].next = ei;
-    }
-    h._entries[ei].next = fr.entry_i;
-    return ei;
-}
-
-/// Allocates a new array for the hashes and recomputes the hashes of the
-/// already allocated values
+/// Allocates a new index with room for at least `new_size` slots and fills it from the entries. The entries
+/// themselves are not touched, and since they carry their hash, the hash function is not called.
 template <TypeList> void rehash(PodHashSig &h, uint32_t new_size) {
-    // create a new hash table
-    PodHashSig new_hash(*h._hashes._allocator, *h._entries._allocator, h._hashfn, h._equalfn);
+    new_size = clip_to_pow2(std::max(new_size, size(h._entries) + 1));
 
-    // Don't need the previous hashes.
-    free(h._hashes);
-    resize(new_hash._hashes, new_size);
-    reserve(new_hash._entries, size(h._entries));
-
-    // Empty out hashes
-    for (uint32_t &entry_i : new_hash._hashes) {
-        entry_i = END_OF_LIST;
+    resize(h._index, new_size);
+    for (IndexSlot &slot : h._index) {
+        slot.entry_i = END_OF_LIST;
     }
 
-    // Insert one by one
-    for (const auto &entry : h._entries) {
-        insert(new_hash, entry.key, entry.value);
+    for (uint32_t entry_i = 0; entry_i < size(h._entries); ++entry_i) {
+        const uint32_t hash = h._entries[entry_i].hash;
+        uint32_t index_i = home_slot(h, hash);
+        while (h._index[index_i].entry_i != END_OF_LIST) {
+            index_i = next_slot(h, index_i);
+        }
+        h._index[index_i] = IndexSlot{ entry_i, hash };
     }
-
-    std::swap(h, new_hash);
 }
 
 template <TypeList> void grow(PodHashSig &h) {
@@ -339,51 +354,55 @@ template <TypeList> void grow(PodHashSig &h) {
     rehash(h, new_size);
 }
 
-/// Returns true if the number of entries is more than 70% of the number of hashes. Note that if the number of
-/// entries is less than that of hashes then surely the hash table is not exhausted. So this function detects
-/// that too.
+/// Returns true if the number of entries has reached the load factor times the number of index slots, or if
+/// one more entry would leave no empty slot, which probing relies on to stop.
 template <TypeList> bool full(const PodHashSig &h) {
     const float max_load_factor = h._load_factor;
-    return size(h._entries) >= size(h._hashes) * max_load_factor;
+    return size(h._entries) + 1 >= size(h._index) || size(h._entries) >= size(h._index) * max_load_factor;
 }
 
-/// Inserts an entry by simply appending to the chain, so if no chain already exists for the given key, it's
-/// same as creating a new entry. Otherwise, it just adds a new entry to the chain, and does not overwrite any
-/// entry having the same key
-template <TypeList> void insert(PodHashSig &h, const K &key, const V &value) {
-    if (size(h._hashes) == 0) {
-        grow(h);
-    }
+/// Empties the given index slot. Slots after it in the same run are shifted back so that no probe sequence
+/// gets broken, which means we never need tombstones.
+template <TypeList> void remove_slot(PodHashSig &h, uint32_t hole) {
+    uint32_t index_i = hole;
+    while (true) {
+        index_i = next_slot(h, index_i);
+        const IndexSlot slot = h._index[index_i];
+        if (slot.entry_i == END_OF_LIST) {
+            break;
+        }
 
-    const uint32_t ei = make(h, key);
-    h._entries[ei].value = value;
-    if (full(h)) {
-        grow(h);
+        // The slot can fill the hole only if its home slot is not cyclically within (hole, index_i]
+        const uint32_t home = home_slot(h, slot.hash);
+        const bool stays =
+            hole <= index_i ? (hole < home && home <= index_i) : (hole < home || home <= index_i);
+        if (!stays) {
+            h._index[hole] = slot;
+            hole = index_i;
+        }
     }
+    h._index[hole].entry_i = END_OF_LIST;
 }
 
-/// Erases the entry found
+/// Erases the entry found. The last entry is moved into its place to keep the entries dense.
 template <TypeList> void erase(PodHashSig &h, const FindResult &fr) {
-    if (fr.entry_prev == END_OF_LIST) {
-        h._hashes[fr.hash_i] = h._entries[fr.entry_i].next;
-    } else {
-        h._entries[fr.entry_prev].next = h._entries[fr.entry_i].next;
-    }
+    remove_slot(h, fr.index_i);
 
-    if (fr.entry_i == size(h._entries) - 1) {
+    const uint32_t last_i = size(h._entries) - 1;
+    if (fr.entry_i == last_i) {
         pop_back(h._entries);
         return;
     }
 
-    h._entries[fr.entry_i] = h._entries[size(h._entries) - 1];
+    h._entries[fr.entry_i] = h._entries[last_i];
     pop_back(h._entries);
-    FindResult last = find(h, h._entries[fr.entry_i].key);
 
-    if (last.entry_prev == END_OF_LIST) {
-        h._hashes[last.hash_i] = fr.entry_i;
-    } else {
-        h._entries[last.entry_prev].next = fr.entry_i;
+    // Point the index slot of the moved entry to its new position
+    uint32_t index_i = home_slot(h, h._entries[fr.entry_i].hash);
+    while (h._index[index_i].entry_i != last_i) {
+        index_i = next_slot(h, index_i);
     }
+    h._index[index_i].entry_i = fr.entry_i;
 }
 
 /// Finds entry with the given key and removes it
@@ -399,35 +418,27 @@ template <TypeList> void find_and_erase(PodHashSig &h, const K &key) {
 
 namespace fo {
 
-template <TypeList> void reserve(PodHashSig &h, uint32_t size) { pod_hash_internal::rehash(h, size); }
+template <TypeList> void reserve(PodHashSig &h, uint32_t size) {
+    pod_hash_internal::rehash(h, uint32_t(size / h._load_factor) + 1);
+}
 
 template <TypeList> void set(PodHashSig &h, const K &key, const V &value) {
-    if (size(h._hashes) == 0 || pod_hash_internal::full(h)) {
+    if (size(h._index) == 0 || pod_hash_internal::full(h)) {
         pod_hash_internal::grow(h);
     }
 
     const uint32_t ei = pod_hash_internal::find_or_make(h, key, false);
     h._entries[ei].value = value;
-    if (pod_hash_internal::full(h)) {
-        pod_hash_internal::grow(h);
-    }
 }
 
 template <TypeList> V &set_then_ref(PodHashSig &h, const K &key, const V &value) {
-    // @rksht - Duplicate code with above `set` function. But don't want to do any extra work in `set`.
-    if (size(h._hashes) == 0 || pod_hash_internal::full(h)) {
+    if (size(h._index) == 0 || pod_hash_internal::full(h)) {
         pod_hash_internal::grow(h);
     }
 
     const uint32_t ei = pod_hash_internal::find_or_make(h, key, false);
     h._entries[ei].value = value;
-
-    if (pod_hash_internal::full(h)) {
-        pod_hash_internal::grow(h);
-        return get(h, key)->value;
-    } else {
-        return h._entries[ei].value;
-    }
+    return h._entries[ei].value;
 }
 
 template <TypeList> bool has(PodHashSig &h, const K &key) {
@@ -443,8 +454,88 @@ template <TypeList> typename PodHashSig::iterator get(const PodHashSig &h, const
     return h._entries.begin() + fr.entry_i;
 }
 
+template <TypeList> void find_batch(const PodHashSig &h, const K *keys, uint32_t n, uint32_t *out_indices) {
+    using namespace pod_hash_internal;
+
+    if (size(h._index) == 0) {
+        std::fill(out_indices, out_indices + n, END_OF_LIST);
+        return;
+    }
+
+    uint32_t hashes[BATCH_GROUP_SIZE];
+
+    for (uint32_t start = 0; start < n; start += BATCH_GROUP_SIZE) {
+        const uint32_t end = std::min(n, start + BATCH_GROUP_SIZE);
+
+        for (uint32_t i = start; i < end; ++i) {
+            hashes[i - start] = hash_key(h, keys[i]);
+            out_indices[i] = home_slot(h, hashes[i - start]);
+            SCAFFOLD_PREFETCH(&h._index[out_indices[i]]);
+        }
+
+        // Find the first slot with a matching hash, which is almost always the right one, and prefetch its
+        // entry. `out_indices` holds the index slot until the last pass.
+        for (uint32_t i = start; i < end; ++i) {
+            uint32_t index_i = out_indices[i];
+            while (h._index[index_i].entry_i != END_OF_LIST && h._index[index_i].hash != hashes[i - start]) {
+                index_i = next_slot(h, index_i);
+            }
+            if (h._index[index_i].entry_i != END_OF_LIST) {
+                SCAFFOLD_PREFETCH(&h._entries[h._index[index_i].entry_i]);
+            }
+            out_indices[i] = index_i;
+        }
+
+        for (uint32_t i = start; i < end; ++i) {
+            out_indices[i] = probe(h, keys[i], hashes[i - start], out_indices[i]).entry_i;
+        }
+    }
+}
+
+template <TypeList>
+void build_from(PodHashSig &h, const K *keys, const V *values, uint32_t n, uint32_t num_threads) {
+    using namespace pod_hash_internal;
+
+    clear(h._entries);
+    reserve(h._entries, n);
+    rehash(h, uint32_t(n / h._load_factor) + 1);
+
+    Allocator &allocator = *h._index._allocator;
+    Array<uint32_t> hashes(allocator, n);
+    Array<uint32_t> order(allocator, n);
+
+    parallel_chunks(n, num_threads, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            hashes[i] = hash_key(h, keys[i]);
+        }
+    });
+
+    const uint32_t region_size = std::min(size(h._index), BUILD_REGION_SIZE);
+    radix_partition(n,
+                    size(h._index) / region_size,
+                    [&](uint32_t i) { return home_slot(h, hashes[i]) / region_size; },
+                    data(order),
+                    nullptr,
+                    num_threads);
+
+    for (uint32_t i : order) {
+        const FindResult fr = probe(h, keys[i], hashes[i], home_slot(h, hashes[i]));
+        if (fr.entry_i != END_OF_LIST) {
+            h._entries[fr.entry_i].value = values[i];
+            continue;
+        }
+
+        typename PodHashSig::Entry e;
+        e.key = keys[i];
+        e.value = values[i];
+        e.hash = hashes[i];
+        h._index[fr.index_i] = IndexSlot{ size(h._entries), hashes[i] };
+        push_back(h._entries, e);
+    }
+}
+
 template <TypeList> V &PodHashSig::operator[](const K &key) {
-    if (size(_hashes) == 0) {
+    if (size(_index) == 0 || pod_hash_internal::full(*this)) {
         pod_hash_internal::grow(*this);
     }
     auto ei = pod_hash_internal::find_or_make(*this, key, true);
@@ -453,18 +544,19 @@ template <TypeList> V &PodHashSig::operator[](const K &key) {
 
 template <TypeList> V &set_default(PodHashSig &h, const K &key, const V &deffault) {
     pod_hash_internal::FindResult fr = pod_hash_internal::find(h, key);
-    if (fr.entry_i == pod_hash_internal::END_OF_LIST) {
-        if (size(h._hashes) == 0) {
-            pod_hash_internal::grow(h);
-        }
-        const uint32_t ei = pod_hash_internal::make(h, key);
-        h._entries[ei].value = deffault;
-        if (pod_hash_internal::full(h)) {
-            pod_hash_internal::grow(h);
-        }
-        return h._entries[ei].value;
+    if (fr.entry_i != pod_hash_internal::END_OF_LIST) {
+        return h._entries[fr.entry_i].value;
     }
-    return h._entries[fr.entry_i].value;
+
+    if (size(h._index) == 0 || pod_hash_internal::full(h)) {
+        pod_hash_internal::grow(h);
+        fr = pod_hash_internal::find(h, key);
+    }
+    using PushEntry = pod_hash_internal::PushEntry<K, V, HashFnType, EqualFnType, false>;
+    const uint32_t ei = PushEntry::push_entry(h, key, fr.hash);
+    h._entries[ei].value = deffault;
+    h._index[fr.index_i] = pod_hash_internal::IndexSlot{ ei, fr.hash };
+    return h._entries[ei].value;
 }
 
 /// Returns a const reference to the key. Use when using the hash as a set.
@@ -480,26 +572,21 @@ template <TypeList> const K &get_key(const PodHashSig &h, K const &key, K const
 template <TypeList> void remove(PodHashSig &h, const K &key) { pod_hash_internal::find_and_erase(h, key); }
 
 template <TypeList> void remove(PodHashSig &h, float new_load_factor) {
-    log_assert(new_load_factor <= 1.0f, "Must have load factor < 1.0f for decent performance");
+    log_assert(new_load_factor > 0 && new_load_factor < 1.0f, "Load factor must be in (0, 1)");
     h._load_factor = new_load_factor;
 }
 
-/// Finds the maximum chain length in the hash table.
+/// Finds the longest probe sequence in the index, i.e. the most slots a lookup of a present key looks at.
 template <TypeList> uint32_t max_chain_length(const PodHashSig &h) {
     uint32_t max_length = 0;
 
-    for (uint32_t i = 0; i < size(h._entries); ++i) {
-        if (h._hashes[i] == pod_hash_internal::END_OF_LIST) {
+    for (uint32_t i = 0; i < size(h._index); ++i) {
+        if (h._index[i].entry_i == pod_hash_internal::END_OF_LIST) {
             continue;
         }
 
-        uint32_t entry_i = h._hashes[i];
-        uint32_t length = 1;
-
-        while (h._entries[entry_i].next != pod_hash_internal::END_OF_LIST) {
-            entry_i = h._entries[entry_i].next;
-            ++length;
-        }
+        const uint32_t home = pod_hash_internal::home_slot(h, h._index[i].hash);
+        const uint32_t length = ((i - home) & (size(h._index) - 1)) + 1;
         if (max_length < length) {
             max_length = length;
         }
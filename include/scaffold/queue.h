@@ -2,6 +2,7 @@
 
 #include <scaffold/array.h>
 #include <scaffold/collection_types.h>
+#include <scaffold/const_log.h>
 
 namespace fo {
 /// Returns the number of items in the queue.
@@ -50,6 +51,10 @@ template <typename T> struct ChunkExtent {
 template <typename T> ChunkExtent<T> get_extent(Queue<T> &q, uint32_t start, uint32_t size);
 
 namespace queue_internal {
+// Reduces an index less than twice the capacity into the ring. Every index we compute is an offset plus
+// something no larger than the capacity, so a conditional subtract does it, without the division of `%`.
+inline uint32_t wrap(uint32_t i, uint32_t capacity) { return i >= capacity ? i - capacity : i; }
+
 // Can only be used to increase the capacity.
 template <typename T> void increase_capacity(Queue<T> &q, uint32_t new_capacity) {
     uint32_t end = size(q._data);
@@ -61,10 +66,13 @@ template <typename T> void increase_capacity(Queue<T> &q, uint32_t new_capacity)
     }
 }
 
+// Grows to the next power of two that fits, at least 8.
 template <typename T> void grow(Queue<T> &q, uint32_t min_capacity = 0) {
-    uint32_t new_capacity = size(q._data) * 2 + 8;
+    uint32_t new_capacity = clip_to_pow2(size(q._data) + 1);
     if (new_capacity < min_capacity)
-        new_capacity = min_capacity;
+        new_capacity = clip_to_pow2(min_capacity);
+    if (new_capacity < 8)
+        new_capacity = 8;
     increase_capacity(q, new_capacity);
 }
 } // namespace queue_internal
@@ -89,29 +97,29 @@ template <typename T> inline void pop_back(Queue<T> &q) { --q._size; }
 template <typename T> inline void push_front(Queue<T> &q, const T &item) {
     if (!space(q))
         queue_internal::grow(q);
-    q._offset = (q._offset - 1 + size(q._data)) % size(q._data);
+    q._offset = queue_internal::wrap(q._offset - 1 + size(q._data), size(q._data));
     ++q._size;
     q[0] = item;
 }
 
 template <typename T> inline void pop_front(Queue<T> &q) {
-    q._offset = (q._offset + 1) % size(q._data);
+    q._offset = queue_internal::wrap(q._offset + 1, size(q._data));
     --q._size;
 }
 
 template <typename T> inline void consume(Queue<T> &q, uint32_t n) {
-    q._offset = (q._offset + n) % size(q._data);
+    q._offset = queue_internal::wrap(q._offset + n, size(q._data));
     q._size -= n;
 }
 
 template <typename T> void push(Queue<T> &q, const T *items, uint32_t n) {
     if (space(q) < n)
         queue_internal::grow(q, size(q) + n);
-    const uint32_t size = size(q._data);
-    const uint32_t insert = (q._offset + q._size) % size;
+    const uint32_t capacity = size(q._data);
+    const uint32_t insert = queue_internal::wrap(q._offset + q._size, capacity);
     uint32_t to_insert = n;
-    if (insert + to_insert > size)
-        to_insert = size - insert;
+    if (insert + to_insert > capacity)
+        to_insert = capacity - insert;
     memcpy(begin(q._data) + insert, items, to_insert * sizeof(T));
     q._size += to_insert;
     items += to_insert;
@@ -137,7 +145,7 @@ template <typename T> const T *end_front(const Queue<T> &q) {
 template <typename T> ChunkExtent<T> get_extent(Queue<T> &q, uint32_t start, uint32_t count) {
     ChunkExtent<T> e;
 
-    uint32_t first_chunk_start = (q._offset + start) % size(q._data);
+    uint32_t first_chunk_start = queue_internal::wrap(q._offset + start, size(q._data));
     uint32_t first_chunk_end = first_chunk_start + count;
 
     e.first_chunk = &q._data[first_chunk_start];
@@ -182,10 +190,10 @@ template <typename T> Queue<T> &Queue<T>::operator=(Queue<T> &&other) {
 }
 
 template <typename T> inline T &Queue<T>::operator[](uint32_t i) {
-    return _data[(i + _offset) % size(_data)];
+    return _data[queue_internal::wrap(i + _offset, size(_data))];
 }
 
 template <typename T> inline const T &Queue<T>::operator[](uint32_t i) const {
-    return _data[(i + _offset) % size(_data)];
+    return _data[queue_internal::wrap(i + _offset, size(_data))];
 }
 } // namespace fo
\ No newline at end of file
@@ -0,0 +1,118 @@
+// Helpers for building tables in bulk. Splitting work on an index range across threads, and grouping items
+// by a small integer key (a bucket or a range of slots) with a counting sort.
+#pragma once
+
+#include <scaffold/array.h>
+#include <scaffold/memory.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace fo {
+
+/// Calls `fn(begin, end)` on `num_threads` consecutive chunks of [0, n), each on its own thread (the calling
+/// thread takes the first chunk). Fewer threads are used if chunks would hold less than `min_chunk_size`
+/// items. With `num_threads <= 1`, simply calls `fn(0, n)`.
+template <typename Fn>
+void parallel_chunks(uint32_t n, uint32_t num_threads, Fn fn, uint32_t min_chunk_size = 1024);
+
+/// Writes a permutation of [0, n) into `out_order` where items are grouped by `partition_of(i)`, which must
+/// return a value less than `num_partitions`. Items keep their relative order within a partition. If
+/// `out_starts` is not null, it receives `num_partitions + 1` offsets, partition `p` being
+/// `out_order[out_starts[p] .. out_starts[p + 1])`.
+template <typename PartitionFn>
+void radix_partition(uint32_t n,
+                     uint32_t num_partitions,
+                     PartitionFn partition_of,
+                     uint32_t *out_order,
+                     uint32_t *out_starts = nullptr,
+                     uint32_t num_threads = 1);
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+template <typename Fn>
+void parallel_chunks(uint32_t n, uint32_t num_threads, Fn fn, uint32_t min_chunk_size) {
+    num_threads = std::max(1u, std::min(num_threads, n / std::max(1u, min_chunk_size) + 1));
+    if (num_threads == 1) {
+        fn(0u, n);
+        return;
+    }
+
+    const uint32_t chunk_size = (n + num_threads - 1) / num_threads;
+
+    Allocator &allocator = memory_globals::default_allocator();
+    auto threads = reinterpret_cast<std::thread *>(
+        allocator.allocate(sizeof(std::thread) * (num_threads - 1), alignof(std::thread)));
+
+    for (uint32_t t = 1; t < num_threads; ++t) {
+        const uint32_t begin = std::min(n, t * chunk_size);
+        const uint32_t end = std::min(n, begin + chunk_size);
+        new (&threads[t - 1]) std::thread(fn, begin, end);
+    }
+
+    fn(0u, std::min(n, chunk_size));
+
+    for (uint32_t t = 1; t < num_threads; ++t) {
+        threads[t - 1].join();
+        threads[t - 1].~thread();
+    }
+    allocator.deallocate(threads);
+}
+
+template <typename PartitionFn>
+void radix_partition(uint32_t n,
+                     uint32_t num_partitions,
+                     PartitionFn partition_of,
+                     uint32_t *out_order,
+                     uint32_t *out_starts,
+                     uint32_t num_threads) {
+    if (n == 0) {
+        if (out_starts) {
+            std::fill(out_starts, out_starts + num_partitions + 1, 0u);
+        }
+        return;
+    }
+
+    num_threads = std::max(1u, std::min(num_threads, n / 1024 + 1));
+    const uint32_t chunk_size = (n + num_threads - 1) / num_threads;
+
+    // counts[t * num_partitions + p] is the number of items of chunk t in partition p, and after the prefix
+    // sum, where chunk t starts writing partition p.
+    Array<uint32_t> counts(memory_globals::default_allocator(), num_threads * num_partitions);
+    std::fill(begin(counts), end(counts), 0u);
+
+    parallel_chunks(n, num_threads, [&](uint32_t begin, uint32_t end) {
+        uint32_t *chunk_counts = data(counts) + (begin / chunk_size) * num_partitions;
+        for (uint32_t i = begin; i < end; ++i) {
+            ++chunk_counts[partition_of(i)];
+        }
+    });
+
+    uint32_t offset = 0;
+    for (uint32_t p = 0; p < num_partitions; ++p) {
+        if (out_starts) {
+            out_starts[p] = offset;
+        }
+        for (uint32_t t = 0; t < num_threads; ++t) {
+            const uint32_t count = counts[t * num_partitions + p];
+            counts[t * num_partitions + p] = offset;
+            offset += count;
+        }
+    }
+    if (out_starts) {
+        out_starts[num_partitions] = offset;
+    }
+
+    parallel_chunks(n, num_threads, [&](uint32_t begin, uint32_t end) {
+        uint32_t *chunk_offsets = data(counts) + (begin / chunk_size) * num_partitions;
+        for (uint32_t i = begin; i < end; ++i) {
+            out_order[chunk_offsets[partition_of(i)]++] = i;
+        }
+    });
+}
+
+} // namespace fo
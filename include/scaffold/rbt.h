@@ -8,6 +8,7 @@
 
 #include <assert.h>
 #include <functional>
+#include <new>
 #include <type_traits>
 
 namespace fo {
@@ -25,11 +26,13 @@ template <typename Key, typename T> struct RBNode; // Fwd decl
 
 namespace internal {
 
-// We keep the kid pointers here
+// We keep the kid pointers here. Along with the size of the subtree rooted at the node, used by `rank` and
+// `select`. It sits in what would be padding after `_color`, so it doesn't make nodes any bigger.
 template <typename Key, typename T> struct ChildPointers {
     RBNode<Key, T> *_childs[2] = { nullptr, nullptr };
     RBNode<Key, T> *_parent = nullptr;
     Color _color = BLACK;
+    u32 _count = 0;
 };
 
 } // namespace internal
@@ -61,12 +64,132 @@ template <typename Key, typename T> struct RBNode : public internal::ChildPointe
     T &second() { return v; }
 };
 
-/// Represents a red-black tree based map.
-template <typename Key, typename T> struct RBTree {
+namespace internal {
+
+// Each tree carves its nodes out of chunks allocated from the tree's allocator. Removed nodes go on a free
+// list and are reused by later inserts. Chunks are only given back to the allocator on `clear` or when the
+// tree is destroyed, so that costs one deallocation per chunk rather than one per node. Chunk sizes double
+// up to MAX_CHUNK_NODES, so the number of chunks stays small.
+//
+// Not using `PoolAllocator` for this since it looks up the owning pool of a node by walking its chain of
+// pools, which is linear in the number of pools.
+template <typename Key, typename T> struct NodePool {
+    static constexpr u32 FIRST_CHUNK_NODES = 32;
+    static constexpr u32 MAX_CHUNK_NODES = 4096;
+
+    struct alignas(alignof(RBNode<Key, T>)) ChunkHeader {
+        ChunkHeader *_next;
+    };
+
+    struct FreeNode {
+        FreeNode *_next;
+    };
+
+    static_assert(sizeof(RBNode<Key, T>) >= sizeof(FreeNode), "");
+
+    ChunkHeader *_chunks = nullptr;
+    FreeNode *_free = nullptr;
+
+    // Unused part of the most recent chunk
+    char *_bump = nullptr;
+    char *_bump_end = nullptr;
+
+    u32 _next_chunk_nodes = FIRST_CHUNK_NODES;
+};
+
+// Starts a new chunk with room for `num_nodes` nodes. Whatever was left of the previous chunk is not used.
+template <typename Key, typename T>
+void pool_add_chunk(NodePool<Key, T> &pool, Allocator &allocator, u32 num_nodes) {
+    using Pool = NodePool<Key, T>;
+
+    const AddrUint bytes = sizeof(typename Pool::ChunkHeader) + AddrUint(num_nodes) * sizeof(RBNode<Key, T>);
+
+    auto chunk = (typename Pool::ChunkHeader *)allocator.allocate(bytes, alignof(RBNode<Key, T>));
+    chunk->_next = pool._chunks;
+    pool._chunks = chunk;
+
+    pool._bump = (char *)(chunk + 1);
+    pool._bump_end = pool._bump + AddrUint(num_nodes) * sizeof(RBNode<Key, T>);
+}
+
+template <typename Key, typename T> void *pool_allocate(NodePool<Key, T> &pool, Allocator &allocator) {
+    using Pool = NodePool<Key, T>;
+
+    if (pool._free) {
+        auto node = pool._free;
+        pool._free = node->_next;
+        return node;
+    }
+
+    if (pool._bump == pool._bump_end) {
+        const u32 num_nodes = pool._next_chunk_nodes;
+        pool_add_chunk(pool, allocator, num_nodes);
+
+        if (num_nodes < Pool::MAX_CHUNK_NODES) {
+            pool._next_chunk_nodes = num_nodes * 2;
+        }
+    }
+
+    void *p = pool._bump;
+    pool._bump += sizeof(RBNode<Key, T>);
+    return p;
+}
+
+template <typename Key, typename T> void pool_deallocate(NodePool<Key, T> &pool, void *p) {
+    auto node = new (p) typename NodePool<Key, T>::FreeNode;
+    node->_next = pool._free;
+    pool._free = node;
+}
+
+// Moves the chunks and free nodes of `from` into `into`. The unused rest of `from`'s current chunk goes on the
+// free list.
+template <typename Key, typename T> void pool_merge(NodePool<Key, T> &into, NodePool<Key, T> &from) {
+    while (from._bump != from._bump_end) {
+        pool_deallocate(from, from._bump);
+        from._bump += sizeof(RBNode<Key, T>);
+    }
+
+    if (from._chunks) {
+        auto last = from._chunks;
+        while (last->_next) {
+            last = last->_next;
+        }
+        last->_next = into._chunks;
+        into._chunks = from._chunks;
+    }
+
+    if (from._free) {
+        auto last = from._free;
+        while (last->_next) {
+            last = last->_next;
+        }
+        last->_next = into._free;
+        into._free = from._free;
+    }
+
+    from = NodePool<Key, T>{};
+}
+
+// Returns all chunks to the allocator. Does not run any destructors.
+template <typename Key, typename T> void pool_release(NodePool<Key, T> &pool, Allocator &allocator) {
+    auto chunk = pool._chunks;
+    while (chunk) {
+        auto next = chunk->_next;
+        allocator.deallocate(chunk);
+        chunk = next;
+    }
+    pool = NodePool<Key, T>{};
+}
+
+} // namespace internal
+
+/// Represents a red-black tree based map. `Less` is the key comparison, a callable type taking two keys. It's
+/// a template parameter rather than a `std::function` so that the comparisons in the descent get inlined.
+template <typename Key, typename T, typename Less = std::less<Key>> struct RBTree {
     using key_type = Key;
     using mapped_type = T;
     using value_type = RBNode<Key, T>;
-    using is_less_fn = std::function<bool(const Key &, const Key &)>;
+    using is_less_fn = Less;
 
     // This being nullptr denotes moved-from tree
     Allocator *_allocator;
@@ -75,12 +198,19 @@ template <typename Key, typename T> struct RBTree {
     internal::ChildPointers<Key, T> *_nil;
     RBNode<Key, T> *_root;
 
-    is_less_fn _less;
+    // Number of nodes in the tree, not counting nil
+    u32 _size;
+
+    // Nodes are allocated from here. The chunks themselves come from `_allocator`.
+    internal::NodePool<Key, T> _pool;
+
+    Less _less;
 
     bool _equal(const Key &k1, const Key &k2) const { return !(_less(k1, k2) || _less(k2, k1)); }
 
-    /// Constructs a new RBTree where nodes will be allocated using given `allocator`.
-    RBTree(Allocator &allocator, is_less_fn less = std::less<Key>{});
+    /// Constructs a new RBTree. Nodes are allocated in chunks from the given `allocator`, and the memory of
+    /// removed nodes is kept for reuse until the tree is cleared or destroyed.
+    RBTree(Allocator &allocator, Less less = Less{});
     ~RBTree();
 
     /// Copy ctor. If used like a copy constructor i.e you don't provide an allocator, the new tree will use
@@ -103,13 +233,16 @@ template <typename Key, typename T> struct RBTree {
 // a const pointer argument and then `const_cast` to remove the const. Or I could template the whole 'Node'
 // type. But a middle ground is to template on whether the const-ness of the RBNode object itself, and
 // implement the traversalk functions templated on Key, T, and is_const.
-template <template <class, class> typename TreeOrNode, typename Key, typename T, bool is_const>
-using KT = typename std::conditional<is_const, const TreeOrNode<Key, T>, TreeOrNode<Key, T>>::type;
+template <typename Key, typename T, bool is_const>
+using KTNode = typename std::conditional<is_const, const RBNode<Key, T>, RBNode<Key, T>>::type;
+
+template <typename Key, typename T, typename Less, bool is_const>
+using KTTree = typename std::conditional<is_const, const RBTree<Key, T, Less>, RBTree<Key, T, Less>>::type;
 
 /// The iterator is bidirectional, but not random-access.
-template <typename Key, typename T, bool is_const> struct Iterator {
-    using TreeType = KT<RBTree, Key, T, is_const>;
-    using NodeType = KT<RBNode, Key, T, is_const>;
+template <typename Key, typename T, bool is_const, typename Less = std::less<Key>> struct Iterator {
+    using TreeType = KTTree<Key, T, Less, is_const>;
+    using NodeType = KTNode<Key, T, is_const>;
 
     TreeType *_tree;
     NodeType *_node;
@@ -135,11 +268,11 @@ template <typename Key, typename T, bool is_const> struct Iterator {
     NodeType *operator->() const { return _node; }
     NodeType &operator*() const { return *_node; }
 
-    template <bool other_const> bool operator==(const Iterator<Key, T, other_const> &o) const {
+    template <bool other_const> bool operator==(const Iterator<Key, T, other_const, Less> &o) const {
         return o._node == _node;
     }
 
-    template <bool other_const> bool operator!=(const Iterator<Key, T, other_const> &o) const {
+    template <bool other_const> bool operator!=(const Iterator<Key, T, other_const, Less> &o) const {
         return o._node != _node;
     }
 };
@@ -150,13 +283,13 @@ template <typename Key, typename T, bool is_const> struct Iterator {
 
 namespace rbt {
 
-template <typename Key, typename T>
-inline bool is_nil_node(const RBTree<Key, T> &rbt, const RBNode<Key, T> *node) {
+template <typename Key, typename T, typename Less>
+inline bool is_nil_node(const RBTree<Key, T, Less> &rbt, const RBNode<Key, T> *node) {
     return static_cast<const internal::ChildPointers<Key, T> *>(node) == rbt._nil;
 }
 
-template <typename Key, typename T>
-u32 count_nodes(const RBTree<Key, T> &tree, const RBNode<Key, T> *current_node, u32 parent_count) {
+template <typename Key, typename T, typename Less>
+u32 count_nodes(const RBTree<Key, T, Less> &tree, const RBNode<Key, T> *current_node, u32 parent_count) {
     if (!is_nil_node(tree, current_node)) {
         parent_count += 1 + count_nodes(tree, current_node->_childs[0], 0);
         return count_nodes(tree, current_node->_childs[1], parent_count);
@@ -164,56 +297,78 @@ u32 count_nodes(const RBTree<Key, T> &tree, const RBNode<Key, T> *current_node,
     return parent_count;
 }
 
-template <typename Key, typename T> u32 count_nodes(const RBTree<Key, T> &tree) {
+/// Counts the nodes by walking the whole tree. Use `size` instead, this is for checking that it's right.
+template <typename Key, typename T, typename Less> u32 count_nodes(const RBTree<Key, T, Less> &tree) {
     return count_nodes(tree, tree._root, 0);
 }
 
+/// Returns the number of nodes in the tree.
+template <typename Key, typename T, typename Less> u32 size(const RBTree<Key, T, Less> &tree) {
+    return tree._size;
+}
+
 namespace internal {
 
-template <typename Key, typename T> void delete_all_nodes(RBTree<Key, T> &tree, bool delete_nil_node) {
-    if (tree._allocator == nullptr) {
-        return;
-    }
+template <typename Key, typename T, typename Less, typename... Args>
+RBNode<Key, T> *new_node(RBTree<Key, T, Less> &tree, Args &&... args) {
+    void *p = pool_allocate(tree._pool, *tree._allocator);
+    return new (p) RBNode<Key, T>(std::forward<Args>(args)...);
+}
 
-    if (is_nil_node(tree, tree._root)) {
-        if (delete_nil_node) {
-            make_delete(*tree._allocator, tree._nil);
-            tree._root = nullptr;
-            tree._nil = nullptr;
-        }
+template <typename Key, typename T, typename Less>
+void delete_node(RBTree<Key, T, Less> &tree, RBNode<Key, T> *n) {
+    n->~RBNode<Key, T>();
+    pool_deallocate(tree._pool, n);
+}
+
+template <typename Key, typename T, typename Less>
+void delete_all_nodes(RBTree<Key, T, Less> &tree, bool delete_nil_node) {
+    if (tree._allocator == nullptr) {
         return;
     }
 
-    TempAllocator1024 ta(memory_globals::default_allocator());
-    Array<RBNode<Key, T> *> stack(ta);
-    reserve(stack, 512 / sizeof(RBNode<Key, T> *));
-
-    push_back(stack, tree._root);
-
-    while (size(stack) != 0) {
-        RBNode<Key, T> *p = back(stack);
-        pop_back(stack);
-        for (u32 i = 0; i < 2; ++i) {
-            if (!is_nil_node(tree, p->_childs[i])) {
-                push_back(stack, p->_childs[i]);
+    // Nodes don't need to be deallocated one by one, the chunks are released at the end. So we only need to
+    // visit each node if there's a destructor to call.
+    if (!std::is_trivially_destructible<RBNode<Key, T>>::value && !is_nil_node(tree, tree._root)) {
+        TempAllocator1024 ta(memory_globals::default_allocator());
+        Array<RBNode<Key, T> *> stack(ta);
+        reserve(stack, 512 / sizeof(RBNode<Key, T> *));
+
+        push_back(stack, tree._root);
+
+        while (size(stack) != 0) {
+            RBNode<Key, T> *p = back(stack);
+            pop_back(stack);
+            for (u32 i = 0; i < 2; ++i) {
+                if (!is_nil_node(tree, p->_childs[i])) {
+                    push_back(stack, p->_childs[i]);
+                }
             }
+            p->~RBNode<Key, T>();
         }
-        make_delete(*tree._allocator, p);
     }
 
+    pool_release(tree._pool, *tree._allocator);
+    tree._size = 0;
+
     if (delete_nil_node) {
         make_delete(*tree._allocator, tree._nil);
         tree._root = nullptr;
         tree._nil = nullptr;
+    } else {
+        tree._root = static_cast<RBNode<Key, T> *>(tree._nil);
     }
 }
 
-template <typename Key, typename T> void copy_tree(RBTree<Key, T> &tree, const RBTree<Key, T> &other) {
+template <typename Key, typename T, typename Less>
+void copy_tree(RBTree<Key, T, Less> &tree, const RBTree<Key, T, Less> &other) {
     if (is_nil_node(other, other._root)) {
         return;
     }
 
-    tree._root = make_new<RBNode<Key, T>>(*tree._allocator, other._root->k, other._root->v);
+    tree._root = new_node(tree, other._root->k, other._root->v);
+    tree._root->_parent = static_cast<RBNode<Key, T> *>(tree._nil);
+    tree._size = other._size;
 
     // We maintain the recursion stack ourselves.
 
@@ -233,14 +388,15 @@ template <typename Key, typename T> void copy_tree(RBTree<Key, T> &tree, const R
         fo::pop_back(others_stack);
 
         wips_top->_color = others_top->_color;
+        wips_top->_count = others_top->_count;
 
         for (u32 i = 0; i < 2; ++i) {
             if (rbt::is_nil_node(other, others_top->_childs[i])) {
                 wips_top->_childs[i] = static_cast<RBNode<Key, T> *>(tree._nil);
             } else {
                 // Create the child node
-                wips_top->_childs[i] = make_new<RBNode<Key, T>>(
-                    *tree._allocator, others_top->_childs[i]->k, others_top->_childs[i]->v);
+                wips_top->_childs[i] = new_node(tree, others_top->_childs[i]->k, others_top->_childs[i]->v);
+                wips_top->_childs[i]->_parent = wips_top;
                 fo::push_back(others_stack, others_top->_childs[i]);
                 fo::push_back(wips_stack, wips_top->_childs[i]);
             }
@@ -248,28 +404,63 @@ template <typename Key, typename T> void copy_tree(RBTree<Key, T> &tree, const R
     }
 }
 
-template <typename Key, typename T, bool is_const>
-KT<RBNode, Key, T, is_const> *find(KT<RBTree, Key, T, is_const> &rbt, const Key &k) {
+template <typename Key, typename T, typename Less, bool is_const>
+KTNode<Key, T, is_const> *find(KTTree<Key, T, Less, is_const> &rbt, const Key &k) {
     auto cur_node = rbt._root;
     while (!is_nil_node(rbt, cur_node)) {
-        if (rbt._equal(cur_node->k, k)) {
+        if (rbt._less(k, cur_node->k)) {
+            cur_node = cur_node->_childs[0];
+        } else if (rbt._less(cur_node->k, k)) {
+            cur_node = cur_node->_childs[1];
+        } else {
             return cur_node;
         }
-        if (rbt._less(cur_node->k, k)) {
-            cur_node = cur_node->_childs[1];
+    }
+
+    return cur_node;
+}
+
+// Returns the first node whose key is not less than `k` (or, if `upper` is true, greater than `k`), or nil.
+template <typename Key, typename T, typename Less, bool is_const, bool upper>
+KTNode<Key, T, is_const> *bound(KTTree<Key, T, Less, is_const> &t, const Key &k) {
+    auto result = static_cast<KTNode<Key, T, is_const> *>(t._nil);
+    auto cur_node = t._root;
+    while (!is_nil_node(t, cur_node)) {
+        const bool go_left = upper ? t._less(k, cur_node->k) : !t._less(cur_node->k, k);
+        if (go_left) {
+            result = cur_node;
+            cur_node = cur_node->_childs[LEFT];
         } else {
-            cur_node = cur_node->_childs[0];
+            cur_node = cur_node->_childs[RIGHT];
         }
     }
+    return result;
+}
 
+// Returns the node at in-order position `i`, or nil.
+template <typename Key, typename T, typename Less, bool is_const>
+KTNode<Key, T, is_const> *select_node(KTTree<Key, T, Less, is_const> &t, u32 i) {
+    auto cur_node = t._root;
+    while (!is_nil_node(t, cur_node)) {
+        const u32 left_count = cur_node->_childs[LEFT]->_count;
+        if (i < left_count) {
+            cur_node = cur_node->_childs[LEFT];
+        } else if (i == left_count) {
+            return cur_node;
+        } else {
+            i -= left_count + 1;
+            cur_node = cur_node->_childs[RIGHT];
+        }
+    }
     return cur_node;
 }
 
-template <typename Key, typename T> RBNode<Key, T> *nil_node(RBTree<Key, T> &t) {
+template <typename Key, typename T, typename Less> RBNode<Key, T> *nil_node(RBTree<Key, T, Less> &t) {
     return static_cast<RBNode<Key, T> *>(t._nil);
 }
 
-template <int left, int right, typename Key, typename T> void rotate(RBTree<Key, T> &t, RBNode<Key, T> *x) {
+template <int left, int right, typename Key, typename T, typename Less>
+void rotate(RBTree<Key, T, Less> &t, RBNode<Key, T> *x) {
     auto y = x->_childs[right];
     x->_childs[right] = y->_childs[left];
     if (!is_nil_node(t, y->_childs[left])) {
@@ -285,10 +476,22 @@ template <int left, int right, typename Key, typename T> void rotate(RBTree<Key,
     }
     y->_childs[left] = x;
     x->_parent = y;
+
+    y->_count = x->_count;
+    x->_count = x->_childs[LEFT]->_count + x->_childs[RIGHT]->_count + 1;
 }
 
-template <typename Key, typename T>
-void transplant(RBTree<Key, T> &t, RBNode<Key, T> *n1, RBNode<Key, T> *n2) {
+// Adds `delta` to the subtree sizes of `node` and all its ancestors
+template <typename Key, typename T, typename Less>
+void add_to_counts_up_to_root(RBTree<Key, T, Less> &t, RBNode<Key, T> *node, int delta) {
+    while (!is_nil_node(t, node)) {
+        node->_count += delta;
+        node = node->_parent;
+    }
+}
+
+template <typename Key, typename T, typename Less>
+void transplant(RBTree<Key, T, Less> &t, RBNode<Key, T> *n1, RBNode<Key, T> *n2) {
     if (n1 == t._root) {
         t._root = n2;
     } else if (n1->_parent->_childs[0] == n1) {
@@ -299,8 +502,8 @@ void transplant(RBTree<Key, T> &t, RBNode<Key, T> *n1, RBNode<Key, T> *n2) {
     n2->_parent = n1->_parent;
 }
 
-template <int left, int right, typename Key, typename T>
-RBNode<Key, T> *insert_fix(RBTree<Key, T> &t, RBNode<Key, T> *z) {
+template <int left, int right, typename Key, typename T, typename Less>
+RBNode<Key, T> *insert_fix(RBTree<Key, T, Less> &t, RBNode<Key, T> *z) {
     auto y = z->_parent->_parent->_childs[right];
     if (y->_color == RED) {
         z->_parent->_color = BLACK;
@@ -319,8 +522,8 @@ RBNode<Key, T> *insert_fix(RBTree<Key, T> &t, RBNode<Key, T> *z) {
     return z;
 }
 
-template <int left, int right, typename Key, typename T>
-RBNode<Key, T> *remove_fix(RBTree<Key, T> &t, RBNode<Key, T> *x) {
+template <int left, int right, typename Key, typename T, typename Less>
+RBNode<Key, T> *remove_fix(RBTree<Key, T, Less> &t, RBNode<Key, T> *x) {
     auto w = x->_parent->_childs[right];
     if (w->_color == RED) {
         w->_color = BLACK;
@@ -347,9 +550,9 @@ RBNode<Key, T> *remove_fix(RBTree<Key, T> &t, RBNode<Key, T> *x) {
     return x;
 }
 
-template <typename Key, typename T, bool is_const>
-KT<RBNode, Key, T, is_const> *min_node_of_subtree(KT<RBTree, Key, T, is_const> &t,
-                                                  KT<RBNode, Key, T, is_const> *node) {
+template <typename Key, typename T, typename Less, bool is_const>
+KTNode<Key, T, is_const> *min_node_of_subtree(KTTree<Key, T, Less, is_const> &t,
+                                                  KTNode<Key, T, is_const> *node) {
     if (is_nil_node(t, node)) {
         return node;
     }
@@ -359,9 +562,9 @@ KT<RBNode, Key, T, is_const> *min_node_of_subtree(KT<RBTree, Key, T, is_const> &
     return node;
 }
 
-template <typename Key, typename T, bool is_const>
-KT<RBNode, Key, T, is_const> *max_node_of_subtree(KT<RBTree, Key, T, is_const> &t,
-                                                  KT<RBNode, Key, T, is_const> *node) {
+template <typename Key, typename T, typename Less, bool is_const>
+KTNode<Key, T, is_const> *max_node_of_subtree(KTTree<Key, T, Less, is_const> &t,
+                                                  KTNode<Key, T, is_const> *node) {
     if (is_nil_node(t, node)) {
         return node;
     }
@@ -372,9 +575,9 @@ KT<RBNode, Key, T, is_const> *max_node_of_subtree(KT<RBTree, Key, T, is_const> &
 }
 
 // Returns the next in-order node for the given `node`. Given node must not be pointing to `nil`.
-template <typename Key, typename T, bool is_const>
-KT<RBNode, Key, T, is_const> *next_inorder_node(KT<RBTree, Key, T, is_const> &t,
-                                                KT<RBNode, Key, T, is_const> *node) {
+template <typename Key, typename T, typename Less, bool is_const>
+KTNode<Key, T, is_const> *next_inorder_node(KTTree<Key, T, Less, is_const> &t,
+                                                KTNode<Key, T, is_const> *node) {
     // Right subtree is nil? Follow parent pointers as long as we are right node.
     if (is_nil_node(t, node->_childs[RIGHT])) {
         while (node->_parent->_childs[RIGHT] == node) {
@@ -383,14 +586,14 @@ KT<RBNode, Key, T, is_const> *next_inorder_node(KT<RBTree, Key, T, is_const> &t,
         return node->_parent;
     }
     // Get the minimum node of right subtree.
-    auto r = min_node_of_subtree<Key, T, is_const>(t, node->_childs[RIGHT]);
+    auto r = min_node_of_subtree<Key, T, Less, is_const>(t, node->_childs[RIGHT]);
     return r;
 }
 
 // Returns the previous in-order node for given `node`. Given node must not be pointing to `nil`.
-template <typename Key, typename T, bool is_const>
-KT<RBNode, Key, T, is_const> *prev_inorder_node(KT<RBTree, Key, T, is_const> &t,
-                                                KT<RBNode, Key, T, is_const> *node) {
+template <typename Key, typename T, typename Less, bool is_const>
+KTNode<Key, T, is_const> *prev_inorder_node(KTTree<Key, T, Less, is_const> &t,
+                                                KTNode<Key, T, is_const> *node) {
     if (is_nil_node(t, node->_childs[LEFT])) {
         while (node->_parent->_childs[LEFT] == node) {
             node = node->_parent;
@@ -398,18 +601,45 @@ KT<RBNode, Key, T, is_const> *prev_inorder_node(KT<RBTree, Key, T, is_const> &t,
         return node->_parent;
     }
     // Not leaf node. Get the maximum of left subtree
-    auto l = max_node_of_subtree<Key, T, is_const>(t, node->_childs[LEFT]);
+    auto l = max_node_of_subtree<Key, T, Less, is_const>(t, node->_childs[LEFT]);
     return l;
 }
 
+// Links `nodes[lo, hi)`, which are in key order, into a balanced subtree and returns its root. The nodes at
+// depth `red_depth` are colored red, the others black.
+template <typename Key, typename T, typename Less>
+RBNode<Key, T> *link_sorted(RBTree<Key, T, Less> &tree, RBNode<Key, T> *nodes, u32 lo, u32 hi, u32 depth,
+                            u32 red_depth) {
+    if (lo == hi) {
+        return static_cast<RBNode<Key, T> *>(tree._nil);
+    }
+
+    const u32 mid = lo + (hi - lo) / 2;
+    RBNode<Key, T> *n = nodes + mid;
+
+    n->_childs[LEFT] = link_sorted(tree, nodes, lo, mid, depth + 1, red_depth);
+    n->_childs[RIGHT] = link_sorted(tree, nodes, mid + 1, hi, depth + 1, red_depth);
+
+    for (u32 i = 0; i < 2; ++i) {
+        if (!is_nil_node(tree, n->_childs[i])) {
+            n->_childs[i]->_parent = n;
+        }
+    }
+
+    n->_color = depth == red_depth ? RED : BLACK;
+    n->_count = hi - lo;
+    return n;
+}
+
 } // namespace internal
 } // namespace rbt
 
 namespace rbt {
 
-template <typename Key, typename T>
-RBTree<Key, T>::RBTree(Allocator &allocator, RBTree<Key, T>::is_less_fn less)
-    : _less(less) {
+template <typename Key, typename T, typename Less>
+RBTree<Key, T, Less>::RBTree(Allocator &allocator, Less less)
+    : _size(0)
+    , _less(std::move(less)) {
     _allocator = &allocator;
     _nil = make_new<internal::ChildPointers<Key, T>>(*_allocator);
     _nil->_childs[LEFT] = static_cast<RBNode<Key, T> *>(_nil);
@@ -421,9 +651,10 @@ RBTree<Key, T>::RBTree(Allocator &allocator, RBTree<Key, T>::is_less_fn less)
     _root = static_cast<RBNode<Key, T> *>(_nil);
 }
 
-template <typename Key, typename T>
-RBTree<Key, T>::RBTree(const RBTree &other, Allocator *allocator)
-    : _less(other._less) {
+template <typename Key, typename T, typename Less>
+RBTree<Key, T, Less>::RBTree(const RBTree &other, Allocator *allocator)
+    : _size(0)
+    , _less(other._less) {
     _allocator = allocator ? allocator : other._allocator;
     _nil = make_new<internal::ChildPointers<Key, T>>(*_allocator);
     _nil->_childs[LEFT] = static_cast<RBNode<Key, T> *>(_nil);
@@ -434,15 +665,19 @@ RBTree<Key, T>::RBTree(const RBTree &other, Allocator *allocator)
     rbt::internal::copy_tree(*this, other);
 }
 
-template <typename Key, typename T> RBTree<Key, T>::RBTree(RBTree &&other) {
+template <typename Key, typename T, typename Less> RBTree<Key, T, Less>::RBTree(RBTree &&other) {
     _allocator = other._allocator;
     _root = other._root;
     _nil = other._nil;
+    _size = other._size;
+    _pool = other._pool;
     _less = std::move(other._less);
     other._allocator = nullptr;
+    other._pool = internal::NodePool<Key, T>{};
 }
 
-template <typename Key, typename T> RBTree<Key, T> &RBTree<Key, T>::operator=(const RBTree &other) {
+template <typename Key, typename T, typename Less>
+RBTree<Key, T, Less> &RBTree<Key, T, Less>::operator=(const RBTree &other) {
     if (this == &other) {
         return *this;
     }
@@ -458,7 +693,8 @@ template <typename Key, typename T> RBTree<Key, T> &RBTree<Key, T>::operator=(co
     return *this;
 }
 
-template <typename Key, typename T> RBTree<Key, T> &RBTree<Key, T>::operator=(RBTree &&other) {
+template <typename Key, typename T, typename Less>
+RBTree<Key, T, Less> &RBTree<Key, T, Less>::operator=(RBTree &&other) {
     if (this == &other) {
         return *this;
     }
@@ -468,111 +704,232 @@ template <typename Key, typename T> RBTree<Key, T> &RBTree<Key, T>::operator=(RB
     _allocator = other._allocator;
     _root = other._root;
     _nil = other._nil;
+    _size = other._size;
+    _pool = other._pool;
     _less = std::move(other._less);
 
     other._allocator = nullptr;
+    other._pool = internal::NodePool<Key, T>{};
 
     return *this;
 }
 
-template <typename Key, typename T> RBTree<Key, T>::~RBTree() {
+template <typename Key, typename T, typename Less> RBTree<Key, T, Less>::~RBTree() {
     if (_allocator) {
         rbt::internal::delete_all_nodes(*this, true);
         _allocator = nullptr;
     }
 }
 
-template <typename Key, typename T> auto begin(const RBTree<Key, T> &t) {
-    return Iterator<Key, T, true>(t, internal::min_node_of_subtree<Key, T, true>(t, t._root));
+template <typename Key, typename T, typename Less> auto begin(const RBTree<Key, T, Less> &t) {
+    return Iterator<Key, T, true, Less>(t, internal::min_node_of_subtree<Key, T, Less, true>(t, t._root));
 }
 
-template <typename Key, typename T> auto begin(RBTree<Key, T> &t) {
-    return Iterator<Key, T, false>(t, internal::min_node_of_subtree<Key, T, false>(t, t._root));
+template <typename Key, typename T, typename Less> auto begin(RBTree<Key, T, Less> &t) {
+    return Iterator<Key, T, false, Less>(t, internal::min_node_of_subtree<Key, T, Less, false>(t, t._root));
 }
 
-template <typename Key, typename T> auto end(const RBTree<Key, T> &t) {
-    return Iterator<Key, T, true>(t, static_cast<const RBNode<Key, T> *>(t._nil));
+template <typename Key, typename T, typename Less> auto end(const RBTree<Key, T, Less> &t) {
+    return Iterator<Key, T, true, Less>(t, static_cast<const RBNode<Key, T> *>(t._nil));
 }
 
-template <typename Key, typename T> auto end(RBTree<Key, T> &t) {
-    return Iterator<Key, T, false>(t, static_cast<RBNode<Key, T> *>(t._nil));
+template <typename Key, typename T, typename Less> auto end(RBTree<Key, T, Less> &t) {
+    return Iterator<Key, T, false, Less>(t, static_cast<RBNode<Key, T> *>(t._nil));
 }
 
-template <typename Key, typename T, bool is_const>
-Iterator<Key, T, is_const> &Iterator<Key, T, is_const>::operator++() {
-    _node = internal::next_inorder_node<Key, T, is_const>(*_tree, _node);
+template <typename Key, typename T, bool is_const, typename Less>
+Iterator<Key, T, is_const, Less> &Iterator<Key, T, is_const, Less>::operator++() {
+    _node = internal::next_inorder_node<Key, T, Less, is_const>(*_tree, _node);
     return *this;
 }
 
-template <typename Key, typename T, bool is_const>
-Iterator<Key, T, is_const> Iterator<Key, T, is_const>::operator++(int) {
-    Iterator<Key, T, is_const> saved(*this);
+template <typename Key, typename T, bool is_const, typename Less>
+Iterator<Key, T, is_const, Less> Iterator<Key, T, is_const, Less>::operator++(int) {
+    Iterator<Key, T, is_const, Less> saved(*this);
     this->operator++();
     return saved;
 }
 
-template <typename Key, typename T, bool is_const>
-Iterator<Key, T, is_const> &Iterator<Key, T, is_const>::operator--() {
+template <typename Key, typename T, bool is_const, typename Less>
+Iterator<Key, T, is_const, Less> &Iterator<Key, T, is_const, Less>::operator--() {
     if (is_nil_node(*_tree, _node)) {
-        _node = internal::max_node_of_subtree<Key, T, is_const>(*_tree, _tree->_root);
+        _node = internal::max_node_of_subtree<Key, T, Less, is_const>(*_tree, _tree->_root);
     } else {
-        _node = internal::prev_inorder_node<Key, T, is_const>(*_tree, _node);
+        _node = internal::prev_inorder_node<Key, T, Less, is_const>(*_tree, _node);
     }
     return *this;
 }
 
-template <typename Key, typename T, bool is_const>
-Iterator<Key, T, is_const> Iterator<Key, T, is_const>::operator--(int) {
-    Iterator<Key, T, is_const> saved(*this);
+template <typename Key, typename T, bool is_const, typename Less>
+Iterator<Key, T, is_const, Less> Iterator<Key, T, is_const, Less>::operator--(int) {
+    Iterator<Key, T, is_const, Less> saved(*this);
     this->operator--();
     return saved;
 }
 
-template <typename Key, typename T> constexpr size_t node_size(const RBTree<Key, T> &) {
+/// Size of each node. Nodes are allocated in chunks, so this is the per-element memory cost of the tree.
+template <typename Key, typename T, typename Less> constexpr size_t node_size(const RBTree<Key, T, Less> &) {
     return sizeof(RBNode<Key, T>);
 }
 
 /// Represents the result of `get` and `set` operations.
-template <typename Key, typename T, bool is_const> struct Result {
+template <typename Key, typename T, bool is_const, typename Less = std::less<Key>> struct Result {
     bool key_was_present = false;
-    Iterator<Key, T, is_const> i;
+    Iterator<Key, T, is_const, Less> i;
 };
 
-/// Deletes all nodes in the RBTree
-template <typename Key, typename T> void clear(RBTree<Key, T> &rbt) {
+/// Deletes all nodes in the RBTree. The node chunks are returned to the tree's allocator, one deallocation
+/// per chunk. Destructors of keys and values are only called if they are not trivial.
+template <typename Key, typename T, typename Less> void clear(RBTree<Key, T, Less> &rbt) {
     internal::delete_all_nodes(rbt, false);
 }
 
-template <typename Key, typename T> Result<Key, T, false> get(RBTree<Key, T> &rbt, const Key &k) {
-    auto node = internal::find<Key, T, false>(rbt, k);
+/// Replaces the contents of the tree with the given `n` key-value pairs. The keys must be in strictly
+/// increasing order. Builds the balanced tree directly in O(n), without any rotations, and the nodes are
+/// allocated contiguously in key order so that iterating over the tree afterwards walks memory forwards.
+template <typename Key, typename T, typename Less>
+void build_from_sorted(RBTree<Key, T, Less> &t, const Key *keys, const T *values, u32 n) {
+    internal::delete_all_nodes(t, false);
+
+    if (n == 0) {
+        return;
+    }
+
+    internal::pool_add_chunk(t._pool, *t._allocator, n);
+    RBNode<Key, T> *nodes = static_cast<RBNode<Key, T> *>(internal::pool_allocate(t._pool, *t._allocator));
+    new (nodes) RBNode<Key, T>(keys[0], values[0]);
+
+    for (u32 i = 1; i < n; ++i) {
+        assert(t._less(keys[i - 1], keys[i]) && "Keys must be sorted and unique");
+        new (internal::pool_allocate(t._pool, *t._allocator)) RBNode<Key, T>(keys[i], values[i]);
+    }
+
+    // Splitting at the middle puts every nil child on the last two levels. If the last level is not full, its
+    // nodes are colored red so that every path has the same number of black nodes.
+    u32 height = 0;
+    while (height < 32 && (u64(1) << height) - 1 < n) {
+        ++height;
+    }
+    const u32 red_depth = (u64(1) << height) - 1 == n ? ~u32(0) : height - 1;
+
+    t._root = internal::link_sorted(t, nodes, 0, n, 0, red_depth);
+    t._root->_parent = static_cast<RBNode<Key, T> *>(t._nil);
+    t._size = n;
+}
+
+template <typename Key, typename T, typename Less>
+Result<Key, T, false, Less> get(RBTree<Key, T, Less> &rbt, const Key &k) {
+    auto node = internal::find<Key, T, Less, false>(rbt, k);
     if (is_nil_node(rbt, node)) {
-        return Result<Key, T, false>{ false, end(rbt) };
+        return Result<Key, T, false, Less>{ false, end(rbt) };
     }
-    return Result<Key, T, false>{ true, Iterator<Key, T, false>(rbt, node) };
+    return Result<Key, T, false, Less>{ true, Iterator<Key, T, false, Less>(rbt, node) };
 }
 
-template <typename Key, typename T> Result<Key, T, true> get_const(const RBTree<Key, T> &rbt, const Key &k) {
-    auto node = internal::find<Key, T, true>(rbt, k);
+template <typename Key, typename T, typename Less>
+Result<Key, T, true, Less> get_const(const RBTree<Key, T, Less> &rbt, const Key &k) {
+    auto node = internal::find<Key, T, Less, true>(rbt, k);
     if (is_nil_node(rbt, node)) {
-        return Result<Key, T, true>{ false, end(rbt) };
+        return Result<Key, T, true, Less>{ false, end(rbt) };
     }
-    return Result<Key, T, true>{ true, Iterator<Key, T, true>(rbt, node) };
+    return Result<Key, T, true, Less>{ true, Iterator<Key, T, true, Less>(rbt, node) };
 }
 
-template <typename Key, typename T> Result<Key, T, true> get(const RBTree<Key, T> &rbt, Key k) {
+template <typename Key, typename T, typename Less>
+Result<Key, T, true, Less> get(const RBTree<Key, T, Less> &rbt, Key k) {
     return get_const(rbt, k);
 }
 
-template <typename Key, typename T> Result<Key, T, false> set(RBTree<Key, T> &rbt, Key k, T v) {
+/// Returns an iterator to the first node whose key is not less than `k`, or `end(t)`.
+template <typename Key, typename T, typename Less>
+Iterator<Key, T, true, Less> lower_bound(const RBTree<Key, T, Less> &t, const Key &k) {
+    return Iterator<Key, T, true, Less>(t, internal::bound<Key, T, Less, true, false>(t, k));
+}
+
+template <typename Key, typename T, typename Less>
+Iterator<Key, T, false, Less> lower_bound(RBTree<Key, T, Less> &t, const Key &k) {
+    return Iterator<Key, T, false, Less>(t, internal::bound<Key, T, Less, false, false>(t, k));
+}
+
+/// Returns an iterator to the first node whose key is greater than `k`, or `end(t)`.
+template <typename Key, typename T, typename Less>
+Iterator<Key, T, true, Less> upper_bound(const RBTree<Key, T, Less> &t, const Key &k) {
+    return Iterator<Key, T, true, Less>(t, internal::bound<Key, T, Less, true, true>(t, k));
+}
+
+template <typename Key, typename T, typename Less>
+Iterator<Key, T, false, Less> upper_bound(RBTree<Key, T, Less> &t, const Key &k) {
+    return Iterator<Key, T, false, Less>(t, internal::bound<Key, T, Less, false, true>(t, k));
+}
+
+/// A range of nodes in key order, as returned by `range`. Can be used in a range-based for loop.
+template <typename Key, typename T, bool is_const, typename Less = std::less<Key>> struct Range {
+    Iterator<Key, T, is_const, Less> _first;
+    Iterator<Key, T, is_const, Less> _last;
+};
+
+template <typename Key, typename T, bool is_const, typename Less>
+Iterator<Key, T, is_const, Less> begin(const Range<Key, T, is_const, Less> &r) {
+    return r._first;
+}
+
+template <typename Key, typename T, bool is_const, typename Less>
+Iterator<Key, T, is_const, Less> end(const Range<Key, T, is_const, Less> &r) {
+    return r._last;
+}
+
+/// Returns the nodes with keys in `[lo, hi)`.
+template <typename Key, typename T, typename Less>
+Range<Key, T, true, Less> range(const RBTree<Key, T, Less> &t, const Key &lo, const Key &hi) {
+    assert(!t._less(hi, lo));
+    return Range<Key, T, true, Less>{ lower_bound(t, lo), lower_bound(t, hi) };
+}
+
+template <typename Key, typename T, typename Less>
+Range<Key, T, false, Less> range(RBTree<Key, T, Less> &t, const Key &lo, const Key &hi) {
+    assert(!t._less(hi, lo));
+    return Range<Key, T, false, Less>{ lower_bound(t, lo), lower_bound(t, hi) };
+}
+
+/// Returns the number of keys less than `k`. O(log n), each node keeps the size of its subtree.
+template <typename Key, typename T, typename Less> u32 rank(const RBTree<Key, T, Less> &t, const Key &k) {
+    u32 r = 0;
+    auto cur_node = t._root;
+    while (!is_nil_node(t, cur_node)) {
+        if (t._less(cur_node->k, k)) {
+            r += cur_node->_childs[LEFT]->_count + 1;
+            cur_node = cur_node->_childs[RIGHT];
+        } else {
+            cur_node = cur_node->_childs[LEFT];
+        }
+    }
+    return r;
+}
+
+/// Returns an iterator to the node at in-order position `i`, or `end(t)` if `i >= size(t)`. O(log n).
+template <typename Key, typename T, typename Less>
+Iterator<Key, T, true, Less> select(const RBTree<Key, T, Less> &t, u32 i) {
+    return Iterator<Key, T, true, Less>(t, internal::select_node<Key, T, Less, true>(t, i));
+}
+
+template <typename Key, typename T, typename Less>
+Iterator<Key, T, false, Less> select(RBTree<Key, T, Less> &t, u32 i) {
+    return Iterator<Key, T, false, Less>(t, internal::select_node<Key, T, Less, false>(t, i));
+}
+
+template <typename Key, typename T, typename Less>
+Result<Key, T, false, Less> set(RBTree<Key, T, Less> &rbt, Key k, T v) {
     if (is_nil_node(rbt, rbt._root)) {
-        rbt._root = make_new<RBNode<Key, T>>(*rbt._allocator, std::move(k), std::move(v));
+        rbt._root = internal::new_node(rbt, std::move(k), std::move(v));
         rbt._root->_childs[0] = static_cast<RBNode<Key, T> *>(rbt._nil);
         rbt._root->_childs[1] = static_cast<RBNode<Key, T> *>(rbt._nil);
         rbt._root->_parent = static_cast<RBNode<Key, T> *>(rbt._nil);
-        return Result<Key, T, false>{ false, Iterator<Key, T, false>(rbt, rbt._root) };
+        rbt._root->_count = 1;
+        rbt._size = 1;
+        return Result<Key, T, false, Less>{ false, Iterator<Key, T, false, Less>(rbt, rbt._root) };
     }
 
-    Result<Key, T, false> result{ false, end(rbt) };
+    Result<Key, T, false, Less> result{ false, end(rbt) };
 
     auto cur = rbt._root;
     auto par = rbt._root;
@@ -590,19 +947,22 @@ template <typename Key, typename T> Result<Key, T, false> set(RBTree<Key, T> &rb
             cur->k = std::move(k);
             cur->v = std::move(v);
             result.key_was_present = true;
-            result.i = Iterator<Key, T, false>(rbt, cur);
+            result.i = Iterator<Key, T, false, Less>(rbt, cur);
 
             return result;
         }
     }
 
-    auto n = make_new<RBNode<Key, T>>(*rbt._allocator, std::move(k), std::move(v));
-    result.i = Iterator<Key, T, false>(rbt, n);
+    auto n = internal::new_node(rbt, std::move(k), std::move(v));
+    result.i = Iterator<Key, T, false, Less>(rbt, n);
     n->_color = RED;
     n->_parent = par;
     n->_childs[LEFT] = static_cast<RBNode<Key, T> *>(rbt._nil);
     n->_childs[RIGHT] = static_cast<RBNode<Key, T> *>(rbt._nil);
     par->_childs[dir] = n;
+    n->_count = 1;
+    internal::add_to_counts_up_to_root(rbt, par, 1);
+    ++rbt._size;
 
     // bottom-up fix
     while (n->_parent->_color == RED) {
@@ -620,17 +980,20 @@ template <typename Key, typename T> Result<Key, T, false> set(RBTree<Key, T> &rb
 
 // xyspoon: Too much duplication of code. Clean this up. Make set and set_default use the same function before
 // fixup.
-template <typename Key, typename T> Result<Key, T, false> set_default(RBTree<Key, T> &rbt, Key k, T v) {
+template <typename Key, typename T, typename Less>
+Result<Key, T, false, Less> set_default(RBTree<Key, T, Less> &rbt, Key k, T v) {
     if (is_nil_node(rbt, rbt._root)) {
-        rbt._root = make_new<RBNode<Key, T>>(*rbt._allocator, std::move(k), std::move(v));
+        rbt._root = internal::new_node(rbt, std::move(k), std::move(v));
         rbt._root->_childs[0] = reinterpret_cast<RBNode<Key, T> *>(rbt._nil);
         rbt._root->_childs[1] = reinterpret_cast<RBNode<Key, T> *>(rbt._nil);
         rbt._root->_parent = reinterpret_cast<RBNode<Key, T> *>(rbt._nil);
+        rbt._root->_count = 1;
+        rbt._size = 1;
 
-        return Result<Key, T, false>{ false, Iterator<Key, T, false>(rbt, rbt._root) };
+        return Result<Key, T, false, Less>{ false, Iterator<Key, T, false, Less>(rbt, rbt._root) };
     }
 
-    Result<Key, T, false> result{ false, end(rbt) };
+    Result<Key, T, false, Less> result{ false, end(rbt) };
 
     auto cur = rbt._root;
     auto par = rbt._root;
@@ -641,24 +1004,27 @@ template <typename Key, typename T> Result<Key, T, false> set_default(RBTree<Key
         if (rbt._less(k, cur->k)) {
             cur = cur->_childs[LEFT];
             dir = LEFT;
-        } else if (k > cur->k) {
+        } else if (rbt._less(cur->k, k)) {
             cur = cur->_childs[RIGHT];
             dir = RIGHT;
         } else {
             // The only place in the code where it's different from `set`. Yuck. Factor this.
             result.key_was_present = true;
-            result.i = Iterator<Key, T, false>(rbt, cur);
+            result.i = Iterator<Key, T, false, Less>(rbt, cur);
             return result;
         }
     }
 
-    auto n = make_new<RBNode<Key, T>>(*rbt._allocator, std::move(k), std::move(v));
-    result.i = Iterator<Key, T, false>(rbt, n);
+    auto n = internal::new_node(rbt, std::move(k), std::move(v));
+    result.i = Iterator<Key, T, false, Less>(rbt, n);
     n->_color = RED;
     n->_parent = par;
     n->_childs[LEFT] = static_cast<RBNode<Key, T> *>(rbt._nil);
     n->_childs[RIGHT] = static_cast<RBNode<Key, T> *>(rbt._nil);
     par->_childs[dir] = n;
+    n->_count = 1;
+    internal::add_to_counts_up_to_root(rbt, par, 1);
+    ++rbt._size;
 
     // bottom-up fix
     while (n->_parent->_color == RED) {
@@ -673,11 +1039,12 @@ template <typename Key, typename T> Result<Key, T, false> set_default(RBTree<Key
 }
 
 // Removes the node with the given key.
-template <typename Key, typename T> Result<Key, T, false> remove(RBTree<Key, T> &t, Key k) {
-    auto n = internal::find<Key, T, false>(t, k);
+template <typename Key, typename T, typename Less>
+Result<Key, T, false, Less> remove(RBTree<Key, T, Less> &t, Key k) {
+    auto n = internal::find<Key, T, Less, false>(t, k);
 
     if (is_nil_node(t, n)) {
-        return Result<Key, T, false>{ false, end(t) };
+        return Result<Key, T, false, Less>{ false, end(t) };
     }
 
     assert(t._equal(n->k, k));
@@ -686,9 +1053,11 @@ template <typename Key, typename T> Result<Key, T, false> remove(RBTree<Key, T>
     auto orig_color = n->_color;
     RBNode<Key, T> *x;
     if (is_nil_node(t, n->_childs[LEFT])) {
+        internal::add_to_counts_up_to_root(t, n->_parent, -1);
         x = n->_childs[RIGHT];
         transplant(t, n, n->_childs[RIGHT]);
     } else if (is_nil_node(t, n->_childs[RIGHT])) {
+        internal::add_to_counts_up_to_root(t, n->_parent, -1);
         x = n->_childs[LEFT];
         transplant(t, n, n->_childs[LEFT]);
     } else {
@@ -699,6 +1068,8 @@ template <typename Key, typename T> Result<Key, T, false> remove(RBTree<Key, T>
         }
         y = min;
         orig_color = y->_color;
+        // The successor takes the place of the removed node, so everything from its old parent up loses one
+        internal::add_to_counts_up_to_root(t, y->_parent, -1);
         x = y->_childs[RIGHT];
         if (y->_parent == n) {
             x->_parent = y;
@@ -711,6 +1082,7 @@ template <typename Key, typename T> Result<Key, T, false> remove(RBTree<Key, T>
         y->_childs[LEFT] = n->_childs[LEFT];
         y->_childs[LEFT]->_parent = y;
         y->_color = n->_color;
+        y->_count = n->_count;
     }
 
     if (orig_color != RED) {
@@ -726,9 +1098,10 @@ template <typename Key, typename T> Result<Key, T, false> remove(RBTree<Key, T>
     }
 
     // Delete the node
-    make_delete(*t._allocator, n);
+    internal::delete_node(t, n);
+    --t._size;
 
-    return Result<Key, T, false>{ true, end(t) };
+    return Result<Key, T, false, Less>{ true, end(t) };
 }
 
 } // namespace rbt
@@ -0,0 +1,445 @@
+// Union, intersection and difference of red-black trees, built on `split` and `join` as described in "Just
+// Join for Parallel Ordered Sets" (Blelloch, Ferizovic, Sun). With sizes m <= n these take O(m log(n/m + 1))
+// instead of the O(m log n) of doing a `get` or `set` per element, and the two halves of each step are
+// independent so they can run on separate threads. When one tree is much smaller than the other, updating the
+// larger one key by key is still faster, and union and difference do that instead.
+
+#pragma once
+
+#include <scaffold/ordered_map.h>
+#include <scaffold/rbt.h>
+
+#include <thread>
+
+namespace fo {
+namespace rbt {
+
+/// Adds the keys of `b` that are not in `a` to `a`, copying their nodes. Keys in both trees keep the value
+/// they have in `a`. With `num_threads > 1`, large subproblems are run on separate threads, in which case the
+/// allocator of `a` must be thread-safe.
+template <typename Key, typename T, typename Less>
+void set_union(RBTree<Key, T, Less> &a, const RBTree<Key, T, Less> &b, u32 num_threads = 1);
+
+/// Removes the keys that are not in `b` from `a`.
+template <typename Key, typename T, typename Less>
+void set_intersection(RBTree<Key, T, Less> &a, const RBTree<Key, T, Less> &b, u32 num_threads = 1);
+
+/// Removes the keys that are in `b` from `a`.
+template <typename Key, typename T, typename Less>
+void set_difference(RBTree<Key, T, Less> &a, const RBTree<Key, T, Less> &b, u32 num_threads = 1);
+
+} // namespace rbt
+
+// Same as above, for OrderedMap.
+
+template <typename Key, typename Value, typename Less>
+void set_union(OrderedMap<Key, Value, Less> &a, const OrderedMap<Key, Value, Less> &b, u32 num_threads = 1) {
+    rbt::set_union(a._rbt, b._rbt, num_threads);
+}
+
+template <typename Key, typename Value, typename Less>
+void set_intersection(OrderedMap<Key, Value, Less> &a,
+                      const OrderedMap<Key, Value, Less> &b,
+                      u32 num_threads = 1) {
+    rbt::set_intersection(a._rbt, b._rbt, num_threads);
+}
+
+template <typename Key, typename Value, typename Less>
+void set_difference(OrderedMap<Key, Value, Less> &a,
+                    const OrderedMap<Key, Value, Less> &b,
+                    u32 num_threads = 1) {
+    rbt::set_difference(a._rbt, b._rbt, num_threads);
+}
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+namespace rbt {
+namespace internal {
+
+// Subproblems with fewer nodes than this, counting both trees, are not handed to another thread.
+constexpr u32 SET_OP_MIN_PARALLEL_SIZE = 1u << 14;
+
+// When `b` is this many times smaller than `a`, union and difference just insert or remove its keys one by
+// one. Splitting and joining rewrites every node along the split paths, and reads the subtree sizes of their
+// siblings, so the asymptotic win only shows once `b` is a sizable fraction of `a`.
+constexpr u32 SET_OP_SMALL_RATIO = 32;
+
+// The root of a tree taken apart from `a` and its black height, counting the black nodes on a path down to
+// (but not including) nil. The root itself can be red.
+template <typename Key, typename T> struct Subtree {
+    RBNode<Key, T> *root;
+    u32 black_height;
+};
+
+template <typename Key, typename T, typename Less> struct SetOpContext {
+    RBTree<Key, T, Less> *a;
+    const RBTree<Key, T, Less> *b;
+
+    // Nodes are allocated from and freed to this pool. Each thread uses its own.
+    NodePool<Key, T> *pool;
+
+    // Threads the current call is allowed to use, counting itself
+    u32 num_threads;
+};
+
+template <typename Key, typename T, typename Less>
+u32 black_height(const RBTree<Key, T, Less> &t, const RBNode<Key, T> *n) {
+    u32 h = 0;
+    for (; !is_nil_node(t, n); n = n->_childs[LEFT]) {
+        h += n->_color == BLACK ? 1 : 0;
+    }
+    return h;
+}
+
+// Makes `n` the root of a subtree with the given children and color.
+template <typename Key, typename T, typename Less>
+RBNode<Key, T> *make_node(const SetOpContext<Key, T, Less> &c,
+                          RBNode<Key, T> *l,
+                          RBNode<Key, T> *n,
+                          RBNode<Key, T> *r,
+                          Color color) {
+    n->_childs[LEFT] = l;
+    n->_childs[RIGHT] = r;
+    // Never writing to the nil node, it's shared by the threads.
+    if (!is_nil_node(*c.a, l)) {
+        l->_parent = n;
+    }
+    if (!is_nil_node(*c.a, r)) {
+        r->_parent = n;
+    }
+    n->_color = color;
+    n->_count = l->_count + r->_count + 1;
+    return n;
+}
+
+// Rotates the `dir` child of `x` up in its place and returns it.
+template <typename Key, typename T, typename Less>
+RBNode<Key, T> *rotate_up(const SetOpContext<Key, T, Less> &c, RBNode<Key, T> *x, Arrow dir) {
+    RBNode<Key, T> *y = x->_childs[dir];
+    if (dir == RIGHT) {
+        make_node(c, x->_childs[LEFT], x, y->_childs[LEFT], x->_color);
+        return make_node(c, x, y, y->_childs[RIGHT], y->_color);
+    }
+    make_node(c, y->_childs[RIGHT], x, x->_childs[RIGHT], x->_color);
+    return make_node(c, y->_childs[LEFT], y, x, y->_color);
+}
+
+// Joins the taller tree `t` with `k` and the shorter tree `s` by going down along the `dir` side of `t` until
+// reaching a black node with the same black height as `s`. `dir` is RIGHT if `t` holds the smaller keys.
+template <typename Key, typename T, typename Less>
+RBNode<Key, T> *join_down(const SetOpContext<Key, T, Less> &c,
+                          Arrow dir,
+                          RBNode<Key, T> *t,
+                          u32 t_bh,
+                          RBNode<Key, T> *k,
+                          RBNode<Key, T> *s,
+                          u32 s_bh) {
+    if (t->_color == BLACK && t_bh == s_bh) {
+        return dir == RIGHT ? make_node(c, t, k, s, RED) : make_node(c, s, k, t, RED);
+    }
+
+    const u32 child_bh = t_bh - (t->_color == BLACK ? 1 : 0);
+    RBNode<Key, T> *child = join_down(c, dir, t->_childs[dir], child_bh, k, s, s_bh);
+
+    if (dir == RIGHT) {
+        make_node(c, t->_childs[LEFT], t, child, t->_color);
+    } else {
+        make_node(c, child, t, t->_childs[RIGHT], t->_color);
+    }
+
+    if (t->_color == BLACK && child->_color == RED && child->_childs[dir]->_color == RED) {
+        child->_childs[dir]->_color = BLACK;
+        return rotate_up(c, t, dir);
+    }
+    return t;
+}
+
+// Returns the tree with the keys of `l`, then `k`, then the keys of `r`.
+template <typename Key, typename T, typename Less>
+Subtree<Key, T>
+join(const SetOpContext<Key, T, Less> &c, Subtree<Key, T> l, RBNode<Key, T> *k, Subtree<Key, T> r) {
+    if (l.black_height > r.black_height) {
+        RBNode<Key, T> *t = join_down(c, RIGHT, l.root, l.black_height, k, r.root, r.black_height);
+        if (t->_color == RED && t->_childs[RIGHT]->_color == RED) {
+            t->_color = BLACK;
+            return Subtree<Key, T>{ t, l.black_height + 1 };
+        }
+        return Subtree<Key, T>{ t, l.black_height };
+    }
+
+    if (r.black_height > l.black_height) {
+        RBNode<Key, T> *t = join_down(c, LEFT, r.root, r.black_height, k, l.root, l.black_height);
+        if (t->_color == RED && t->_childs[LEFT]->_color == RED) {
+            t->_color = BLACK;
+            return Subtree<Key, T>{ t, r.black_height + 1 };
+        }
+        return Subtree<Key, T>{ t, r.black_height };
+    }
+
+    if (l.root->_color == BLACK && r.root->_color == BLACK) {
+        return Subtree<Key, T>{ make_node(c, l.root, k, r.root, RED), l.black_height };
+    }
+    return Subtree<Key, T>{ make_node(c, l.root, k, r.root, BLACK), l.black_height + 1 };
+}
+
+// Takes the last node out of `t`, leaving the others in `rest`.
+template <typename Key, typename T, typename Less>
+RBNode<Key, T> *split_last(const SetOpContext<Key, T, Less> &c, Subtree<Key, T> t, Subtree<Key, T> &rest) {
+    RBNode<Key, T> *m = t.root;
+    const u32 child_bh = t.black_height - (m->_color == BLACK ? 1 : 0);
+    const Subtree<Key, T> l{ m->_childs[LEFT], child_bh };
+
+    if (is_nil_node(*c.a, m->_childs[RIGHT])) {
+        rest = l;
+        return m;
+    }
+
+    RBNode<Key, T> *last = split_last(c, Subtree<Key, T>{ m->_childs[RIGHT], child_bh }, rest);
+    rest = join(c, l, m, rest);
+    return last;
+}
+
+// Join without a middle node.
+template <typename Key, typename T, typename Less>
+Subtree<Key, T> join2(const SetOpContext<Key, T, Less> &c, Subtree<Key, T> l, Subtree<Key, T> r) {
+    if (is_nil_node(*c.a, l.root)) {
+        return r;
+    }
+    if (is_nil_node(*c.a, r.root)) {
+        return l;
+    }
+    Subtree<Key, T> rest;
+    RBNode<Key, T> *last = split_last(c, l, rest);
+    return join(c, rest, last, r);
+}
+
+template <typename Key, typename T> struct Split {
+    Subtree<Key, T> l;
+    RBNode<Key, T> *found; // The node with the key, or nullptr
+    Subtree<Key, T> r;
+};
+
+// Splits `t` into the keys less than `k`, the node with key `k` if there is one, and the keys greater than
+// `k`.
+template <typename Key, typename T, typename Less>
+Split<Key, T> split(const SetOpContext<Key, T, Less> &c, Subtree<Key, T> t, const Key &k) {
+    if (is_nil_node(*c.a, t.root)) {
+        return Split<Key, T>{ t, nullptr, t };
+    }
+
+    RBNode<Key, T> *m = t.root;
+    const u32 child_bh = t.black_height - (m->_color == BLACK ? 1 : 0);
+    const Subtree<Key, T> l{ m->_childs[LEFT], child_bh };
+    const Subtree<Key, T> r{ m->_childs[RIGHT], child_bh };
+
+    if (c.a->_less(k, m->k)) {
+        Split<Key, T> s = split(c, l, k);
+        s.r = join(c, s.r, m, r);
+        return s;
+    }
+    if (c.a->_less(m->k, k)) {
+        Split<Key, T> s = split(c, r, k);
+        s.l = join(c, l, m, s.l);
+        return s;
+    }
+    return Split<Key, T>{ l, m, r };
+}
+
+template <typename Key, typename T, typename Less>
+RBNode<Key, T> *copy_node(const SetOpContext<Key, T, Less> &c, const RBNode<Key, T> *n) {
+    return new (pool_allocate(*c.pool, *c.a->_allocator)) RBNode<Key, T>(n->k, n->v);
+}
+
+// Copies a subtree of `b`, keeping its shape and colors.
+template <typename Key, typename T, typename Less>
+RBNode<Key, T> *copy_subtree(const SetOpContext<Key, T, Less> &c, const RBNode<Key, T> *n) {
+    if (is_nil_node(*c.b, n)) {
+        return static_cast<RBNode<Key, T> *>(c.a->_nil);
+    }
+    RBNode<Key, T> *l = copy_subtree(c, n->_childs[LEFT]);
+    RBNode<Key, T> *copy = copy_node(c, n);
+    RBNode<Key, T> *r = copy_subtree(c, n->_childs[RIGHT]);
+    return make_node(c, l, copy, r, n->_color);
+}
+
+template <typename Key, typename T, typename Less>
+void free_node(const SetOpContext<Key, T, Less> &c, RBNode<Key, T> *n) {
+    n->~RBNode<Key, T>();
+    pool_deallocate(*c.pool, n);
+}
+
+template <typename Key, typename T, typename Less>
+void free_subtree(const SetOpContext<Key, T, Less> &c, RBNode<Key, T> *n) {
+    if (is_nil_node(*c.a, n)) {
+        return;
+    }
+    free_subtree(c, n->_childs[LEFT]);
+    free_subtree(c, n->_childs[RIGHT]);
+    free_node(c, n);
+}
+
+// Calls `left(c)` and `right(c)`. If the context has threads to spare and `size` is large enough, `left` runs
+// on a new thread, with its own node pool that is merged back afterwards.
+template <typename Key, typename T, typename Less, typename LeftFn, typename RightFn>
+void fork_join(const SetOpContext<Key, T, Less> &c, u32 size, LeftFn left, RightFn right) {
+    if (c.num_threads < 2 || size < SET_OP_MIN_PARALLEL_SIZE) {
+        left(c);
+        right(c);
+        return;
+    }
+
+    NodePool<Key, T> left_pool;
+
+    SetOpContext<Key, T, Less> left_c = c;
+    left_c.pool = &left_pool;
+    left_c.num_threads = c.num_threads / 2;
+
+    SetOpContext<Key, T, Less> right_c = c;
+    right_c.num_threads = c.num_threads - left_c.num_threads;
+
+    std::thread thread([&]() { left(left_c); });
+    right(right_c);
+    thread.join();
+
+    pool_merge(*c.pool, left_pool);
+}
+
+template <typename Key, typename T, typename Less>
+Subtree<Key, T> set_union(const SetOpContext<Key, T, Less> &c,
+                          Subtree<Key, T> t1,
+                          const RBNode<Key, T> *t2,
+                          u32 t2_bh) {
+    if (is_nil_node(*c.b, t2)) {
+        return t1;
+    }
+    if (is_nil_node(*c.a, t1.root)) {
+        return Subtree<Key, T>{ copy_subtree(c, t2), t2_bh };
+    }
+
+    const Split<Key, T> s = split(c, t1, t2->k);
+    const u32 child_bh = t2_bh - (t2->_color == BLACK ? 1 : 0);
+
+    Subtree<Key, T> l, r;
+    fork_join(c,
+              t1.root->_count + t2->_count,
+              [&](const auto &sub) { l = set_union(sub, s.l, t2->_childs[LEFT], child_bh); },
+              [&](const auto &sub) { r = set_union(sub, s.r, t2->_childs[RIGHT], child_bh); });
+
+    return join(c, l, s.found ? s.found : copy_node(c, t2), r);
+}
+
+template <typename Key, typename T, typename Less>
+Subtree<Key, T> set_intersection(const SetOpContext<Key, T, Less> &c,
+                                 Subtree<Key, T> t1,
+                                 const RBNode<Key, T> *t2,
+                                 u32 t2_bh) {
+    if (is_nil_node(*c.a, t1.root)) {
+        return t1;
+    }
+    if (is_nil_node(*c.b, t2)) {
+        free_subtree(c, t1.root);
+        return Subtree<Key, T>{ static_cast<RBNode<Key, T> *>(c.a->_nil), 0 };
+    }
+
+    const Split<Key, T> s = split(c, t1, t2->k);
+    const u32 child_bh = t2_bh - (t2->_color == BLACK ? 1 : 0);
+
+    Subtree<Key, T> l, r;
+    fork_join(c,
+              t1.root->_count + t2->_count,
+              [&](const auto &sub) { l = set_intersection(sub, s.l, t2->_childs[LEFT], child_bh); },
+              [&](const auto &sub) { r = set_intersection(sub, s.r, t2->_childs[RIGHT], child_bh); });
+
+    return s.found ? join(c, l, s.found, r) : join2(c, l, r);
+}
+
+template <typename Key, typename T, typename Less>
+Subtree<Key, T> set_difference(const SetOpContext<Key, T, Less> &c,
+                               Subtree<Key, T> t1,
+                               const RBNode<Key, T> *t2,
+                               u32 t2_bh) {
+    if (is_nil_node(*c.a, t1.root) || is_nil_node(*c.b, t2)) {
+        return t1;
+    }
+
+    const Split<Key, T> s = split(c, t1, t2->k);
+    const u32 child_bh = t2_bh - (t2->_color == BLACK ? 1 : 0);
+
+    Subtree<Key, T> l, r;
+    fork_join(c,
+              t1.root->_count + t2->_count,
+              [&](const auto &sub) { l = set_difference(sub, s.l, t2->_childs[LEFT], child_bh); },
+              [&](const auto &sub) { r = set_difference(sub, s.r, t2->_childs[RIGHT], child_bh); });
+
+    if (s.found) {
+        free_node(c, s.found);
+    }
+    return join2(c, l, r);
+}
+
+// Calls the set operation `op` on the whole trees and makes the result the tree of `a`.
+template <typename Key, typename T, typename Less, typename Op>
+void run_set_op(RBTree<Key, T, Less> &a, const RBTree<Key, T, Less> &b, u32 num_threads, Op op) {
+    const SetOpContext<Key, T, Less> c{ &a, &b, &a._pool, num_threads };
+
+    const Subtree<Key, T> t1{ a._root, black_height(a, a._root) };
+    const Subtree<Key, T> t = op(c, t1, b._root, black_height(b, b._root));
+
+    a._root = t.root;
+    if (!is_nil_node(a, a._root)) {
+        a._root->_parent = static_cast<RBNode<Key, T> *>(a._nil);
+        a._root->_color = BLACK;
+    }
+    a._size = a._root->_count;
+}
+
+} // namespace internal
+
+template <typename Key, typename T, typename Less>
+void set_union(RBTree<Key, T, Less> &a, const RBTree<Key, T, Less> &b, u32 num_threads) {
+    if (&a == &b) {
+        return;
+    }
+    if (u64(size(b)) * internal::SET_OP_SMALL_RATIO < size(a)) {
+        for (auto &node : b) {
+            set_default(a, node.k, node.v);
+        }
+        return;
+    }
+    internal::run_set_op(a, b, num_threads, [](auto &c, auto t1, auto t2, u32 t2_bh) {
+        return internal::set_union(c, t1, t2, t2_bh);
+    });
+}
+
+template <typename Key, typename T, typename Less>
+void set_intersection(RBTree<Key, T, Less> &a, const RBTree<Key, T, Less> &b, u32 num_threads) {
+    if (&a == &b) {
+        return;
+    }
+    internal::run_set_op(a, b, num_threads, [](auto &c, auto t1, auto t2, u32 t2_bh) {
+        return internal::set_intersection(c, t1, t2, t2_bh);
+    });
+}
+
+template <typename Key, typename T, typename Less>
+void set_difference(RBTree<Key, T, Less> &a, const RBTree<Key, T, Less> &b, u32 num_threads) {
+    if (&a == &b) {
+        clear(a);
+        return;
+    }
+    if (u64(size(b)) * internal::SET_OP_SMALL_RATIO < size(a)) {
+        for (auto &node : b) {
+            remove(a, node.k);
+        }
+        return;
+    }
+    internal::run_set_op(a, b, num_threads, [](auto &c, auto t1, auto t2, u32 t2_bh) {
+        return internal::set_difference(c, t1, t2, t2_bh);
+    });
+}
+
+} // namespace rbt
+} // namespace fo
@@ -0,0 +1,228 @@
+/// An append-mostly array stored in fixed-size chunks. Growing allocates one more chunk and never moves the
+/// items already there, so pointers to items stay valid, and growing a multi-gigabyte array doesn't need a
+/// second copy of it in memory. Indexing is a shift and a mask into the table of chunks.
+///
+/// Chunks hold `CHUNK_ITEMS` items, a power of two, which by default makes a chunk about 64 KiB. They are
+/// all the same size, so a `PoolAllocator` with `CHUNK_BYTES` nodes serves them well. The table of chunk
+/// pointers is an `Array` on its own allocator, since a pool allocator can't reallocate.
+///
+/// The chunks are independent blocks, so they're the natural unit to split work on: `num_chunks`,
+/// `chunk_data` and `chunk_size` let e.g. `jobs::parallel_for` hand out whole chunks.
+///
+/// Items follow the same rules as the items of an `Array`.
+#pragma once
+
+#include <scaffold/array.h>
+#include <scaffold/const_log.h>
+#include <scaffold/debug.h>
+#include <scaffold/memory.h>
+
+#include <algorithm>
+#include <string.h>
+
+namespace fo {
+
+namespace segmented_internal {
+
+// Shift giving chunks of about 64 KiB, at least one item
+template <typename T> constexpr u32 default_chunk_shift() {
+    return sizeof(T) >= 64 * 1024 ? 0u : u32(log2_floor(u64(64 * 1024 / sizeof(T))));
+}
+
+} // namespace segmented_internal
+
+template <typename T, u32 CHUNK_SHIFT = segmented_internal::default_chunk_shift<T>()> struct SegmentedArray {
+    static_assert(internal::DefaultCtorTrivial<T>::value, "Use fo::Vector instead");
+    static_assert(std::is_trivially_copyable<T>::value, "Only supports trivially copyable items");
+
+    static constexpr u32 CHUNK_ITEMS = u32(1) << CHUNK_SHIFT;
+    static constexpr u32 CHUNK_MASK = CHUNK_ITEMS - 1;
+    static constexpr AddrUint CHUNK_BYTES = AddrUint(sizeof(T)) * CHUNK_ITEMS;
+
+    /// Chunks are allocated from `chunk_allocator`, the table of chunks from `table_allocator`.
+    SegmentedArray(Allocator &chunk_allocator = memory_globals::default_allocator(),
+                   Allocator &table_allocator = memory_globals::default_allocator());
+    ~SegmentedArray();
+
+    SegmentedArray(const SegmentedArray &) = delete;
+    SegmentedArray &operator=(const SegmentedArray &) = delete;
+    // Move ctor and assign
+    SegmentedArray(SegmentedArray &&other);
+    SegmentedArray &operator=(SegmentedArray &&other);
+
+    T &operator[](u32 i) { return _chunks[i >> CHUNK_SHIFT][i & CHUNK_MASK]; }
+    const T &operator[](u32 i) const { return _chunks[i >> CHUNK_SHIFT][i & CHUNK_MASK]; }
+
+    Allocator *_chunk_allocator;
+    Array<T *> _chunks; // All allocated chunks. The ones past the last item are kept for reuse.
+    u32 _size;
+};
+
+/// Number of items.
+template <typename T, u32 S> u32 size(const SegmentedArray<T, S> &a);
+/// Returns true if there are no items.
+template <typename T, u32 S> bool empty(const SegmentedArray<T, S> &a);
+/// Number of items the allocated chunks can hold.
+template <typename T, u32 S> u32 capacity(const SegmentedArray<T, S> &a);
+
+/// Appends an item. Allocates a chunk if the last one is full. Doesn't move any other item.
+template <typename T, u32 S> T &push_back(SegmentedArray<T, S> &a, const T &item);
+/// Removes the last item. There must be one.
+template <typename T, u32 S> void pop_back(SegmentedArray<T, S> &a);
+/// Returns the first/last item. Don't use these on an empty array.
+template <typename T, u32 S> T &front(SegmentedArray<T, S> &a);
+template <typename T, u32 S> T &back(SegmentedArray<T, S> &a);
+
+/// Changes the number of items, allocating chunks as needed. New items are zeroed in debug builds.
+template <typename T, u32 S> void resize(SegmentedArray<T, S> &a, u32 new_size);
+/// Allocates chunks for at least the given number of items.
+template <typename T, u32 S> void reserve(SegmentedArray<T, S> &a, u32 new_capacity);
+/// Removes all items, keeping the chunks.
+template <typename T, u32 S> void clear(SegmentedArray<T, S> &a);
+/// Frees the chunks past the one holding the last item.
+template <typename T, u32 S> void trim(SegmentedArray<T, S> &a);
+/// Removes all items and frees all the chunks.
+template <typename T, u32 S> void free(SegmentedArray<T, S> &a);
+
+/// Number of chunks holding items. All but the last are full.
+template <typename T, u32 S> u32 num_chunks(const SegmentedArray<T, S> &a);
+/// Returns the items of chunk c, and how many of them are used.
+template <typename T, u32 S> T *chunk_data(SegmentedArray<T, S> &a, u32 c);
+template <typename T, u32 S> const T *chunk_data(const SegmentedArray<T, S> &a, u32 c);
+template <typename T, u32 S> u32 chunk_size(const SegmentedArray<T, S> &a, u32 c);
+
+/// Calls `fn(items, count, first_index)` for each chunk holding items, in order.
+template <typename T, u32 S, typename Fn> void for_each_chunk(SegmentedArray<T, S> &a, Fn fn);
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+template <typename T, u32 S> inline u32 size(const SegmentedArray<T, S> &a) { return a._size; }
+template <typename T, u32 S> inline bool empty(const SegmentedArray<T, S> &a) { return a._size == 0; }
+template <typename T, u32 S> inline u32 capacity(const SegmentedArray<T, S> &a) {
+    return size(a._chunks) << S;
+}
+
+namespace segmented_internal {
+
+template <typename T, u32 S> void add_chunk(SegmentedArray<T, S> &a) {
+    constexpr AddrUint align = alignof(T) > 16 ? alignof(T) : 16;
+    T *chunk = (T *)a._chunk_allocator->allocate(SegmentedArray<T, S>::CHUNK_BYTES, align);
+    log_assert(chunk != nullptr, "%s - Failed to allocate a chunk", __PRETTY_FUNCTION__);
+    push_back(a._chunks, chunk);
+}
+
+// Frees the chunks from index `first` on
+template <typename T, u32 S> void free_chunks_from(SegmentedArray<T, S> &a, u32 first) {
+    for (u32 c = first; c < size(a._chunks); ++c) {
+        a._chunk_allocator->deallocate(a._chunks[c]);
+    }
+    resize(a._chunks, first);
+}
+
+} // namespace segmented_internal
+
+template <typename T, u32 S> T &push_back(SegmentedArray<T, S> &a, const T &item) {
+    if (a._size == capacity(a)) {
+        segmented_internal::add_chunk(a);
+    }
+    T &slot = a[a._size++];
+    slot = item;
+    return slot;
+}
+
+template <typename T, u32 S> inline void pop_back(SegmentedArray<T, S> &a) { --a._size; }
+
+template <typename T, u32 S> inline T &front(SegmentedArray<T, S> &a) { return a[0]; }
+template <typename T, u32 S> inline T &back(SegmentedArray<T, S> &a) { return a[a._size - 1]; }
+
+template <typename T, u32 S> void reserve(SegmentedArray<T, S> &a, u32 new_capacity) {
+    const u32 chunks_needed = u32((u64(new_capacity) + SegmentedArray<T, S>::CHUNK_MASK) >> S);
+    reserve(a._chunks, chunks_needed);
+    while (size(a._chunks) < chunks_needed) {
+        segmented_internal::add_chunk(a);
+    }
+}
+
+template <typename T, u32 S> void resize(SegmentedArray<T, S> &a, u32 new_size) {
+    reserve(a, new_size);
+// Zero the memory if we are in debug mode
+#ifndef NDEBUG
+    for (u32 i = a._size; i < new_size;) {
+        const u32 in_chunk = i & SegmentedArray<T, S>::CHUNK_MASK;
+        const u32 n = std::min(new_size - i, SegmentedArray<T, S>::CHUNK_ITEMS - in_chunk);
+        memset(&a._chunks[i >> S][in_chunk], 0, sizeof(T) * n);
+        i += n;
+    }
+#endif
+    a._size = new_size;
+}
+
+template <typename T, u32 S> inline void clear(SegmentedArray<T, S> &a) { a._size = 0; }
+
+template <typename T, u32 S> void trim(SegmentedArray<T, S> &a) {
+    segmented_internal::free_chunks_from(a, num_chunks(a));
+}
+
+template <typename T, u32 S> void free(SegmentedArray<T, S> &a) {
+    segmented_internal::free_chunks_from(a, 0);
+    fo::free(a._chunks);
+    a._size = 0;
+}
+
+template <typename T, u32 S> inline u32 num_chunks(const SegmentedArray<T, S> &a) {
+    return u32((u64(a._size) + SegmentedArray<T, S>::CHUNK_MASK) >> S);
+}
+
+template <typename T, u32 S> inline T *chunk_data(SegmentedArray<T, S> &a, u32 c) { return a._chunks[c]; }
+
+template <typename T, u32 S> inline const T *chunk_data(const SegmentedArray<T, S> &a, u32 c) {
+    return a._chunks[c];
+}
+
+template <typename T, u32 S> inline u32 chunk_size(const SegmentedArray<T, S> &a, u32 c) {
+    const u32 first = c << S;
+    return a._size - first < SegmentedArray<T, S>::CHUNK_ITEMS ? a._size - first
+                                                                : SegmentedArray<T, S>::CHUNK_ITEMS;
+}
+
+template <typename T, u32 S, typename Fn> void for_each_chunk(SegmentedArray<T, S> &a, Fn fn) {
+    const u32 n = num_chunks(a);
+    for (u32 c = 0; c < n; ++c) {
+        fn(a._chunks[c], chunk_size(a, c), c << S);
+    }
+}
+
+template <typename T, u32 S>
+SegmentedArray<T, S>::SegmentedArray(Allocator &chunk_allocator, Allocator &table_allocator)
+    : _chunk_allocator(&chunk_allocator)
+    , _chunks(table_allocator)
+    , _size(0) {}
+
+template <typename T, u32 S> SegmentedArray<T, S>::~SegmentedArray() {
+    segmented_internal::free_chunks_from(*this, 0);
+}
+
+template <typename T, u32 S>
+SegmentedArray<T, S>::SegmentedArray(SegmentedArray &&other)
+    : _chunk_allocator(other._chunk_allocator)
+    , _chunks(std::move(other._chunks))
+    , _size(other._size) {
+    other._size = 0;
+}
+
+template <typename T, u32 S> SegmentedArray<T, S> &SegmentedArray<T, S>::operator=(SegmentedArray &&other) {
+    if (this != &other) {
+        segmented_internal::free_chunks_from(*this, 0);
+        _chunk_allocator = other._chunk_allocator;
+        _chunks = std::move(other._chunks);
+        _size = other._size;
+        other._size = 0;
+    }
+    return *this;
+}
+
+} // namespace fo
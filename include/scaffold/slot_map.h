@@ -0,0 +1,172 @@
+/// A slot map, also known as a handle table. Inserting a value returns a `SlotHandle` that keeps referring to
+/// that value until it's removed, however many other values come and go. Insert, remove and lookup by handle
+/// are O(1).
+///
+/// The values are kept packed in one `Array`, so iterating over them is a plain loop over contiguous memory.
+/// Removing a value moves the last one into its place and updates the slot of the moved value. A handle names
+/// a slot plus the slot's generation. The generation is bumped whenever the slot's value is removed, so a
+/// handle to a removed value is detected as stale, even once the slot is reused.
+///
+/// Values follow the same rules as the items of an `Array`.
+#pragma once
+
+#include <scaffold/array.h>
+#include <scaffold/debug.h>
+
+namespace fo {
+
+/// Refers to a value in a `SlotMap`. A zero-initialized handle never refers to a value.
+struct SlotHandle {
+    u32 _index;      // Slot index
+    u32 _generation; // Generation of the slot when the value was inserted. Always odd.
+
+    bool operator==(const SlotHandle &o) const { return _index == o._index && _generation == o._generation; }
+    bool operator!=(const SlotHandle &o) const { return !(*this == o); }
+};
+
+template <typename T> struct SlotMap {
+    // The generation is even while the slot is free and odd while it has a value, so it's incremented on both
+    // insert and remove. A slot is reused about 2^31 times before an old handle to it could match again.
+    struct Slot {
+        u32 dense_or_next_free; // Index into `_values` while used, next slot of the free list while free
+        u32 generation;
+    };
+
+    static constexpr u32 NIL = ~u32(0);
+
+    Array<T> _values;        // Packed values
+    Array<u32> _value_slots; // Slot of each value in `_values`, to fix up the slot of a moved value
+    Array<Slot> _slots;      // Indexed by handle
+    u32 _free_head;          // First free slot, or NIL
+
+    SlotMap(Allocator &allocator = memory_globals::default_allocator());
+};
+
+/// Number of values.
+template <typename T> u32 size(const SlotMap<T> &m);
+
+/// Inserts a value and returns its handle.
+template <typename T> SlotHandle insert(SlotMap<T> &m, const T &value);
+
+/// Removes the value with the given handle. Returns false if the handle is stale. Invalidates pointers to the
+/// values and positions in the packed array, but not handles.
+template <typename T> bool remove(SlotMap<T> &m, SlotHandle h);
+
+/// Returns a pointer to the value with the given handle, or nullptr if the handle is stale.
+template <typename T> T *get(SlotMap<T> &m, SlotHandle h);
+template <typename T> const T *get(const SlotMap<T> &m, SlotHandle h);
+
+/// Returns true if the handle refers to a value.
+template <typename T> bool has(const SlotMap<T> &m, SlotHandle h);
+
+/// Returns the handle of the value at position i of the packed values.
+template <typename T> SlotHandle handle_at(const SlotMap<T> &m, u32 i);
+
+/// Removes all values. Every handle given out becomes stale.
+template <typename T> void clear(SlotMap<T> &m);
+
+/// Makes room for the given number of values without allocating.
+template <typename T> void reserve(SlotMap<T> &m, u32 capacity);
+
+/// Iterate over the packed values, in no particular order.
+template <typename T> T *begin(SlotMap<T> &m) { return data(m._values); }
+template <typename T> T *end(SlotMap<T> &m) { return data(m._values) + size(m._values); }
+template <typename T> const T *begin(const SlotMap<T> &m) { return data(m._values); }
+template <typename T> const T *end(const SlotMap<T> &m) { return data(m._values) + size(m._values); }
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+template <typename T>
+SlotMap<T>::SlotMap(Allocator &allocator)
+    : _values(allocator)
+    , _value_slots(allocator)
+    , _slots(allocator)
+    , _free_head(NIL) {}
+
+template <typename T> inline u32 size(const SlotMap<T> &m) { return size(m._values); }
+
+template <typename T> SlotHandle insert(SlotMap<T> &m, const T &value) {
+    using Slot = typename SlotMap<T>::Slot;
+
+    u32 index = m._free_head;
+    if (index != SlotMap<T>::NIL) {
+        m._free_head = m._slots[index].dense_or_next_free;
+    } else {
+        index = size(m._slots);
+        push_back(m._slots, Slot{ 0, 0 });
+    }
+
+    Slot &slot = m._slots[index];
+    slot.dense_or_next_free = size(m._values);
+    ++slot.generation;
+
+    push_back(m._values, value);
+    push_back(m._value_slots, index);
+    return SlotHandle{ index, slot.generation };
+}
+
+template <typename T> inline bool has(const SlotMap<T> &m, SlotHandle h) {
+    return h._index < size(m._slots) && m._slots[h._index].generation == h._generation && (h._generation & 1);
+}
+
+template <typename T> bool remove(SlotMap<T> &m, SlotHandle h) {
+    if (!has(m, h)) {
+        return false;
+    }
+
+    auto &slot = m._slots[h._index];
+    const u32 dense = slot.dense_or_next_free;
+    const u32 last = size(m._values) - 1;
+
+    // Fill the hole with the last value
+    if (dense != last) {
+        const u32 moved_slot = m._value_slots[last];
+        m._values[dense] = m._values[last];
+        m._value_slots[dense] = moved_slot;
+        m._slots[moved_slot].dense_or_next_free = dense;
+    }
+    pop_back(m._values);
+    pop_back(m._value_slots);
+
+    ++slot.generation;
+    slot.dense_or_next_free = m._free_head;
+    m._free_head = h._index;
+    return true;
+}
+
+template <typename T> inline T *get(SlotMap<T> &m, SlotHandle h) {
+    return has(m, h) ? &m._values[m._slots[h._index].dense_or_next_free] : nullptr;
+}
+
+template <typename T> inline const T *get(const SlotMap<T> &m, SlotHandle h) {
+    return has(m, h) ? &m._values[m._slots[h._index].dense_or_next_free] : nullptr;
+}
+
+template <typename T> inline SlotHandle handle_at(const SlotMap<T> &m, u32 i) {
+    log_assert(i < size(m._values), "%s - Index %u out of range", __PRETTY_FUNCTION__, i);
+    const u32 index = m._value_slots[i];
+    return SlotHandle{ index, m._slots[index].generation };
+}
+
+template <typename T> void clear(SlotMap<T> &m) {
+    for (u32 i = 0; i < size(m._value_slots); ++i) {
+        const u32 index = m._value_slots[i];
+        ++m._slots[index].generation;
+        m._slots[index].dense_or_next_free = m._free_head;
+        m._free_head = index;
+    }
+    clear(m._values);
+    clear(m._value_slots);
+}
+
+template <typename T> void reserve(SlotMap<T> &m, u32 capacity) {
+    reserve(m._values, capacity);
+    reserve(m._value_slots, capacity);
+    reserve(m._slots, capacity);
+}
+
+} // namespace fo
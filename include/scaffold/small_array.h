@@ -0,0 +1,271 @@
+/// An `Array` with room for N items inside the struct itself. The items only move to memory from the
+/// allocator once there are more than N of them, so small arrays cost no allocation and no pointer chase to a
+/// separate block. Same element restrictions and same free functions as `Array`.
+///
+/// `_data` points at the inline buffer while the items fit, so moving or swapping a small array copies its
+/// items instead of stealing a pointer, and pointers to the items don't survive a move.
+#pragma once
+
+#include <scaffold/collection_types.h>
+#include <scaffold/const_log.h>
+#include <scaffold/memory.h>
+
+#include <initializer_list>
+#include <string.h>
+
+namespace fo {
+
+template <typename T, u32 N> struct SmallArray {
+    static_assert(N > 0, "Use fo::Array instead");
+
+    static_assert(internal::DefaultCtorTrivial<T>::value, "Use fo::Vector instead");
+
+    static_assert(std::is_trivially_copy_assignable<T>::value,
+                  "Only supports trivially copy-assignable elements");
+
+    static_assert(std::is_trivially_destructible<T>::value, "");
+
+    SmallArray(Allocator &a = fo::memory_globals::default_allocator(), u32 initial_size = 0);
+    SmallArray(std::initializer_list<T> init_list, Allocator &a = fo::memory_globals::default_allocator());
+    ~SmallArray();
+    SmallArray(const SmallArray &other);
+    SmallArray &operator=(const SmallArray &other);
+    // Move ctor and assign
+    SmallArray(SmallArray &&other);
+    SmallArray &operator=(SmallArray &&other);
+
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    T &operator[](u32 i) { return _data[i]; }
+    const T &operator[](u32 i) const { return _data[i]; }
+
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+    const_iterator cbegin() const { return _data; }
+    const_iterator cend() const { return _data + _size; }
+
+    Allocator *_allocator;
+    u32 _size;
+    u32 _capacity; // Never less than N
+    T *_data;      // Either `_inline` or allocated
+    alignas(T) u8 _inline[sizeof(T) * N];
+};
+
+/// The number of elements in the array.
+template <typename T, u32 N> u32 size(const SmallArray<T, N> &a);
+/// Returns true if there are any elements in the array.
+template <typename T, u32 N> bool any(const SmallArray<T, N> &a);
+/// Returns true if the array is empty.
+template <typename T, u32 N> bool empty(const SmallArray<T, N> &a);
+/// Returns true if the items are in the inline buffer.
+template <typename T, u32 N> bool is_inline(const SmallArray<T, N> &a);
+
+/// Returns the first/last element of the array. Don't use these on an empty array.
+template <typename T, u32 N> T &front(SmallArray<T, N> &a);
+template <typename T, u32 N> const T &front(const SmallArray<T, N> &a);
+template <typename T, u32 N> T &back(SmallArray<T, N> &a);
+template <typename T, u32 N> const T &back(const SmallArray<T, N> &a);
+
+/// Returns pointer to first element of array
+template <typename T, u32 N> T *data(SmallArray<T, N> &a);
+template <typename T, u32 N> const T *data(const SmallArray<T, N> &a);
+
+/// Changes the size of the array (does not reallocate memory unless necessary).
+template <typename T, u32 N> void resize(SmallArray<T, N> &a, u32 new_size);
+/// Removes all items in the array but does not free memory
+template <typename T, u32 N> void clear(SmallArray<T, N> &a);
+/// Removes all items in the array and frees any allocated memory, going back to the inline buffer
+template <typename T, u32 N> void free(SmallArray<T, N> &a);
+/// Reallocates the array to the specified capacity. Capacities up to N use the inline buffer.
+template <typename T, u32 N> void set_capacity(SmallArray<T, N> &a, u32 new_capacity);
+/// Makes sure that the array has at least the specified capacity. (If not, the array is grown.)
+template <typename T, u32 N> void reserve(SmallArray<T, N> &a, u32 new_capacity);
+/// Grows the array geometrically, to at least min_capacity if given.
+template <typename T, u32 N> void grow(SmallArray<T, N> &a, u32 min_capacity = 0);
+/// Trims the array so that its capacity matches its size, moving the items back inline if they fit.
+template <typename T, u32 N> void trim(SmallArray<T, N> &a);
+
+/// Pushes the item to the end of the array.
+template <typename T, u32 N> void push_back(SmallArray<T, N> &a, const T &item);
+/// Pops the last item from the array. The array cannot be empty.
+template <typename T, u32 N> void pop_back(SmallArray<T, N> &a);
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+template <typename T, u32 N> inline u32 size(const SmallArray<T, N> &a) { return a._size; }
+template <typename T, u32 N> inline bool any(const SmallArray<T, N> &a) { return a._size != 0; }
+template <typename T, u32 N> inline bool empty(const SmallArray<T, N> &a) { return a._size == 0; }
+template <typename T, u32 N> inline bool is_inline(const SmallArray<T, N> &a) {
+    return a._data == reinterpret_cast<const T *>(a._inline);
+}
+
+template <typename T, u32 N> typename SmallArray<T, N>::iterator begin(SmallArray<T, N> &a) {
+    return a.begin();
+}
+template <typename T, u32 N> typename SmallArray<T, N>::iterator end(SmallArray<T, N> &a) { return a.end(); }
+template <typename T, u32 N> typename SmallArray<T, N>::const_iterator begin(const SmallArray<T, N> &a) {
+    return a.begin();
+}
+template <typename T, u32 N> typename SmallArray<T, N>::const_iterator end(const SmallArray<T, N> &a) {
+    return a.end();
+}
+
+template <typename T, u32 N> inline T &front(SmallArray<T, N> &a) { return a._data[0]; }
+template <typename T, u32 N> inline const T &front(const SmallArray<T, N> &a) { return a._data[0]; }
+template <typename T, u32 N> inline T &back(SmallArray<T, N> &a) { return a._data[a._size - 1]; }
+template <typename T, u32 N> inline const T &back(const SmallArray<T, N> &a) { return a._data[a._size - 1]; }
+
+template <typename T, u32 N> inline T *data(SmallArray<T, N> &a) { return a._data; }
+template <typename T, u32 N> inline const T *data(const SmallArray<T, N> &a) { return a._data; }
+
+template <typename T, u32 N> inline void clear(SmallArray<T, N> &a) { resize(a, 0); }
+
+template <typename T, u32 N> inline void free(SmallArray<T, N> &a) {
+    a._size = 0;
+    set_capacity(a, 0);
+}
+
+template <typename T, u32 N> inline void trim(SmallArray<T, N> &a) { set_capacity(a, a._size); }
+
+template <typename T, u32 N> void resize(SmallArray<T, N> &a, u32 new_size) {
+    if (new_size > a._capacity) {
+        grow(a, new_size);
+    }
+// Zero the memory if we are in debug mode
+#ifndef NDEBUG
+    if (new_size > a._size) {
+        memset(&a._data[a._size], 0, (new_size - a._size) * sizeof(T));
+    }
+#endif
+    a._size = new_size;
+}
+
+template <typename T, u32 N> inline void reserve(SmallArray<T, N> &a, u32 new_capacity) {
+    if (new_capacity > a._capacity) {
+        set_capacity(a, new_capacity);
+    }
+}
+
+template <typename T, u32 N> void set_capacity(SmallArray<T, N> &a, u32 new_capacity) {
+    if (new_capacity < N) {
+        new_capacity = N;
+    }
+    if (new_capacity == a._capacity) {
+        return;
+    }
+    if (new_capacity < a._size) {
+        a._size = new_capacity;
+    }
+
+    T *inline_data = reinterpret_cast<T *>(a._inline);
+
+    if (new_capacity == N) {
+        // Back to the inline buffer
+        memcpy(inline_data, a._data, sizeof(T) * a._size);
+        a._allocator->deallocate(a._data);
+        a._data = inline_data;
+    } else if (a._data == inline_data) {
+        T *new_data = (T *)a._allocator->allocate(sizeof(T) * new_capacity, alignof(T));
+        memcpy(new_data, inline_data, sizeof(T) * a._size);
+        a._data = new_data;
+    } else {
+        a._data = (T *)a._allocator->reallocate(
+          a._data, sizeof(T) * new_capacity, alignof(T), sizeof(T) * a._capacity);
+    }
+    a._capacity = new_capacity;
+}
+
+template <typename T, u32 N> void grow(SmallArray<T, N> &a, u32 min_capacity) {
+    u32 new_capacity = internal::grown_capacity(a._capacity);
+    if (new_capacity < min_capacity) {
+        new_capacity = clip_to_pow2(min_capacity);
+    }
+    set_capacity(a, new_capacity);
+}
+
+template <typename T, u32 N> inline void push_back(SmallArray<T, N> &a, const T &item) {
+    if (a._size + 1 > a._capacity) {
+        grow(a);
+    }
+    a._data[a._size++] = item;
+}
+
+template <typename T, u32 N> inline void pop_back(SmallArray<T, N> &a) { a._size--; }
+
+template <typename T, u32 N>
+SmallArray<T, N>::SmallArray(Allocator &allocator, u32 initial_size)
+    : _allocator(&allocator)
+    , _size(0)
+    , _capacity(N)
+    , _data(reinterpret_cast<T *>(_inline)) {
+    resize(*this, initial_size);
+}
+
+template <typename T, u32 N>
+SmallArray<T, N>::SmallArray(std::initializer_list<T> init_list, Allocator &allocator)
+    : SmallArray(allocator) {
+    reserve(*this, u32(init_list.size()));
+    for (const auto &item : init_list) {
+        push_back(*this, item);
+    }
+}
+
+template <typename T, u32 N> SmallArray<T, N>::~SmallArray() {
+    if (!is_inline(*this)) {
+        _allocator->deallocate(_data);
+    }
+}
+
+template <typename T, u32 N>
+SmallArray<T, N>::SmallArray(const SmallArray &other)
+    : SmallArray(*other._allocator) {
+    *this = other;
+}
+
+template <typename T, u32 N> SmallArray<T, N> &SmallArray<T, N>::operator=(const SmallArray &other) {
+    if (this != &other) {
+        resize(*this, other._size);
+        memcpy(_data, other._data, sizeof(T) * other._size);
+    }
+    return *this;
+}
+
+template <typename T, u32 N>
+SmallArray<T, N>::SmallArray(SmallArray &&other)
+    : SmallArray(*other._allocator) {
+    *this = std::move(other);
+}
+
+template <typename T, u32 N> SmallArray<T, N> &SmallArray<T, N>::operator=(SmallArray &&other) {
+    if (this == &other) {
+        return *this;
+    }
+    if (is_inline(other)) {
+        // Nothing to steal, copy the items
+        *this = other;
+        other._size = 0;
+        return *this;
+    }
+
+    if (!is_inline(*this)) {
+        _allocator->deallocate(_data);
+    }
+    _allocator = other._allocator;
+    _data = other._data;
+    _size = other._size;
+    _capacity = other._capacity;
+
+    other._data = reinterpret_cast<T *>(other._inline);
+    other._size = 0;
+    other._capacity = N;
+    return *this;
+}
+
+} // namespace fo
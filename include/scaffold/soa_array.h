@@ -0,0 +1,328 @@
+/// A structure-of-arrays. `SoAArray<Fields...>` holds rows of `Fields...` like an `Array` of structs would,
+/// but stores each field in its own column, so a loop over two fields of every row streams only those two
+/// columns through the cache instead of the whole struct.
+///
+/// All the columns share a single allocation. Each column starts at a `COLUMN_ALIGN` boundary, so loops over
+/// a column can use aligned vector loads. Growing allocates a new block and copies every column.
+///
+/// The fields follow the same rules as the items of an `Array`.
+#pragma once
+
+#include <scaffold/collection_types.h>
+#include <scaffold/const_log.h>
+#include <scaffold/memory.h>
+
+#include <string.h>
+#include <tuple>
+#include <utility>
+
+namespace fo {
+
+template <typename... Fields> struct SoAArray {
+    static_assert(sizeof...(Fields) > 0, "Need at least one field");
+
+    static_assert(std::conjunction<internal::DefaultCtorTrivial<Fields>...>::value,
+                  "Fields must be trivially default constructible");
+
+    static_assert(std::conjunction<std::is_trivially_copyable<Fields>...>::value,
+                  "Fields must be trivially copyable");
+
+    static constexpr u32 NUM_COLUMNS = u32(sizeof...(Fields));
+    static constexpr u32 COLUMN_ALIGN = 64;
+
+    template <u32 I> using Column = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    SoAArray(Allocator &a = fo::memory_globals::default_allocator(), u32 initial_size = 0);
+    ~SoAArray();
+    SoAArray(const SoAArray &other);
+    SoAArray &operator=(const SoAArray &other);
+    // Move ctor and assign
+    SoAArray(SoAArray &&other);
+    SoAArray &operator=(SoAArray &&other);
+
+    Allocator *_allocator;
+    u32 _size;
+    u32 _capacity;
+    u8 *_block;                  // The single allocation holding all the columns
+    void *_columns[NUM_COLUMNS]; // Start of each column inside `_block`
+};
+
+/// A view of one column. Has the read and write functions of `Array` (size, data, begin, end, operator[],
+/// front, back), so code written against an `Array` of one field works on the column too. Invalidated when
+/// the `SoAArray` grows.
+template <typename T> struct ColumnView {
+    T *_data;
+    u32 _size;
+
+    T &operator[](u32 i) const { return _data[i]; }
+
+    T *begin() const { return _data; }
+    T *end() const { return _data + _size; }
+};
+
+/// The number of rows.
+template <typename... Fields> u32 size(const SoAArray<Fields...> &a);
+/// Number of rows the columns have room for.
+template <typename... Fields> u32 capacity(const SoAArray<Fields...> &a);
+/// Returns true if there are no rows.
+template <typename... Fields> bool empty(const SoAArray<Fields...> &a);
+
+/// Returns the start of column I, aligned to `COLUMN_ALIGN`.
+template <u32 I, typename... Fields>
+typename SoAArray<Fields...>::template Column<I> *column(SoAArray<Fields...> &a);
+template <u32 I, typename... Fields>
+const typename SoAArray<Fields...>::template Column<I> *column(const SoAArray<Fields...> &a);
+
+/// Returns a view of column I over all the rows.
+template <u32 I, typename... Fields>
+ColumnView<typename SoAArray<Fields...>::template Column<I>> view(SoAArray<Fields...> &a);
+template <u32 I, typename... Fields>
+ColumnView<const typename SoAArray<Fields...>::template Column<I>> view(const SoAArray<Fields...> &a);
+
+/// Appends a row.
+template <typename... Fields> void push_back(SoAArray<Fields...> &a, const Fields &... fields);
+/// Removes the last row. There must be one.
+template <typename... Fields> void pop_back(SoAArray<Fields...> &a);
+/// Removes row i by moving the last row into its place. Doesn't keep the order of the rows.
+template <typename... Fields> void swap_remove(SoAArray<Fields...> &a, u32 i);
+
+/// Changes the number of rows. New rows are zeroed in debug builds and left uninitialized otherwise.
+template <typename... Fields> void resize(SoAArray<Fields...> &a, u32 new_size);
+/// Removes all rows but does not free memory.
+template <typename... Fields> void clear(SoAArray<Fields...> &a);
+/// Removes all rows and frees the memory.
+template <typename... Fields> void free(SoAArray<Fields...> &a);
+/// Reallocates the columns to the given capacity, dropping any rows past it.
+template <typename... Fields> void set_capacity(SoAArray<Fields...> &a, u32 new_capacity);
+/// Makes sure there's room for at least the given number of rows.
+template <typename... Fields> void reserve(SoAArray<Fields...> &a, u32 new_capacity);
+/// Grows the capacity by SCAFFOLD_GROWTH_FACTOR_PERCENT, to at least min_capacity if given.
+template <typename... Fields> void grow(SoAArray<Fields...> &a, u32 min_capacity = 0);
+/// Trims the capacity to the number of rows.
+template <typename... Fields> void trim(SoAArray<Fields...> &a);
+
+/// Functions on a column view, as for `Array`.
+template <typename T> u32 size(const ColumnView<T> &v) { return v._size; }
+template <typename T> bool empty(const ColumnView<T> &v) { return v._size == 0; }
+template <typename T> T *data(const ColumnView<T> &v) { return v._data; }
+template <typename T> T *begin(const ColumnView<T> &v) { return v._data; }
+template <typename T> T *end(const ColumnView<T> &v) { return v._data + v._size; }
+template <typename T> T &front(const ColumnView<T> &v) { return v._data[0]; }
+template <typename T> T &back(const ColumnView<T> &v) { return v._data[v._size - 1]; }
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace soa_internal {
+
+constexpr AddrUint align_up(AddrUint n, AddrUint align) { return (n + align - 1) / align * align; }
+
+// Bytes for `capacity` rows, each column padded to the column alignment
+template <typename... Fields> AddrUint block_size(u32 capacity) {
+    constexpr AddrUint align = SoAArray<Fields...>::COLUMN_ALIGN;
+    return (align_up(AddrUint(sizeof(Fields)) * capacity, align) + ... + 0);
+}
+
+// Points each column at its place in `block`
+template <typename... Fields, size_t... I>
+void place_columns(SoAArray<Fields...> &a, u8 *block, u32 capacity, std::index_sequence<I...>) {
+    constexpr AddrUint align = SoAArray<Fields...>::COLUMN_ALIGN;
+    AddrUint offset = 0;
+    ((a._columns[I] = block + offset, offset += align_up(AddrUint(sizeof(Fields)) * capacity, align)), ...);
+}
+
+// Copies rows [0, count) of every column of `from` to `to`
+template <typename... Fields, size_t... I>
+void copy_rows(void *const *to, void *const *from, u32 count, std::index_sequence<I...>) {
+    (memcpy(to[I], from[I], sizeof(Fields) * count), ...);
+}
+
+// Copies row `from` to row `to` in every column
+template <typename... Fields, size_t... I>
+void copy_row(SoAArray<Fields...> &a, u32 to, u32 from, std::index_sequence<I...>) {
+    ((static_cast<Fields *>(a._columns[I])[to] = static_cast<Fields *>(a._columns[I])[from]), ...);
+}
+
+template <typename... Fields, size_t... I>
+void set_row(SoAArray<Fields...> &a, u32 row, std::index_sequence<I...>, const Fields &... fields) {
+    ((static_cast<Fields *>(a._columns[I])[row] = fields), ...);
+}
+
+template <typename... Fields, size_t... I>
+void zero_rows(SoAArray<Fields...> &a, u32 begin, u32 end, std::index_sequence<I...>) {
+    (memset(static_cast<Fields *>(a._columns[I]) + begin, 0, sizeof(Fields) * (end - begin)), ...);
+}
+
+} // namespace soa_internal
+
+template <typename... Fields> inline u32 size(const SoAArray<Fields...> &a) { return a._size; }
+template <typename... Fields> inline u32 capacity(const SoAArray<Fields...> &a) { return a._capacity; }
+template <typename... Fields> inline bool empty(const SoAArray<Fields...> &a) { return a._size == 0; }
+
+template <u32 I, typename... Fields>
+inline typename SoAArray<Fields...>::template Column<I> *column(SoAArray<Fields...> &a) {
+    return static_cast<typename SoAArray<Fields...>::template Column<I> *>(a._columns[I]);
+}
+
+template <u32 I, typename... Fields>
+inline const typename SoAArray<Fields...>::template Column<I> *column(const SoAArray<Fields...> &a) {
+    return static_cast<const typename SoAArray<Fields...>::template Column<I> *>(a._columns[I]);
+}
+
+template <u32 I, typename... Fields>
+ColumnView<typename SoAArray<Fields...>::template Column<I>> view(SoAArray<Fields...> &a) {
+    return { column<I>(a), a._size };
+}
+
+template <u32 I, typename... Fields>
+ColumnView<const typename SoAArray<Fields...>::template Column<I>> view(const SoAArray<Fields...> &a) {
+    return { column<I>(a), a._size };
+}
+
+template <typename... Fields> void push_back(SoAArray<Fields...> &a, const Fields &... fields) {
+    if (a._size == a._capacity) {
+        grow(a);
+    }
+    soa_internal::set_row(a, a._size++, std::index_sequence_for<Fields...>{}, fields...);
+}
+
+template <typename... Fields> inline void pop_back(SoAArray<Fields...> &a) { --a._size; }
+
+template <typename... Fields> void swap_remove(SoAArray<Fields...> &a, u32 i) {
+    log_assert(i < a._size, "%s - Row %u out of range", __PRETTY_FUNCTION__, i);
+    --a._size;
+    if (i != a._size) {
+        soa_internal::copy_row(a, i, a._size, std::index_sequence_for<Fields...>{});
+    }
+}
+
+template <typename... Fields> void resize(SoAArray<Fields...> &a, u32 new_size) {
+    if (new_size > a._capacity) {
+        grow(a, new_size);
+    }
+// Zero the memory if we are in debug mode
+#ifndef NDEBUG
+    if (new_size > a._size) {
+        soa_internal::zero_rows(a, a._size, new_size, std::index_sequence_for<Fields...>{});
+    }
+#endif
+    a._size = new_size;
+}
+
+template <typename... Fields> inline void clear(SoAArray<Fields...> &a) { a._size = 0; }
+
+template <typename... Fields> inline void free(SoAArray<Fields...> &a) {
+    a._size = 0;
+    set_capacity(a, 0);
+}
+
+template <typename... Fields> void set_capacity(SoAArray<Fields...> &a, u32 new_capacity) {
+    if (new_capacity == a._capacity) {
+        return;
+    }
+    if (new_capacity < a._size) {
+        a._size = new_capacity;
+    }
+
+    void *old_columns[SoAArray<Fields...>::NUM_COLUMNS];
+    memcpy(old_columns, a._columns, sizeof(old_columns));
+
+    u8 *new_block = nullptr;
+    if (new_capacity > 0) {
+        new_block = (u8 *)a._allocator->allocate(soa_internal::block_size<Fields...>(new_capacity),
+                                                 SoAArray<Fields...>::COLUMN_ALIGN);
+        soa_internal::place_columns(a, new_block, new_capacity, std::index_sequence_for<Fields...>{});
+        if (a._size != 0) {
+            soa_internal::copy_rows<Fields...>(
+              a._columns, old_columns, a._size, std::index_sequence_for<Fields...>{});
+        }
+    } else {
+        memset(a._columns, 0, sizeof(a._columns));
+    }
+
+    a._allocator->deallocate(a._block);
+    a._block = new_block;
+    a._capacity = new_capacity;
+}
+
+template <typename... Fields> inline void reserve(SoAArray<Fields...> &a, u32 new_capacity) {
+    if (new_capacity > a._capacity) {
+        set_capacity(a, new_capacity);
+    }
+}
+
+template <typename... Fields> void grow(SoAArray<Fields...> &a, u32 min_capacity) {
+    u32 new_capacity = a._capacity ? internal::grown_capacity(a._capacity) : 8;
+    if (new_capacity < min_capacity) {
+        new_capacity = clip_to_pow2(min_capacity);
+    }
+    set_capacity(a, new_capacity);
+}
+
+template <typename... Fields> inline void trim(SoAArray<Fields...> &a) { set_capacity(a, a._size); }
+
+template <typename... Fields>
+SoAArray<Fields...>::SoAArray(Allocator &allocator, u32 initial_size)
+    : _allocator(&allocator)
+    , _size(0)
+    , _capacity(0)
+    , _block(nullptr)
+    , _columns{} {
+    resize(*this, initial_size);
+}
+
+template <typename... Fields> SoAArray<Fields...>::~SoAArray() { _allocator->deallocate(_block); }
+
+template <typename... Fields>
+SoAArray<Fields...>::SoAArray(const SoAArray &other)
+    : SoAArray(*other._allocator) {
+    *this = other;
+}
+
+template <typename... Fields> SoAArray<Fields...> &SoAArray<Fields...>::operator=(const SoAArray &other) {
+    if (this != &other) {
+        _size = 0;
+        reserve(*this, other._size);
+        if (other._size != 0) {
+            soa_internal::copy_rows<Fields...>(
+              _columns, other._columns, other._size, std::index_sequence_for<Fields...>{});
+        }
+        _size = other._size;
+    }
+    return *this;
+}
+
+template <typename... Fields>
+SoAArray<Fields...>::SoAArray(SoAArray &&other)
+    : _allocator(other._allocator)
+    , _size(other._size)
+    , _capacity(other._capacity)
+    , _block(other._block) {
+    memcpy(_columns, other._columns, sizeof(_columns));
+    other._size = 0;
+    other._capacity = 0;
+    other._block = nullptr;
+    memset(other._columns, 0, sizeof(other._columns));
+}
+
+template <typename... Fields> SoAArray<Fields...> &SoAArray<Fields...>::operator=(SoAArray &&other) {
+    if (this != &other) {
+        _allocator->deallocate(_block);
+        _allocator = other._allocator;
+        _size = other._size;
+        _capacity = other._capacity;
+        _block = other._block;
+        memcpy(_columns, other._columns, sizeof(_columns));
+        // Leave other empty, keeping its allocator
+        other._size = 0;
+        other._capacity = 0;
+        other._block = nullptr;
+        memset(other._columns, 0, sizeof(other._columns));
+    }
+    return *this;
+}
+
+} // namespace fo
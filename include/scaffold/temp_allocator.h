@@ -51,8 +51,16 @@ template <int BUFFER_SIZE> class TempAllocator : public Allocator {
 
     void *allocate(AddrUint size, AddrUint align = DEFAULT_ALIGN) override;
 
+    /// The last allocation grows or shrinks in place if the current region has room for it and it is
+    /// aligned to `align`. `must_old_size` is required.
     void *
     reallocate(void *old_allocation, AddrUint new_size, AddrUint align, AddrUint must_old_size) override {
+        char *old = (char *)old_allocation;
+        if (old && new_size != 0 && must_old_size != DONT_CARE_OLD_SIZE && old + must_old_size == _p &&
+            new_size <= AddrUint(_end - old) && (uintptr_t(old) & (align - 1)) == 0) {
+            _p = old + new_size;
+            return old;
+        }
         DefaultReallocInfo realloc_info = {};
         default_realloc(old_allocation, new_size, align, must_old_size, &realloc_info);
         return realloc_info.new_allocation;
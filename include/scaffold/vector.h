@@ -112,16 +112,27 @@ template <typename T, bool is_resize> void set_capacity(Vector<T> &a, u32 new_ca
         return;
     }
 
-    T *new_allocation = reinterpret_cast<T *>(
-        a._allocator->allocate(new_capacity * sizeof(T), std::max(alignof(T), size_t(16))));
-
-    log_assert(new_allocation != nullptr, "Failed to allocate capacity: %u", new_capacity);
+    const size_t align = std::max(alignof(T), size_t(16));
+    T *new_allocation;
 
-    move(a._data, new_allocation, a._size);
+    if
+        SCAFFOLD_IF_CONSTEXPR(std::is_trivially_move_constructible<T>::value &&
+                              std::is_trivially_destructible<T>::value) {
+            // The elements can be moved with a plain copy of their bytes, so let the allocator extend the
+            // block in place, or remap it, when it can.
+            new_allocation = reinterpret_cast<T *>(
+              a._allocator->reallocate(a._data, new_capacity * sizeof(T), align, a._capacity * sizeof(T)));
+            log_assert(new_allocation != nullptr, "Failed to allocate capacity: %u", new_capacity);
+        }
+    else {
+        new_allocation = reinterpret_cast<T *>(a._allocator->allocate(new_capacity * sizeof(T), align));
+        log_assert(new_allocation != nullptr, "Failed to allocate capacity: %u", new_capacity);
+        move(a._data, new_allocation, a._size);
+        a._allocator->deallocate(a._data);
+    }
 
     init_with_defaults_if_nonpod<T, is_resize>(new_allocation + a._size, new_allocation + new_capacity);
 
-    a._allocator->deallocate(a._data);
     a._data = new_allocation;
     a._capacity = new_capacity;
 }
@@ -389,11 +400,14 @@ template <typename T> Vector<T> &Vector<T>::operator=(const Vector<T> &o) {
 namespace internal {
 
 template <typename T> void grow(Vector<T> &a) {
-    u32 new_capacity = a._capacity == 0 ? 1 : a._capacity * 2;
+    u32 new_capacity = a._capacity == 0 ? 1 : grown_capacity(a._capacity);
     set_capacity<T, false>(a, new_capacity);
 }
 
 template <typename T> void move(T *source, T *destination, u32 source_size) {
+    if (source_size == 0) {
+        return; // Either pointer can be null then, which memcpy must not get
+    }
     if
         SCAFFOLD_IF_CONSTEXPR(std::is_trivially_move_constructible<T>::value) {
             memcpy(destination, source, source_size * sizeof(T));
@@ -406,6 +420,9 @@ template <typename T> void move(T *source, T *destination, u32 source_size) {
 }
 
 template <typename T> void copy(T *source, T *destination, u32 source_size) {
+    if (source_size == 0) {
+        return; // Either pointer can be null then, which memcpy must not get
+    }
     if
         SCAFFOLD_IF_CONSTEXPR(std::is_trivially_copy_constructible<T>::value) {
             memcpy(destination, source, source_size * sizeof(T));
@@ -0,0 +1,204 @@
+/// A Chase-Lev work-stealing deque. One owner thread pushes and pops items at the bottom end, like a stack,
+/// while any other thread can steal items from the top end. The owner only synchronizes with thieves when
+/// the deque is down to its last item, so a thread working through its own items pays almost nothing.
+///
+/// The memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.). The
+/// ring doubles when full. A thief may still be reading the old ring, so replaced rings are kept on a retired
+/// list until the deque is destroyed. The ring never shrinks, and each ring is half the size of the next, so
+/// the old rings add up to less than the current one and the list at most doubles the memory used.
+///
+/// Items are stored in `std::atomic<T>`, so T must be lock-free as an atomic. Typically a pointer.
+#pragma once
+
+#include <scaffold/const_log.h>
+#include <scaffold/memory.h>
+#include <scaffold/types.h>
+
+#include <assert.h>
+#include <atomic>
+#include <new>
+
+namespace fo {
+
+template <typename T> struct WorkStealingDeque {
+    static_assert(std::atomic<T>::is_always_lock_free, "Item type must be lock-free as a std::atomic");
+
+    // A ring of items. The items are allocated right after the header in the same block.
+    struct Ring {
+        i64 mask;
+        Ring *next_retired;
+        std::atomic<T> *items;
+    };
+
+    // Index of the next item to steal. Only ever incremented.
+    alignas(64) std::atomic<i64> _top;
+    // Index one past the item the owner pops next.
+    alignas(64) std::atomic<i64> _bottom;
+
+    std::atomic<Ring *> _ring;
+    Ring *_retired; // Rings replaced by a grow
+    Allocator *_allocator;
+
+    /// Creates a deque with room for `initial_capacity` items before it needs to grow.
+    WorkStealingDeque(Allocator &allocator, u32 initial_capacity = 64);
+    ~WorkStealingDeque();
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+};
+
+namespace work_stealing_deque {
+
+/// Pushes the item to the bottom. Only the owner thread can call this.
+template <typename T> void push(WorkStealingDeque<T> &d, T item);
+
+/// Pops the last pushed item into `item`. Returns false if the deque is empty. Only the owner thread can call
+/// this.
+template <typename T> bool pop(WorkStealingDeque<T> &d, T &item);
+
+/// Takes the oldest item into `item`. Returns false if the deque is empty, or if another thread took the item
+/// first. Any thread can call this.
+template <typename T> bool steal(WorkStealingDeque<T> &d, T &item);
+
+/// Number of items in the deque. Only a snapshot while other threads steal.
+template <typename T> u32 size(const WorkStealingDeque<T> &d);
+
+} // namespace work_stealing_deque
+
+} // namespace fo
+
+// --- Implementations
+
+namespace fo {
+
+namespace work_stealing_deque {
+
+namespace internal {
+
+template <typename T> typename WorkStealingDeque<T>::Ring *new_ring(Allocator &a, u32 capacity) {
+    using Ring = typename WorkStealingDeque<T>::Ring;
+
+    constexpr AddrUint items_offset =
+        (sizeof(Ring) + alignof(std::atomic<T>) - 1) / alignof(std::atomic<T>) * alignof(std::atomic<T>);
+    constexpr AddrUint align =
+        alignof(std::atomic<T>) > alignof(Ring) ? alignof(std::atomic<T>) : alignof(Ring);
+
+    auto mem = (u8 *)a.allocate(items_offset + sizeof(std::atomic<T>) * capacity, align);
+
+    Ring *r = new (mem) Ring;
+    r->mask = i64(capacity) - 1;
+    r->next_retired = nullptr;
+    r->items = reinterpret_cast<std::atomic<T> *>(mem + items_offset);
+    for (u32 i = 0; i < capacity; ++i) {
+        new (&r->items[i]) std::atomic<T>();
+    }
+    return r;
+}
+
+// Replaces the full ring with one twice as large holding the items in [top, bottom).
+template <typename T>
+typename WorkStealingDeque<T>::Ring *
+grow(WorkStealingDeque<T> &d, typename WorkStealingDeque<T>::Ring *old, i64 top, i64 bottom) {
+    auto r = new_ring<T>(*d._allocator, u32(old->mask + 1) * 2);
+    for (i64 i = top; i < bottom; ++i) {
+        r->items[i & r->mask].store(old->items[i & old->mask].load(std::memory_order_relaxed),
+                                    std::memory_order_relaxed);
+    }
+    old->next_retired = d._retired;
+    d._retired = old;
+    d._ring.store(r, std::memory_order_release);
+    return r;
+}
+
+} // namespace internal
+
+template <typename T> void push(WorkStealingDeque<T> &d, T item) {
+    const i64 bottom = d._bottom.load(std::memory_order_relaxed);
+    const i64 top = d._top.load(std::memory_order_acquire);
+    auto r = d._ring.load(std::memory_order_relaxed);
+
+    if (bottom - top > r->mask) {
+        r = internal::grow(d, r, top, bottom);
+    }
+
+    r->items[bottom & r->mask].store(item, std::memory_order_relaxed);
+    // Release so that a thief that sees the new bottom also sees the item, and whatever it points to
+    d._bottom.store(bottom + 1, std::memory_order_release);
+}
+
+template <typename T> bool pop(WorkStealingDeque<T> &d, T &item) {
+    const i64 bottom = d._bottom.load(std::memory_order_relaxed) - 1;
+    auto r = d._ring.load(std::memory_order_relaxed);
+
+    // Claim the bottom item before looking at top. Thieves do the opposite, so between the two fences at
+    // least one side sees the other's claim.
+    d._bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 top = d._top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        // Empty
+        d._bottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    item = r->items[bottom & r->mask].load(std::memory_order_relaxed);
+    if (top < bottom) {
+        return true;
+    }
+
+    // The last item, race the thieves for it
+    const bool won =
+        d._top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    d._bottom.store(bottom + 1, std::memory_order_relaxed);
+    return won;
+}
+
+template <typename T> bool steal(WorkStealingDeque<T> &d, T &item) {
+    i64 top = d._top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const i64 bottom = d._bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+        return false;
+    }
+
+    auto r = d._ring.load(std::memory_order_acquire);
+    T x = r->items[top & r->mask].load(std::memory_order_relaxed);
+    if (!d._top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return false;
+    }
+    item = x;
+    return true;
+}
+
+template <typename T> u32 size(const WorkStealingDeque<T> &d) {
+    const i64 top = d._top.load(std::memory_order_acquire);
+    const i64 bottom = d._bottom.load(std::memory_order_acquire);
+    return bottom > top ? u32(bottom - top) : 0;
+}
+
+} // namespace work_stealing_deque
+
+template <typename T>
+WorkStealingDeque<T>::WorkStealingDeque(Allocator &allocator, u32 initial_capacity)
+    : _top(0)
+    , _bottom(0)
+    , _ring(nullptr)
+    , _retired(nullptr)
+    , _allocator(&allocator) {
+    _ring.store(work_stealing_deque::internal::new_ring<T>(
+                  allocator, clip_to_pow2(initial_capacity < 2 ? 2u : initial_capacity)),
+                std::memory_order_relaxed);
+}
+
+template <typename T> WorkStealingDeque<T>::~WorkStealingDeque() {
+    _allocator->deallocate(_ring.load(std::memory_order_relaxed));
+    while (_retired) {
+        Ring *next = _retired->next_retired;
+        _allocator->deallocate(_retired);
+        _retired = next;
+    }
+}
+
+} // namespace fo
@@ -0,0 +1,246 @@
+#include <scaffold/bit_vector.h>
+
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__BMI2__)
+#    include <immintrin.h>
+#endif
+
+namespace fo {
+
+namespace {
+
+using namespace bit_vector_internal;
+
+u32 words_for_bits(u32 num_bits) { return u32((u64(num_bits) + 63) >> 6); }
+
+// Sets or clears the bits of `word` selected by `mask`
+void assign_bits(u64 &word, u64 mask, bool value) { word = value ? word | mask : word & ~mask; }
+
+u64 count_words(const u64 *words, u32 n) {
+    u64 ones = 0;
+    u32 i = 0;
+#if defined(__AVX2__)
+    // Looks up the count of each nibble with a byte shuffle, then sums the bytes into 64-bit lanes
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i sums = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)(words + i));
+        const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_nibbles));
+        const __m256i v_hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+        const __m256i hi = _mm256_shuffle_epi8(lookup, v_hi);
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+    ones = u64(_mm256_extract_epi64(sums, 0)) + u64(_mm256_extract_epi64(sums, 1)) +
+           u64(_mm256_extract_epi64(sums, 2)) + u64(_mm256_extract_epi64(sums, 3));
+#endif
+    for (; i < n; ++i) {
+        ones += popcount(words[i]);
+    }
+    return ones;
+}
+
+// Position of the set bit of `word` with r set bits below it
+u32 select_in_word(u64 word, u32 r) {
+#if defined(__BMI2__)
+    return trailing_zeros(_pdep_u64(u64(1) << r, word));
+#else
+    // Skip whole bytes, then clear the lowest bits of the byte holding it
+    u32 shift = 0;
+    for (u32 c = popcount(word & 0xff); c <= r; c = popcount((word >> shift) & 0xff)) {
+        r -= c;
+        shift += 8;
+    }
+    u64 byte = (word >> shift) & 0xff;
+    for (; r != 0; --r) {
+        byte &= byte - 1;
+    }
+    return shift + trailing_zeros(byte);
+#endif
+}
+
+// Calls `op(dst_word, src_word)` on each word. Plain loops, so they vectorize.
+template <typename Op> void combine(BitVector &dst, const BitVector &src, Op op) {
+    log_assert(dst._num_bits == src._num_bits, "%s - Sizes differ: %u, %u", __PRETTY_FUNCTION__,
+               dst._num_bits, src._num_bits);
+    u64 *d = data(dst._words);
+    const u64 *s = data(src._words);
+    const u32 n = size(dst._words);
+    for (u32 i = 0; i < n; ++i) {
+        d[i] = op(d[i], s[i]);
+    }
+    dst._indexed = false;
+}
+
+} // namespace
+
+BitVector::BitVector(Allocator &allocator)
+    : _words(allocator)
+    , _blocks(allocator)
+    , _select_samples(allocator)
+    , _num_bits(0)
+    , _num_ones(0)
+    , _indexed(false) {}
+
+void resize(BitVector &bv, u32 num_bits) {
+    const u32 old_words = size(bv._words);
+    const u32 new_words = words_for_bits(num_bits);
+    resize(bv._words, new_words);
+    if (new_words > old_words) {
+        memset(data(bv._words) + old_words, 0, sizeof(u64) * (new_words - old_words));
+    }
+    // Keep the bits past the end zero
+    if (num_bits & 63) {
+        bv._words[new_words - 1] &= (u64(1) << (num_bits & 63)) - 1;
+    }
+    bv._num_bits = num_bits;
+    bv._indexed = false;
+}
+
+void set_range(BitVector &bv, u32 begin, u32 end, bool value) {
+    assert(end <= bv._num_bits);
+    if (begin >= end) {
+        return;
+    }
+
+    u64 *words = data(bv._words);
+    const u32 first = begin >> 6;
+    const u32 last = (end - 1) >> 6;
+    const u64 first_mask = ~u64(0) << (begin & 63);
+    const u64 last_mask = ~u64(0) >> (63 - ((end - 1) & 63));
+
+    if (first == last) {
+        assign_bits(words[first], first_mask & last_mask, value);
+    } else {
+        assign_bits(words[first], first_mask, value);
+        memset(words + first + 1, value ? 0xff : 0, sizeof(u64) * (last - first - 1));
+        assign_bits(words[last], last_mask, value);
+    }
+    bv._indexed = false;
+}
+
+u32 count(const BitVector &bv) {
+    return bv._indexed ? bv._num_ones : u32(count_words(data(bv._words), size(bv._words)));
+}
+
+void build_rank_index(BitVector &bv) {
+    const u32 num_words = size(bv._words);
+    // One more block than needed, so `rank1(bv, size(bv))` has a block to read
+    const u32 num_blocks = num_words / BitVector::BLOCK_WORDS + 1;
+    resize(bv._blocks, num_blocks * 2);
+    clear(bv._select_samples);
+
+    u64 ones = 0;
+    u64 next_sample = 0;
+    for (u32 b = 0; b < num_blocks; ++b) {
+        u64 in_block = 0;
+        u64 packed = 0;
+        for (u32 j = 0; j < BitVector::BLOCK_WORDS; ++j) {
+            if (j != 0) {
+                packed |= in_block << (9 * (j - 1));
+            }
+            const u32 w = b * BitVector::BLOCK_WORDS + j;
+            if (w < num_words) {
+                in_block += popcount(bv._words[w]);
+            }
+        }
+        bv._blocks[b * 2] = ones;
+        bv._blocks[b * 2 + 1] = packed;
+
+        for (; next_sample < ones + in_block; next_sample += BitVector::SELECT_SAMPLE) {
+            push_back(bv._select_samples, b);
+        }
+        ones += in_block;
+    }
+
+    bv._num_ones = u32(ones);
+    bv._indexed = true;
+}
+
+u32 select1(const BitVector &bv, u32 k) {
+    assert(bv._indexed && "select1 - Index is stale, call build_rank_index");
+    if (k >= bv._num_ones) {
+        return BitVector::NOT_FOUND;
+    }
+
+    // The one is in the last block in [lo, hi] with no more than k ones before it
+    const u32 s = k / BitVector::SELECT_SAMPLE;
+    u32 lo = bv._select_samples[s];
+    u32 hi = s + 1 < size(bv._select_samples) ? bv._select_samples[s + 1] : size(bv._blocks) / 2 - 1;
+    while (lo < hi) {
+        const u32 mid = lo + (hi - lo + 1) / 2;
+        if (bv._blocks[mid * 2] <= k) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    // Then in the last word of the block with no more than r ones before it
+    const u64 *block = &bv._blocks[lo * 2];
+    u32 r = u32(k - block[0]);
+    u32 before = 0;
+    u32 j = 0;
+    for (; j + 1 < BitVector::BLOCK_WORDS; ++j) {
+        const u32 next = u32((block[1] >> (9 * j)) & 0x1ff);
+        if (next > r) {
+            break;
+        }
+        before = next;
+    }
+    r -= before;
+
+    const u32 w = lo * BitVector::BLOCK_WORDS + j;
+    return w * 64 + select_in_word(bv._words[w], r);
+}
+
+u32 find_first_set(const BitVector &bv, u32 from) {
+    if (from >= bv._num_bits) {
+        return BitVector::NOT_FOUND;
+    }
+    const u32 num_words = size(bv._words);
+    u32 w = from >> 6;
+    u64 word = bv._words[w] & (~u64(0) << (from & 63));
+    while (word == 0) {
+        if (++w == num_words) {
+            return BitVector::NOT_FOUND;
+        }
+        word = bv._words[w];
+    }
+    // Bits past the end are zero, so this is in range
+    return w * 64 + trailing_zeros(word);
+}
+
+u32 find_first_clear(const BitVector &bv, u32 from) {
+    if (from >= bv._num_bits) {
+        return BitVector::NOT_FOUND;
+    }
+    const u32 num_words = size(bv._words);
+    u32 w = from >> 6;
+    u64 word = ~bv._words[w] & (~u64(0) << (from & 63));
+    while (word == 0) {
+        if (++w == num_words) {
+            return BitVector::NOT_FOUND;
+        }
+        word = ~bv._words[w];
+    }
+    // The zeros past the end show up here
+    const u32 i = w * 64 + trailing_zeros(word);
+    return i < bv._num_bits ? i : BitVector::NOT_FOUND;
+}
+
+void bitwise_and(BitVector &dst, const BitVector &src) {
+    combine(dst, src, [](u64 a, u64 b) { return a & b; });
+}
+
+void bitwise_or(BitVector &dst, const BitVector &src) {
+    combine(dst, src, [](u64 a, u64 b) { return a | b; });
+}
+
+void bitwise_xor(BitVector &dst, const BitVector &src) {
+    combine(dst, src, [](u64 a, u64 b) { return a ^ b; });
+}
+
+} // namespace fo
@@ -0,0 +1,330 @@
+#include <scaffold/const_log.h>
+#include <scaffold/jobs.h>
+#include <scaffold/work_stealing_deque.h>
+
+#include <assert.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace fo {
+
+namespace jobs {
+
+namespace {
+
+// A stack allocator over a fixed buffer. Running a job saves the top and restores it afterwards, which frees
+// everything the job allocated. Nested jobs run while waiting are freed before the outer job continues, so
+// the allocations stay in stack order. Allocations that don't fit in the buffer are made from the default
+// allocator, linked in a list, and freed the same way.
+class ScratchStack : public Allocator {
+  public:
+    struct Overflow {
+        Overflow *next;
+        void *allocation; // The backing allocation, this link sits at the end of its header
+    };
+
+    struct Mark {
+        AddrUint top;
+        Overflow *overflow;
+    };
+
+    ScratchStack(Allocator &backing, AddrUint size)
+        : _backing(backing)
+        , _size(size)
+        , _top(0)
+        , _overflow(nullptr) {
+        _buffer = (u8 *)_backing.allocate(size, 64);
+    }
+
+    ~ScratchStack() {
+        release(Mark{ 0, nullptr });
+        _backing.deallocate(_buffer);
+    }
+
+    void *allocate(AddrUint size, AddrUint align = DEFAULT_ALIGN) override {
+        const AddrUint start = (_top + align - 1) / align * align;
+        if (start + size <= _size) {
+            _top = start + size;
+            return _buffer + start;
+        }
+
+        // Room for the list link in front of the allocation, keeping the alignment
+        const AddrUint header = (sizeof(Overflow) + align - 1) / align * align;
+        const AddrUint backing_align = align < alignof(Overflow) ? alignof(Overflow) : align;
+        auto mem = (u8 *)_backing.allocate(header + size, backing_align);
+        auto o = reinterpret_cast<Overflow *>(mem + header - sizeof(Overflow));
+        o->next = _overflow;
+        o->allocation = mem;
+        _overflow = o;
+        return mem + header;
+    }
+
+    void *reallocate(void *old_allocation, AddrUint new_size, AddrUint align, AddrUint old_size) override {
+        DefaultReallocInfo realloc_info = {};
+        default_realloc(old_allocation, new_size, align, old_size, &realloc_info);
+        return realloc_info.new_allocation;
+    }
+
+    /// Nop, memory is freed when the job returns.
+    void deallocate(void *) override {}
+
+    AddrUint allocated_size(void *) override { return SIZE_NOT_TRACKED; }
+
+    AddrUint total_allocated() override { return SIZE_NOT_TRACKED; }
+
+    Mark mark() const { return Mark{ _top, _overflow }; }
+
+    void release(Mark m) {
+        while (_overflow != m.overflow) {
+            Overflow *next = _overflow->next;
+            _backing.deallocate(_overflow->allocation);
+            _overflow = next;
+        }
+        _top = m.top;
+    }
+
+  private:
+    Allocator &_backing;
+    u8 *_buffer;
+    AddrUint _size;
+    AddrUint _top;
+    Overflow *_overflow;
+};
+
+struct ThreadState {
+    WorkStealingDeque<Job *> deque;
+    Job *jobs; // Ring of `max_jobs_per_thread` jobs, unfinished ones are skipped
+    u32 next_job;
+    ScratchStack scratch;
+    u32 index;
+    u32 rng;
+
+    ThreadState(Allocator &a, const InitConfig &config, u32 index)
+        : deque(a, config.max_jobs_per_thread)
+        , jobs(nullptr)
+        , next_job(0)
+        , scratch(a, config.scratch_size)
+        , index(index)
+        , rng(index * 0x9E3779B9u + 1) {
+        jobs = (Job *)a.allocate(sizeof(Job) * config.max_jobs_per_thread, alignof(Job));
+        for (u32 i = 0; i < config.max_jobs_per_thread; ++i) {
+            Job *job = new (&jobs[i]) Job;
+            job->_unfinished.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct JobSystem {
+    Allocator *allocator = nullptr;
+    InitConfig config;
+
+    ThreadState **threads = nullptr;
+    u32 num_threads = 0;
+    std::thread *workers = nullptr;
+
+    // Jobs queued and not yet taken by any thread. Idle workers sleep while it's zero.
+    std::atomic<i32> num_queued{ 0 };
+    std::atomic<u32> num_sleeping{ 0 };
+    std::atomic<bool> stop{ false };
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+};
+
+JobSystem g_jobs;
+
+thread_local ThreadState *t_state = nullptr;
+
+ThreadState &this_thread() {
+    log_assert(t_state, "%s - Not a job system thread", __PRETTY_FUNCTION__);
+    return *t_state;
+}
+
+void finish(Job *job) {
+    while (job) {
+        // Once finished, the job can be recycled by its creator at any moment, so read the parent first
+        Job *parent = job->_parent;
+        if (job->_unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        job = parent;
+    }
+}
+
+void execute(ThreadState &ts, Job *job) {
+    const ScratchStack::Mark mark = ts.scratch.mark();
+    job->_run(job);
+    ts.scratch.release(mark);
+    finish(job);
+}
+
+// Returns a job from the calling thread's own deque, or failing that, one stolen from another thread.
+Job *find_job(ThreadState &ts) {
+    Job *job;
+    if (work_stealing_deque::pop(ts.deque, job)) {
+        g_jobs.num_queued.fetch_sub(1);
+        return job;
+    }
+
+    // Visit the others starting at a random one, so thieves spread over the victims
+    ts.rng ^= ts.rng << 13;
+    ts.rng ^= ts.rng >> 17;
+    ts.rng ^= ts.rng << 5;
+    const u32 start = ts.rng % g_jobs.num_threads;
+    for (u32 i = 0; i < g_jobs.num_threads; ++i) {
+        ThreadState *victim = g_jobs.threads[(start + i) % g_jobs.num_threads];
+        if (victim != &ts && work_stealing_deque::steal(victim->deque, job)) {
+            g_jobs.num_queued.fetch_sub(1);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void worker_main(u32 index) {
+    t_state = g_jobs.threads[index];
+    ThreadState &ts = *t_state;
+
+    while (!g_jobs.stop.load()) {
+        if (Job *job = find_job(ts)) {
+            execute(ts, job);
+            continue;
+        }
+
+        // `run` increments `num_queued` before it checks `num_sleeping`, and we do the opposite, so either we
+        // see the job or it sees us and wakes us.
+        std::unique_lock<std::mutex> lock(g_jobs.sleep_mutex);
+        g_jobs.num_sleeping.fetch_add(1);
+        g_jobs.wake.wait(lock, [] { return g_jobs.num_queued.load() > 0 || g_jobs.stop.load(); });
+        g_jobs.num_sleeping.fetch_sub(1);
+    }
+
+    t_state = nullptr;
+}
+
+} // namespace
+
+void init(const InitConfig &config) {
+    log_assert(g_jobs.allocator == nullptr, "%s - Already initialized", __PRETTY_FUNCTION__);
+    log_assert(config.max_jobs_per_thread != 0 && is_power_of_2(config.max_jobs_per_thread),
+               "%s - max_jobs_per_thread must be a power of two",
+               __PRETTY_FUNCTION__);
+
+    Allocator &a = memory_globals::default_allocator();
+    g_jobs.allocator = &a;
+    g_jobs.config = config;
+
+    u32 num_workers = config.num_workers;
+    if (num_workers == ~0u) {
+        const u32 hardware = std::thread::hardware_concurrency();
+        num_workers = hardware > 1 ? hardware - 1 : 0;
+    }
+    g_jobs.num_threads = num_workers + 1;
+    g_jobs.stop.store(false);
+    g_jobs.num_queued.store(0);
+
+    g_jobs.threads =
+        (ThreadState **)a.allocate(sizeof(ThreadState *) * g_jobs.num_threads, alignof(ThreadState *));
+    for (u32 i = 0; i < g_jobs.num_threads; ++i) {
+        g_jobs.threads[i] = make_new<ThreadState>(a, a, config, i);
+    }
+    t_state = g_jobs.threads[0];
+
+    g_jobs.workers = (std::thread *)a.allocate(sizeof(std::thread) * num_workers, alignof(std::thread));
+    for (u32 i = 0; i < num_workers; ++i) {
+        new (&g_jobs.workers[i]) std::thread(worker_main, i + 1);
+    }
+}
+
+void shutdown() {
+    log_assert(g_jobs.allocator, "%s - Not initialized", __PRETTY_FUNCTION__);
+    log_assert(g_jobs.num_queued.load() == 0, "%s - Jobs still queued", __PRETTY_FUNCTION__);
+
+    {
+        std::lock_guard<std::mutex> lock(g_jobs.sleep_mutex);
+        g_jobs.stop.store(true);
+    }
+    g_jobs.wake.notify_all();
+
+    Allocator &a = *g_jobs.allocator;
+    for (u32 i = 0; i < g_jobs.num_threads - 1; ++i) {
+        g_jobs.workers[i].join();
+        g_jobs.workers[i].~thread();
+    }
+    a.deallocate(g_jobs.workers);
+
+    for (u32 i = 0; i < g_jobs.num_threads; ++i) {
+        a.deallocate(g_jobs.threads[i]->jobs);
+        make_delete(a, g_jobs.threads[i]);
+    }
+    a.deallocate(g_jobs.threads);
+
+    t_state = nullptr;
+    g_jobs.threads = nullptr;
+    g_jobs.workers = nullptr;
+    g_jobs.num_threads = 0;
+    g_jobs.allocator = nullptr;
+}
+
+u32 num_threads() { return g_jobs.num_threads; }
+
+u32 thread_index() { return this_thread().index; }
+
+bool is_job_thread() { return t_state != nullptr; }
+
+Job *internal::allocate_job(Job *parent) {
+    ThreadState &ts = this_thread();
+    const u32 mask = g_jobs.config.max_jobs_per_thread - 1;
+
+    // Skip the slots of jobs still running or waited on, such as a parallel_for root, so only live jobs
+    // count against the limit. Jobs mostly finish in about the order they were created, so the next slot
+    // is nearly always free.
+    Job *job = nullptr;
+    for (u32 i = 0; i <= mask && job == nullptr; ++i) {
+        Job *slot = &ts.jobs[ts.next_job++ & mask];
+        if (slot->_unfinished.load(std::memory_order_acquire) == 0) {
+            job = slot;
+        }
+    }
+    log_assert(job, "%s - Too many unfinished jobs, raise max_jobs_per_thread", __PRETTY_FUNCTION__);
+
+    job->_parent = parent;
+    job->_unfinished.store(1, std::memory_order_relaxed);
+    if (parent) {
+        parent->_unfinished.fetch_add(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job *create_group(Job *parent) {
+    return create([]() {}, parent);
+}
+
+void run(Job *job) {
+    ThreadState &ts = this_thread();
+    work_stealing_deque::push(ts.deque, job);
+    g_jobs.num_queued.fetch_add(1);
+    if (g_jobs.num_sleeping.load() != 0) {
+        std::lock_guard<std::mutex> lock(g_jobs.sleep_mutex);
+        g_jobs.wake.notify_one();
+    }
+}
+
+bool is_finished(const Job *job) { return job->_unfinished.load(std::memory_order_acquire) == 0; }
+
+void wait(const Job *job) {
+    ThreadState &ts = this_thread();
+    while (!is_finished(job)) {
+        if (Job *other = find_job(ts)) {
+            execute(ts, other);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+Allocator &scratch_allocator() { return this_thread().scratch; }
+
+} // namespace jobs
+
+} // namespace fo
@@ -0,0 +1,91 @@
+#include <scaffold/magic_ring_queue.h>
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#    define MMAP_AVAILABLE 1
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+#else
+#    define MMAP_AVAILABLE 0
+#endif
+
+#if MMAP_AVAILABLE && !defined(__linux__)
+#    include <atomic>
+#    include <stdio.h>
+#endif
+
+namespace fo {
+
+#if MMAP_AVAILABLE
+
+u64 page_size() { return u64(sysconf(_SC_PAGESIZE)); }
+
+// Returns an unlinked shared memory file of the given size
+static int shared_memory_file(u64 size) {
+#    if defined(__linux__)
+    const int fd = memfd_create("fo_magic_ring", 0);
+#    else
+    static std::atomic<u32> counter(0);
+    char name[64];
+    snprintf(name, sizeof(name), "/fo_magic_ring_%d_%u", int(getpid()), counter++);
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        shm_unlink(name);
+    }
+#    endif
+    log_assert(fd >= 0, "%s - Failed to create shared memory", __PRETTY_FUNCTION__);
+    const int res = ftruncate(fd, off_t(size));
+    log_assert(res == 0, "%s - Failed to resize shared memory", __PRETTY_FUNCTION__);
+    return fd;
+}
+
+MirroredMemory map_mirrored(u64 size) {
+    log_assert(size != 0 && size % page_size() == 0,
+               "%s - Size must be a multiple of the page size",
+               __PRETTY_FUNCTION__);
+
+    const int fd = shared_memory_file(size);
+
+    // Reserve address space for both copies, then map the file over each half
+    void *reserved = mmap(nullptr, size_t(size * 2), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    log_assert(reserved != MAP_FAILED, "%s - Failed to reserve address space", __PRETTY_FUNCTION__);
+
+    u8 *base = (u8 *)reserved;
+    void *first = mmap(base, size_t(size), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void *second = mmap(base + size, size_t(size), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    log_assert(first == base && second == base + size,
+               "%s - Failed to map the ring twice",
+               __PRETTY_FUNCTION__);
+
+    // The mappings keep the memory alive
+    close(fd);
+
+    MirroredMemory m;
+    m._base = base;
+    m._size = size;
+    return m;
+}
+
+void unmap_mirrored(MirroredMemory &m) {
+    if (m._base) {
+        const int res = munmap(m._base, size_t(m._size * 2));
+        log_assert(res == 0, "%s - munmap failed", __PRETTY_FUNCTION__);
+        m = MirroredMemory{};
+    }
+}
+
+#else
+
+u64 page_size() { return 4096; }
+
+MirroredMemory map_mirrored(u64 size) {
+    (void)size;
+    log_assert(false, "%s - Not supported on this platform", __PRETTY_FUNCTION__);
+    return MirroredMemory{};
+}
+
+void unmap_mirrored(MirroredMemory &m) { m = MirroredMemory{}; }
+
+#endif
+
+} // namespace fo
@@ -272,14 +272,43 @@ class MallocAllocator : public Allocator {
         return p;
     }
 
+    // Goes through realloc, which can extend a block in place, and which moves large blocks (the ones malloc
+    // got from mmap) by remapping their pages with mremap instead of copying them.
     void *reallocate(void *old_allocation,
                      AddrUint new_size,
                      AddrUint align,
                      AddrUint optional_old_size = DONT_CARE_OLD_SIZE) override {
-        DefaultReallocInfo realloc_info = {};
-        default_realloc(old_allocation, new_size, align, optional_old_size, &realloc_info);
+        (void)optional_old_size; // The header has the size
 
-        return realloc_info.new_allocation;
+        if (old_allocation == nullptr) {
+            return allocate(new_size, align);
+        }
+        if (new_size == 0) {
+            deallocate(old_allocation);
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lk(_mutex);
+
+        HeaderNative *h = header_before_data<HeaderNative>(old_allocation);
+        const AddrUint old_size = h->size;
+        const AddrUint old_offset = AddrUint((u8 *)old_allocation - (u8 *)h);
+
+        // Pad for the old offset too, so that the data keeps fitting in the block until it's moved below
+        const AddrUint pad = align > old_offset ? align : old_offset;
+        HeaderNative *new_h = reinterpret_cast<HeaderNative *>(realloc(h, size_with_padding(new_size, pad)));
+        log_assert(new_h != nullptr, "MallocAllocator failed to reallocate " ADDRUINT_FMT " bytes", new_size);
+
+        // The block's new address can have a different alignment, in which case the data moves within it
+        void *p = data_pointer(new_h, align);
+        const AddrUint offset = AddrUint((u8 *)p - (u8 *)new_h);
+        if (offset != old_offset) {
+            memmove(p, (u8 *)new_h + old_offset, old_size < new_size ? old_size : new_size);
+        }
+        fill_with_padding(new_h, p, new_size);
+
+        _total_allocated = _total_allocated - old_size + new_size;
+        return p;
     }
 
     void deallocate(void *p) override {
@@ -1,11 +1,90 @@
 #include <scaffold/array.h>
 #include <scaffold/debug.h>
+#include <scaffold/small_array.h>
 
 #include <algorithm>
 #include <assert.h>
 
 using namespace fo;
 
+// Forwards to the default allocator, counting the allocations still live.
+struct CountingAllocator : public Allocator {
+    int live = 0;
+
+    void *allocate(AddrUint size, AddrUint align = DEFAULT_ALIGN) override {
+        ++live;
+        return memory_globals::default_allocator().allocate(size, align);
+    }
+
+    void *reallocate(void *old_allocation, AddrUint new_size, AddrUint align, AddrUint old_size) override {
+        live += old_allocation == nullptr;
+        return memory_globals::default_allocator().reallocate(old_allocation, new_size, align, old_size);
+    }
+
+    void deallocate(void *p) override {
+        live -= p != nullptr;
+        memory_globals::default_allocator().deallocate(p);
+    }
+
+    AddrUint allocated_size(void *p) override {
+        return memory_globals::default_allocator().allocated_size(p);
+    }
+
+    AddrUint total_allocated() override { return SIZE_NOT_TRACKED; }
+};
+
+static void test_small_array() {
+    CountingAllocator ca;
+    {
+        // No allocation while the items fit inline
+        SmallArray<int, 4> a(ca);
+        for (int i = 0; i < 4; ++i) {
+            push_back(a, i);
+        }
+        assert(is_inline(a) && ca.live == 0);
+
+        // Spills on overflow, keeping the items
+        push_back(a, 4);
+        assert(!is_inline(a) && ca.live == 1);
+        for (int i = 0; i < 100; ++i) {
+            push_back(a, 5 + i);
+        }
+        assert(size(a) == 105 && ca.live == 1);
+        for (int i = 0; i < 105; ++i) {
+            assert(a[i] == i);
+        }
+
+        // Copies and moves of spilled and inline arrays
+        SmallArray<int, 4> b = a;
+        assert(ca.live == 2 && size(b) == 105 && b[104] == 104);
+        SmallArray<int, 4> c = std::move(b);
+        assert(ca.live == 2 && size(b) == 0 && is_inline(b) && c[104] == 104);
+
+        SmallArray<int, 4> d({ 7, 8, 9 }, ca);
+        // Moving from an inline array copies into the buffer already there
+        c = std::move(d);
+        assert(ca.live == 2 && size(c) == 3 && c[2] == 9 && size(d) == 0);
+        b = c;
+        assert(ca.live == 2 && is_inline(b) && size(b) == 3 && b[0] == 7);
+
+        // Trimming moves the items back inline
+        trim(c);
+        resize(a, 3);
+        trim(a);
+        assert(is_inline(a) && is_inline(c) && ca.live == 0);
+        assert(a[0] == 0 && a[1] == 1 && a[2] == 2);
+
+        reserve(a, 10);
+        assert(!is_inline(a) && ca.live == 1 && a[2] == 2);
+        free(a);
+        assert(is_inline(a) && ca.live == 0 && empty(a));
+
+        resize(a, 1000);
+        assert(ca.live == 1);
+    }
+    assert(ca.live == 0);
+}
+
 int main() {
     memory_globals::init();
     {
@@ -60,6 +139,8 @@ int main() {
 #else
         resize(arr1, 2048);
 #endif
+
+        test_small_array();
     }
     memory_globals::shutdown();
 }
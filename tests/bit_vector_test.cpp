@@ -0,0 +1,137 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/bit_vector.h>
+
+#include <random>
+#include <vector>
+
+using namespace fo;
+
+// Checks every query against a std::vector<bool> holding the same bits
+static void check_against(const BitVector &bv, const std::vector<bool> &bits) {
+    REQUIRE(size(bv) == bits.size());
+
+    u32 bad = 0;
+    u32 ones = 0;
+    std::vector<u32> positions;
+    for (u32 i = 0; i < bits.size(); ++i) {
+        bad += get(bv, i) != bits[i];
+        bad += rank1(bv, i) != ones;
+        bad += rank0(bv, i) != i - ones;
+        if (bits[i]) {
+            positions.push_back(i);
+            ++ones;
+        }
+    }
+    REQUIRE(bad == 0);
+    REQUIRE(rank1(bv, size(bv)) == ones);
+    REQUIRE(count(bv) == ones);
+
+    for (u32 k = 0; k < positions.size(); ++k) {
+        bad += select1(bv, k) != positions[k];
+    }
+    REQUIRE(bad == 0);
+    REQUIRE(select1(bv, ones) == BitVector::NOT_FOUND);
+
+    // Scans from every position
+    u32 next_set = BitVector::NOT_FOUND;
+    u32 next_clear = BitVector::NOT_FOUND;
+    for (u32 i = u32(bits.size()); i-- > 0;) {
+        (bits[i] ? next_set : next_clear) = i;
+        bad += find_first_set(bv, i) != next_set;
+        bad += find_first_clear(bv, i) != next_clear;
+    }
+    REQUIRE(bad == 0);
+    REQUIRE(find_first_set(bv, size(bv)) == BitVector::NOT_FOUND);
+}
+
+TEST_CASE("BitVector rank and select", "[BitVector]") {
+    memory_globals::init();
+    {
+        std::mt19937 rng(11);
+
+        // Sizes around the word and block boundaries, at a few densities
+        for (u32 n : { 0u, 1u, 63u, 64u, 65u, 511u, 512u, 513u, 4096u, 20000u }) {
+            for (u32 density : { 0u, 1u, 50u, 99u, 100u }) {
+                BitVector bv;
+                resize(bv, n);
+                std::vector<bool> bits(n);
+                for (u32 i = 0; i < n; ++i) {
+                    bits[i] = rng() % 100 < density;
+                    set(bv, i, bits[i]);
+                }
+                build_rank_index(bv);
+                check_against(bv, bits);
+            }
+        }
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("BitVector ranges and bulk operations", "[BitVector_bulk]") {
+    memory_globals::init();
+    {
+        std::mt19937 rng(5);
+        const u32 n = 3000;
+
+        BitVector a;
+        BitVector b;
+        resize(a, n);
+        resize(b, n);
+        std::vector<bool> bits_a(n);
+        std::vector<bool> bits_b(n);
+
+        for (u32 step = 0; step < 200; ++step) {
+            const u32 begin = rng() % n;
+            const u32 end = begin + rng() % (n - begin + 1);
+            const bool value = rng() & 1;
+            BitVector &bv = step & 1 ? a : b;
+            std::vector<bool> &bits = step & 1 ? bits_a : bits_b;
+            set_range(bv, begin, end, value);
+            for (u32 i = begin; i < end; ++i) {
+                bits[i] = value;
+            }
+        }
+        build_rank_index(a);
+        check_against(a, bits_a);
+
+        BitVector c = a;
+        bitwise_and(c, b);
+        std::vector<bool> expected(n);
+        for (u32 i = 0; i < n; ++i) {
+            expected[i] = bits_a[i] && bits_b[i];
+        }
+        build_rank_index(c);
+        check_against(c, expected);
+
+        c = a;
+        bitwise_or(c, b);
+        for (u32 i = 0; i < n; ++i) {
+            expected[i] = bits_a[i] || bits_b[i];
+        }
+        build_rank_index(c);
+        check_against(c, expected);
+
+        c = a;
+        bitwise_xor(c, b);
+        for (u32 i = 0; i < n; ++i) {
+            expected[i] = bits_a[i] != bits_b[i];
+        }
+        build_rank_index(c);
+        check_against(c, expected);
+
+        // x ^ x leaves nothing set
+        bitwise_xor(c, c);
+        REQUIRE(count(c) == 0);
+
+        // Shrinking drops the bits past the end, growing adds zeros
+        set_range(a, 0, n, true);
+        resize(a, 100);
+        resize(a, 200);
+        REQUIRE(count(a) == 100);
+        REQUIRE(find_first_clear(a) == 100);
+        REQUIRE(find_first_set(a, 100) == BitVector::NOT_FOUND);
+    }
+    memory_globals::shutdown();
+}
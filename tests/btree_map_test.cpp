@@ -0,0 +1,232 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/btree_map.h>
+
+#include <map>
+#include <string>
+
+using namespace fo;
+
+namespace {
+
+// Checks the structure: key order within and across nodes, node occupancy and the leaf list.
+template <typename Key, typename Value, typename Less>
+u32 check_node(const BTreeMap<Key, Value, Less> &m,
+               const btree_internal::NodeHeader *node,
+               const btree_internal::Leaf<Key, Value> *&prev_leaf,
+               u32 depth,
+               u32 &leaf_depth) {
+    using Capacity = btree_internal::Capacity<Key, Value>;
+
+    if (node->_is_leaf) {
+        auto leaf = static_cast<const btree_internal::Leaf<Key, Value> *>(node);
+        REQUIRE((node == m._root || leaf->_num_keys >= Capacity::leaf_min));
+        REQUIRE(leaf->_prev == prev_leaf);
+        if (prev_leaf) {
+            REQUIRE(prev_leaf->_next == leaf);
+        } else {
+            REQUIRE(m._first_leaf == leaf);
+        }
+        prev_leaf = leaf;
+
+        if (leaf_depth == ~u32(0)) {
+            leaf_depth = depth;
+        }
+        REQUIRE(leaf_depth == depth);
+        return leaf->_num_keys;
+    }
+
+    auto inner = static_cast<const btree_internal::Inner<Key, Value> *>(node);
+    REQUIRE(inner->_num_keys >= (node == m._root ? 1 : Capacity::inner_min));
+
+    u32 count = 0;
+    for (u32 i = 0; i <= inner->_num_keys; ++i) {
+        count += check_node(m, inner->_children[i], prev_leaf, depth + 1, leaf_depth);
+    }
+    return count;
+}
+
+template <typename Key, typename Value, typename Less> void check_tree(const BTreeMap<Key, Value, Less> &m) {
+    if (!m._root) {
+        REQUIRE(size(m) == 0);
+        return;
+    }
+    const btree_internal::Leaf<Key, Value> *prev_leaf = nullptr;
+    u32 leaf_depth = ~u32(0);
+    REQUIRE(check_node(m, m._root, prev_leaf, 0, leaf_depth) == size(m));
+    REQUIRE(m._last_leaf == prev_leaf);
+}
+
+} // namespace
+
+TEST_CASE("BTreeMap insert remove", "[BTreeMap]") {
+    memory_globals::init();
+    {
+        BTreeMap<u64, u64> m(memory_globals::default_allocator());
+        std::map<u64, u64> expected;
+
+        REQUIRE(get(m, u64(1)) == end(m));
+        REQUIRE(!remove(m, u64(1)));
+        REQUIRE(begin(m) == end(m));
+
+        u64 x = 0x2545F4914F6CDD1Dull;
+        for (u32 i = 0; i < 100000; ++i) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+
+            const u64 key = x % 5000;
+            if (x % 3 == 0) {
+                REQUIRE(remove(m, key) == (expected.erase(key) == 1));
+            } else {
+                auto it = set(m, key, x);
+                REQUIRE(it->k == key);
+                REQUIRE(it->v == x);
+                expected[key] = x;
+            }
+
+            if (i % 10000 == 0) {
+                check_tree(m);
+            }
+        }
+
+        check_tree(m);
+        REQUIRE(size(m) == expected.size());
+
+        auto e = expected.begin();
+        for (auto &entry : m) {
+            REQUIRE(entry.k == e->first);
+            REQUIRE(entry.v == e->second);
+            ++e;
+        }
+        REQUIRE(e == expected.end());
+
+        // Backwards
+        auto it = end(m);
+        for (auto r = expected.rbegin(); r != expected.rend(); ++r) {
+            --it;
+            REQUIRE(it->k == r->first);
+        }
+        REQUIRE(it == begin(m));
+
+        // Remove everything, the tree must shrink back to nothing
+        for (auto &kv : expected) {
+            REQUIRE(remove(m, kv.first));
+        }
+        check_tree(m);
+        REQUIRE(size(m) == 0);
+        REQUIRE(m._root == nullptr);
+        REQUIRE(begin(m) == end(m));
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("BTreeMap sequential keys and range scans", "[BTreeMap_range]") {
+    memory_globals::init();
+    {
+        BTreeMap<u32, u32> m(memory_globals::default_allocator());
+
+        // Ascending inserts always split the last leaf
+        for (u32 i = 0; i < 20000; ++i) {
+            set(m, i * 2, i);
+        }
+        check_tree(m);
+
+        const auto &cm = m;
+        REQUIRE(lower_bound(cm, 100u)->k == 100);
+        REQUIRE(lower_bound(cm, 101u)->k == 102);
+        REQUIRE(upper_bound(cm, 100u)->k == 102);
+        REQUIRE(lower_bound(cm, 39998u)->k == 39998);
+        REQUIRE(upper_bound(cm, 39998u) == end(cm));
+        REQUIRE(lower_bound(cm, 50000u) == end(cm));
+
+        u32 sum = 0;
+        for (auto it = lower_bound(cm, 1000u), last = lower_bound(cm, 2000u); it != last; ++it) {
+            sum += it->v;
+        }
+        REQUIRE(sum == (500 + 999) * 500 / 2);
+
+        // Descending removes always take from the last leaf
+        for (u32 i = 20000; i-- > 10000;) {
+            REQUIRE(remove(m, i * 2));
+        }
+        check_tree(m);
+        REQUIRE(size(m) == 10000);
+        REQUIRE((--end(m))->k == 19998);
+
+        // Every other one, from the front
+        for (u32 i = 0; i < 10000; i += 2) {
+            REQUIRE(remove(m, i * 2));
+        }
+        check_tree(m);
+        REQUIRE(size(m) == 5000);
+        REQUIRE(begin(m)->k == 2);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("BTreeMap string keys, copy and move", "[BTreeMap_copy]") {
+    memory_globals::init();
+    {
+        BTreeMap<std::string, u32> m(memory_globals::default_allocator());
+
+        for (u32 i = 0; i < 3000; ++i) {
+            auto &count = set_default(m, std::to_string(i % 1000), 0u)->v;
+            ++count;
+        }
+        REQUIRE(size(m) == 1000);
+        REQUIRE(get(m, std::string("999"))->v == 3);
+        ++m[std::string("999")];
+        REQUIRE(get(m, std::string("999"))->v == 4);
+        REQUIRE(m[std::string("abc")] == 0);
+        check_tree(m);
+
+        BTreeMap<std::string, u32> copy(m);
+        check_tree(copy);
+        REQUIRE(size(copy) == 1001);
+
+        for (u32 i = 0; i < 1000; i += 2) {
+            REQUIRE(remove(m, std::to_string(i)));
+        }
+        check_tree(m);
+        REQUIRE(size(m) == 501);
+        REQUIRE(get(copy, std::string("0"))->v == 3);
+
+        copy = m;
+        check_tree(copy);
+        REQUIRE(get(copy, std::string("0")) == end(copy));
+        REQUIRE(get(copy, std::string("1"))->v == 3);
+
+        BTreeMap<std::string, u32> moved(std::move(copy));
+        REQUIRE(size(moved) == 501);
+
+        moved = std::move(m);
+        REQUIRE(size(moved) == 501);
+        check_tree(moved);
+
+        clear(moved);
+        REQUIRE(size(moved) == 0);
+        set(moved, std::string("x"), 1u);
+        REQUIRE(get(moved, std::string("x"))->v == 1);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("BTreeMap custom less", "[BTreeMap_less]") {
+    memory_globals::init();
+    {
+        BTreeMap<u32, u32, std::greater<u32>> m(memory_globals::default_allocator());
+        for (u32 i = 0; i < 1000; ++i) {
+            set(m, (i * 7919) % 1000, i);
+        }
+        check_tree(m);
+
+        u32 expected = 999;
+        for (auto &entry : m) {
+            REQUIRE(entry.k == expected);
+            --expected;
+        }
+    }
+    memory_globals::shutdown();
+}
@@ -0,0 +1,271 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/concurrent_open_hash.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct GetNilAndDeleted__uint64_t {
+    static constexpr uint64_t get_nil() { return ~uint64_t(0); }
+    static constexpr uint64_t get_deleted() { return ~uint64_t(0) - 1; }
+};
+
+using hash_type = fo::ConcurrentOpenHash<uint64_t, uint64_t, GetNilAndDeleted__uint64_t>;
+
+namespace coh = fo::concurrent_open_hash;
+
+static uint32_t hash_u64(const uint64_t &i) { return uint32_t(i * 0x9E3779B97F4A7C15ull >> 32); }
+static bool equal_u64(const uint64_t &i, const uint64_t &j) { return i == j; }
+
+TEST_CASE("ConcurrentOpenHash set get remove", "[ConcurrentOpenHash_basic]") {
+    fo::memory_globals::init();
+    {
+        hash_type h{ fo::memory_globals::default_allocator(), 16, hash_u64, equal_u64 };
+
+        for (uint64_t k = 0; k < 4096; ++k) {
+            coh::set(h, k, k * 3);
+        }
+        REQUIRE(coh::size(h) == 4096);
+
+        // Overwrite doesn't add keys
+        for (uint64_t k = 0; k < 4096; k += 2) {
+            coh::set(h, k, k * 5);
+        }
+        REQUIRE(coh::size(h) == 4096);
+
+        for (uint64_t k = 0; k < 4096; ++k) {
+            uint64_t v = 0;
+            REQUIRE(coh::get(h, k, v));
+            REQUIRE(v == (k % 2 == 0 ? k * 5 : k * 3));
+        }
+
+        for (uint64_t k = 0; k < 4096; k += 3) {
+            coh::remove(h, k);
+        }
+
+        for (uint64_t k = 0; k < 4096; ++k) {
+            REQUIRE(coh::has(h, k) == (k % 3 != 0));
+        }
+
+        coh::reclaim_retired(h);
+
+        // Deleted slots are reused
+        for (uint64_t k = 0; k < 4096; k += 3) {
+            coh::set(h, k, uint64_t(1));
+        }
+        REQUIRE(coh::size(h) == 4096);
+    }
+    fo::memory_globals::shutdown();
+}
+
+TEST_CASE("ConcurrentOpenHash from OpenHash", "[ConcurrentOpenHash_from_open_hash]") {
+    fo::memory_globals::init();
+    {
+        auto &alloc = fo::memory_globals::default_allocator();
+
+        fo::OpenHash<uint64_t, uint64_t, GetNilAndDeleted__uint64_t> oh{ alloc, 16, hash_u64, equal_u64 };
+
+        for (uint64_t k = 0; k < 1000; ++k) {
+            fo::open_hash::set(oh, k, 1000 - k);
+        }
+
+        hash_type h{ alloc, oh };
+
+        REQUIRE(coh::size(h) == 1000);
+        for (uint64_t k = 0; k < 1000; ++k) {
+            uint64_t v = 0;
+            REQUIRE(coh::get(h, k, v));
+            REQUIRE(v == 1000 - k);
+        }
+    }
+    fo::memory_globals::shutdown();
+}
+
+TEST_CASE("ConcurrentOpenHash readers during writes", "[ConcurrentOpenHash_threads]") {
+    fo::memory_globals::init();
+    {
+        hash_type h{ fo::memory_globals::default_allocator(), 16, hash_u64, equal_u64 };
+
+        constexpr uint64_t stable_keys = 1024;
+        constexpr uint64_t total_keys = 1 << 16;
+
+        // Values are always key * 7, so a reader can check that it never sees a torn or foreign value.
+        for (uint64_t k = 0; k < stable_keys; ++k) {
+            coh::set(h, k, k * 7);
+        }
+
+        std::atomic<bool> done{ false };
+        std::atomic<uint64_t> bad_reads{ 0 };
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&]() {
+                uint64_t k = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    uint64_t v = 0;
+                    // Stable keys must always be found, even while the table grows under us.
+                    if (!coh::get(h, k % stable_keys, v) || v != (k % stable_keys) * 7) {
+                        bad_reads.fetch_add(1);
+                    }
+                    const uint64_t other = stable_keys + k % (total_keys - stable_keys);
+                    if (coh::get(h, other, v) && v != other * 7) {
+                        bad_reads.fetch_add(1);
+                    }
+                    ++k;
+                }
+            });
+        }
+
+        uint32_t removed = 0;
+        for (uint64_t k = stable_keys; k < total_keys; ++k) {
+            coh::set(h, k, k * 7);
+            if (k % 5 == 0) {
+                coh::remove(h, k);
+                ++removed;
+            }
+        }
+
+        done.store(true);
+        for (auto &t : readers) {
+            t.join();
+        }
+
+        REQUIRE(bad_reads.load() == 0);
+        REQUIRE(coh::size(h) == total_keys - removed);
+    }
+    fo::memory_globals::shutdown();
+}
+
+TEST_CASE("ConcurrentOpenHash reader doesn't wait on a stalled writer", "[ConcurrentOpenHash_stalled]") {
+    fo::memory_globals::init();
+    {
+        hash_type h{ fo::memory_globals::default_allocator(), 16, hash_u64, equal_u64 };
+        coh::set(h, uint64_t(5), uint64_t(35));
+
+        // Leave the slot as a writer preempted half way through an overwrite would: counter odd, spare copy
+        // partly written.
+        auto t = h._table.load();
+        uint32_t idx = 0;
+        while (t->slots[idx].copies[0].key.load() != 5 && t->slots[idx].copies[1].key.load() != 5) {
+            ++idx;
+        }
+        auto &slot = t->slots[idx];
+        const uint32_t seq = slot.seq.load();
+        slot.seq.store(seq + 1);
+        slot.copies[((seq >> 1) + 1) & 1].value = 99;
+
+        uint64_t v = 0;
+        REQUIRE(coh::get(h, uint64_t(5), v));
+        REQUIRE(v == 35);
+        REQUIRE(!coh::has(h, uint64_t(6)));
+
+        slot.seq.store(seq);
+    }
+    fo::memory_globals::shutdown();
+}
+
+struct CheckedValue {
+    uint64_t a;
+    uint64_t not_a; // Always ~a, unless a read was torn
+};
+
+TEST_CASE("ConcurrentOpenHash readers during overwrites", "[ConcurrentOpenHash_overwrites]") {
+    fo::memory_globals::init();
+    {
+        fo::ConcurrentOpenHash<uint64_t, CheckedValue, GetNilAndDeleted__uint64_t> h{
+            fo::memory_globals::default_allocator(), 16, hash_u64, equal_u64
+        };
+
+        constexpr uint64_t num_keys = 64;
+        for (uint64_t k = 0; k < num_keys; ++k) {
+            coh::set(h, k, CheckedValue{ 0, ~uint64_t(0) });
+        }
+
+        std::atomic<bool> done{ false };
+        std::atomic<uint64_t> bad_reads{ 0 };
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&]() {
+                uint64_t k = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    CheckedValue v{ 0, 0 };
+                    if (!coh::get(h, k % num_keys, v) || v.not_a != ~v.a) {
+                        bad_reads.fetch_add(1);
+                    }
+                    ++k;
+                }
+            });
+        }
+
+        // The same few slots are rewritten over and over
+        for (uint64_t i = 1; i < 200000; ++i) {
+            coh::set(h, i % num_keys, CheckedValue{ i, ~i });
+        }
+
+        done.store(true);
+        for (auto &t : readers) {
+            t.join();
+        }
+
+        REQUIRE(bad_reads.load() == 0);
+        REQUIRE(coh::size(h) == num_keys);
+    }
+    fo::memory_globals::shutdown();
+}
+
+// Number of tables waiting for `reclaim_retired`
+static uint32_t num_retired(const hash_type &h) {
+    uint32_t n = 0;
+    for (auto t = h._retired; t; t = t->next_retired) {
+        ++n;
+    }
+    return n;
+}
+
+TEST_CASE("ConcurrentOpenHash remove/set churn", "[ConcurrentOpenHash_churn]") {
+    fo::memory_globals::init();
+    {
+        hash_type h{ fo::memory_globals::default_allocator(), 16, hash_u64, equal_u64 };
+
+        constexpr uint64_t live_keys = 512;
+        for (uint64_t k = 0; k < live_keys; ++k) {
+            coh::set(h, k, k * 7);
+        }
+        const uint32_t grown_retired = num_retired(h);
+        const uint32_t num_slots = h._table.load()->num_slots;
+
+        // A sliding window of keys. Their number stays the same, so the table neither grows nor retires more
+        // tables.
+        constexpr uint64_t steps = 200000;
+        for (uint64_t k = 0; k < steps; ++k) {
+            coh::remove(h, k);
+            coh::set(h, k + live_keys, (k + live_keys) * 7);
+        }
+        REQUIRE(num_retired(h) == grown_retired);
+        REQUIRE(h._table.load()->num_slots == num_slots);
+        REQUIRE(coh::size(h) == live_keys);
+
+        uint32_t bad = 0;
+        for (uint64_t k = steps; k < steps + live_keys; ++k) {
+            uint64_t v = 0;
+            bad += !coh::get(h, k, v) || v != k * 7;
+        }
+        for (uint64_t k = 0; k < steps; k += 97) {
+            bad += coh::has(h, k);
+        }
+        REQUIRE(bad == 0);
+
+        // Deleted slots have piled up. Once nothing is retired, the next insert clears them out.
+        REQUIRE(h._table.load()->num_deleted + live_keys + 1 >= num_slots / 2);
+        coh::reclaim_retired(h);
+        coh::set(h, uint64_t(steps + live_keys), uint64_t(1));
+        REQUIRE(num_retired(h) == 1);
+        REQUIRE(h._table.load()->num_slots == num_slots);
+        REQUIRE(h._table.load()->num_deleted == 0);
+        REQUIRE(coh::size(h) == live_keys + 1);
+    }
+    fo::memory_globals::shutdown();
+}
@@ -0,0 +1,180 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/concurrent_queue.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace fo;
+
+template <typename Q> static void check_single_threaded() {
+    Q q(memory_globals::default_allocator(), 5);
+    REQUIRE(capacity(q) == 8);
+    REQUIRE(size(q) == 0);
+
+    int item;
+    REQUIRE(!pop_front(q, item));
+
+    // Go around the ring a few times with batches that wrap
+    int next_push = 0;
+    int next_pop = 0;
+    for (u32 round = 0; round < 20; ++round) {
+        int items[5];
+        for (int &i : items) {
+            i = next_push++;
+        }
+        REQUIRE(push(q, items, 5) == 5);
+        REQUIRE(size(q) == 5);
+
+        int out[3];
+        REQUIRE(consume(q, out, 3) == 3);
+        for (int i : out) {
+            REQUIRE(i == next_pop++);
+        }
+        REQUIRE(consume(q, out, 3) == 2);
+        REQUIRE(out[0] == next_pop++);
+        REQUIRE(out[1] == next_pop++);
+        REQUIRE(size(q) == 0);
+    }
+
+    // Only what fits is pushed
+    int items[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    REQUIRE(push(q, items, 10) == 8);
+    REQUIRE(!push_back(q, 10));
+    REQUIRE(push(q, items, 3) == 0);
+    REQUIRE(pop_front(q, item));
+    REQUIRE(item == 0);
+    REQUIRE(push_back(q, 10));
+
+    int out[10];
+    REQUIRE(consume(q, out, 10) == 8);
+    REQUIRE(out[6] == 7);
+    REQUIRE(out[7] == 10);
+    REQUIRE(consume(q, out, 0) == 0);
+    REQUIRE(push(q, items, 0) == 0);
+}
+
+TEST_CASE("SpscQueue single threaded", "[SpscQueue]") {
+    memory_globals::init();
+    check_single_threaded<SpscQueue<int>>();
+    memory_globals::shutdown();
+}
+
+TEST_CASE("MpmcQueue single threaded", "[MpmcQueue]") {
+    memory_globals::init();
+    check_single_threaded<MpmcQueue<int>>();
+    memory_globals::shutdown();
+}
+
+TEST_CASE("SpscQueue keeps order across threads", "[SpscQueue_threads]") {
+    memory_globals::init();
+    {
+        constexpr u32 num_items = 200000;
+        SpscQueue<u32> q(memory_globals::default_allocator(), 64);
+
+        std::thread producer([&]() {
+            u32 batch[16];
+            u32 next = 0;
+            while (next < num_items) {
+                const u32 n = next % 16 + 1 < num_items - next ? next % 16 + 1 : num_items - next;
+                for (u32 i = 0; i < n; ++i) {
+                    batch[i] = next + i;
+                }
+                u32 pushed = 0;
+                while (pushed < n) {
+                    pushed += push(q, batch + pushed, n - pushed);
+                }
+                next += n;
+            }
+        });
+
+        // Catch's assertions are not thread-safe, so all the checking happens on this thread
+        u32 expected = 0;
+        bool in_order = true;
+        u32 out[7];
+        while (expected < num_items) {
+            const u32 n = consume(q, out, 7);
+            for (u32 i = 0; i < n; ++i) {
+                in_order = in_order && out[i] == expected;
+                ++expected;
+            }
+        }
+        producer.join();
+
+        REQUIRE(in_order);
+        REQUIRE(size(q) == 0);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("MpmcQueue delivers every item once", "[MpmcQueue_threads]") {
+    memory_globals::init();
+    {
+        constexpr u32 num_producers = 3;
+        constexpr u32 num_consumers = 3;
+        constexpr u32 items_per_producer = 100000;
+
+        MpmcQueue<u64> q(memory_globals::default_allocator(), 128);
+
+        // Items are the producer number in the high half and a counter in the low half
+        auto producer = [&](u64 id) {
+            u64 batch[8];
+            u32 next = 0;
+            while (next < items_per_producer) {
+                const u32 n = id + 1 < items_per_producer - next ? u32(id + 1) : items_per_producer - next;
+                for (u32 i = 0; i < n; ++i) {
+                    batch[i] = id << 32 | (next + i);
+                }
+                u32 pushed = 0;
+                while (pushed < n) {
+                    pushed += push(q, batch + pushed, n - pushed);
+                }
+                next += n;
+            }
+        };
+
+        std::atomic<u32> num_consumed(0);
+        std::vector<std::vector<u64>> consumed(num_consumers);
+
+        auto consumer = [&](u32 id) {
+            u64 out[5];
+            while (num_consumed.load() < num_producers * items_per_producer) {
+                const u32 n = consume(q, out, id % 2 == 0 ? 5 : 1);
+                consumed[id].insert(consumed[id].end(), out, out + n);
+                num_consumed += n;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (u32 i = 0; i < num_producers; ++i) {
+            threads.emplace_back(producer, u64(i));
+        }
+        for (u32 i = 0; i < num_consumers; ++i) {
+            threads.emplace_back(consumer, i);
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        // Each consumer sees any one producer's items in order, and all of them are seen exactly once
+        std::vector<u32> seen(num_producers * items_per_producer, 0);
+        for (auto &items : consumed) {
+            std::vector<i64> last(num_producers, -1);
+            for (u64 item : items) {
+                const u32 producer_id = u32(item >> 32);
+                const u32 counter = u32(item);
+                REQUIRE(producer_id < num_producers);
+                REQUIRE(i64(counter) > last[producer_id]);
+                last[producer_id] = counter;
+                ++seen[producer_id * items_per_producer + counter];
+            }
+        }
+        for (u32 s : seen) {
+            REQUIRE(s == 1);
+        }
+        REQUIRE(size(q) == 0);
+    }
+    memory_globals::shutdown();
+}
@@ -177,6 +177,66 @@ void test_multi_hash() {
     memory_globals::shutdown();
 }
 
+void test_hash_build_from() {
+    memory_globals::init();
+    {
+        Allocator &a = memory_globals::default_allocator();
+
+        const uint32_t n = 10000;
+        Array<uint64_t> keys(a, n);
+        Array<int> values(a, n);
+        for (uint32_t i = 0; i < n; ++i) {
+            keys[i] = uint64_t(i) * 37;
+            values[i] = int(i);
+        }
+
+        for (uint32_t num_threads = 1; num_threads <= 4; num_threads *= 2) {
+            Hash<int> h(a);
+            hash::set(h, 5, 5);
+            build_from(h, data(keys), data(values), n, num_threads);
+
+            ASSERT(size(h._data) == n);
+            ASSERT(!hash::has(h, 5));
+            for (uint32_t i = 0; i < n; ++i)
+                ASSERT(hash::get(h, keys[i], -1) == int(i));
+
+            // Still a normal table afterwards
+            hash::set(h, 1, 100);
+            hash::remove(h, 37);
+            ASSERT(hash::get(h, 1, 0) == 100);
+            ASSERT(!hash::has(h, 37));
+        }
+
+        // Enough keys to span several regions of the lookup table. Repeated keys keep their values in order.
+        const uint32_t n_big = 100000;
+        Array<uint64_t> big_keys(a, n_big);
+        Array<int> big_values(a, n_big);
+        for (uint32_t i = 0; i < n_big; ++i) {
+            big_keys[i] = uint64_t(i) * 2654435761u % (n_big / 4);
+            big_values[i] = int(i);
+        }
+
+        for (uint32_t num_threads = 1; num_threads <= 4; num_threads *= 2) {
+            Hash<int> h(a);
+            build_from(h, data(big_keys), data(big_values), n_big, num_threads);
+
+            ASSERT(size(h._data) == n_big);
+            for (uint64_t key = 0; key < n_big / 4; ++key) {
+                uint32_t count = 0;
+                int prev = -1;
+                for (auto e = multi_hash_find_first(h, key); e; e = find_next(h, e)) {
+                    ASSERT(big_keys[uint32_t(e->value)] == key);
+                    ASSERT(e->value > prev);
+                    prev = e->value;
+                    ++count;
+                }
+                ASSERT(count == 4);
+            }
+        }
+    }
+    memory_globals::shutdown();
+}
+
 void test_murmur_hash() {
     const char *s = "test_string";
     uint64_t h = murmur_hash_64(s, strlen(s), 0);
@@ -272,6 +332,7 @@ int main(int, char **) {
     /*test_arena();*/
     test_hash();
     test_multi_hash();
+    test_hash_build_from();
     test_murmur_hash();
     test_pointer_arithmetic();
     test_string_stream();
@@ -0,0 +1,240 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/array.h>
+#include <scaffold/jobs.h>
+#include <scaffold/temp_allocator.h>
+#include <scaffold/work_stealing_deque.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace fo;
+
+namespace wsd = fo::work_stealing_deque;
+
+TEST_CASE("WorkStealingDeque single threaded", "[WorkStealingDeque]") {
+    memory_globals::init();
+    {
+        WorkStealingDeque<u64> d(memory_globals::default_allocator(), 2);
+        u64 item;
+        REQUIRE(!wsd::pop(d, item));
+        REQUIRE(!wsd::steal(d, item));
+
+        // Grows past the initial capacity while items are stolen from the other end
+        for (u64 i = 0; i < 1000; ++i) {
+            wsd::push(d, i);
+            if (i % 3 == 0) {
+                REQUIRE(wsd::steal(d, item));
+                REQUIRE(item == i / 3);
+            }
+        }
+        REQUIRE(wsd::size(d) == 1000 - 334);
+
+        // The owner pops newest first
+        REQUIRE(wsd::pop(d, item));
+        REQUIRE(item == 999);
+        REQUIRE(wsd::pop(d, item));
+        REQUIRE(item == 998);
+
+        u32 count = 2;
+        while (wsd::pop(d, item)) {
+            ++count;
+        }
+        REQUIRE(count == 1000 - 334);
+        REQUIRE(wsd::size(d) == 0);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("WorkStealingDeque hands out every item once", "[WorkStealingDeque_threads]") {
+    memory_globals::init();
+    {
+        constexpr u32 num_items = 100000;
+        constexpr u32 num_thieves = 3;
+
+        WorkStealingDeque<u64> d(memory_globals::default_allocator(), 16);
+        std::vector<std::atomic<u32>> taken(num_items);
+        for (auto &t : taken) {
+            t.store(0);
+        }
+        std::atomic<bool> done(false);
+
+        auto thief = [&]() {
+            u64 item;
+            while (!done.load()) {
+                if (wsd::steal(d, item)) {
+                    ++taken[item];
+                }
+            }
+        };
+
+        std::vector<std::thread> thieves;
+        for (u32 i = 0; i < num_thieves; ++i) {
+            thieves.emplace_back(thief);
+        }
+
+        // Push in bursts and pop some back, so the owner and the thieves race for the last items
+        u64 item;
+        for (u64 i = 0; i < num_items; ++i) {
+            wsd::push(d, i);
+            if (i % 4 == 3 && wsd::pop(d, item)) {
+                ++taken[item];
+            }
+        }
+        while (wsd::pop(d, item)) {
+            ++taken[item];
+        }
+        done = true;
+        for (auto &t : thieves) {
+            t.join();
+        }
+
+        u32 bad = 0;
+        for (auto &t : taken) {
+            bad += t.load() != 1;
+        }
+        REQUIRE(bad == 0);
+    }
+    memory_globals::shutdown();
+}
+
+// Sums [begin, end) by forking a child job for the upper half until the range is small
+static void sum_range(u64 begin, u64 end, std::atomic<u64> &sum, jobs::Job *parent) {
+    while (end - begin > 64) {
+        const u64 mid = begin + (end - begin) / 2;
+        jobs::run(jobs::create([mid, end, &sum, parent]() { sum_range(mid, end, sum, parent); }, parent));
+        end = mid;
+    }
+    u64 s = 0;
+    for (u64 i = begin; i < end; ++i) {
+        s += i;
+    }
+    sum += s;
+}
+
+TEST_CASE("Jobs fork and join", "[jobs]") {
+    memory_globals::init();
+    jobs::InitConfig config;
+    config.num_workers = 3;
+    config.scratch_size = 1024;
+    jobs::init(config);
+    {
+        REQUIRE(jobs::num_threads() == 4);
+        REQUIRE(jobs::thread_index() == 0);
+
+        std::atomic<u64> sum(0);
+        jobs::Job *root = jobs::create_group();
+        jobs::run(jobs::create([&sum, root]() { sum_range(0, 100000, sum, root); }, root));
+        jobs::run(root);
+        jobs::wait(root);
+        REQUIRE(jobs::is_finished(root));
+        REQUIRE(sum.load() == u64(100000) * 99999 / 2);
+
+        // A parent doesn't finish before its children, even when it runs first
+        std::atomic<u32> children_done(0);
+        jobs::Job *parent = jobs::create([]() {});
+        for (u32 i = 0; i < 8; ++i) {
+            jobs::run(jobs::create(
+              [&children_done]() {
+                  std::this_thread::yield();
+                  ++children_done;
+              },
+              parent));
+        }
+        jobs::run(parent);
+        jobs::wait(parent);
+        REQUIRE(children_done.load() == 8);
+
+        // Waiting inside a job runs other jobs instead of blocking
+        std::atomic<u32> outer_done(0);
+        jobs::parallel_for(16, 1, [&](u32, u32) {
+            std::atomic<u32> inner(0);
+            jobs::parallel_for(100, 10, [&](u32 b, u32 e) { inner += e - b; });
+            if (inner.load() == 100) {
+                ++outer_done;
+            }
+        });
+        REQUIRE(outer_done.load() == 16);
+
+        // Each item visited once, from many threads
+        std::vector<std::atomic<u32>> visits(50000);
+        for (auto &v : visits) {
+            v.store(0);
+        }
+        std::atomic<u32> threads_seen(0);
+        jobs::parallel_for(50000, 100, [&](u32 begin, u32 end) {
+            threads_seen |= 1u << jobs::thread_index();
+            for (u32 i = begin; i < end; ++i) {
+                ++visits[i];
+            }
+        });
+        u32 bad = 0;
+        for (auto &v : visits) {
+            bad += v.load() != 1;
+        }
+        REQUIRE(bad == 0);
+        REQUIRE(threads_seen.load() != 0);
+    }
+    jobs::shutdown();
+    memory_globals::shutdown();
+}
+
+TEST_CASE("Jobs scratch memory", "[jobs_scratch]") {
+    memory_globals::init();
+    jobs::InitConfig config;
+    config.num_workers = 2;
+    config.scratch_size = 4096;
+    jobs::init(config);
+    {
+        // Arrays in scratch memory, some larger than the scratch buffer. Nothing is deallocated explicitly,
+        // the leak check at memory_globals::shutdown catches anything not released when the jobs return.
+        std::atomic<u32> good(0);
+        jobs::parallel_for(64, 1, [&](u32 begin, u32) {
+            Array<u32> a(jobs::scratch_allocator());
+            for (u32 i = 0; i < 100 + begin * 50; ++i) {
+                push_back(a, i);
+            }
+
+            TempAllocator128 ta(jobs::scratch_allocator());
+            Array<u64> b(ta);
+            resize(b, 1000);
+            b[999] = a[99];
+
+            void *big = jobs::scratch_allocator().allocate(10000, 64);
+            if (b[999] == 99 && size(a) == 100 + begin * 50 && uintptr_t(big) % 64 == 0) {
+                ++good;
+            }
+        });
+        REQUIRE(good.load() == 64);
+    }
+    jobs::shutdown();
+    memory_globals::shutdown();
+}
+
+// Counts the items of a parallel_for with one job per item, many more jobs than `max_jobs_per_thread`
+static void check_many_jobs(u32 num_workers, u32 max_jobs_per_thread, u32 n) {
+    jobs::InitConfig config;
+    config.num_workers = num_workers;
+    config.max_jobs_per_thread = max_jobs_per_thread;
+    config.scratch_size = 1024;
+    jobs::init(config);
+    {
+        std::atomic<u32> items(0);
+        jobs::parallel_for(n, 1, [&](u32 begin, u32 end) { items += end - begin; });
+        REQUIRE(items.load() == n);
+    }
+    jobs::shutdown();
+}
+
+TEST_CASE("Jobs outnumbering max_jobs_per_thread", "[jobs_many]") {
+    memory_globals::init();
+    {
+        // The root stays unfinished while the ring wraps around it many times
+        check_many_jobs(0, 4096, 5000);
+        check_many_jobs(0, 64, 100000);
+        check_many_jobs(3, 256, 100000);
+    }
+    memory_globals::shutdown();
+}
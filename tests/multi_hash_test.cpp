@@ -0,0 +1,107 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/multi_hash.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace fo;
+
+TEST_CASE("MultiHash insert get", "[MultiHash_insert_get]") {
+    memory_globals::init();
+    {
+        MultiHash<uint32_t> h(memory_globals::default_allocator());
+
+        REQUIRE(!multi_hash::has(h, 10));
+        REQUIRE(multi_hash::count(h, 10) == 0);
+        REQUIRE(size(multi_hash::get(h, 10)) == 0);
+
+        // Interleave the keys so that runs keep getting moved to the end of the pool as they grow
+        for (uint32_t i = 0; i < 1000; ++i) {
+            for (uint64_t key = 0; key < 10; ++key) {
+                if (i < key * 100) {
+                    multi_hash::insert(h, key, uint32_t(key * 10000 + i));
+                }
+            }
+        }
+
+        REQUIRE(multi_hash::num_keys(h) == 9);
+        REQUIRE(multi_hash::num_values(h) == 4500);
+
+        for (uint64_t key = 1; key < 10; ++key) {
+            REQUIRE(multi_hash::count(h, key) == key * 100);
+
+            // Values of a key are contiguous and keep their insertion order until something is removed
+            uint32_t i = 0;
+            for (uint32_t v : multi_hash::get(h, key)) {
+                REQUIRE(v == key * 10000 + i);
+                ++i;
+            }
+            REQUIRE(i == key * 100);
+        }
+
+        Array<uint32_t> items(memory_globals::default_allocator());
+        multi_hash::get(h, 3, items);
+        multi_hash::get(h, 5, items);
+        REQUIRE(size(items) == 800);
+        REQUIRE(items[0] == 30000);
+        REQUIRE(items[300] == 50000);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("MultiHash remove and compact", "[MultiHash_remove]") {
+    memory_globals::init();
+    {
+        MultiHash<uint64_t> h(memory_globals::default_allocator());
+        std::map<uint64_t, std::vector<uint64_t>> expected;
+
+        uint64_t x = 0x2545F4914F6CDD1Dull;
+        for (uint32_t i = 0; i < 20000; ++i) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+
+            const uint64_t key = x % 200;
+            auto &values = expected[key];
+
+            if (x % 7 == 0) {
+                multi_hash::remove_all(h, key);
+                values.clear();
+            } else if (x % 5 == 0 && !values.empty()) {
+                const uint32_t i = uint32_t((x >> 20) % values.size());
+                multi_hash::remove(h, key, i);
+                values[i] = values.back();
+                values.pop_back();
+            } else {
+                multi_hash::insert(h, key, x);
+                values.push_back(x);
+            }
+        }
+
+        // Removing and moving runs around must have triggered compaction at least once
+        REQUIRE(h._num_dead <= size(h._pool) / 2 + 64);
+
+        uint32_t total = 0;
+        for (auto &kv : expected) {
+            auto values = multi_hash::get(h, kv.first);
+            REQUIRE(size(values) == kv.second.size());
+            REQUIRE(std::equal(begin(values), end(values), kv.second.begin()));
+            REQUIRE(multi_hash::has(h, kv.first) == !kv.second.empty());
+            total += uint32_t(kv.second.size());
+        }
+        REQUIRE(multi_hash::num_values(h) == total);
+
+        multi_hash::compact(h);
+        REQUIRE(h._num_dead == 0);
+        REQUIRE(size(h._pool) == total);
+
+        for (auto &kv : expected) {
+            auto values = multi_hash::get(h, kv.first);
+            REQUIRE(std::equal(begin(values), end(values), kv.second.begin(), kv.second.end()));
+        }
+    }
+    memory_globals::shutdown();
+}
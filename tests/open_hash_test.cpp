@@ -2,6 +2,7 @@
 #include "catch.hpp"
 
 #include <iostream>
+#include <vector>
 #include <scaffold/open_hash.h>
 
 struct GetNilAndDeleted__uint64_t {
@@ -275,3 +276,145 @@ TEST_CASE("OpenHash iterator", "[OpenHash_iterator]") {
     }
     fo::memory_globals::shutdown();
 }
+
+TEST_CASE("OpenHash find_batch", "[OpenHash_find_batch]") {
+    fo::memory_globals::init();
+    {
+        auto &alloc = fo::memory_globals::default_allocator();
+
+        using hash_type = fo::OpenHash<uint64_t, uint64_t, GetNilAndDeleted__uint64_t>;
+
+        namespace open_hash = fo::open_hash;
+
+        hash_type h{ alloc,
+                     16,
+                     [](const auto &i) { return i & 0xffffffffu; },
+                     [](const auto &i, const auto &j) { return i == j; } };
+
+        for (uint64_t k = 0; k < 1024; ++k) {
+            open_hash::set(h, k * 3, k);
+        }
+
+        // Every third key is present. Use a count that isn't a multiple of the batch group size.
+        constexpr uint32_t count = 3 * 1024 + 5;
+        std::vector<uint64_t> keys(count);
+        std::vector<uint32_t> indices(count);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            keys[i] = count - i;
+        }
+
+        open_hash::find_batch(h, keys.data(), count, indices.data());
+
+        for (uint32_t i = 0; i < count; ++i) {
+            REQUIRE(indices[i] == open_hash::find(h, keys[i]));
+            if (keys[i] % 3 == 0 && keys[i] < 3 * 1024) {
+                REQUIRE(open_hash::value(h, indices[i]) == keys[i] / 3);
+            }
+        }
+    }
+    fo::memory_globals::shutdown();
+}
+
+TEST_CASE("OpenHash interleaved slots", "[OpenHash_interleaved]") {
+    fo::memory_globals::init();
+    {
+        auto &alloc = fo::memory_globals::default_allocator();
+
+        using hash_type = fo::OpenHash<uint64_t, uint32_t, GetNilAndDeleted__uint64_t, fo::open_hash::InterleavedSlots>;
+
+        namespace open_hash = fo::open_hash;
+
+        static_assert(hash_type::Slots::key_stride == 16, "Key and value share a 16 byte slot");
+
+        hash_type h{ alloc,
+                     16,
+                     [](const auto &i) { return i & 0xffffffffu; },
+                     [](const auto &i, const auto &j) { return i == j; } };
+
+        // Enough keys to go through a few rehashes
+        for (uint64_t k = 0; k < 4096; ++k) {
+            open_hash::set(h, k, uint32_t(k * 2));
+        }
+
+        for (uint64_t k = 0; k < 4096; k += 2) {
+            open_hash::remove(h, k);
+        }
+
+        for (uint64_t k = 0; k < 4096; ++k) {
+            auto i = open_hash::find(h, k);
+            if (k % 2 == 0) {
+                REQUIRE(i == open_hash::NOT_FOUND);
+            } else {
+                REQUIRE(i != open_hash::NOT_FOUND);
+                REQUIRE(open_hash::value(h, i) == k * 2);
+            }
+        }
+
+        uint32_t count = 0;
+        for (auto it = begin(h); it != end(h); ++it) {
+            REQUIRE((*it).key % 2 == 1);
+            REQUIRE((*it).value == (*it).key * 2);
+            ++count;
+        }
+        REQUIRE(count == 2048);
+
+        hash_type copy = h;
+        for (uint64_t k = 1; k < 4096; k += 2) {
+            REQUIRE(open_hash::must_value(copy, k) == k * 2);
+        }
+
+        std::vector<uint64_t> keys{ 1, 2, 3, 4095, 5000 };
+        std::vector<uint32_t> indices(keys.size());
+        open_hash::find_batch(h, keys.data(), uint32_t(keys.size()), indices.data());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            REQUIRE(indices[i] == open_hash::find(h, keys[i]));
+        }
+    }
+    fo::memory_globals::shutdown();
+}
+
+TEST_CASE("OpenHash build_from", "[OpenHash_build_from]") {
+    fo::memory_globals::init();
+    {
+        auto &alloc = fo::memory_globals::default_allocator();
+
+        using hash_type = fo::OpenHash<uint64_t, uint64_t, GetNilAndDeleted__uint64_t>;
+
+        namespace open_hash = fo::open_hash;
+
+        // Enough keys for a few build regions. The last key repeats the first one with another value.
+        constexpr uint32_t count = 100000;
+        std::vector<uint64_t> keys(count + 1);
+        std::vector<uint64_t> values(count + 1);
+        for (uint32_t i = 0; i < count; ++i) {
+            keys[i] = i * 7 + 10000;
+            values[i] = i;
+        }
+        keys[count] = keys[0];
+        values[count] = 42;
+
+        for (uint32_t num_threads : { 1, 4 }) {
+            hash_type h{ alloc,
+                         16,
+                         [](const auto &i) { return uint32_t(i * 0x9E3779B97F4A7C15ull >> 32); },
+                         [](const auto &i, const auto &j) { return i == j; } };
+            open_hash::set(h, uint64_t(1), uint64_t(1));
+
+            open_hash::build_from(h, keys.data(), values.data(), count + 1, num_threads);
+
+            REQUIRE(h._num_valid == count);
+            REQUIRE(open_hash::find(h, uint64_t(1)) == open_hash::NOT_FOUND);
+            REQUIRE(open_hash::must_value(h, keys[0]) == 42);
+            for (uint32_t i = 1; i < count; ++i) {
+                REQUIRE(open_hash::must_value(h, keys[i]) == i);
+            }
+
+            // Adding one more key must not need a rehash
+            const uint32_t num_slots = h._num_slots;
+            open_hash::set(h, uint64_t(3), uint64_t(3));
+            REQUIRE(h._num_slots == num_slots);
+        }
+    }
+    fo::memory_globals::shutdown();
+}
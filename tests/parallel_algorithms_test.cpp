@@ -0,0 +1,158 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/array.h>
+#include <scaffold/jobs.h>
+#include <scaffold/parallel_algorithms.h>
+#include <scaffold/temp_allocator.h>
+#include <scaffold/vector.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace fo;
+
+namespace {
+
+struct Keyed {
+    u32 key;
+    u32 order;
+};
+
+// Polynomial hash of a sequence, with the power of the multiplier so that two hashes combine associatively
+struct Hash {
+    u32 h;
+    u32 pow;
+};
+
+Hash combine(Hash x, Hash y) { return Hash{ x.h * y.pow + y.h, x.pow * y.pow }; }
+
+// Runs the same checks with the job system running and serially
+void check_algorithms(u32 n) {
+    std::mt19937 rng(n);
+
+    Array<u64> a;
+    resize(a, n);
+    for (u32 i = 0; i < n; ++i) {
+        a[i] = i;
+    }
+
+    parallel::for_each(a, [](u64 &x) { x *= 3; });
+    REQUIRE(parallel::reduce(a, u64(0), [](u64 x, u64 y) { return x + y; }) == u64(n) * (n - 1) / 2 * 3);
+
+    // Not commutative, so the items must be combined in order
+    Vector<Hash> digits;
+    resize(digits, n);
+    parallel::transform(data(a), n, data(digits), [](u64 x) { return Hash{ u32(x / 3 % 10), 31 }; });
+    const Hash hash = parallel::reduce(digits, Hash{ 0, 1 }, combine);
+    u32 expected_hash = 0;
+    for (u32 i = 0; i < n; ++i) {
+        expected_hash = expected_hash * 31 + i % 10;
+    }
+    REQUIRE(hash.h == expected_hash);
+
+    // Scans, including in place
+    std::vector<u64> expected(n);
+    std::vector<u64> in(n);
+    for (u32 i = 0; i < n; ++i) {
+        in[i] = rng() % 1000;
+    }
+    std::vector<u64> out(n);
+    auto plus = [](u64 x, u64 y) { return x + y; };
+    std::partial_sum(in.begin(), in.end(), expected.begin());
+    parallel::inclusive_scan(in.data(), n, out.data(), plus);
+    REQUIRE(out == expected);
+
+    u64 acc = 7;
+    for (u32 i = 0; i < n; ++i) {
+        expected[i] = acc;
+        acc += in[i];
+    }
+    out = in;
+    parallel::exclusive_scan(out.data(), n, out.data(), u64(7), plus);
+    REQUIRE(out == expected);
+
+    // Sorts
+    Array<i64> s;
+    resize(s, n);
+    for (u32 i = 0; i < n; ++i) {
+        s[i] = i64(rng()) - i64(rng());
+    }
+    std::vector<i64> sorted(begin(s), end(s));
+    std::sort(sorted.begin(), sorted.end());
+
+    Array<i64> s2 = s;
+    parallel::sort(s);
+    REQUIRE(std::equal(sorted.begin(), sorted.end(), begin(s)));
+    parallel::radix_sort(s2);
+    REQUIRE(std::equal(sorted.begin(), sorted.end(), begin(s2)));
+
+    // Both sorts are stable
+    Vector<Keyed> k;
+    resize(k, n);
+    for (u32 i = 0; i < n; ++i) {
+        k[i] = Keyed{ u32(rng() % 100), i };
+    }
+    Vector<Keyed> k2 = k;
+    parallel::sort(k, [](const Keyed &x, const Keyed &y) { return x.key < y.key; });
+    parallel::radix_sort_by_key(data(k2), n, [](const Keyed &x) { return x.key; });
+    u32 bad = 0;
+    for (u32 i = 1; i < n; ++i) {
+        bad += k[i - 1].key > k[i].key || (k[i - 1].key == k[i].key && k[i - 1].order > k[i].order);
+        bad += k[i].key != k2[i].key || k[i].order != k2[i].order;
+    }
+    REQUIRE(bad == 0);
+}
+
+} // namespace
+
+TEST_CASE("Parallel algorithms serially", "[parallel_serial]") {
+    memory_globals::init();
+    {
+        check_algorithms(0);
+        check_algorithms(1);
+        check_algorithms(1000);
+        check_algorithms(100000);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("Parallel algorithms on job threads", "[parallel]") {
+    memory_globals::init();
+    jobs::InitConfig config;
+    config.num_workers = 3;
+    jobs::init(config);
+    {
+        check_algorithms(0);
+        check_algorithms(1);
+        check_algorithms(1000);
+        // Uneven chunk counts, so merge rounds have a leftover run
+        check_algorithms(100000);
+        check_algorithms(300001);
+    }
+    jobs::shutdown();
+    memory_globals::shutdown();
+}
+
+TEST_CASE("Parallel algorithms with more chunks than jobs per thread", "[parallel_many_chunks]") {
+    memory_globals::init();
+    jobs::InitConfig config;
+    config.num_workers = 3;
+    config.max_jobs_per_thread = 16;
+    jobs::init(config);
+    {
+        check_algorithms(300001);
+
+        // The partials of reduce come from the given allocator, here a buffer with no backing allocator
+        Array<u64> a;
+        resize(a, 300001);
+        std::iota(begin(a), end(a), u64(0));
+        TempAllocator<1024> ta(TempAllocatorConfig::local_only());
+        const u64 sum = parallel::reduce(data(a), size(a), u64(0), [](u64 x, u64 y) { return x + y; }, ta);
+        REQUIRE(sum == u64(300001) * 300000 / 2);
+    }
+    jobs::shutdown();
+    memory_globals::shutdown();
+}
@@ -0,0 +1,119 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/perfect_hash.h>
+#include <scaffold/murmur_hash.h>
+
+#include <string.h>
+
+using namespace fo;
+
+TEST_CASE("PerfectHash build and find", "[PerfectHash]") {
+    memory_globals::init();
+    {
+        PerfectHash<uint64_t, uint32_t> h(memory_globals::default_allocator());
+        REQUIRE(perfect_hash::size(h) == 0);
+        REQUIRE(!perfect_hash::has(h, uint64_t(0)));
+
+        Array<uint64_t> keys(memory_globals::default_allocator());
+        Array<uint32_t> values(memory_globals::default_allocator());
+
+        // Clustered keys, like sequential ids, and a sprinkling of large ones
+        for (uint32_t i = 0; i < 50000; ++i) {
+            push_back(keys, i % 3 == 0 ? uint64_t(i) * uint64_t(0x100000001) : uint64_t(i) * 1024);
+            push_back(values, i);
+        }
+
+        REQUIRE(perfect_hash::build(h, keys, values));
+        REQUIRE(perfect_hash::size(h) == 50000);
+
+        // About 2.7 bits of metadata per key
+        REQUIRE(size(h._pilots) * 16 < 3 * size(keys));
+
+        for (uint32_t i = 0; i < size(keys); ++i) {
+            const uint32_t slot = perfect_hash::find(h, keys[i]);
+            REQUIRE(slot != perfect_hash::NOT_FOUND);
+            REQUIRE(perfect_hash::value(h, slot) == i);
+        }
+
+        // Keys not in the set, including ones that would land in unused slots
+        for (uint64_t k = 1; k < 20000; k += 2) {
+            REQUIRE(perfect_hash::get(h, k * 1024 + 1, 0xffffffffu) == 0xffffffffu);
+        }
+
+        // Rebuilding replaces the contents
+        resize(keys, 3);
+        resize(values, 3);
+        REQUIRE(perfect_hash::build(h, keys, values));
+        REQUIRE(perfect_hash::size(h) == 3);
+        REQUIRE(perfect_hash::get(h, keys[2], 100u) == 2);
+        REQUIRE(!perfect_hash::has(h, uint64_t(1024 * 4)));
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("PerfectHash with string hash keys", "[PerfectHash_string_hash]") {
+    memory_globals::init();
+    {
+        const auto string_hash = [](const char *s) { return murmur_hash_64(s, uint32_t(strlen(s)), 0xdeadbeef); };
+
+        const char *names[] = { "width", "height", "fullscreen", "vsync", "msaa", "gamma", "fov", "volume" };
+
+        Array<uint64_t> keys(memory_globals::default_allocator());
+        Array<uint32_t> values(memory_globals::default_allocator());
+        for (uint32_t i = 0; i < 8; ++i) {
+            push_back(keys, string_hash(names[i]));
+            push_back(values, i);
+        }
+
+        PerfectHash<uint64_t, uint32_t> h(memory_globals::default_allocator());
+        REQUIRE(perfect_hash::build(h, keys, values));
+
+        for (uint32_t i = 0; i < 8; ++i) {
+            REQUIRE(perfect_hash::get(h, string_hash(names[i]), 100u) == i);
+        }
+        REQUIRE(!perfect_hash::has(h, string_hash("brightness")));
+    }
+    memory_globals::shutdown();
+}
+
+namespace {
+
+enum class Opcode { ADD, SUB, MUL, DIV, LOAD, STORE, JUMP, CALL, RET };
+
+constexpr std::pair<const char *, Opcode> opcode_names[] = {
+    { "add", Opcode::ADD },   { "sub", Opcode::SUB },     { "mul", Opcode::MUL },
+    { "div", Opcode::DIV },   { "load", Opcode::LOAD },   { "store", Opcode::STORE },
+    { "jump", Opcode::JUMP }, { "call", Opcode::CALL },   { "ret", Opcode::RET },
+};
+
+constexpr auto opcodes = make_perfect_hash(opcode_names);
+
+static_assert(*perfect_hash::find(opcodes, "store") == Opcode::STORE, "");
+static_assert(perfect_hash::find(opcodes, "nop") == nullptr, "");
+
+constexpr std::pair<uint32_t, uint32_t> squares[] = { { 1, 1 }, { 2, 4 }, { 3, 9 }, { 10, 100 }, { 1000, 1000000 } };
+
+constexpr auto square_table = make_perfect_hash(squares);
+
+static_assert(*perfect_hash::find(square_table, 1000u) == 1000000, "");
+static_assert(perfect_hash::find(square_table, 4u) == nullptr, "");
+
+} // namespace
+
+TEST_CASE("ConstexprPerfectHash", "[ConstexprPerfectHash]") {
+    for (const auto &item : opcode_names) {
+        const Opcode *op = perfect_hash::find(opcodes, item.first);
+        REQUIRE(op != nullptr);
+        REQUIRE(*op == item.second);
+    }
+
+    // Looked up with a pointer that isn't the literal the table was built from
+    char name[] = "call";
+    REQUIRE(*perfect_hash::find(opcodes, (const char *)name) == Opcode::CALL);
+    REQUIRE(perfect_hash::find(opcodes, "calls") == nullptr);
+
+    for (const auto &item : squares) {
+        REQUIRE(*perfect_hash::find(square_table, item.first) == item.second);
+    }
+}
@@ -0,0 +1,249 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/persistent_map.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace fo;
+
+namespace {
+
+// Checks the red-black properties and subtree sizes. Returns the black height.
+template <typename Key, typename Value> u32 check_node(const PersistentNode<Key, Value> *n, u32 &count) {
+    if (!n) {
+        count = 0;
+        return 0;
+    }
+    REQUIRE(n->_refs.load() >= 1);
+    if (n->_red) {
+        REQUIRE(!persistent_internal::is_red(n->_childs[0]));
+        REQUIRE(!persistent_internal::is_red(n->_childs[1]));
+    }
+    u32 left_count, right_count;
+    const u32 left_bh = check_node(n->_childs[0], left_count);
+    const u32 right_bh = check_node(n->_childs[1], right_count);
+    REQUIRE(left_bh == right_bh);
+    count = left_count + right_count + 1;
+    REQUIRE(n->_count == count);
+    return left_bh + (n->_red ? 0 : 1);
+}
+
+template <typename Key, typename Value, typename Less>
+void check_tree(const PersistentMap<Key, Value, Less> &m) {
+    u32 count;
+    REQUIRE(check_node(m._root, count) == m._black_height);
+    REQUIRE(count == size(m));
+}
+
+template <typename Key, typename Value, typename Less>
+void check_same(const PersistentMap<Key, Value, Less> &m, const std::map<Key, Value> &expected) {
+    REQUIRE(size(m) == expected.size());
+    auto e = expected.begin();
+    for (auto &node : m) {
+        REQUIRE(node.k == e->first);
+        REQUIRE(node.v == e->second);
+        ++e;
+    }
+    REQUIRE(e == expected.end());
+}
+
+// Forwards to the default allocator, counting the calls.
+struct CountingAllocator : public Allocator {
+    u32 num_allocations = 0;
+    u32 num_deallocations = 0;
+
+    void *allocate(AddrUint size, AddrUint align = DEFAULT_ALIGN) override {
+        ++num_allocations;
+        return memory_globals::default_allocator().allocate(size, align);
+    }
+
+    void *reallocate(void *, AddrUint, AddrUint, AddrUint) override {
+        REQUIRE(false);
+        return nullptr;
+    }
+
+    void deallocate(void *p) override {
+        if (p) {
+            ++num_deallocations;
+        }
+        memory_globals::default_allocator().deallocate(p);
+    }
+
+    uint64_t allocated_size(void *p) override {
+        return memory_globals::default_allocator().allocated_size(p);
+    }
+
+    uint64_t total_allocated() override { return SIZE_NOT_TRACKED; }
+};
+
+} // namespace
+
+TEST_CASE("PersistentMap versions", "[PersistentMap]") {
+    memory_globals::init();
+    {
+        PersistentMap<u64, u64> m(memory_globals::default_allocator());
+        std::map<u64, u64> expected;
+
+        REQUIRE(get(m, u64(1)) == end(m));
+        REQUIRE(!remove(m, u64(1)));
+        REQUIRE(begin(m) == end(m));
+
+        std::vector<PersistentMap<u64, u64>> snapshots;
+        std::vector<std::map<u64, u64>> expected_snapshots;
+
+        u64 x = 0x2545F4914F6CDD1Dull;
+        for (u32 i = 0; i < 60000; ++i) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+
+            const u64 key = x % 4000;
+            if (x % 3 == 0) {
+                REQUIRE(remove(m, key) == (expected.erase(key) == 1));
+            } else {
+                set(m, key, x);
+                expected[key] = x;
+                REQUIRE(get(m, key)->v == x);
+            }
+
+            if (i % 5000 == 0) {
+                check_tree(m);
+                snapshots.push_back(m);
+                expected_snapshots.push_back(expected);
+            }
+        }
+
+        check_tree(m);
+        check_same(m, expected);
+
+        // Older versions are untouched
+        for (size_t i = 0; i < snapshots.size(); ++i) {
+            check_tree(snapshots[i]);
+            check_same(snapshots[i], expected_snapshots[i]);
+        }
+
+        auto lb = lower_bound(m, u64(1000));
+        auto e_lb = expected.lower_bound(1000);
+        for (; e_lb != expected.end(); ++e_lb, ++lb) {
+            REQUIRE(lb->k == e_lb->first);
+        }
+        REQUIRE(lb == end(m));
+
+        for (auto &kv : expected) {
+            REQUIRE(remove(m, kv.first));
+        }
+        REQUIRE(size(m) == 0);
+        REQUIRE(m._root == nullptr);
+        check_same(snapshots.back(), expected_snapshots.back());
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("PersistentMap allocations", "[PersistentMap_alloc]") {
+    memory_globals::init();
+    {
+        CountingAllocator a;
+        {
+            PersistentMap<u32, std::string> m(a);
+            for (u32 i = 0; i < 10000; ++i) {
+                set(m, i * 7919 % 10000, std::to_string(i));
+            }
+            check_tree(m);
+
+            // A new version takes O(log n) nodes, and a snapshot takes none
+            for (u32 i = 0; i < 100; ++i) {
+                const u32 before = a.num_allocations;
+                PersistentMap<u32, std::string> snapshot(m);
+                REQUIRE(a.num_allocations == before);
+
+                set(m, i * 31, std::string("changed"));
+                REQUIRE(a.num_allocations - before <= 2 * 14);
+                REQUIRE(get(snapshot, i * 31)->v != "changed");
+                REQUIRE(get(m, i * 31)->v == "changed");
+            }
+
+            // Nodes no version uses any more have been freed along the way
+            REQUIRE(a.num_allocations - a.num_deallocations == size(m));
+
+            PersistentMap<u32, std::string> copy(m);
+            clear(m);
+            REQUIRE(size(copy) == 10000);
+            check_tree(copy);
+        }
+        REQUIRE(a.num_allocations == a.num_deallocations);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("PersistentMap snapshots read on other threads", "[PersistentMap_threads]") {
+    memory_globals::init();
+    {
+        constexpr u32 num_keys = 1000;
+
+        // The writer moves amounts between keys, so every version sums to zero.
+        PersistentMap<u32, i64> published(memory_globals::default_allocator());
+        for (u32 k = 0; k < num_keys; ++k) {
+            set(published, k, i64(0));
+        }
+        std::mutex mutex;
+        bool done = false;
+
+        // Catch's assertions are not thread-safe, the readers just record whether they saw a bad version
+        std::atomic<bool> bad_version(false);
+
+        auto reader = [&]() {
+            u32 reads = 0;
+            while (true) {
+                PersistentMap<u32, i64> snapshot(memory_globals::default_allocator());
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done && reads > 0) {
+                        break;
+                    }
+                    snapshot = published;
+                }
+                i64 sum = 0;
+                for (auto &node : snapshot) {
+                    sum += node.v;
+                }
+                if (sum != 0 || size(snapshot) != num_keys) {
+                    bad_version = true;
+                }
+                ++reads;
+            }
+        };
+
+        std::thread readers[] = { std::thread(reader), std::thread(reader) };
+
+        PersistentMap<u32, i64> m(published);
+        u32 x = 12345;
+        for (u32 i = 0; i < 20000; ++i) {
+            x = x * 1103515245u + 12345u;
+            const u32 from = (x >> 8) % num_keys;
+            const u32 to = (x >> 20) % num_keys;
+            const i64 amount = x % 100;
+            set(m, from, get(m, from)->v - amount);
+            set(m, to, get(m, to)->v + amount);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            published = m;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        for (auto &t : readers) {
+            t.join();
+        }
+        REQUIRE(!bad_version);
+        check_tree(m);
+    }
+    memory_globals::shutdown();
+}
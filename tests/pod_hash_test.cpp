@@ -19,6 +19,15 @@ uint64_t Data_hash(const Data &d) { return murmur_hash_64(&d, sizeof(Data), 0xDE
 
 bool Data_equal(const Data &d1, const Data &d2) { return d1.id == d2.id && d1.hp == d2.hp && d1.mp == d2.mp; }
 
+static uint32_t hash_calls = 0;
+
+struct CountingHash {
+    uint32_t operator()(const uint64_t &k) const {
+        ++hash_calls;
+        return uint32_t(k * 0x9E3779B97F4A7C15ull >> 32);
+    }
+};
+
 int main() {
     Data D1 = {100lu, 100lu, 100lu};
     Data D2 = {201lu, 202lu, 203lu};
@@ -67,6 +76,24 @@ int main() {
             i++;
         }
 
+        {
+            // Batched lookup agrees with `get`, including keys that are not present.
+            Data keys[1100];
+            uint32_t indices[1100];
+            for (uint64_t i = 0; i < 1100; ++i) {
+                keys[i] = Data{i, i, i};
+            }
+            find_batch(h, keys, 1100, indices);
+            for (uint64_t i = 0; i < 1100; ++i) {
+                if (i < 1000) {
+                    assert(indices[i] != pod_hash_internal::END_OF_LIST);
+                    assert(begin(h) + indices[i] == get(h, keys[i]));
+                } else {
+                    assert(indices[i] == pod_hash_internal::END_OF_LIST);
+                }
+            }
+        }
+
         for (uint64_t i = 0; i < 1000; ++i) {
             Data d = {i, i, i};
             HashType::iterator res = get(h, d);
@@ -96,6 +123,120 @@ int main() {
             remove(h1, i);
         }
 
+        {
+            // Integer keys that all share their low bits, with removals interleaved with inserts, so that the
+            // index sees long runs and plenty of backward shifts.
+            using HashType3 = PodHash<uint64_t, uint64_t>;
+            HashType3 h3(memory_globals::default_allocator(),
+                         memory_globals::default_allocator(),
+                         ConvertToInt<uint64_t>(),
+                         CallEqualOperator<uint64_t>());
+
+            for (uint64_t i = 0; i < 10000; ++i) {
+                set(h3, i * 1024, i);
+                if (i % 3 == 0) {
+                    remove(h3, (i / 2) * 1024);
+                }
+            }
+
+            // Check against a plain array of what should be present
+            bool present[10000] = {};
+            for (uint64_t i = 0; i < 10000; ++i) {
+                present[i] = true;
+                if (i % 3 == 0) {
+                    present[i / 2] = false;
+                }
+            }
+
+            uint32_t count = 0;
+            for (uint64_t i = 0; i < 10000; ++i) {
+                auto it = get(h3, i * 1024);
+                if (present[i]) {
+                    assert(it != end(h3) && it->value == i);
+                    ++count;
+                } else {
+                    assert(it == end(h3));
+                }
+            }
+            assert(size(h3._entries) == count);
+
+            log_info("Max probe length with clustered keys: %u\n", max_chain_length(h3));
+        }
+
+        {
+            // Entries carry their hash, so growing the table or moving entries around on removal never calls
+            // the hash function. Only the lookups done by `set` and `remove` themselves do.
+            PodHash<uint64_t, uint64_t, CountingHash> h4(memory_globals::default_allocator(),
+                                                          memory_globals::default_allocator(),
+                                                          CountingHash(),
+                                                          CallEqualOperator<uint64_t>());
+            hash_calls = 0;
+            for (uint64_t i = 0; i < 5000; ++i) {
+                set(h4, i, i);
+            }
+            assert(hash_calls == 5000);
+
+            for (uint64_t i = 0; i < 5000; i += 2) {
+                remove(h4, i);
+            }
+            assert(hash_calls == 7500);
+            for (uint64_t i = 1; i < 5000; i += 2) {
+                assert(get(h4, i)->value == i);
+            }
+        }
+
+        {
+            // Even at a high load factor the index keeps an empty slot, so looking up missing keys ends.
+            PodHash<uint32_t, uint32_t> h6(memory_globals::default_allocator(),
+                                           memory_globals::default_allocator(),
+                                           ConvertToInt<uint32_t>(),
+                                           CallEqualOperator<uint32_t>());
+            set_load_factor(h6, 0.999f);
+            for (uint32_t i = 0; i < 1000; ++i) {
+                set(h6, i, i);
+                assert(size(h6._entries) < size(h6._index));
+                assert(!has(h6, 12345u + i));
+            }
+            for (uint32_t i = 0; i < 1000; ++i) {
+                assert(get(h6, i)->value == i);
+            }
+        }
+
+        {
+            // Bulk build agrees with a table built by `set`, duplicate keys taking their last value.
+            constexpr uint32_t count = 50000;
+            Array<uint64_t> keys(memory_globals::default_allocator(), count);
+            Array<uint64_t> values(memory_globals::default_allocator(), count);
+            for (uint32_t i = 0; i < count; ++i) {
+                keys[i] = (i * 2654435761u) % (count / 2);
+                values[i] = i;
+            }
+
+            PodHash<uint64_t, uint64_t> expected(memory_globals::default_allocator(),
+                                                 memory_globals::default_allocator(),
+                                                 ConvertToInt<uint64_t>(),
+                                                 CallEqualOperator<uint64_t>());
+            for (uint32_t i = 0; i < count; ++i) {
+                set(expected, keys[i], values[i]);
+            }
+
+            for (uint32_t num_threads = 1; num_threads <= 4; num_threads *= 4) {
+                PodHash<uint64_t, uint64_t> h5(memory_globals::default_allocator(),
+                                               memory_globals::default_allocator(),
+                                               ConvertToInt<uint64_t>(),
+                                               CallEqualOperator<uint64_t>());
+                set(h5, uint64_t(count), uint64_t(1));
+                build_from(h5, data(keys), data(values), count, num_threads);
+
+                assert(size(h5._entries) == size(expected._entries));
+                assert(!has(h5, uint64_t(count)));
+                for (const auto &e : expected) {
+                    assert(get(h5, e.key)->value == e.value);
+                }
+                assert(!pod_hash_internal::full(h5));
+            }
+        }
+
 #if 0
 
         HashType h2(
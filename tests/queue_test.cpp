@@ -1,4 +1,5 @@
 #include <scaffold/debug.h>
+#include <scaffold/magic_ring_queue.h>
 #include <scaffold/queue.h>
 
 #include <algorithm>
@@ -88,6 +89,98 @@ int main() {
 
         assert(ex.first_chunk_size + ex.second_chunk_size == 10);
         assert(ex.first_chunk_size == 6);
+
+        // Grows to powers of two
+        Queue<int> q4(memory_globals::default_allocator());
+        push_back(q4, 0);
+        assert(size(q4._data) == 8);
+        int items[20];
+        for (int i = 0; i < 20; ++i) {
+            items[i] = i + 1;
+        }
+        push(q4, items, 20);
+        assert(size(q4._data) == 32);
+        for (int i = 0; i < 21; ++i) {
+            assert(q4[i] == i);
+        }
+
+        // Wraps around an odd capacity at every position
+        Queue<int> q5(memory_globals::default_allocator());
+        reserve(q5, 7);
+        assert(space(q5) == 7);
+        for (int i = 0; i < 30; ++i) {
+            push(q5, items, 5);
+            push_front(q5, -1);
+            assert(size(q5) == 6);
+            assert(q5[0] == -1 && q5[5] == 5);
+            consume(q5, 6);
+        }
+        assert(size(q5._data) == 7);
+    }
+
+    {
+        MagicRingQueue<u64> q;
+        assert(size(q) == 0);
+
+        reserve(q, 10);
+        const u32 capacity = space(q);
+        assert(capacity >= 10);
+
+        // Move the front to near the end of the ring, then push past it
+        for (u32 i = 0; i < capacity - 3; ++i) {
+            push_back(q, u64(i));
+        }
+        consume(q, capacity - 3);
+
+        u64 items[10];
+        for (u32 i = 0; i < 10; ++i) {
+            items[i] = 100 + i;
+        }
+        push(q, items, 10);
+        assert(space(q) == capacity - 10);
+
+        // The wrapped items are contiguous
+        assert(end_front(q) - begin_front(q) == 10);
+        for (u32 i = 0; i < 10; ++i) {
+            assert(begin_front(q)[i] == 100 + i);
+            assert(q[i] == 100 + i);
+        }
+        auto ex = get_extent(q, 2, 8);
+        assert(ex.first_chunk_size == 8 && ex.second_chunk_size == 0);
+        assert(ex.first_chunk[7] == 109);
+
+        push_front(q, u64(99));
+        assert(q[0] == 99);
+        pop_back(q);
+        assert(q[size(q) - 1] == 108);
+
+        // Growing keeps the items in order
+        for (u32 i = 0; i < capacity; ++i) {
+            push_back(q, u64(1000 + i));
+        }
+        assert(space(q) != 0);
+        assert(q[0] == 99 && q[9] == 108 && q[10] == 1000);
+        assert(q[size(q) - 1] == 1000 + capacity - 1);
+
+        MagicRingQueue<u64> moved(std::move(q));
+        assert(size(moved) == 10 + capacity);
+        pop_front(moved);
+        assert(*begin_front(moved) == 100);
+
+        // Items whose size doesn't divide the page size
+        struct Odd {
+            u8 bytes[24];
+        };
+        MagicRingQueue<Odd> odd;
+        Odd o = {};
+        for (u32 i = 0; i < 1000; ++i) {
+            o.bytes[0] = u8(i);
+            push_back(odd, o);
+        }
+        for (u32 i = 0; i < 1000; ++i) {
+            assert(odd[i].bytes[0] == u8(i));
+        }
+        assert((end_front(odd) - begin_front(odd)) == 1000);
     }
 
     memory_globals::shutdown();
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <scaffold/ordered_map.h>
+#include <scaffold/rbt_set_ops.h>
 #include <scaffold/string_stream.h>
 #include <set>
 #include <string>
@@ -131,6 +134,7 @@ void test_must_have_each_key() {
     const char *file = SOURCE_DIR "/rbt_keys.txt";
     auto context = read_file_into_rbt(file);
     must_have_each_key(context);
+    assert(rbt::size(context.rbt) == context.map.size());
 
     std::set<u32> unique_keys(context.read_keys.begin(), context.read_keys.end());
 
@@ -148,6 +152,8 @@ void test_must_have_each_key() {
         }
     }
     must_have_each_key(context);
+    assert(rbt::size(context.rbt) == context.map.size());
+    assert(rbt::size(context.rbt) == rbt::count_nodes(context.rbt));
 
     printf("%s - success\n", __PRETTY_FUNCTION__);
 }
@@ -208,6 +214,7 @@ void test_copy_and_move() {
 
     // Copy assign rbt that was read from file
     copied_rbt = context.rbt;
+    assert(rbt::size(copied_rbt) == rbt::size(context.rbt));
 
     assert(rbt::get_const(copied_rbt, max_number + 100).i == end(copied_rbt));
     assert(rbt::get_const(copied_rbt, max_number + 200).i == end(copied_rbt));
@@ -266,6 +273,371 @@ void print_graph() {
     fclose(f);
 }
 
+void test_custom_less() {
+    OrderedMap<u32, u32, std::greater<u32>> m(memory_globals::default_allocator());
+
+    for (u32 i = 0; i < 1000; ++i) {
+        set(m, (i * 7919) % 1000, i);
+    }
+    assert(size(m) == 1000);
+
+    u32 expected = 999;
+    for (auto &node : m) {
+        assert(node.k == expected);
+        --expected;
+    }
+
+    for (u32 i = 0; i < 1000; i += 2) {
+        assert(remove(m, i));
+    }
+    assert(!remove(m, 0u));
+    assert(size(m) == 500);
+    assert(rbt::count_nodes(m._rbt) == 500);
+
+    rbt::clear(m._rbt);
+    assert(size(m) == 0);
+    assert(begin(m) == end(m));
+
+    set(m, 10u, 10u);
+    assert(size(m) == 1);
+
+    printf("%s - success\n", __PRETTY_FUNCTION__);
+}
+
+// Checks the subtree sizes kept in each node, returns the size of the subtree
+template <typename Key, typename T, typename Less>
+u32 check_counts(const rbt::RBTree<Key, T, Less> &t, const rbt::RBNode<Key, T> *n) {
+    if (rbt::is_nil_node(t, n)) {
+        assert(n->_count == 0);
+        return 0;
+    }
+    const u32 count = check_counts(t, n->_childs[rbt::LEFT]) + check_counts(t, n->_childs[rbt::RIGHT]) + 1;
+    assert(n->_count == count);
+    return count;
+}
+
+void test_bounds_and_rank() {
+    rbt::RBTree<u32, u32> t(memory_globals::default_allocator());
+    std::set<u32> expected;
+
+    u32 x = 0x12345678u;
+    for (u32 i = 0; i < 20000; ++i) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        const u32 key = (x % 4000) * 2;
+        if (x % 4 == 0) {
+            rbt::remove(t, key);
+            expected.erase(key);
+        } else {
+            rbt::set(t, key, key + 1);
+            expected.insert(key);
+        }
+    }
+
+    assert(check_counts(t, t._root) == expected.size());
+
+    const auto &ct = t;
+
+    for (u32 k = 0; k < 8010; ++k) {
+        auto lb = rbt::lower_bound(ct, k);
+        auto e_lb = expected.lower_bound(k);
+        assert((lb == end(ct)) == (e_lb == expected.end()));
+        if (e_lb != expected.end()) {
+            assert(lb->k == *e_lb);
+        }
+
+        auto ub = rbt::upper_bound(ct, k);
+        auto e_ub = expected.upper_bound(k);
+        assert((ub == end(ct)) == (e_ub == expected.end()));
+        if (e_ub != expected.end()) {
+            assert(ub->k == *e_ub);
+        }
+
+        assert(rbt::rank(ct, k) == u32(std::distance(expected.begin(), e_lb)));
+    }
+
+    u32 i = 0;
+    for (u32 k : expected) {
+        auto it = rbt::select(ct, i);
+        assert(it != end(ct));
+        assert(it->k == k);
+        ++i;
+    }
+    assert(rbt::select(ct, i) == end(ct));
+
+    u32 in_range = 0;
+    for (auto &node : rbt::range(t, 1000u, 2001u)) {
+        assert(node.k >= 1000 && node.k < 2001);
+        assert(node.v == node.k + 1);
+        ++in_range;
+    }
+    assert(in_range == u32(std::distance(expected.lower_bound(1000), expected.lower_bound(2001))));
+    assert(rbt::rank(ct, 2001u) - rbt::rank(ct, 1000u) == in_range);
+
+    // Counts must survive copying
+    rbt::RBTree<u32, u32> copy(t);
+    assert(check_counts(copy, copy._root) == expected.size());
+
+    printf("%s - success\n", __PRETTY_FUNCTION__);
+}
+
+// Checks the red-black properties, returns the black height of the subtree
+template <typename Key, typename T, typename Less>
+u32 check_black_height(const rbt::RBTree<Key, T, Less> &t, const rbt::RBNode<Key, T> *n) {
+    if (rbt::is_nil_node(t, n)) {
+        return 1;
+    }
+    for (u32 i = 0; i < 2; ++i) {
+        if (!rbt::is_nil_node(t, n->_childs[i])) {
+            assert(n->_childs[i]->_parent == n);
+            assert(n->_color == rbt::BLACK || n->_childs[i]->_color == rbt::BLACK);
+        }
+    }
+    const u32 left = check_black_height(t, n->_childs[rbt::LEFT]);
+    const u32 right = check_black_height(t, n->_childs[rbt::RIGHT]);
+    assert(left == right);
+    return left + (n->_color == rbt::BLACK ? 1 : 0);
+}
+
+void test_build_from_sorted() {
+    rbt::RBTree<u32, std::string> t(memory_globals::default_allocator());
+
+    std::vector<u32> keys;
+    std::vector<std::string> values;
+
+    for (u32 n = 0; n < 1100; n += (n < 70 ? 1 : 97)) {
+        keys.clear();
+        values.clear();
+        for (u32 i = 0; i < n; ++i) {
+            keys.push_back(i * 3);
+            values.push_back(std::to_string(i));
+        }
+
+        rbt::build_from_sorted(t, keys.data(), values.data(), n);
+
+        assert(rbt::size(t) == n);
+        assert(t._root->_color == rbt::BLACK);
+        assert(t._root->_parent == t._nil);
+        check_black_height(t, t._root);
+        assert(check_counts(t, t._root) == n);
+
+        // In key order and contiguous in memory
+        u32 i = 0;
+        const rbt::RBNode<u32, std::string> *prev = nullptr;
+        for (auto &node : t) {
+            assert(node.k == i * 3);
+            assert(node.v == std::to_string(i));
+            assert(prev == nullptr || prev + 1 == &node);
+            prev = &node;
+            ++i;
+        }
+        assert(i == n);
+
+        // Still a normal tree
+        rbt::set(t, 1u, std::string("one"));
+        rbt::remove(t, 0u);
+        check_black_height(t, t._root);
+        assert(rbt::size(t) == n + 1 - (n > 0 ? 1 : 0));
+        assert(rbt::get(t, 1u).i->v == "one");
+    }
+
+    OrderedMap<u32, u32> m(memory_globals::default_allocator());
+    const u32 m_keys[] = { 1, 2, 5, 8 };
+    const u32 m_values[] = { 10, 20, 50, 80 };
+    build_from_sorted(m, m_keys, m_values, 4);
+    assert(size(m) == 4);
+    assert(get(m, 5u)->v == 50);
+
+    printf("%s - success\n", __PRETTY_FUNCTION__);
+}
+
+void test_set_ops() {
+    using Tree = rbt::RBTree<u32, u32>;
+
+    u32 x = 0x9e3779b9u;
+    auto next_random = [&]() {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    };
+
+    // Values in `a` are key + 1 and in `b` key + 2, so we can tell which one a node came from
+    auto fill = [&](Tree &t, std::set<u32> &keys, u32 n, u32 key_range, u32 value_offset) {
+        for (u32 i = 0; i < n; ++i) {
+            const u32 k = next_random() % key_range;
+            rbt::set(t, k, k + value_offset);
+            keys.insert(k);
+        }
+    };
+
+    auto check = [](const Tree &t, const std::set<u32> &expected) {
+        assert(rbt::size(t) == expected.size());
+        assert(t._root->_color == rbt::BLACK);
+        check_black_height(t, t._root);
+        assert(check_counts(t, t._root) == expected.size());
+        auto it = expected.begin();
+        for (auto &node : t) {
+            assert(node.k == *it);
+            ++it;
+        }
+    };
+
+    const u32 sizes[][2] = { { 0, 0 },      { 0, 50 },       { 50, 0 },       { 1, 1 },
+                             { 100, 3 },    { 3, 100 },      { 500, 500 },    { 5000, 40 },
+                             { 40, 5000 },  { 3000, 3000 },  { 60000, 500 },  { 500, 60000 },
+                             { 50000, 50000 } };
+
+    for (u32 num_threads : { 1u, 4u }) {
+        for (auto &sz : sizes) {
+            const u32 key_range = (sz[0] + sz[1]) * 2 + 1;
+
+            Tree a(memory_globals::default_allocator());
+            Tree b(memory_globals::default_allocator());
+            std::set<u32> a_keys, b_keys;
+            fill(a, a_keys, sz[0], key_range, 1);
+            fill(b, b_keys, sz[1], key_range, 2);
+
+            std::set<u32> expected;
+
+            Tree u(a);
+            rbt::set_union(u, b, num_threads);
+            std::set_union(a_keys.begin(), a_keys.end(), b_keys.begin(), b_keys.end(),
+                           std::inserter(expected, expected.end()));
+            check(u, expected);
+            for (auto &node : u) {
+                assert(node.v == node.k + (a_keys.count(node.k) ? 1 : 2));
+            }
+
+            expected.clear();
+            Tree i(a);
+            rbt::set_intersection(i, b, num_threads);
+            std::set_intersection(a_keys.begin(), a_keys.end(), b_keys.begin(), b_keys.end(),
+                                  std::inserter(expected, expected.end()));
+            check(i, expected);
+            for (auto &node : i) {
+                assert(node.v == node.k + 1);
+            }
+
+            expected.clear();
+            Tree d(a);
+            rbt::set_difference(d, b, num_threads);
+            std::set_difference(a_keys.begin(), a_keys.end(), b_keys.begin(), b_keys.end(),
+                                std::inserter(expected, expected.end()));
+            check(d, expected);
+
+            // The results are ordinary trees
+            rbt::set(d, key_range + 1, 0u);
+            rbt::remove(d, key_range + 1);
+            check(d, expected);
+        }
+    }
+
+    // A tree with itself
+    Tree a(memory_globals::default_allocator());
+    std::set<u32> a_keys;
+    fill(a, a_keys, 100, 1000, 1);
+    rbt::set_union(a, a);
+    rbt::set_intersection(a, a);
+    check(a, a_keys);
+    rbt::set_difference(a, a);
+    check(a, {});
+
+    // OrderedMap
+    OrderedMap<std::string, u32> m1(memory_globals::default_allocator());
+    OrderedMap<std::string, u32> m2(memory_globals::default_allocator());
+    m1["apple"] = 1;
+    m1["pear"] = 2;
+    m2["pear"] = 3;
+    m2["plum"] = 4;
+    set_union(m1, m2);
+    assert(size(m1) == 3);
+    assert(get(m1, std::string("pear"))->v == 2);
+    set_difference(m1, m2);
+    assert(size(m1) == 1);
+    assert(get(m1, std::string("apple"))->v == 1);
+
+    printf("%s - success\n", __PRETTY_FUNCTION__);
+}
+
+// Forwards to the default allocator, counting the calls.
+struct CountingAllocator : public Allocator {
+    u32 num_allocations = 0;
+    u32 num_deallocations = 0;
+
+    void *allocate(AddrUint size, AddrUint align = DEFAULT_ALIGN) override {
+        ++num_allocations;
+        return memory_globals::default_allocator().allocate(size, align);
+    }
+
+    void *reallocate(void *, AddrUint, AddrUint, AddrUint) override {
+        assert(false);
+        return nullptr;
+    }
+
+    void deallocate(void *p) override {
+        if (p) {
+            ++num_deallocations;
+        }
+        memory_globals::default_allocator().deallocate(p);
+    }
+
+    uint64_t allocated_size(void *p) override {
+        return memory_globals::default_allocator().allocated_size(p);
+    }
+
+    uint64_t total_allocated() override { return SIZE_NOT_TRACKED; }
+};
+
+void test_node_pool() {
+    CountingAllocator a;
+
+    {
+        rbt::RBTree<u32, std::string> t(a);
+        const u32 allocations_before = a.num_allocations;
+
+        for (u32 i = 0; i < 10000; ++i) {
+            rbt::set(t, i, std::to_string(i));
+        }
+        const u32 chunks = a.num_allocations - allocations_before;
+        assert(chunks < 10000 / 64);
+
+        // Removed nodes get reused
+        for (u32 i = 0; i < 10000; i += 2) {
+            rbt::remove(t, i);
+        }
+        for (u32 i = 0; i < 10000; i += 2) {
+            rbt::set(t, i, std::to_string(i));
+        }
+        assert(a.num_allocations - allocations_before == chunks);
+        assert(rbt::size(t) == 10000);
+
+        for (u32 i = 0; i < 10000; ++i) {
+            assert(rbt::get(t, i).i->v == std::to_string(i));
+        }
+
+        // Clearing returns the chunks, one deallocation each
+        const u32 deallocations_before = a.num_deallocations;
+        rbt::clear(t);
+        assert(a.num_deallocations - deallocations_before == chunks);
+        assert(rbt::size(t) == 0);
+        assert(begin(t) == end(t));
+
+        rbt::set(t, 5u, std::string("five"));
+        assert(rbt::get(t, 5u).i->v == "five");
+
+        // The moved-to tree owns the chunks now
+        rbt::RBTree<u32, std::string> moved(std::move(t));
+        assert(rbt::get(moved, 5u).i->v == "five");
+    }
+
+    assert(a.num_allocations == a.num_deallocations);
+
+    printf("%s - success\n", __PRETTY_FUNCTION__);
+}
+
 void ordered_map_test() {
     // OrderedMap tests
     using Map = OrderedMap<std::string, unsigned>;
@@ -287,6 +659,8 @@ void ordered_map_test() {
         count = count + 1;
     }
 
+    assert(size(word_count) == 6);
+
     for (auto s = cbegin(word_count), e = cend(word_count); s != e; ++s) {
         printf("count[%s] = %u\n", s->k.c_str(), s->v);
     }
@@ -299,6 +673,11 @@ int main() {
         print_graph();
         test_iterators_sorted();
         test_copy_and_move();
+        test_custom_less();
+        test_bounds_and_rank();
+        test_node_pool();
+        test_build_from_sorted();
+        test_set_ops();
 
         ordered_map_test();
     }
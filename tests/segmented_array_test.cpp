@@ -0,0 +1,112 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/jobs.h>
+#include <scaffold/pool_allocator.h>
+#include <scaffold/segmented_array.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace fo;
+
+TEST_CASE("SegmentedArray items stay in place", "[SegmentedArray]") {
+    memory_globals::init();
+    {
+        // 16 items per chunk, to cross many chunk boundaries
+        SegmentedArray<u64, 4> a;
+        REQUIRE(a.CHUNK_ITEMS == 16);
+        REQUIRE(empty(a));
+
+        std::vector<const u64 *> addresses;
+        for (u64 i = 0; i < 1000; ++i) {
+            addresses.push_back(&push_back(a, i * 3));
+        }
+        REQUIRE(size(a) == 1000);
+        REQUIRE(num_chunks(a) == 63);
+        REQUIRE(capacity(a) == 63 * 16);
+
+        u32 bad = 0;
+        for (u32 i = 0; i < 1000; ++i) {
+            bad += a[i] != i * 3 || &a[i] != addresses[i];
+        }
+        REQUIRE(bad == 0);
+        REQUIRE(front(a) == 0);
+        REQUIRE(back(a) == 999 * 3);
+
+        // Chunks cover the items in order, all full but the last
+        u32 next = 0;
+        for_each_chunk(a, [&](u64 *items, u32 count, u32 first) {
+            REQUIRE(first == next);
+            REQUIRE((count == 16 || first + count == 1000));
+            for (u32 i = 0; i < count; ++i) {
+                bad += items[i] != (first + i) * 3;
+            }
+            next += count;
+        });
+        REQUIRE(next == 1000);
+        REQUIRE(bad == 0);
+        REQUIRE(chunk_size(a, 62) == 1000 - 62 * 16);
+
+        // Shrinking keeps the chunks until trimmed
+        resize(a, 40);
+        REQUIRE(capacity(a) == 63 * 16);
+        trim(a);
+        REQUIRE(capacity(a) == 3 * 16);
+        REQUIRE(a[39] == 39 * 3);
+
+        resize(a, 100);
+#ifndef NDEBUG
+        REQUIRE(a[99] == 0);
+#endif
+        pop_back(a);
+        REQUIRE(size(a) == 99);
+
+        SegmentedArray<u64, 4> b = std::move(a);
+        REQUIRE(size(a) == 0);
+        REQUIRE(b[39] == 39 * 3);
+
+        clear(b);
+        REQUIRE(empty(b));
+        REQUIRE(capacity(b) != 0);
+        free(b);
+        REQUIRE(capacity(b) == 0);
+        push_back(b, u64(5));
+        REQUIRE(b[0] == 5);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("SegmentedArray with pooled chunks", "[SegmentedArray_pool]") {
+    memory_globals::init();
+    {
+        using Segmented = SegmentedArray<u32>;
+        PoolAllocator pool(Segmented::CHUNK_BYTES, 8);
+        REQUIRE(Segmented::CHUNK_BYTES == 64 * 1024);
+
+        // Filled from several threads, a chunk each
+        jobs::InitConfig config;
+        config.num_workers = 3;
+        jobs::init(config);
+        {
+            Segmented a(pool);
+            resize(a, 20 * Segmented::CHUNK_ITEMS + 5);
+            jobs::parallel_for(num_chunks(a), 1, [&](u32 begin, u32 end) {
+                for (u32 c = begin; c < end; ++c) {
+                    u32 *items = chunk_data(a, c);
+                    for (u32 i = 0; i < chunk_size(a, c); ++i) {
+                        items[i] = c * Segmented::CHUNK_ITEMS + i;
+                    }
+                }
+            });
+
+            u32 bad = 0;
+            for (u32 i = 0; i < size(a); ++i) {
+                bad += a[i] != i;
+            }
+            REQUIRE(bad == 0);
+        }
+        jobs::shutdown();
+    }
+    memory_globals::shutdown();
+}
@@ -0,0 +1,107 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/slot_map.h>
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace fo;
+
+TEST_CASE("SlotMap handles", "[SlotMap]") {
+    memory_globals::init();
+    {
+        SlotMap<u64> m;
+        REQUIRE(size(m) == 0);
+        REQUIRE(!has(m, SlotHandle{ 0, 0 }));
+
+        const SlotHandle a = insert(m, u64(10));
+        const SlotHandle b = insert(m, u64(20));
+        const SlotHandle c = insert(m, u64(30));
+        REQUIRE(size(m) == 3);
+        REQUIRE(*get(m, a) == 10);
+        REQUIRE(*get(m, b) == 20);
+        REQUIRE(*get(m, c) == 30);
+
+        // Removing from the middle moves the last value, handles still work
+        REQUIRE(remove(m, a));
+        REQUIRE(!remove(m, a));
+        REQUIRE(get(m, a) == nullptr);
+        REQUIRE(*get(m, b) == 20);
+        REQUIRE(*get(m, c) == 30);
+        REQUIRE(size(m) == 2);
+
+        // The freed slot is reused with a new generation, the old handle stays stale
+        const SlotHandle d = insert(m, u64(40));
+        REQUIRE(d._index == a._index);
+        REQUIRE(d != a);
+        REQUIRE(!has(m, a));
+        REQUIRE(*get(m, d) == 40);
+
+        // The packed values and their handles
+        u64 sum = 0;
+        for (u64 v : m) {
+            sum += v;
+        }
+        REQUIRE(sum == 90);
+        for (u32 i = 0; i < size(m); ++i) {
+            REQUIRE(*get(m, handle_at(m, i)) == m._values[i]);
+        }
+
+        clear(m);
+        REQUIRE(size(m) == 0);
+        REQUIRE(!has(m, b));
+        REQUIRE(!has(m, c));
+        REQUIRE(!has(m, d));
+        const SlotHandle e = insert(m, u64(50));
+        REQUIRE(*get(m, e) == 50);
+        REQUIRE(size(m._slots) == 3);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("SlotMap random operations", "[SlotMap_random]") {
+    memory_globals::init();
+    {
+        SlotMap<u32> m;
+        reserve(m, 100);
+        std::vector<SlotHandle> live;
+        std::vector<SlotHandle> dead;
+        std::unordered_map<u64, u32> expected;
+        auto key = [](SlotHandle h) { return u64(h._index) << 32 | h._generation; };
+
+        std::mt19937 rng(7);
+        for (u32 step = 0; step < 20000; ++step) {
+            if (live.empty() || rng() % 3 != 0) {
+                const u32 value = rng();
+                const SlotHandle h = insert(m, value);
+                live.push_back(h);
+                expected[key(h)] = value;
+            } else {
+                const u32 i = rng() % live.size();
+                const SlotHandle h = live[i];
+                REQUIRE(remove(m, h));
+                live[i] = live.back();
+                live.pop_back();
+                dead.push_back(h);
+                expected.erase(key(h));
+            }
+        }
+
+        REQUIRE(size(m) == live.size());
+        u32 bad = 0;
+        for (SlotHandle h : live) {
+            const u32 *v = get(m, h);
+            bad += v == nullptr || *v != expected[key(h)];
+        }
+        for (SlotHandle h : dead) {
+            bad += has(m, h);
+        }
+        REQUIRE(bad == 0);
+
+        // Slots are reused, so the sparse array only grows to the peak number of values
+        REQUIRE(size(m._slots) < 20000);
+    }
+    memory_globals::shutdown();
+}
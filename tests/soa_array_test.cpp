@@ -0,0 +1,133 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <scaffold/array.h>
+#include <scaffold/soa_array.h>
+
+#include <algorithm>
+#include <numeric>
+
+using namespace fo;
+
+namespace {
+
+struct Vec3 {
+    float x, y, z;
+};
+
+// Written against Array, used on a column view too
+template <typename Items> float sum_items(const Items &items) {
+    float s = 0.0f;
+    for (u32 i = 0; i < size(items); ++i) {
+        s += items[i];
+    }
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("SoAArray rows and columns", "[SoAArray]") {
+    memory_globals::init();
+    {
+        SoAArray<Vec3, float, u8> a;
+        REQUIRE(empty(a));
+
+        for (u32 i = 0; i < 1000; ++i) {
+            push_back(a, Vec3{ float(i), 0.0f, 0.0f }, float(i) * 2.0f, u8(i));
+        }
+        REQUIRE(size(a) == 1000);
+        REQUIRE(capacity(a) >= 1000);
+
+        // Every column is aligned, and they don't overlap
+        REQUIRE(uintptr_t(column<0>(a)) % 64 == 0);
+        REQUIRE(uintptr_t(column<1>(a)) % 64 == 0);
+        REQUIRE(uintptr_t(column<2>(a)) % 64 == 0);
+        REQUIRE((u8 *)column<1>(a) >= (u8 *)(column<0>(a) + capacity(a)));
+        REQUIRE((u8 *)column<2>(a) >= (u8 *)(column<1>(a) + capacity(a)));
+
+        for (u32 i = 0; i < 1000; ++i) {
+            REQUIRE(column<0>(a)[i].x == float(i));
+            REQUIRE(column<1>(a)[i] == float(i) * 2.0f);
+            REQUIRE(column<2>(a)[i] == u8(i));
+        }
+
+        // Views work like an Array of the field
+        auto weights = view<1>(a);
+        Array<float> copy;
+        resize(copy, size(weights));
+        std::copy(begin(weights), end(weights), begin(copy));
+        REQUIRE(sum_items(weights) == sum_items(copy));
+        REQUIRE(front(weights) == 0.0f);
+        REQUIRE(back(weights) == 1998.0f);
+
+        for (auto &w : view<1>(a)) {
+            w = 1.0f;
+        }
+        REQUIRE(sum_items(view<1>(a)) == 1000.0f);
+
+        // swap_remove moves the last row into the hole
+        swap_remove(a, 10);
+        REQUIRE(size(a) == 999);
+        REQUIRE(column<0>(a)[10].x == 999.0f);
+        REQUIRE(column<2>(a)[10] == u8(999));
+        swap_remove(a, 998);
+        REQUIRE(size(a) == 998);
+        REQUIRE(column<0>(a)[997].x == 997.0f);
+
+        pop_back(a);
+        REQUIRE(size(a) == 997);
+    }
+    memory_globals::shutdown();
+}
+
+TEST_CASE("SoAArray capacity, copy and move", "[SoAArray_capacity]") {
+    memory_globals::init();
+    {
+        SoAArray<u64, u16> a;
+        resize(a, 100);
+        std::iota(column<0>(a), column<0>(a) + 100, u64(0));
+#ifndef NDEBUG
+        REQUIRE(std::all_of(begin(view<1>(a)), end(view<1>(a)), [](u16 x) { return x == 0; }));
+#endif
+
+        // Growing and trimming keep the rows
+        reserve(a, 5000);
+        REQUIRE(capacity(a) == 5000);
+        trim(a);
+        REQUIRE(capacity(a) == 100);
+        REQUIRE(column<0>(a)[99] == 99);
+
+        SoAArray<u64, u16> b = a;
+        REQUIRE(size(b) == 100);
+        REQUIRE(column<0>(b) != column<0>(a));
+        REQUIRE(column<0>(b)[42] == 42);
+
+        SoAArray<u64, u16> c = std::move(b);
+        REQUIRE(size(b) == 0);
+        REQUIRE(column<0>(c)[42] == 42);
+
+        b = c;
+        push_back(b, u64(7), u16(8));
+        REQUIRE(size(b) == 101);
+        REQUIRE(size(c) == 100);
+
+        c = std::move(b);
+        REQUIRE(size(c) == 101);
+        REQUIRE(column<1>(c)[100] == 8);
+
+        // Shrinking drops the rows past the capacity
+        set_capacity(c, 10);
+        REQUIRE(size(c) == 10);
+        REQUIRE(column<0>(c)[9] == 9);
+
+        free(c);
+        REQUIRE(size(c) == 0);
+        REQUIRE(capacity(c) == 0);
+        push_back(c, u64(1), u16(2));
+        REQUIRE(column<1>(c)[0] == 2);
+
+        clear(c);
+        REQUIRE(empty(c));
+    }
+    memory_globals::shutdown();
+}
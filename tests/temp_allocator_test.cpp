@@ -29,5 +29,38 @@ int main() {
         assert(std::all_of(arr.begin(), arr.end(),
                            [](auto x) { return x == 0xcafebab1; }));
     }
+    {
+        // The last allocation grows in place while the region has room
+        TempAllocator1024 ta;
+        Array<u32> arr{ta};
+        reserve(arr, 16);
+        const u32 *first = data(arr);
+        for (u32 i = 0; i < 16; ++i) {
+            push_back(arr, i);
+        }
+        reserve(arr, 128);
+        assert(data(arr) == first);
+
+        // Not anymore once something else is allocated after it
+        Array<u32> other{ta};
+        push_back(other, 1u);
+        reserve(arr, 200);
+        assert(data(arr) != first);
+        for (u32 i = 0; i < 16; ++i) {
+            assert(arr[i] == i);
+        }
+    }
+    {
+        // Nor when the allocation isn't aligned as the new alignment asks
+        TempAllocator1024 ta;
+        u32 *p = (u32 *)ta.allocate(sizeof(u32), alignof(u32));
+        if (uintptr_t(p) % 64 == 0) {
+            p = (u32 *)ta.allocate(sizeof(u32), alignof(u32));
+        }
+        *p = 0xcafe;
+        u32 *q = (u32 *)ta.reallocate(p, sizeof(u32) * 2, 64, sizeof(u32));
+        assert(uintptr_t(q) % 64 == 0);
+        assert(*q == 0xcafe);
+    }
     memory_globals::shutdown();
 }
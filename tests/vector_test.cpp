@@ -1,5 +1,7 @@
 #include <scaffold/vector.h>
 #include <scaffold/temp_allocator.h>
+
+#include <assert.h>
 #include <time.h>
 
 struct PodType {
@@ -38,5 +40,32 @@ int main() {
     	fo::push_back(v, 1);
     }
 
+    {
+        // Growing through reallocate keeps the elements, from small blocks to ones large enough to be mmapped
+        fo::Vector<uint64_t> v;
+        for (uint64_t i = 0; i < (1u << 20); ++i) {
+            fo::push_back(v, i * 7);
+            assert(uintptr_t(fo::data(v)) % 16 == 0);
+        }
+        for (uint64_t i = 0; i < (1u << 20); ++i) {
+            assert(v[i] == i * 7);
+        }
+
+        // Over-aligned blocks stay aligned when realloc returns a block with another alignment
+        auto &a = fo::memory_globals::default_allocator();
+        auto p = (uint64_t *)a.allocate(100 * sizeof(uint64_t), 256);
+        for (uint64_t i = 0; i < 100; ++i) {
+            p[i] = i;
+        }
+        for (uint64_t size = 200; size < (1u << 22); size = size * 3 / 2) {
+            p = (uint64_t *)a.reallocate(p, size * sizeof(uint64_t), 256);
+            assert(uintptr_t(p) % 256 == 0);
+            for (uint64_t i = 0; i < 100; ++i) {
+                assert(p[i] == i);
+            }
+        }
+        a.deallocate(p);
+    }
+
     fo::memory_globals::shutdown();
 }
\ No newline at end of file